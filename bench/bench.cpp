@@ -0,0 +1,39 @@
+#include "bench.hpp"
+#include <iomanip>
+
+namespace triarb::bench {
+
+void Runner::write_table(std::ostream& out) const
+{
+    out << std::left << std::setw(36) << "benchmark" << std::right
+        << std::setw(12) << "mean ns" << std::setw(12) << "median ns"
+        << std::setw(12) << "p99 ns" << std::setw(12) << "min ns" << "\n";
+    out << std::fixed << std::setprecision(1);
+    for (const auto& r : results_)
+        out << std::left << std::setw(36) << r.name << std::right
+            << std::setw(12) << r.mean_ns << std::setw(12) << r.median_ns
+            << std::setw(12) << r.p99_ns << std::setw(12) << r.min_ns << "\n";
+}
+
+void Runner::write_json(std::ostream& out,
+                        const std::vector<std::pair<std::string, std::string>>& context) const
+{
+    out << std::fixed << std::setprecision(2);
+    out << "{\n  \"context\": {";
+    for (std::size_t i = 0; i < context.size(); ++i)
+        out << (i ? ", " : "") << '"' << context[i].first << "\": \"" << context[i].second << '"';
+    out << "},\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < results_.size(); ++i) {
+        const auto& r = results_[i];
+        out << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\""
+            << ", \"iterations\": " << r.iterations
+            << ", \"batch\": " << r.batch
+            << ", \"mean_ns\": " << r.mean_ns
+            << ", \"median_ns\": " << r.median_ns
+            << ", \"p99_ns\": " << r.p99_ns
+            << ", \"min_ns\": " << r.min_ns << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace triarb::bench
@@ -0,0 +1,124 @@
+#pragma once
+#include "latency.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace triarb::bench {
+
+/// Keeps the compiler from discarding a value the benchmark computes.
+template <class T>
+inline void keep(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/// Timing of one benchmark, per operation.
+struct Result {
+    std::string   name;
+    std::uint64_t iterations = 0;    // operations timed in total
+    std::uint64_t batch      = 0;    // operations per sample
+    double mean_ns   = 0;
+    double median_ns = 0;
+    double p99_ns    = 0;
+    double min_ns    = 0;
+};
+
+/* Benchmark Runner
+ * ----------------
+ * Times `fn(i)` for i = 0, 1, 2, ...: after a short warm-up the batch size
+ * is doubled until one batch takes at least the target sample time, then
+ * `samples` batches are timed and every sample is divided by the batch
+ * size.  Mean, median, p99 and min of those per-operation times are kept.
+ *
+ * The index lets a benchmark cycle through its inputs (captured frames,
+ * books) so a single hot input does not flatter the result.
+ */
+class Runner
+{
+    public:
+        Runner(std::string_view filter, std::size_t samples, std::uint64_t sample_ns)
+            : filter_(filter), samples_(samples), sample_ns_(sample_ns) {}
+
+        template <class Fn>
+        void run(std::string_view name, Fn&& fn)
+        {
+            if (!filter_.empty() && name.find(filter_) == std::string_view::npos) return;
+
+            std::uint64_t i = 0;
+            auto time_batch = [&](std::uint64_t n) {
+                const auto start = now_ns();
+                for (std::uint64_t k = 0; k < n; ++k) fn(i++);
+                return now_ns() - start;
+            };
+
+            time_batch(16);     // first-call setup (library init, cold caches)
+            std::uint64_t batch = 1;
+            while (time_batch(batch) < sample_ns_ && batch < (std::uint64_t{1} << 30)) batch *= 2;
+
+            std::vector<double> per_op(samples_);
+            for (auto& s : per_op) s = static_cast<double>(time_batch(batch)) / static_cast<double>(batch);
+            add(name, batch, std::move(per_op));
+        }
+
+        /// Times `fn()` as one batch of `ops` operations, `samples` times,
+        /// each after an untimed `setup()`: for work that cannot repeat in
+        /// place, such as a replay, which needs fresh books every time.
+        template <class Setup, class Fn>
+        void run_fixed(std::string_view name, std::uint64_t ops, std::size_t samples,
+                       Setup&& setup, Fn&& fn)
+        {
+            if (!filter_.empty() && name.find(filter_) == std::string_view::npos) return;
+
+            std::vector<double> per_op(std::max<std::size_t>(samples, 1));
+            for (auto& s : per_op) {
+                setup();
+                const auto start = now_ns();
+                fn();
+                s = static_cast<double>(now_ns() - start) / static_cast<double>(ops);
+            }
+            add(name, ops, std::move(per_op));
+        }
+
+        const std::vector<Result>& results() const { return results_; }
+
+        /// Aligned table for people.
+        void write_table(std::ostream& out) const;
+
+        /// One JSON document for tools; `context` pairs are written as
+        /// string fields of a "context" object.
+        void write_json(std::ostream& out,
+                        const std::vector<std::pair<std::string, std::string>>& context) const;
+
+    private:
+        void add(std::string_view name, std::uint64_t batch, std::vector<double> per_op)
+        {
+            Result r;
+            r.name       = std::string(name);
+            r.iterations = batch * per_op.size();
+            r.batch      = batch;
+            for (double s : per_op) r.mean_ns += s;
+            r.mean_ns   /= static_cast<double>(per_op.size());
+            std::sort(per_op.begin(), per_op.end());
+            r.min_ns    = per_op.front();
+            r.median_ns = per_op[per_op.size() / 2];
+            r.p99_ns    = per_op[std::min(per_op.size() - 1, per_op.size() * 99 / 100)];
+            results_.push_back(std::move(r));
+        }
+
+        std::string         filter_;
+        std::size_t         samples_;
+        std::uint64_t       sample_ns_;
+        std::vector<Result> results_;
+};
+
+} // namespace triarb::bench
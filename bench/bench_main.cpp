@@ -0,0 +1,364 @@
+#include "async_log.hpp"
+#include "bench.hpp"
+#include "common.hpp"
+#include "exchange_info.hpp"
+#include "frame_parser.hpp"
+#include "gateway.hpp"
+#include "order_template.hpp"
+#include "orderbook.hpp"
+#include "triangle_engine.hpp"
+#include "triarb_bot.hpp"
+#include <boost/asio.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// triarb_bench [--filter <substring>] [--json <path>] [--quick]
+//
+// Microbenchmarks of the hot path on the captured frames in test/data.  The
+// table goes to stderr and a JSON document to stdout (or --json <path>), so
+//   ./triarb_bench > bench_output.txt
+// keeps a machine-readable record to compare across commits.
+
+namespace {
+
+using namespace triarb;
+using triarb::bench::keep;
+
+std::vector<std::string> read_lines(const std::string& name)
+{
+    std::ifstream in(std::string(TRIARB_BENCH_DATA_DIR) + "/" + name);
+    if (!in) throw std::runtime_error("missing bench data " + name);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);)
+        if (!line.empty()) lines.push_back(line);
+    return lines;
+}
+
+/// Frame decoding as TriArbBot::handle_frame does it in the default mode.
+void bench_parsing(bench::Runner& runner, const std::vector<std::string>& frames)
+{
+    MarketFrame frame;
+    runner.run("handle_frame/parse_fast", [&](std::uint64_t i) {
+        const auto& msg = frames[i % frames.size()];
+        keep(parse_market_frame(msg, frame) || parse_market_frame_json(msg, frame));
+    });
+    runner.run("handle_frame/parse_json", [&](std::uint64_t i) {
+        keep(parse_market_frame_json(frames[i % frames.size()], frame));
+    });
+}
+
+/// Book writes from the captured depth frames, and top() reads with and
+/// without a concurrent writer.
+void bench_orderbook(bench::Runner& runner, const std::vector<std::string>& frames)
+{
+    TriangleEngine engine(default_symbols(), "USDT");
+
+    struct Depth { SymbolId id; MarketFrame frame; };
+    std::vector<Depth> depth;
+    for (const auto& msg : frames) {
+        MarketFrame f;
+        if (!parse_market_frame(msg, f) || f.kind != FrameKind::PartialDepth) continue;
+        if (auto id = engine.find_stream(f.stream)) depth.push_back({*id, std::move(f)});
+    }
+    if (depth.empty()) throw std::runtime_error("no depth frames in bench data");
+
+    // Books drop updates that are not newer than the last one, so every
+    // write carries a fresh id.
+    std::uint64_t seq = std::uint64_t{1} << 40;
+
+    runner.run("orderbook/apply_snapshot", [&](std::uint64_t i) {
+        const auto& d = depth[i % depth.size()];
+        engine.book(d.id).apply_snapshot(++seq, d.frame.bids, d.frame.asks);
+    });
+
+    OrderBook& book = engine.book(depth.front().id);
+    const TopOfBook top = book.top();
+    runner.run("orderbook/update", [&](std::uint64_t i) {
+        const double nudge = static_cast<double>(i & 7) * 0.01;
+        book.update(++seq, {top.bid.px - nudge, top.bid.qty}, {top.ask.px + nudge, top.ask.qty});
+    });
+    runner.run("orderbook/top", [&](std::uint64_t) {
+        keep(book.top());
+    });
+
+    // Contention: one thread keeps publishing while this one reads, and
+    // three threads keep reading while this one publishes.
+    std::atomic<bool> stop{false};
+    {
+        std::thread writer([&] {
+            while (!stop.load(std::memory_order_relaxed))
+                book.update(++seq, top.bid, top.ask);
+        });
+        runner.run("orderbook/top_with_writer", [&](std::uint64_t) { keep(book.top()); });
+        stop = true;
+        writer.join();
+    }
+    stop = false;
+    {
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 3; ++r)
+            readers.emplace_back([&] {
+                while (!stop.load(std::memory_order_relaxed)) keep(book.top());
+            });
+        runner.run("orderbook/update_with_3_readers", [&](std::uint64_t) {
+            book.update(++seq, top.bid, top.ask);
+        });
+        stop = true;
+        for (auto& t : readers) t.join();
+    }
+}
+
+/// The work TriArbBot::edge_scanner does per book update: top-of-book
+/// edge of every home-anchored triangle on the symbol, sizing the ones
+/// that pass the threshold.
+void bench_edges(bench::Runner& runner, const std::vector<std::string>& frames)
+{
+    constexpr double kThreshold = 0.0008;
+    TriangleEngine engine(default_symbols(), "USDT");
+    for (const auto& msg : frames) {
+        MarketFrame f;
+        if (!parse_market_frame(msg, f) || f.kind != FrameKind::PartialDepth) continue;
+        if (auto id = engine.find_stream(f.stream))
+            engine.book(*id).apply_snapshot(f.lastUpdateId, f.bids, f.asks);
+    }
+
+    const auto symbols = static_cast<SymbolId>(engine.symbol_count());
+    runner.run("edge_scanner", [&](std::uint64_t i) {
+        double best = 0;
+        for (std::uint32_t t : engine.triangles_for(static_cast<SymbolId>(i % symbols))) {
+            const auto& tri = engine.triangles()[t];
+            if (!engine.anchored(tri)) continue;
+            const double edge = engine.edge(tri);
+            if (edge <= kThreshold) continue;
+            best = std::max(best, engine.size(tri, 15.0).profit);
+        }
+        keep(best);
+    });
+
+    const auto& tri = engine.triangles().front();
+    runner.run("edge_scanner/size_triangle", [&](std::uint64_t) {
+        keep(engine.size(tri, 15.0));
+    });
+}
+
+/// Order body serialization and signing: the allocating reference builders
+/// and the templates Gateway::send_order uses.
+void bench_orders(bench::Runner& runner)
+{
+    const SymbolScale btcusdt{{1, 2}, {1, 5}};
+    const Qty qty = btcusdt.qty_floor(0.00123);
+    const Price price = btcusdt.price_near(104312.01);
+    const std::string secret(64, 's');
+    const std::int64_t ts = 1'700'000'000'000;
+
+    runner.run("send_order/order_body", [&](std::uint64_t i) {
+        keep(order_body("BTCUSDT", "BUY", qty, price, btcusdt, ts + static_cast<std::int64_t>(i)));
+    });
+    const std::string body = order_body("BTCUSDT", "BUY", qty, price, btcusdt, ts);
+    runner.run("send_order/hmac_sha256", [&](std::uint64_t) {
+        keep(hmac_sha256(secret, body));
+    });
+    runner.run("send_order/signed_body", [&](std::uint64_t i) {
+        auto b = order_body("BTCUSDT", "BUY", qty, price, btcusdt, ts + static_cast<std::int64_t>(i));
+        b.append("&signature=").append(hmac_sha256(secret, b));
+        keep(b);
+    });
+
+    // The same bytes from a preformatted template and a keyed signer
+    const HmacSha256 signer(secret);
+    char sig[HmacSha256::kHexSize];
+    runner.run("send_order/hmac_cached", [&](std::uint64_t) {
+        keep(signer.sign_hex(body, sig));
+    });
+    OrderTemplate tmpl("BTCUSDT", "BUY", std::string(64, 'k'));
+    runner.run("send_order/template_rest", [&](std::uint64_t i) {
+        keep(tmpl.rest_body(qty, price, btcusdt, ts + static_cast<std::int64_t>(i), signer));
+    });
+
+    const ApiKeys keys{std::string(64, 'k'), secret};
+    runner.run("send_order/ws_request", [&](std::uint64_t i) {
+        keep(ws_order_request(i, "BTCUSDT", "BUY", qty, price, btcusdt, ts, keys));
+    });
+    runner.run("send_order/template_ws", [&](std::uint64_t i) {
+        keep(tmpl.ws_request(i, qty, price, btcusdt, ts, signer));
+    });
+}
+
+/* Sharded replay
+ * --------------
+ * A synthetic universe the size of a real one: `alts` assets quoted in
+ * USDT, BTC, ETH and BNB, and the six pairs among those four.  Prices are
+ * consistent, so nothing fires and the work measured is the frame path
+ * alone: parse, book, clock and edge scan of every triangle on the symbol.
+ */
+struct Universe {
+    std::string              exchange_info;   // path of the generated file
+    std::vector<std::string> frames;          // `rounds` depth5 frames per symbol
+};
+
+Universe make_universe(std::size_t alts, std::size_t rounds)
+{
+    const std::vector<std::pair<std::string, double>> quotes{
+        {"USDT", 1.0}, {"BTC", 100000.0}, {"ETH", 2000.0}, {"BNB", 600.0}};
+    struct Pair { std::string base, quote; double price; };
+    std::vector<Pair> pairs;
+    for (std::size_t a = 0; a < alts; ++a) {
+        char name[16];
+        std::snprintf(name, sizeof name, "ALT%03zu", a);
+        const double usdt = 0.5 + static_cast<double>(a) * 0.731;
+        for (const auto& [quote, px] : quotes) pairs.push_back({name, quote, usdt / px});
+    }
+    for (std::size_t b = 1; b < quotes.size(); ++b)
+        for (std::size_t q = 0; q < b; ++q)
+            pairs.push_back({quotes[b].first, quotes[q].first, quotes[b].second / quotes[q].second});
+
+    Universe u;
+    u.exchange_info = (std::filesystem::temp_directory_path() / "triarb_bench_universe.json").string();
+    std::ofstream info(u.exchange_info);
+    info << R"({"symbols":[)";
+    for (std::size_t i = 0; i < pairs.size(); ++i)
+        info << (i ? "," : "") << R"({"symbol":")" << pairs[i].base << pairs[i].quote
+             << R"(","status":"TRADING","baseAsset":")" << pairs[i].base
+             << R"(","quoteAsset":")" << pairs[i].quote << R"(","isSpotTradingAllowed":true,)"
+             << R"("filters":[{"filterType":"PRICE_FILTER","tickSize":"0.00000001"},)"
+             << R"({"filterType":"LOT_SIZE","stepSize":"0.00100000"},)"
+             << R"({"filterType":"NOTIONAL","minNotional":"0.00000100"}]})";
+    info << "]}";
+
+    // Five levels a side, 0.05 % off the mid, which moves a little from
+    // round to round so every frame changes its book
+    char level[64];
+    for (std::size_t r = 0; r < rounds; ++r)
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            std::string stream = pairs[i].base + pairs[i].quote;
+            for (auto& c : stream) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            const double mid = pairs[i].price * (1.0 + 1e-4 * static_cast<double>((r * 7 + i) % 5));
+            std::string f = R"({"stream":")" + stream + R"(@depth5@100ms","data":{"lastUpdateId":)" +
+                            std::to_string(r + 1) + R"(,"bids":[)";
+            for (int l = 0; l < 5; ++l) {
+                std::snprintf(level, sizeof level, R"(%s["%.8f","%.3f"])", l ? "," : "",
+                              mid * (1.0 - 5e-4 - 1e-4 * l), 10.0 + l);
+                f += level;
+            }
+            f += R"(],"asks":[)";
+            for (int l = 0; l < 5; ++l) {
+                std::snprintf(level, sizeof level, R"(%s["%.8f","%.3f"])", l ? "," : "",
+                              mid * (1.0 + 5e-4 + 1e-4 * l), 10.0 + l);
+                f += level;
+            }
+            f += "]}}";
+            u.frames.push_back(std::move(f));
+        }
+    return u;
+}
+
+/// Frames per second of a whole-universe replay, single-threaded and
+/// sharded over 1, 2, 4, ... strategy threads (up to the CPUs there are,
+/// and at least 4).  The bot's own output is muted while it runs.
+void bench_sharded_replay(bench::Runner& runner, bool quick)
+{
+    const auto u = make_universe(quick ? 20 : 100, quick ? 2 : 16);
+    ::setenv("EXCHANGE_INFO", u.exchange_info.c_str(), 1);
+
+    std::cout.flush();
+    std::fflush(stdout);
+    const int saved_out = ::dup(1);
+    const int null_fd   = ::open("/dev/null", O_WRONLY);
+    ::dup2(null_fd, 1);
+
+    std::vector<std::size_t> shard_counts{0};
+    const auto cpus = std::max<std::size_t>(std::thread::hardware_concurrency(), 4);
+    for (std::size_t n = 1; n <= cpus; n *= 2) shard_counts.push_back(n);
+
+    boost::asio::io_context ioc;
+    std::unique_ptr<TriArbBot> bot;
+    for (const auto shards : shard_counts) {
+        BotOptions options;
+        options.replay          = true;
+        options.pipeline.shards = shards;
+        const auto name = shards ? "replay/sharded_" + std::to_string(shards) : std::string("replay/single");
+        runner.run_fixed(name, u.frames.size(), quick ? 1 : 5,
+            [&] {
+                bot.reset();
+                bot = std::make_unique<TriArbBot>(ioc, options);
+                bot->start();
+            },
+            [&] {
+                std::uint64_t ts = 1'700'000'000'000'000'000;
+                for (const auto& f : u.frames) bot->replay({ts += 1000, RecordKind::Frame, {}, f});
+                bot->wait_idle();
+            });
+        bot.reset();
+    }
+
+    logger().flush();
+    std::cout.flush();
+    std::fflush(stdout);
+    ::dup2(saved_out, 1);
+    ::close(saved_out);
+    ::close(null_fd);
+    ::unsetenv("EXCHANGE_INFO");
+    std::filesystem::remove(u.exchange_info);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string filter, json_path;
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) quick = true;
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = argv[++i];
+        else {
+            std::cerr << "usage: " << argv[0] << " [--filter <substring>] [--json <path>] [--quick]\n";
+            return 2;
+        }
+    }
+
+    try {
+        // --quick only proves every benchmark still runs (used by ctest).
+        bench::Runner runner(filter, quick ? 3 : 50, quick ? 10'000 : 200'000);
+        const auto frames = read_lines("frames.jsonl");
+
+        bench_parsing(runner, frames);
+        bench_orderbook(runner, frames);
+        bench_edges(runner, frames);
+        bench_orders(runner);
+        bench_sharded_replay(runner, quick);
+
+        runner.write_table(std::cerr);
+        const std::vector<std::pair<std::string, std::string>> context = {
+            {"version", triarb::version},
+            {"compiler", TRIARB_BENCH_COMPILER},
+            {"build_type", TRIARB_BENCH_BUILD_TYPE},
+            {"threads", std::to_string(std::thread::hardware_concurrency())},
+        };
+        if (json_path.empty()) {
+            runner.write_json(std::cout, context);
+        } else {
+            std::ofstream out(json_path);
+            runner.write_json(out, context);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
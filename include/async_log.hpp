@@ -0,0 +1,165 @@
+#pragma once
+#include "spsc_queue.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace triarb {
+
+enum class LogStream : std::uint8_t { Out, Err };
+
+/// Short text copied into a log record by value (symbols, paths, error
+/// codes).  Longer text is truncated.
+struct LogStr {
+    static constexpr std::size_t kMax = 47;
+
+    LogStr() = default;
+    LogStr(std::string_view s) : len(static_cast<std::uint8_t>(std::min(s.size(), kMax)))
+    {
+        std::memcpy(text, s.data(), len);
+    }
+
+    std::string_view view() const { return {text, len}; }
+
+    std::uint8_t len = 0;
+    char         text[kMax];
+};
+
+/* Async Logger
+ * ------------
+ * Takes formatting and I/O off the trading thread.  A log call copies a
+ * format id and its arguments into a fixed 128-byte slot of the calling
+ * thread's single-producer/single-consumer ring and returns; a background
+ * thread drains every ring, formats the records and hands them to the
+ * sink in batches.
+ *
+ * The format id is a function `void(std::string& out, Args...)` given as a
+ * template argument; the record stores a pointer to a decoder instantiated
+ * for it, so the hot path does no formatting and no lookups.  Arguments
+ * must be trivially copyable and may not be pointers or string_views, so a
+ * record never refers to memory the caller may free: pass text as LogStr.
+ *
+ * Memory is bounded: each thread's ring has a fixed number of slots, and a
+ * record that finds its ring full is dropped and counted.  The consumer
+ * reports drops as a line on the error stream.  Records from one thread
+ * keep their order; records from different threads are interleaved in
+ * drain order.
+ */
+class AsyncLogger
+{
+    public:
+        /// Receives formatted lines, newlines included, a batch at a time;
+        /// called from the consumer thread only.
+        using Sink = std::function<void(LogStream, std::string_view)>;
+
+        static constexpr std::size_t kSlotBytes = 128;
+
+        explicit AsyncLogger(Sink sink, std::size_t ring_slots = 4096);
+        ~AsyncLogger();
+
+        AsyncLogger(const AsyncLogger&) = delete;
+        AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+        template <auto Format, class... Args>
+        void write(LogStream stream, const Args&... args) noexcept
+        {
+            static_assert(((std::is_trivially_copyable_v<Args> &&
+                            !std::is_pointer_v<Args> &&
+                            !std::is_same_v<Args, std::string_view>) && ...),
+                          "log arguments are copied by value; pass text as LogStr");
+            static_assert((sizeof(Args) + ... + 0) <= kPayloadBytes, "log record too large");
+
+            Ring& r = ring();
+            Slot* slot = r.queue.claim();
+            if (!slot) {
+                r.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            slot->decode = &decode<Format, Args...>;
+            slot->stream = stream;
+            std::byte* at = slot->payload;
+            ((std::memcpy(at, &args, sizeof(Args)), at += sizeof(Args)), ...);
+            r.queue.publish();
+        }
+
+        /// Blocks until every record logged before the call has been
+        /// written to the sink.
+        void flush();
+
+        /// Records dropped so far because a ring was full.
+        std::uint64_t dropped() const;
+
+    private:
+        static constexpr std::size_t kPayloadBytes = kSlotBytes - 16;
+
+        using Decoder = void (*)(std::string&, const std::byte*);
+
+        struct alignas(64) Slot {
+            Decoder   decode;
+            LogStream stream;
+            std::byte payload[kPayloadBytes];
+        };
+        static_assert(sizeof(Slot) == kSlotBytes);
+
+        struct Ring {
+            Ring(std::size_t slots, std::thread::id owner) : queue(slots), owner(owner) {}
+
+            SpscQueue<Slot>            queue;
+            std::thread::id            owner;                  // the producer
+            std::atomic<std::uint64_t> dropped{0};
+            std::uint64_t              dropped_seen = 0;       // consumer only
+        };
+
+        template <auto Format, class... Args>
+        static void decode(std::string& out, const std::byte* at)
+        {
+            std::tuple<Args...> args;
+            std::apply([&](auto&... a) {
+                ((std::memcpy(&a, at, sizeof(a)), at += sizeof(a)), ...);
+            }, args);
+            std::apply([&](const auto&... a) { Format(out, a...); }, args);
+        }
+
+        Ring& ring();
+        Ring& add_ring();
+        bool  drain();
+        void  run();
+
+        Sink                               sink_;
+        std::size_t                        ring_slots_;
+        std::uint64_t                      id_;
+        mutable std::mutex                 rings_mutex_;
+        std::vector<std::unique_ptr<Ring>> rings_;
+        std::atomic<bool>                  stop_{false};
+        std::string                        out_, err_;     // consumer's batch buffers
+        std::thread                        consumer_;
+};
+
+/// The process-wide logger: stdout/stderr, 4096 slots per thread.
+AsyncLogger& logger();
+
+/// Logs through logger(); see AsyncLogger::write.
+template <auto Format, class... Args>
+inline void log(LogStream stream, const Args&... args) noexcept
+{
+    logger().write<Format>(stream, args...);
+}
+
+/// Appends `v` with `decimals` digits after the point (std::fixed style).
+void append_fixed(std::string& out, double v, int decimals);
+/// Appends `v` in the shortest form that reads back exactly.
+void append_double(std::string& out, double v);
+void append_int(std::string& out, std::int64_t v);
+
+} // namespace triarb
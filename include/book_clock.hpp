@@ -0,0 +1,108 @@
+#pragma once
+#include "common.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace triarb {
+
+/* Book Clock
+ * ----------
+ * When each book was last current, kept by the thread that applies the
+ * frames.  Every book remembers the receive time of the frame that last
+ * changed it (the journal clock, so replay sees the same times) and, for
+ * streams that carry one, the exchange's event time E.
+ *
+ * The two clocks are related by a running offset: the lowest receive-minus
+ * event time seen over the last one to two minutes.  The fastest frame of
+ * that window is taken to have had no lag, so the offset soaks up both the
+ * clock difference and the network's floor, and what is left on a frame,
+ * (receive - E) - offset, is how much later than the best case it came: the
+ * feed lag.  Windows rotate every minute so that clock drift moves the
+ * offset in both directions.
+ *
+ * A book's as_of() is its event time on the receive clock, or its receive
+ * time when the stream has no E (partial depth, bookTicker).  The edge scan
+ * holds back triangles whose oldest leg is too old, or whose legs are too
+ * far apart; a quiet diff-depth book is only as old as its last change.
+ *
+ * One writer; report(), as_of() and received() may run on other threads
+ * (in the sharded mode a shard reads the books another shard keeps).
+ */
+class BookClock
+{
+    public:
+        static constexpr std::uint64_t kWindowNs = 60'000'000'000;
+
+        explicit BookClock(std::size_t symbols);
+
+        /// `symbol`'s book changed on a frame received at `recv_ns` whose
+        /// exchange event time is `event_ms` (0 when the stream has none).
+        /// Returns the frame's feed lag in ns when it had an event time.
+        std::optional<std::uint64_t> observe(SymbolId symbol, std::uint64_t recv_ns,
+                                             std::uint64_t event_ms);
+
+        /// `symbol`'s book was rebuilt from a REST snapshot received at
+        /// `recv_ns`.
+        void snapshot(SymbolId symbol, std::uint64_t recv_ns)
+        {
+            books_[symbol].received.store(recv_ns, std::memory_order_relaxed);
+            books_[symbol].as_of.store(recv_ns, std::memory_order_relaxed);
+        }
+
+        /// When `symbol`'s book was last current, on the receive clock; 0
+        /// before its first change.
+        std::uint64_t as_of(SymbolId symbol) const
+        {
+            return books_[symbol].as_of.load(std::memory_order_relaxed);
+        }
+        /// Receive time of the frame that last changed `symbol`'s book.
+        std::uint64_t received(SymbolId symbol) const
+        {
+            return books_[symbol].received.load(std::memory_order_relaxed);
+        }
+
+        /// Receive clock minus exchange clock, in ns; nullopt before the
+        /// first event time.
+        std::optional<std::int64_t> offset_ns() const;
+
+        enum class Hold : std::uint8_t { Stale, Skew };
+
+        /// Counts a triangle the edge scan held back.
+        void hold(Hold reason);
+        std::uint64_t held(Hold reason) const
+        {
+            return held_[static_cast<std::size_t>(reason)].load(std::memory_order_relaxed);
+        }
+
+        /// Offset, frames with and without event time, and holds.
+        void report(std::ostream& out) const;
+
+    private:
+        static constexpr std::int64_t kNoOffset = std::numeric_limits<std::int64_t>::max();
+
+        struct Book {
+            std::atomic<std::uint64_t> received{0};
+            std::atomic<std::uint64_t> as_of{0};
+        };
+        static void bump(std::atomic<std::uint64_t>& n)
+        {
+            n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        std::vector<Book>          books_;         // by SymbolId
+        std::uint64_t              window_start_ = 0;
+        std::int64_t               current_      = kNoOffset;   // lowest of this window
+        std::int64_t               previous_     = kNoOffset;   // lowest of the one before
+        std::atomic<std::int64_t>  offset_{kNoOffset};
+        std::atomic<std::uint64_t> stamped_{0};    // frames with an event time
+        std::atomic<std::uint64_t> unstamped_{0};
+        std::array<std::atomic<std::uint64_t>, 2> held_{};
+};
+
+} // namespace triarb
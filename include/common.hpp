@@ -1,13 +1,42 @@
 #pragma once
+#include <compare>
 #include <cstdint>
 #include <string_view>
 
 namespace triarb {
 
-using Price = double;
-using Qty   = double;
 using Ts    = std::uint64_t;
 
+using SymbolId = std::uint32_t;   // index into the symbol universe
+using AssetId  = std::uint32_t;
+
+/// Price as a whole number of its symbol's tickSize (see SymbolScale).
+struct Price {
+    std::int64_t ticks = 0;
+    auto operator<=>(const Price&) const = default;
+};
+
+/// Quantity as a whole number of its symbol's stepSize.
+struct Qty {
+    std::int64_t steps = 0;
+    auto operator<=>(const Qty&) const = default;
+};
+
+/// An exact decimal as read off the wire: mantissa * 10^-scale.
+struct Decimal {
+    std::int64_t mantissa = 0;
+    std::uint8_t scale    = 0;
+    bool operator==(const Decimal&) const = default;
+};
+
+/// One price level as published by the exchange.
+struct WireLevel {
+    Decimal px;
+    Decimal qty;
+    bool operator==(const WireLevel&) const = default;
+};
+
+/// Floating-point view of a level, used by the edge and sizing math.
 struct Quote {
     double px;  // price
     double qty; // quantity
@@ -0,0 +1,109 @@
+#pragma once
+#include "exchange_info.hpp"
+#include "feed_set.hpp"
+#include "pipeline.hpp"
+#include "triangle_path.hpp"
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace triarb {
+
+/// How incoming frames are decoded (FRAME_PARSER environment variable).
+enum class ParserMode {
+    Fast,       // zero-allocation scanner, nlohmann fallback on failure (default)
+    Json,       // nlohmann::json only
+    Validate    // run both and report any disagreement
+};
+
+/// Which depth stream feeds the books (DEPTH_FEED environment variable).
+/// BOOK_TICKER adds <symbol>@bookTicker for the top of book, alongside
+/// partial depth or on its own.
+enum class DepthFeed {
+    Partial,    // <symbol>@depth5@100ms top-5 snapshots (default)
+    Diff,       // <symbol>@depth@100ms diffs synced against REST snapshots
+    None        // no depth stream; one level per side from bookTicker
+};
+
+/// What the bot trades and how it reads the market.  Fixed for the life of
+/// a bot: a reload that changes it is reported and otherwise ignored.
+struct MarketConfig {
+    std::string              exchange_info;            // symbols from this file; default_symbols() if empty
+    std::vector<std::string> symbols;                  // trade only these; empty keeps every symbol
+    std::string              home_asset  = "USDT";
+    std::string              rest_host   = "api.binance.com";
+    DepthFeed                depth_feed  = DepthFeed::Partial;
+    bool                     book_ticker = false;
+    ParserMode               parser      = ParserMode::Fast;
+
+    bool operator==(const MarketConfig&) const = default;
+};
+
+/// What the strategy reads on every frame.  A reload replaces it whole.
+struct StrategyConfig {
+    std::string               fee_tier;                 // the fee_tiers entry `fees` came from
+    FeeSchedule               fees;
+    double                    edge_threshold = 0.0008;  // top-of-book edge a triangle must beat
+    double                    max_notional   = 15.0;    // per triangle, in the home asset
+    std::vector<std::string>  triangles;                // "USDT->ETH->BTC->USDT"; empty trades all
+    std::chrono::milliseconds max_book_age{0};          // hold a triangle with an older leg; 0 is off
+    std::chrono::milliseconds max_book_skew{0};         // or with legs further apart; 0 is off
+};
+
+/* Configuration
+ * -------------
+ * Everything the bot is told at startup, in one typed value.  The
+ * environment gives the defaults (EXCHANGE_INFO, HOME_ASSET, REST_HOST,
+ * DEPTH_FEED, BOOK_TICKER, FRAME_PARSER, EDGE_THRESHOLD, MAX_NOTIONAL,
+ * MAX_BOOK_AGE_MS, MAX_BOOK_SKEW_MS and the PipelineOptions and FeedOptions
+ * variables); a JSON file named by CONFIG is laid over them, section by
+ * section and key by key:
+ *
+ *   {"market":   {"exchange_info": "...", "symbols": ["BTCUSDT", ...],
+ *                 "home_asset": "USDT", "rest_host": "api.binance.com",
+ *                 "depth_feed": "partial", "book_ticker": false,
+ *                 "parser": "fast"},
+ *    "strategy": {"fee_tier": "vip0",
+ *                 "fee_tiers": {"vip0": {"maker": 0.001, "taker": 0.001}},
+ *                 "edge_threshold": 0.0008, "max_notional": 15,
+ *                 "triangles": ["USDT->ETH->BTC->USDT"],
+ *                 "max_book_age_ms": 0, "max_book_skew_ms": 0},
+ *    "feeds":    {"connections": 2, "endpoints": ["stream.binance.com:9443"],
+ *                 "stall_timeout_ms": 10000, "compression": false,
+ *                 "read_buffer": 65536,
+ *                 "socket": {"nodelay": true, "busy_poll_us": 0, "rcvbuf": 0,
+ *                            "sndbuf": 0, "quickack": false, "timestamps": true}},
+ *    "threads":  {"threading": "pipelined", "net_cpu": 1, "strategy_cpu": 2,
+ *                 "egress_cpu": 3, "busy_poll": true,
+ *                 "shards": 4, "shard_cpus": [2, 3, 4, 5]}}
+ *
+ * Only the strategy section can change while the bot runs (see
+ * TriArbBot::reload_config); the others are read once.
+ */
+struct Config {
+    std::string     path;       // the CONFIG file; empty when there is none
+    MarketConfig    market;
+    StrategyConfig  strategy;
+    PipelineOptions pipeline;
+    FeedOptions     feeds;
+};
+
+/// Lays the configuration document `json_text` over `base`.  Throws
+/// std::runtime_error if it is not a JSON object and std::invalid_argument
+/// on an unknown or out-of-range value.
+Config parse_config(std::string_view json_text, Config base);
+
+/// Reads and parses a configuration file over `base`; `path` is recorded
+/// in the result.  Throws std::runtime_error if the file cannot be read.
+Config load_config(const std::string& path, Config base);
+
+/// The environment, then the CONFIG file if one is named.
+Config load_config_from_env();
+
+/// The symbols `market` trades: its exchange_info file or the defaults,
+/// narrowed to its symbol list.  Throws std::invalid_argument on a listed
+/// symbol the source does not have.
+std::vector<SymbolInfo> load_symbols(const MarketConfig& market);
+
+} // namespace triarb
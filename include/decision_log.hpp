@@ -0,0 +1,57 @@
+#pragma once
+#include "common.hpp"
+#include "edge_evaluator.hpp"
+#include "fixed_point.hpp"
+#include "triangle_path.hpp"
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace triarb {
+
+/* Decision Log
+ * ------------
+ * One text line per trading decision, keyed by the receive time of the
+ * frame that caused it:
+ *
+ *   <ts> FIRE  <path> edge=<e> notional=<n> profit=<p>
+ *   <ts> ORDER <leg> <symbol> <side> <qty> @ <price>
+ *   <ts> FILL  <leg> <symbol> <qty> @ <price>
+ *   <ts> SKIP  <leg> <symbol> <reason>
+ *   <ts> RISK  <leg> <symbol> exposure=<x>
+ *
+ * RISK is written in concurrent execution for each leg that did not fill,
+ * with the home value the triangle left in its other assets.
+ * Nothing in a line depends on the wall clock or on stream formatting
+ * state: doubles are written with std::to_chars (shortest round-trip form)
+ * and order prices and quantities as exact decimals, so replaying a journal
+ * twice gives byte-identical files.
+ */
+class DecisionLog
+{
+    public:
+        /// Disabled; every call is a no-op.
+        DecisionLog() = default;
+        /// Creates or truncates `path`; throws std::runtime_error on failure.
+        explicit DecisionLog(const std::string& path);
+
+        bool enabled() const { return out_.is_open(); }
+
+        void fire(Ts ts, std::string_view path, const SizedEdge& sized);
+        void order(Ts ts, std::size_t leg, std::string_view symbol, Side side,
+                   Qty qty, Price price, const SymbolScale& scale);
+        void fill(Ts ts, std::size_t leg, std::string_view symbol, double qty, double price);
+        void skip(Ts ts, std::size_t leg, std::string_view symbol, std::string_view reason);
+        void risk(Ts ts, std::size_t leg, std::string_view symbol, double exposure);
+
+    private:
+        void begin(Ts ts, std::string_view what);
+        void put(double v);
+        void end();
+
+        std::ofstream out_;
+        std::string   line_;
+};
+
+} // namespace triarb
@@ -0,0 +1,68 @@
+#pragma once
+#include "frame_parser.hpp"
+#include "orderbook.hpp"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace triarb {
+
+/// Keeps an `OrderBook` in step with a Binance diff-depth stream.
+///
+/// Follows the documented procedure for local books:
+///   1. buffer stream events while a REST snapshot is in flight;
+///   2. on snapshot `L`, drop buffered events with `u <= L`;
+///   3. the first applied event must satisfy `U <= L+1 <= u`;
+///   4. every later event must start at `previous u + 1` (overlap is
+///      tolerated since diff quantities are absolute).
+/// Any violation clears the book and requests a fresh snapshot.
+class DepthSync
+{
+    public:
+        /// Asks the owner to fetch a snapshot and hand it to on_snapshot().
+        /// The snapshot must be delivered later, not from inside the call.
+        using SnapshotRequest = std::function<void()>;
+
+        enum class State { Idle, AwaitingSnapshot, Synced };
+
+        DepthSync(OrderBook& book, SnapshotRequest request_snapshot,
+                  std::size_t max_buffered = 4096);
+
+        /// Requests the initial snapshot.
+        void start();
+
+        /// Feeds one diff-depth event from the stream.  Returns true if it
+        /// changed the book; duplicates and stale copies from another feed,
+        /// and events buffered for a snapshot, return false.
+        bool on_diff(const MarketFrame& diff);
+
+        /// Feeds the REST snapshot requested through SnapshotRequest.
+        void on_snapshot(const MarketFrame& snapshot);
+
+        State state() const { return state_; }
+        bool synced() const { return state_ == State::Synced; }
+        std::uint64_t resyncs() const { return resyncs_; }
+
+    private:
+        struct BufferedDiff {
+            std::uint64_t      first;
+            std::uint64_t      last;
+            std::vector<WireLevel> bids;
+            std::vector<WireLevel> asks;
+        };
+
+        void apply(std::uint64_t first, std::uint64_t last,
+                   std::span<const WireLevel> bids, std::span<const WireLevel> asks);
+        void resync();
+
+        OrderBook&               book_;
+        SnapshotRequest          request_snapshot_;
+        std::size_t              max_buffered_;
+        State                    state_ = State::Idle;
+        std::uint64_t            last_applied_ = 0;   // u of the last applied event
+        std::uint64_t            resyncs_ = 0;
+        std::deque<BufferedDiff> buffered_;
+};
+
+} // namespace triarb
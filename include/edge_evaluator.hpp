@@ -0,0 +1,42 @@
+#pragma once
+#include "common.hpp"
+#include <array>
+#include <cstddef>
+#include <span>
+
+namespace triarb {
+
+/// Levels read from each book when sizing a triangle.  Bounds the work per
+/// evaluation to 3 * kMaxLegLevels steps.
+inline constexpr std::size_t kMaxLegLevels = 10;
+
+/// The visible liquidity one leg can trade against.
+struct LegLevels {
+    bool                   buy;     // true: spend quote at the asks, false: spend base at the bids
+    double                 fee;     // fraction of the proceeds kept by the exchange
+    std::span<const Quote> levels;  // best first
+};
+
+/// Result of sizing a triangle against the visible depth.
+struct SizedEdge {
+    double notional = 0.0;              // start asset sent into the first leg
+    double profit   = 0.0;              // expected gain in the start asset, after fees
+    double edge     = -1.0;             // return of the first unit at top of book
+    std::array<double, 3> legInput{};   // amount each leg spends (its "from" asset)
+    std::array<double, 3> limitPx{};    // worst price each leg has to reach
+};
+
+/* Size-optimal Triangle Evaluation
+ * --------------------------------
+ * Each leg converts its input asset at a piecewise-constant rate (one rate
+ * per level), so the cycle's profit is a concave function of the notional.
+ * The evaluator walks the three ladders together: while the product of the
+ * current marginal rates is above 1, it pushes notional through until the
+ * tightest level is exhausted or max_notional is reached, then advances that
+ * level.  The stopping point is the profit-maximising notional.
+ *
+ * Notional beyond the visible levels is never assumed to fill.
+ */
+SizedEdge size_triangle(const std::array<LegLevels, 3>& legs, double max_notional);
+
+} // namespace triarb
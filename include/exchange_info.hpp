@@ -0,0 +1,36 @@
+#pragma once
+#include "fixed_point.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace triarb {
+
+/// Trading rules of one spot symbol, taken from /api/v3/exchangeInfo.
+struct SymbolInfo {
+    std::string symbol;             // "ETHBTC"
+    std::string base;               // "ETH"
+    std::string quote;              // "BTC"
+    double      tickSize    = 0.0;  // PRICE_FILTER
+    double      stepSize    = 0.0;  // LOT_SIZE
+    double      minNotional = 0.0;  // NOTIONAL / MIN_NOTIONAL, in quote asset
+    Increment   tick{0, 0};         // exact tickSize; {0, 0} when only the double is known
+    Increment   step{0, 0};         // exact stepSize
+};
+
+/// Integer price/quantity scale of a symbol: the exact increments when they
+/// were parsed, otherwise recovered from tickSize/stepSize, otherwise 10^-8.
+SymbolScale symbol_scale(const SymbolInfo& info);
+
+/// Parses an exchangeInfo document and keeps the symbols that are currently
+/// TRADING with spot trading allowed.  Throws std::runtime_error on malformed
+/// input.
+std::vector<SymbolInfo> parse_exchange_info(std::string_view json_text);
+
+/// Reads and parses an exchangeInfo JSON file saved from the REST API.
+std::vector<SymbolInfo> load_exchange_info(const std::string& path);
+
+/// The BTC/USDT, ETH/BTC, ETH/USDT universe the bot trades by default.
+std::vector<SymbolInfo> default_symbols();
+
+} // namespace triarb
@@ -0,0 +1,217 @@
+#pragma once
+#include "exchange_info.hpp"
+#include "fixed_point.hpp"
+#include "frame_parser.hpp"
+#include "triangle_path.hpp"
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace triarb {
+
+/// What a LIMIT_MAKER order that would trade at once does in the simulator.
+enum class MakerRule : std::uint8_t {
+    Reject,     // refused with -2010, as Binance does (default)
+    Take        // trades like a LIMIT IOC order at the same price
+};
+
+/// Simulator settings (triarb_sim command line).
+struct SimOptions {
+    std::chrono::microseconds network_latency{0};   // each way: frames, requests, responses
+    std::chrono::microseconds matching_latency{0};  // from an order's arrival to its match
+    double                    fill_ratio = 1.0;     // share of each level an order may take
+    MakerRule                 maker_rule = MakerRule::Reject;
+    std::string               api_key;              // X-MBX-APIKEY required when set
+    std::string               api_secret;           // signatures checked when set
+    std::string               cert_file;            // TLS certificate chain and key (PEM)
+    std::string               key_file;
+    std::uint16_t             port = 0;             // loopback port; 0 picks a free one
+};
+
+/// One trade of an order against a level.
+struct SimFill {
+    Price price;
+    Qty   qty;
+};
+
+/// What matching one order did.  Binance reports an IOC order that was
+/// cut short as EXPIRED, whether or not part of it traded.
+struct SimExecution {
+    enum class Status : std::uint8_t { Filled, Expired, Rejected };
+
+    Status               status = Status::Expired;
+    Qty                  filled{0};
+    double               quote = 0.0;   // sum of price * qty, in the quote asset
+    std::vector<SimFill> fills;
+};
+
+/// A level whose quantity changed, with its new quantity (zero: removed).
+struct SimLevelChange {
+    Side  side;     // Buy: a bid
+    Price price;
+    Qty   qty;
+};
+
+/* Simulated Book
+ * --------------
+ * One symbol's book inside the exchange simulator, in whole ticks and
+ * steps.  The market side sets its levels; incoming orders take them.
+ *
+ * An order trades against the opposite side at its limit price or better,
+ * best level first and at the level's price.  Of each level it reaches it
+ * may take only `fill_ratio` of the quantity (rounded down to the step),
+ * standing in for the share other takers get to first; this is how the
+ * simulator produces partial fills.  What cannot be filled at once
+ * expires: the simulator keeps no resting orders.
+ *
+ * Every change is remembered until flush(), which closes the batch under
+ * the next update id, so the diff depth stream sees each change once.
+ */
+class SimBook
+{
+    public:
+        explicit SimBook(SymbolScale scale = {}) : scale_(scale) {}
+
+        const SymbolScale& scale() const { return scale_; }
+        std::uint64_t update_id() const { return update_id_; }
+
+        /// Sets the level at `price` of the bid (Buy) or ask side; a zero
+        /// quantity removes it.
+        void set(Side side, Price price, Qty qty);
+
+        /// Replaces both sides with the given levels.
+        void replace(const std::vector<WireLevel>& bids, const std::vector<WireLevel>& asks);
+
+        /// Sets the best level of each side, as a bookTicker update does:
+        /// levels better than the new best are removed.
+        void set_top(const WireLevel& bid, const WireLevel& ask);
+
+        /// Matches an order to `side` `qty` at `limit`.  A `maker` order
+        /// that would trade at once is rejected under MakerRule::Reject.
+        SimExecution match(Side side, Price limit, Qty qty, bool maker, double fill_ratio,
+                           MakerRule rule);
+
+        /// Up to `depth` best levels of one side, best first.
+        std::vector<std::pair<Price, Qty>> levels(Side side, std::size_t depth) const;
+
+        /// Changes since the last flush(), under a new update id; empty,
+        /// with the id unchanged, if there were none.
+        std::vector<SimLevelChange> flush();
+
+    private:
+        void record(Side side, std::int64_t ticks, std::int64_t steps);
+
+        SymbolScale                                           scale_;
+        std::map<std::int64_t, std::int64_t, std::greater<>> bids_;   // ticks -> steps
+        std::map<std::int64_t, std::int64_t>                  asks_;
+        std::vector<SimLevelChange>                           changes_;
+        std::uint64_t                                         update_id_ = 1;
+};
+
+/// One order as the simulator saw it, for the fill-quality report.
+struct SimOrderRecord {
+    std::string          symbol;
+    Side                 side = Side::Buy;
+    double               limit = 0.0;
+    double               qty   = 0.0;
+    double               filled = 0.0;
+    double               quote  = 0.0;
+    SimExecution::Status status = SimExecution::Status::Rejected;
+    int                  code   = 0;     // Binance error code of a rejected order
+};
+
+/* Exchange Simulator
+ * ------------------
+ * A local stand-in for the Binance endpoints the bot uses, on one TLS port
+ * of the loopback interface, so the unmodified bot can trade against it:
+ *
+ *   - WebSocket  /stream?streams=...  combined <symbol>@depth<N>[@100ms],
+ *                <symbol>@depth[@100ms] and <symbol>@bookTicker streams,
+ *                pushed whenever a book changes
+ *   - POST       /api/v3/order        signed LIMIT and LIMIT_MAKER orders,
+ *                matched against the books (SimBook); fills take the
+ *                liquidity, and the market data shows it
+ *   - GET        /api/v3/depth        REST snapshots for diff depth
+ *
+ * Frames and responses leave network_latency after they are ready, in the
+ * order they were produced; an order is matched network_latency plus
+ * matching_latency after its request was read, against the book as it is
+ * by then.  Orders must be immediate-or-cancel (timeInForce=IOC); errors
+ * come back as Binance error objects with its codes.
+ *
+ * Runs on one io_context and must outlive its runs.
+ */
+class ExchangeSim
+{
+    public:
+        ExchangeSim(boost::asio::io_context& ioc, const std::vector<SymbolInfo>& symbols,
+                    SimOptions options);
+        ~ExchangeSim();
+
+        ExchangeSim(const ExchangeSim&) = delete;
+        ExchangeSim& operator=(const ExchangeSim&) = delete;
+
+        std::uint16_t port() const { return acceptor_.local_endpoint().port(); }
+
+        /// Throws std::out_of_range on a symbol the simulator does not list.
+        SimBook& book(std::string_view symbol);
+
+        /// Replaces a book's levels and publishes the change.
+        void set_book(std::string_view symbol, const std::vector<WireLevel>& bids,
+                      const std::vector<WireLevel>& asks);
+
+        /// Applies a recorded combined-stream frame (partial depth, diff
+        /// depth or bookTicker) to its book and publishes the change;
+        /// false if it is not one or names an unknown symbol.
+        bool apply_frame(std::string_view frame);
+
+        /// Sends the changes to `symbol` since its last publish to every
+        /// session subscribed to one of its streams.
+        void publish(std::string_view symbol);
+
+        /// Market data sessions open right now.
+        std::size_t subscribers() const;
+
+        const std::vector<SimOrderRecord>& orders() const { return orders_; }
+
+        /// Orders by outcome, fill rate and price improvement over the
+        /// limit price.
+        void report(std::ostream& out) const;
+
+    private:
+        struct Connection;
+        struct Subscription;
+        struct Market {
+            SymbolInfo  info;
+            std::string stream;   // lower-case symbol, the stream name prefix
+            SimBook     book;
+        };
+
+        void accept();
+        Market* find(std::string_view symbol);
+        bool stream_frame(const Subscription& s, const std::vector<SimLevelChange>& changes,
+                          std::string& out) const;
+        std::string handle_order(std::string_view api_key, std::string_view body, int& status);
+        std::string handle_depth(std::string_view target, int& status);
+
+        boost::asio::io_context&                ioc_;
+        SimOptions                              options_;
+        boost::asio::ssl::context               ctx_;
+        boost::asio::ip::tcp::acceptor          acceptor_;
+        std::map<std::string, Market, std::less<>> markets_;
+        std::vector<std::weak_ptr<Connection>>  connections_;
+        std::vector<SimOrderRecord>             orders_;
+        std::uint64_t                           next_order_id_ = 1;
+        MarketFrame                             frame_;   // apply_frame() scratch
+};
+
+} // namespace triarb
@@ -0,0 +1,168 @@
+#pragma once
+#include "latency.hpp"
+#include "symbol_table.hpp"
+#include "websocket_session.hpp"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace triarb {
+
+struct FeedEndpoint {
+    std::string host;
+    std::string port;
+
+    bool operator==(const FeedEndpoint&) const = default;
+};
+
+/// Parses "stream.binance.com:9443"; throws std::invalid_argument if it is
+/// not host:port.
+FeedEndpoint parse_feed_endpoint(std::string_view text);
+
+/// Market data connections (FEED_CONNECTIONS, FEED_ENDPOINTS,
+/// FEED_STALL_TIMEOUT, CA_FILE and the WebsocketOptions variables).
+struct FeedOptions {
+    std::size_t               connections = 1;   // redundant sessions on the same streams
+    std::vector<FeedEndpoint> endpoints{{"stream.binance.com", "9443"}};  // used round-robin
+    std::chrono::milliseconds stall_timeout{std::chrono::seconds(10)};    // silence that drops a session
+    std::chrono::milliseconds retry_delay = kReconnectDelay;  // before reconnecting after a failed attempt
+    std::string               ca_file;           // extra trusted certificates, for local stand-ins
+    WebsocketOptions          session;           // compression and read buffer of every session
+
+    bool operator==(const FeedOptions&) const = default;
+};
+
+/// Throws std::invalid_argument on a malformed FEED_ENDPOINTS list or a
+/// zero FEED_CONNECTIONS.
+FeedOptions load_feed_options_from_env();
+
+/* Feed Set
+ * --------
+ * `connections` WebsocketSessions subscribed to the same combined-stream
+ * target, spread round-robin over the endpoints.  Sessions on the same
+ * host prefer different resolved addresses, so one slow edge node or one
+ * stalled TCP connection holds back only its own copy of the data.
+ *
+ * A session that closes, or that has been silent for stall_timeout, is
+ * reconnected: at once if it had been open, after retry_delay if the
+ * attempt itself failed.  The subscription is the URL, so a reconnect is
+ * also a resubscribe.  Every frame is handed on with the index of the
+ * session it came from; which copy counts is up to the receiver (see
+ * FeedArbiter).
+ *
+ * Runs on one io_context and must outlive its runs.
+ */
+class FeedSet
+{
+    public:
+        /// Receives the session index, the frame, its read stamp and its
+        /// kernel arrival stamp.  The frame is only valid during the call,
+        /// as with WebsocketSession.
+        using FrameHandler = InlineFunction<void(std::size_t, std::string_view, std::uint64_t,
+                                                 std::uint64_t)>;
+
+        FeedSet(boost::asio::io_context& ioc, FeedOptions options, std::string target,
+                FrameHandler on_frame);
+
+        void start();
+
+        std::size_t size() const { return feeds_.size(); }
+        const FeedEndpoint& endpoint(std::size_t feed) const { return feeds_[feed]->endpoint; }
+        bool open(std::size_t feed) const { return feeds_[feed]->session.is_open(); }
+        std::uint64_t frames(std::size_t feed) const { return feeds_[feed]->frames; }
+        /// Sessions that went down after having been open.
+        std::uint64_t drops(std::size_t feed) const { return feeds_[feed]->drops; }
+        /// Connection attempts after the first.
+        std::uint64_t reconnects(std::size_t feed) const { return feeds_[feed]->reconnects; }
+
+        /// Drops session `feed`, as a network failure would.
+        void drop(std::size_t feed) { feeds_[feed]->session.close(); }
+
+        /// Endpoint, state, frames, drops and reconnects per session.
+        void report(std::ostream& out) const;
+
+    private:
+        struct Feed {
+            Feed(boost::asio::io_context& ioc, FeedEndpoint endpoint, const std::string& target,
+                 WebsocketSession::FrameHandler on_frame, const WebsocketOptions& options);
+
+            FeedEndpoint              endpoint;
+            WebsocketSession          session;
+            boost::asio::steady_timer retry;
+            bool                      up         = false;  // handshake done, not yet closed
+            std::uint64_t             last_frame = 0;   // now_ns() of the latest frame
+            std::uint64_t             frames     = 0;
+            std::uint64_t             drops      = 0;
+            std::uint64_t             reconnects = 0;
+        };
+
+        void on_close(std::size_t feed, boost::beast::error_code ec);
+        void schedule_watchdog();
+
+        boost::asio::io_context&          ioc_;
+        FeedOptions                       options_;
+        FrameHandler                      handler_;
+        std::vector<std::unique_ptr<Feed>> feeds_;
+        boost::asio::steady_timer         watchdog_;
+};
+
+/* Feed Arbiter
+ * ------------
+ * Lead/lag statistics of redundant feeds, kept by the thread that applies
+ * the frames.  For every frame it is told which session delivered which
+ * update of which symbol: the first copy of an update is a lead for its
+ * session, a later copy of the latest update is a duplicate, and the gap
+ * to the first copy is that session's lag.  Copies of older updates are
+ * stale.  Whether a frame is applied is still the books' update-id check;
+ * the arbiter only keeps score.
+ *
+ * One writer; report() may run on another thread.
+ */
+class FeedArbiter
+{
+    public:
+        FeedArbiter(std::size_t feeds, std::size_t symbols);
+
+        enum class Arrival : std::uint8_t { First, Duplicate, Stale };
+
+        Arrival observe(std::size_t feed, SymbolId symbol, std::uint64_t update_id,
+                        std::uint64_t read_ns);
+
+        std::size_t feeds() const { return feeds_.size(); }
+        std::uint64_t first(std::size_t feed) const     { return feeds_[feed].first.load(std::memory_order_relaxed); }
+        std::uint64_t duplicate(std::size_t feed) const { return feeds_[feed].duplicate.load(std::memory_order_relaxed); }
+        std::uint64_t stale(std::size_t feed) const     { return feeds_[feed].stale.load(std::memory_order_relaxed); }
+        /// How far behind the first copy this session's duplicates came.
+        const LatencyHistogram& lag(std::size_t feed) const { return feeds_[feed].lag; }
+
+        /// Leads, duplicates, stale copies and lag percentiles per session.
+        void report(std::ostream& out) const;
+
+    private:
+        struct Latest {
+            std::uint64_t update_id = 0;
+            std::uint64_t read_ns   = 0;
+        };
+        struct Score {
+            std::atomic<std::uint64_t> first{0};
+            std::atomic<std::uint64_t> duplicate{0};
+            std::atomic<std::uint64_t> stale{0};
+            LatencyHistogram           lag;
+        };
+        static void bump(std::atomic<std::uint64_t>& n)
+        {
+            n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        std::vector<Score>  feeds_;
+        std::vector<Latest> latest_;   // by SymbolId
+};
+
+} // namespace triarb
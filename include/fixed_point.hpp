@@ -0,0 +1,140 @@
+#pragma once
+#include "common.hpp"
+#include <cstdint>
+#include <string_view>
+
+namespace triarb {
+
+/// Largest scale a Decimal or Increment can carry; 10^18 is the largest
+/// power of ten that fits in an int64.
+inline constexpr int kMaxDecimalScale = 18;
+
+inline constexpr std::int64_t kPow10i[kMaxDecimalScale + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000, 10000000000, 100000000000, 1000000000000, 10000000000000,
+    100000000000000, 1000000000000000, 10000000000000000, 100000000000000000,
+    1000000000000000000};
+
+inline constexpr double kPow10d[kMaxDecimalScale + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+/// Parses a non-negative decimal string such as "0.02391000" straight into
+/// a Decimal, without going through floating point.  Trailing fractional
+/// zeros are dropped, so equal values always give equal Decimals
+/// ({2391, 5} here).  Fails on anything but digits and one '.', or when the
+/// significant digits do not fit in an int64.
+inline bool parse_fixed(std::string_view s, Decimal& out) noexcept
+{
+    constexpr std::int64_t kMax = INT64_MAX;
+
+    std::int64_t mantissa = 0;
+    int  scale   = 0;
+    int  zeros   = 0;      // fractional zeros not yet folded into the mantissa
+    bool seenDot = false;
+    bool seenDigit = false;
+
+    for (char c : s) {
+        if (c >= '0' && c <= '9') {
+            seenDigit = true;
+            const int d = c - '0';
+            if (seenDot) {
+                if (d == 0) { ++zeros; continue; }
+                for (; zeros > 0; --zeros, ++scale) {
+                    if (mantissa > kMax / 10) return false;
+                    mantissa *= 10;
+                }
+                ++scale;
+            }
+            if (mantissa > (kMax - d) / 10) return false;
+            mantissa = mantissa * 10 + d;
+        } else if (c == '.' && !seenDot) {
+            seenDot = true;
+        } else {
+            return false;
+        }
+    }
+    if (!seenDigit || scale > kMaxDecimalScale) return false;
+    out = {mantissa, static_cast<std::uint8_t>(scale)};
+    return true;
+}
+
+/// Correctly rounded while the mantissa stays below 2^53 (15 significant
+/// digits), which covers every price and quantity Binance publishes.
+inline double to_double(Decimal d) noexcept
+{
+    return static_cast<double>(d.mantissa) / kPow10d[d.scale];
+}
+
+/// A tickSize or stepSize: units * 10^-scale, e.g. 0.01 = {1, 2} and
+/// 0.00000500 = {5, 6}.
+struct Increment {
+    std::int64_t units = 1;
+    std::uint8_t scale = 8;
+};
+
+/// Parses a filter value such as "0.01000000"; fails on zero.
+bool parse_increment(std::string_view s, Increment& out);
+
+/// Recovers the decimal increment behind a double such as 0.00001, for
+/// symbol lists written out in code.  Values that are not a whole number of
+/// 10^-12 fall back to 10^-12.
+Increment increment_from_double(double value);
+
+/* Symbol Scale
+ * ------------
+ * Converts between a symbol's integer Price/Qty and the outside world:
+ * wire decimals and doubles in, exact decimal text out.
+ *
+ * Book prices and quantities are kept as whole ticks and steps, so levels
+ * are matched and ordered by integer comparison and an order can only be
+ * priced on tick and sized on step.  Doubles are produced only for the edge
+ * and sizing math, as integer / 10^scale, which is correctly rounded.
+ */
+class SymbolScale
+{
+    public:
+        /// 10^-8 for both, the precision Binance publishes with.
+        SymbolScale() = default;
+        SymbolScale(Increment tick, Increment step) : tick_(tick), step_(step) {}
+
+        Increment tick() const { return tick_; }
+        Increment step() const { return step_; }
+
+        /// Nearest tick / step to a wire decimal (exact when on tick).
+        Price price(Decimal d) const { return {to_units(d, tick_)}; }
+        Qty   qty(Decimal d)   const { return {to_units(d, step_)}; }
+
+        /// Nearest tick to a double price.
+        Price price_near(double px) const { return {from_double(px, tick_, false)}; }
+        /// Nearest step to a double quantity.
+        Qty   qty_near(double qty) const { return {from_double(qty, step_, false)}; }
+        /// Largest whole number of steps not above `qty`; use for orders so a
+        /// leg never spends more than it has.
+        Qty   qty_floor(double qty) const { return {from_double(qty, step_, true)}; }
+
+        double to_double(Price p) const { return as_double(p.ticks, tick_); }
+        double to_double(Qty q)   const { return as_double(q.steps, step_); }
+
+        /// Writes the exact decimal text ("0.02391", "104312.01") to `out`
+        /// and returns one past the last character.  `out` needs room for
+        /// kMaxText characters.
+        char* write(char* out, Price p) const { return write_units(out, p.ticks, tick_); }
+        char* write(char* out, Qty q)   const { return write_units(out, q.steps, step_); }
+
+        static constexpr std::size_t kMaxText = 40;
+
+    private:
+        static std::int64_t to_units(Decimal d, Increment inc);
+        static std::int64_t from_double(double v, Increment inc, bool floor);
+        static double as_double(std::int64_t n, Increment inc)
+        {
+            return static_cast<double>(n * inc.units) / kPow10d[inc.scale];
+        }
+        static char* write_units(char* out, std::int64_t n, Increment inc);
+
+        Increment tick_{};
+        Increment step_{};
+};
+
+} // namespace triarb
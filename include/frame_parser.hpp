@@ -0,0 +1,68 @@
+#pragma once
+#include "common.hpp"
+#include "fixed_point.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace triarb {
+
+/// Payload shapes understood by the frame parser.
+enum class FrameKind : std::uint8_t {
+    Invalid,
+    PartialDepth,   // <symbol>@depth<N>[@100ms]  {"lastUpdateId","bids","asks"}
+    DiffDepth,      // <symbol>@depth[@100ms]     {"e":"depthUpdate","E","s","U","u","b","a"}
+    BookTicker      // <symbol>@bookTicker        {"u","s","b","B","a","A"}
+};
+
+/// Result of parsing one combined-stream frame.
+///
+/// `stream` points into the parsed message, so a frame is only valid while
+/// that message is alive.  The level vectors are cleared but never shrunk,
+/// so reusing one `MarketFrame` across calls keeps the hot path free of
+/// heap allocations once the capacity has warmed up.
+struct MarketFrame {
+    FrameKind          kind = FrameKind::Invalid;
+    std::string_view   stream;
+    std::uint64_t      firstUpdateId = 0; // U (diff depth only)
+    std::uint64_t      lastUpdateId  = 0; // lastUpdateId / u
+    std::uint64_t      eventTime     = 0; // E (diff depth only), ms
+    std::vector<WireLevel> bids;   // exact decimals, see parse_fixed
+    std::vector<WireLevel> asks;
+
+    std::string        streamStorage; // backing store for the json fallback only
+};
+
+/// One <symbol>@bookTicker update: the best bid and ask and their
+/// quantities.  `stream` points into the parsed message.
+struct BookTickerFrame {
+    std::string_view stream;
+    std::uint64_t    updateId = 0;   // u, in the same sequence as the depth streams
+    WireLevel        bid;
+    WireLevel        ask;
+};
+
+/// Zero-allocation parser for Binance combined-stream depth and bookTicker
+/// frames.  Returns false when the frame is not one of the known shapes, in
+/// which case the caller may retry with `parse_market_frame_json`.
+bool parse_market_frame(std::string_view msg, MarketFrame& out);
+
+/// Parser specialised for bookTicker frames: it reads the fields in the
+/// order Binance sends them, in one forward pass, into a fixed-size frame.
+/// Returns false for anything else (depth frames included), so the caller
+/// can fall back to `parse_market_frame`.
+bool parse_book_ticker(std::string_view msg, BookTickerFrame& out);
+
+/// Parses the body of a REST `/api/v3/depth` response, which has the same
+/// shape as a partial depth payload.  `out.stream` is left empty.
+bool parse_depth_snapshot(std::string_view body, MarketFrame& out);
+
+/// Reference implementation on top of nlohmann::json.  Slower, but strict
+/// about JSON syntax; used as fallback and to validate the fast path.
+bool parse_market_frame_json(std::string_view msg, MarketFrame& out);
+
+/// Field-by-field comparison used by the parser validation mode.
+bool same_frame(const MarketFrame& a, const MarketFrame& b);
+
+} // namespace triarb
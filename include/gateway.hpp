@@ -1,5 +1,15 @@
 #pragma once
+#include "fixed_point.hpp"
+#include "https_pool.hpp"
+#include "inline_function.hpp"
+#include "latency.hpp"
+#include "order_template.hpp"
+#include "ws_api_session.hpp"
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <map>
+#include <memory>
 #include <string>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
@@ -20,13 +30,80 @@ struct FillReport
     double price_avg;    // VWAP
 };
 
+/// How live orders reach the exchange: signed REST POSTs on the keep-alive
+/// pool, or order.place requests on one WebSocket API session.
+enum class OrderTransport { Rest, WebSocket };
+
+/// Order-entry connection settings (ORDER_TRANSPORT, ORDER_POOL_SIZE,
+/// ORDER_IDLE_REFRESH, REST_PORT, CA_FILE and the SocketOptions
+/// environment variables).
+struct GatewayOptions
+{
+    OrderTransport            transport = OrderTransport::Rest;
+    std::string               port = "443";                    // REST: orders and depth snapshots
+    std::size_t               pool_size = 2;                   // warm keep-alive connections
+    std::chrono::milliseconds idle_refresh{std::chrono::seconds(50)}; // rebuild connections idle this long
+    std::string               ws_host = "ws-api.binance.com";  // WebSocket transport only
+    std::string               ws_port = "443";
+    std::string               ws_target = "/ws-api/v3";
+    std::string               ca_file;                         // extra trust anchor (local stand-ins)
+    triarb::SocketOptions     socket{.timestamps = false};     // responses are not stamped
+    triarb::LatencyMetrics*   latency = nullptr;               // records Span::OrderRtt when set
+};
+
+GatewayOptions load_gateway_options_from_env();
+
+/// Reads a POST /api/v3/order response: executed quantity and its VWAP
+/// (cummulativeQuoteQty / executedQty, or the fills if that is missing).
+/// success is false when nothing was executed or the body is not an order.
+FillReport parse_order_response(std::string_view body);
+
+/// Reads an order.place response of the WebSocket API: the same order
+/// object under "result" when "status" is 200.
+FillReport parse_ws_order_response(std::string_view frame);
+
+/// Hex-encoded HMAC-SHA256 of `msg` under `key`, as Binance expects in
+/// the `signature` parameter.  Redoes the key schedule on every call; orders are
+/// signed with a triarb::HmacSha256 keyed once.
+std::string hmac_sha256(const std::string& key, const std::string& msg);
+
+/// Unsigned, URL-encoded parameters of a LIMIT_MAKER IOC order.  The
+/// straightforward version of what OrderTemplate::rest_body() patches
+/// in place.
+std::string order_body(std::string_view symbol,
+                       std::string_view side,
+                       triarb::Qty qty,
+                       triarb::Price price,
+                       const triarb::SymbolScale& scale,
+                       std::int64_t timestamp_ms);
+
+/// Signed order.place request of the WebSocket API for the same order as
+/// order_body().  The signature covers every parameter, apiKey included,
+/// sorted by name.  OrderTemplate::ws_request() writes the same bytes
+/// without allocating.
+std::string ws_order_request(std::uint64_t id,
+                             std::string_view symbol,
+                             std::string_view side,
+                             triarb::Qty qty,
+                             triarb::Price price,
+                             const triarb::SymbolScale& scale,
+                             std::int64_t timestamp_ms,
+                             const ApiKeys& keys);
+
 class Gateway
 {
     public:
+        /// Order completions are held inline: an order allocates nothing
+        /// for its callbacks.
+        using FillCallback = triarb::InlineFunction<void(FillReport), 48>;
+        using SentCallback = triarb::InlineFunction<void(), 32>;
+
+        /// In live mode the order connections start connecting at once.
         Gateway(boost::asio::io_context& ioc,
                 std::string              rest_host,   // "api.binance.com"
                 ApiKeys                  keys,
-                bool                     live
+                bool                     live,
+                GatewayOptions           options = {}
             );
 
         /* Order Sender
@@ -37,9 +114,27 @@ class Gateway
         * Parameters:
         * - symbol:  Trading pair (e.g., "BTCUSDT")
         * - side:    Trade direction ("BUY" or "SELL")
-        * - qty:     Order quantity in base asset
-        * - price:   Limit order price
+        * - qty:     Order quantity in whole steps of the symbol
+        * - price:   Limit price in whole ticks of the symbol
+        * - scale:   The symbol's tick/step, used to write qty and price as
+        *            exact decimals
         * - cb:      Callback function that receives FillReport
+        * - on_sent: Optional; called once the signed request is ready to
+        *            write (before the simulated fill in dry-run), for
+        *            latency stamps
+        *
+        * Both callbacks live in inline buffers, so their captures must be
+        * small (FillCallback, SentCallback).  Over REST, once a connection
+        * has carried an order, the next one reaches malloc neither for the
+        * request and response nor for the socket operations, and a FULL
+        * response is read without building a JSON document.
+        *
+        * Live orders go out on a warm keep-alive connection of the pool,
+        * or with OrderTransport::WebSocket as an order.place request on
+        * the WebSocket API session, where other orders may still be in
+        * flight.  The response is parsed into the FillReport.  An order
+        * that gets no response (connection lost, 10 s timeout) reports
+        * failure and is not resent: it may still have executed.
         *
         * Trading Configuration:
         * - Uses LIMIT_MAKER order type to ensure maker fees
@@ -47,7 +142,8 @@ class Gateway
         * - 5000ms receive window for API
         * 
         * Example:
-        * gateway.send_order("BTCUSDT", "BUY", 0.001, 50000.00,
+        * gateway.send_order("BTCUSDT", "BUY", scale.qty_floor(0.001),
+        *     scale.price_near(50000.00), scale,
         *     [](FillReport report) {
         *         if(report.success) {
         *             std::cout << "Filled " << report.qty_filled 
@@ -58,10 +154,39 @@ class Gateway
         void send_order(
             std::string_view symbol,
             std::string_view side, // BUY / SELL
-            double qty,
-            double price,
-            std::function<void(FillReport)> cb
+            triarb::Qty qty,
+            triarb::Price price,
+            const triarb::SymbolScale& scale,
+            FillCallback cb,
+            SentCallback on_sent = {}
         );
+
+        /* Depth Snapshot Fetcher
+        * ----------------------
+        * GET /api/v3/depth?symbol=<symbol>&limit=<limit> over a one-shot
+        * HTTPS connection.  Market data needs no signature, so this works
+        * in dry-run mode as well.
+        *
+        * The callback receives ok=false and an error text when the request
+        * fails, otherwise the raw JSON body.
+        */
+        void fetch_depth(
+            std::string_view symbol,
+            unsigned limit,
+            std::function<void(bool ok, std::string body)> cb
+        );
+
+        /// Builds the BUY and SELL order templates of `symbol` ahead of its
+        /// first order (otherwise that order builds them).  No-op in dry-run.
+        void prepare_orders(std::string_view symbol);
+
+        /// Order connections handshaken and free right now (0 in dry-run).
+        /// The WebSocket session counts as one, busy or not.
+        std::size_t warm_connections() const
+        {
+            if (pool_) return pool_->ready();
+            return ws_ && ws_->ready() ? 1 : 0;
+        }
             
     private:
 
@@ -69,5 +194,22 @@ class Gateway
         boost::asio::io_context& ioc_;
         bool live_;
         ApiKeys keys_;
+        triarb::HmacSha256 signer_;                 // keyed with keys_.secret
         boost::asio::ssl::context ctx_;
+        GatewayOptions options_;
+        std::unique_ptr<triarb::HttpsPool> pool_;   // REST order connections
+        std::unique_ptr<triarb::WsApiSession> ws_;  // WebSocket order session
+        // Both null in dry-run
+
+        struct SymbolTemplates {
+            triarb::OrderTemplate buy;
+            triarb::OrderTemplate sell;
+        };
+        std::map<std::string, SymbolTemplates, std::less<>> templates_;
+
+        triarb::OrderTemplate& order_template(std::string_view symbol, std::string_view side);
+        void send_rest(std::string_view symbol, std::string_view body,
+                       FillCallback cb, SentCallback on_sent);
+        void send_ws(std::string_view symbol, std::uint64_t id, std::string_view request,
+                     FillCallback cb, SentCallback on_sent);
 };
@@ -0,0 +1,112 @@
+#pragma once
+#include "inline_function.hpp"
+#include "recycling_allocator.hpp"
+#include "socket_tuning.hpp"
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace triarb {
+
+/* HTTPS Keep-Alive Pool
+ * ---------------------
+ * A fixed number of HTTP/1.1 TLS connections to one host, resolved,
+ * connected and handshaken ahead of time, so a request only pays for its
+ * own round trip.  Each connection carries one request at a time; a
+ * request that finds none free waits for the first to become free, in a
+ * fixed queue of kMaxWaiting; one that finds the queue full fails at once
+ * with `no_buffer_space`, unsent.
+ *
+ * An idle connection always has a read armed, so a peer that closes it is
+ * noticed straight away and the connection is rebuilt in the background
+ * rather than on the next request.  Connections idle for longer than
+ * `idle_limit` are rebuilt too, before a server or middlebox drops them.
+ * A request in flight on a connection that breaks fails with an error; it
+ * is never resent, since the server may already have acted on it.  The
+ * request timeout runs from the call, not from the write: a request still
+ * queued when it expires fails with `timed_out` and is never sent.
+ *
+ * Requests, responses and the operations on them allocate from the
+ * thread's RecyclingArena, so once a connection has carried an order the
+ * next one of the same shape does not reach malloc.
+ *
+ * Everything runs on the io_context passed in; call from its thread only.
+ */
+class HttpsPool
+{
+    public:
+        using Fields   = boost::beast::http::basic_fields<RecyclingAllocator<char>>;
+        using Body     = boost::beast::http::basic_string_body<char, std::char_traits<char>,
+                                                               RecyclingAllocator<char>>;
+        using Request  = boost::beast::http::request<Body, Fields>;
+        using Response = boost::beast::http::response<Body, Fields>;
+        /// `ec` is set, and the response empty, when no response arrived.
+        using Callback = InlineFunction<void(boost::beast::error_code ec, Response res), 128>;
+
+        /// Requests that may wait for a free connection at once.
+        static constexpr std::size_t kMaxWaiting = 64;
+
+        HttpsPool(boost::asio::io_context& ioc,
+                  boost::asio::ssl::context& ctx,
+                  std::string host,
+                  std::string port,
+                  std::size_t size,
+                  std::chrono::milliseconds idle_limit,
+                  std::chrono::milliseconds request_timeout = std::chrono::seconds(10),
+                  SocketOptions socket = {});
+        ~HttpsPool();
+
+        HttpsPool(const HttpsPool&) = delete;
+        HttpsPool& operator=(const HttpsPool&) = delete;
+
+        /// Starts connecting every connection.
+        void start();
+
+        /// Sends `req` on a free connection, or queues it for the next one.
+        void async_request(Request req, Callback cb);
+
+        /// Connections handshaken and free right now.
+        std::size_t ready() const;
+        /// Successful handshakes so far, initial ones included.
+        std::uint64_t connects() const { return connects_; }
+
+    private:
+        class Connection;
+
+        using Clock = std::chrono::steady_clock;
+
+        struct Pending {
+            Request           req;
+            Callback          cb;
+            Clock::time_point deadline;
+        };
+
+        void on_ready(Connection& conn);
+        Pending take_waiting();
+        void expire_waiting();
+        void arm_expiry();
+
+        boost::asio::io_context&                 ioc_;
+        boost::asio::ssl::context&               ctx_;
+        std::string                              host_;
+        std::string                              port_;
+        std::chrono::milliseconds                idle_limit_;
+        std::chrono::milliseconds                request_timeout_;
+        SocketOptions                            socket_;
+        std::vector<std::shared_ptr<Connection>> conns_;
+        std::array<Pending, kMaxWaiting>         waiting_;     // ring, oldest at waiting_head_
+        std::size_t                              waiting_head_  = 0;
+        std::size_t                              waiting_count_ = 0;
+        boost::asio::steady_timer                expiry_;      // oldest waiting
+        std::uint64_t                            connects_ = 0;
+};
+
+} // namespace triarb
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace triarb {
+
+template <class Signature, std::size_t Capacity = 32>
+class InlineFunction;
+
+/* Inline Function
+ * ---------------
+ * A move-only stand-in for std::function on hot paths.  The callable lives
+ * in an inline buffer of `Capacity` bytes; one that does not fit is a
+ * compile error rather than a heap allocation.  A call is one indirect
+ * call through a plain function pointer, with no type-erasure vtable and
+ * no empty check: calling an empty InlineFunction is undefined.
+ */
+template <class R, class... Args, std::size_t Capacity>
+class InlineFunction<R(Args...), Capacity>
+{
+    public:
+        InlineFunction() noexcept = default;
+
+        template <class F,
+                  class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction>>>
+        InlineFunction(F&& f)
+        {
+            using Fn = std::decay_t<F>;
+            static_assert(sizeof(Fn) <= Capacity, "callable does not fit the inline buffer");
+            static_assert(alignof(Fn) <= alignof(std::max_align_t), "callable is over-aligned");
+            static_assert(std::is_nothrow_move_constructible_v<Fn>,
+                          "callable must be nothrow move constructible");
+
+            ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+            invoke_ = [](void* self, Args... args) -> R {
+                return (*static_cast<Fn*>(self))(std::forward<Args>(args)...);
+            };
+            manage_ = [](void* dst, void* src) noexcept {
+                if (dst) ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+            };
+        }
+
+        InlineFunction(InlineFunction&& other) noexcept { take(other); }
+
+        InlineFunction& operator=(InlineFunction&& other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        InlineFunction(const InlineFunction&) = delete;
+        InlineFunction& operator=(const InlineFunction&) = delete;
+
+        ~InlineFunction() { reset(); }
+
+        R operator()(Args... args) const
+        {
+            return invoke_(storage_, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const noexcept { return invoke_ != nullptr; }
+
+        void reset() noexcept
+        {
+            if (manage_) manage_(nullptr, storage_);
+            invoke_ = nullptr;
+            manage_ = nullptr;
+        }
+
+    private:
+        void take(InlineFunction& other) noexcept
+        {
+            if (!other.invoke_) return;
+            other.manage_(storage_, other.storage_);
+            invoke_ = std::exchange(other.invoke_, nullptr);
+            manage_ = std::exchange(other.manage_, nullptr);
+        }
+
+        alignas(std::max_align_t) mutable unsigned char storage_[Capacity];
+        R    (*invoke_)(void*, Args...)   = nullptr;
+        void (*manage_)(void*, void*)     = nullptr;   // move into dst (if any), destroy src
+};
+
+} // namespace triarb
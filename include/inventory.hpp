@@ -0,0 +1,124 @@
+#pragma once
+#include "common.hpp"
+#include "triangle_engine.hpp"
+#include "triangle_path.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace triarb {
+
+/// Pre-positioned balances and how far they may drift (INVENTORY,
+/// REBALANCE_THRESHOLD and REBALANCE_INTERVAL environment variables).
+struct InventoryOptions {
+    std::vector<std::pair<std::string, double>> targets;  // "USDT:150,ETH:0.05,BTC:0.0015"
+    double               threshold = 0.25;   // drift, as a fraction of target, worth a rebalance
+    std::chrono::seconds interval{30};       // how often drift is checked; 0 never rebalances
+};
+
+/// Throws std::invalid_argument on a malformed INVENTORY list.
+InventoryOptions load_inventory_options_from_env();
+
+/// What one leg of a triangle did, in its own assets.
+struct LegOutcome {
+    bool   filled = false;
+    double spent  = 0.0;     // of the asset the leg sells
+    double got    = 0.0;     // of the asset the leg buys
+};
+
+/// Where a triangle's legs left its three assets.
+struct LegRisk {
+    std::array<double, 3> delta{};   // net change of the cycle's assets, start asset first
+    double exposure = 0.0;           // home value of the non-home changes, absolute
+};
+
+/* Inventory
+ * ---------
+ * Balances of every asset the bot trades, starting from (and aiming back
+ * at) the configured targets, so all three legs of a triangle can be sent
+ * at once from assets already held instead of each waiting for the one
+ * before it to deliver.
+ *
+ * A triangle reserves each leg's input before it fires; a leg's response
+ * releases the reservation and books whatever was actually traded.  The
+ * difference from the targets is the drift: profit in the home asset,
+ * and rounding, partial fills and missed legs elsewhere.  Fees are left
+ * out; they are charged in whatever the account pays them in, and a
+ * rebalance tops the asset up all the same.  rebalance_plan()
+ * turns drift beyond the threshold into orders against the home asset,
+ * which the bot sends when no triangle is in flight.
+ *
+ * Owned by the strategy thread; not thread-safe.
+ */
+class Inventory
+{
+    public:
+        /// No assets; enabled() is false.
+        Inventory() = default;
+        /// Throws std::invalid_argument for an asset `engine` does not trade.
+        Inventory(const TriangleEngine& engine, const InventoryOptions& options);
+
+        bool enabled() const { return engine_ != nullptr; }
+
+        double balance(AssetId a)   const { return balance_[a]; }
+        double target(AssetId a)    const { return target_[a]; }
+        double reserved(AssetId a)  const { return reserved_[a]; }
+        double available(AssetId a) const { return balance_[a] - reserved_[a]; }
+        double drift(AssetId a)     const { return balance_[a] - target_[a]; }
+
+        /// Reserves what each leg of `t` spends (`inputs`, in each leg's
+        /// sold asset).  Reserves nothing and returns the first leg that
+        /// cannot be covered when any is short; 3 when all are reserved.
+        std::size_t reserve(const Triangle& t, const std::array<double, 3>& inputs);
+        void reserve(AssetId a, double amount)  { reserved_[a] += amount; }
+        void release(AssetId a, double amount);
+
+        /// Books a trade of `qty` base at `px` on `symbol`.
+        void apply_fill(SymbolId symbol, Side side, double qty, double px);
+
+        /// Net change of each asset of `t` after its legs, and the home
+        /// value of what is left in the other two.
+        LegRisk leg_risk(const Triangle& t, const std::array<LegOutcome, 3>& legs) const;
+
+        /// Value of `amount` of `a` in the home asset at the mid of their
+        /// direct pair; 0 if there is none or it has no quotes.
+        double home_value(AssetId a, double amount) const;
+
+        struct Rebalance {
+            SymbolId symbol;
+            Side     side;
+            double   qty;        // base asset
+            double   price;      // the touch the order crosses
+        };
+        /// Orders that bring every asset drifted beyond the threshold back
+        /// to its target, trading it against the home asset at the touch.
+        std::vector<Rebalance> rebalance_plan() const;
+
+        /// Counts a concurrent triangle and, if a leg missed, its exposure.
+        void record_triangle(const LegRisk& risk, bool broken);
+
+        /// Balance, target, drift and reservation per asset, and leg-risk
+        /// totals.
+        void report(std::ostream& out) const;
+
+    private:
+        const TriangleEngine* engine_ = nullptr;
+        double                threshold_ = 0.25;
+        std::vector<double>   balance_;      // by AssetId
+        std::vector<double>   target_;
+        std::vector<double>   reserved_;
+        std::vector<bool>     held_;         // configured in INVENTORY
+        std::vector<std::optional<SymbolId>> home_pair_;   // asset vs home, if listed
+
+        std::uint64_t triangles_     = 0;
+        std::uint64_t broken_        = 0;
+        double        exposure_sum_  = 0.0;
+        double        exposure_max_  = 0.0;
+};
+
+} // namespace triarb
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace triarb {
+
+/// What a journal record holds.
+enum class RecordKind : std::uint16_t {
+    Frame    = 1,   // raw combined-stream WebSocket frame
+    Snapshot = 2    // REST /api/v3/depth body; tag is the symbol
+};
+
+/// One record as read back from a journal.  The views point into the
+/// reader's mapping and stay valid while the reader is alive.
+struct JournalRecord {
+    std::uint64_t    recvNs = 0;   // receive time, ns since the Unix epoch
+    RecordKind       kind   = RecordKind::Frame;
+    std::string_view tag;
+    std::string_view payload;
+};
+
+/* Journal Writer
+ * --------------
+ * Append-only binary journal of everything the bot received, backed by a
+ * shared memory mapping of the file.
+ *
+ *   file   := header record*
+ *   header := "TRIARBJ1" u32 version u32 reserved
+ *   record := u64 recvNs  u32 payloadSize  u16 kind  u16 tagSize
+ *             tag payload  zero padding to 8 bytes
+ *
+ * Appending is a bounds check and two memcpys into the mapping; the kernel
+ * writes pages back on its own.  The file grows in fixed chunks, and its
+ * unused tail is zero, which readers treat as the end, so a journal cut
+ * short by a crash is still readable up to the last complete record.  The
+ * destructor trims the file to the bytes written.
+ *
+ * Not thread-safe; the bot appends from its I/O thread only.
+ */
+class JournalWriter
+{
+    public:
+        /// Creates or truncates `path`; throws std::runtime_error on failure.
+        explicit JournalWriter(const std::string& path,
+                               std::size_t chunk_bytes = 64u << 20);
+        ~JournalWriter();
+
+        JournalWriter(const JournalWriter&) = delete;
+        JournalWriter& operator=(const JournalWriter&) = delete;
+
+        void append(RecordKind kind, std::string_view tag,
+                    std::string_view payload, std::uint64_t recv_ns);
+
+        /// Bytes used so far, header included.
+        std::size_t size() const { return used_; }
+
+    private:
+        void grow(std::size_t at_least);
+
+        int          fd_       = -1;
+        char*        base_     = nullptr;
+        std::size_t  mapped_   = 0;
+        std::size_t  used_     = 0;
+        std::size_t  chunk_;
+};
+
+/// Sequential reader over a journal file, mapped read-only.
+class JournalReader
+{
+    public:
+        /// Throws std::runtime_error if the file is missing or not a journal.
+        explicit JournalReader(const std::string& path);
+        ~JournalReader();
+
+        JournalReader(const JournalReader&) = delete;
+        JournalReader& operator=(const JournalReader&) = delete;
+
+        /// Reads the next record; false at the end of the written data.
+        bool next(JournalRecord& out);
+
+        /// Starts again from the first record.
+        void rewind();
+
+    private:
+        const char*  base_ = nullptr;
+        std::size_t  size_ = 0;
+        std::size_t  pos_  = 0;
+};
+
+/// Current time for JournalRecord::recvNs.
+std::uint64_t journal_clock_ns();
+
+} // namespace triarb
@@ -0,0 +1,129 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace triarb {
+
+/// Monotonic nanoseconds for latency stamps.  steady_clock is a vDSO call
+/// on Linux; unlike the raw TSC it needs no calibration and is comparable
+/// across cores.
+inline std::uint64_t now_ns() noexcept
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/* Latency Histogram
+ * -----------------
+ * HDR-style log-linear histogram of nanosecond values.  Values below 64 get
+ * a bucket each; above that every power of two is split into 32 buckets, so
+ * a reported percentile is at most ~3% above the true value.  Values beyond
+ * 2^40 ns (~18 minutes) land in the last bucket.
+ *
+ * record() is a relaxed fetch_add on one counter plus a max update, so any
+ * number of threads may record while others read percentiles.  A read taken
+ * during recording is a near-consistent snapshot: each counter is exact,
+ * but counts and max may be a few records apart.
+ */
+class LatencyHistogram
+{
+    public:
+        static constexpr int         kLinearBits = 6;
+        static constexpr std::size_t kLinear     = std::size_t{1} << kLinearBits;   // 64
+        static constexpr std::size_t kSub        = kLinear / 2;                     // per octave
+        static constexpr int         kMaxBits    = 40;
+        static constexpr std::size_t kBuckets    = kLinear + (kMaxBits - kLinearBits) * kSub;
+
+        void record(std::uint64_t ns) noexcept
+        {
+            counts_[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+            std::uint64_t seen = max_.load(std::memory_order_relaxed);
+            while (ns > seen &&
+                   !max_.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+        }
+
+        /// Number of values recorded.
+        std::uint64_t count() const noexcept;
+        std::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+        /// Smallest bucket bound with at least `q` (0..1) of the values at or
+        /// below it, capped at max(); 0 while empty.
+        std::uint64_t percentile(double q) const noexcept;
+
+        void reset() noexcept;
+
+        static constexpr std::size_t bucket(std::uint64_t ns) noexcept
+        {
+            const int width = std::bit_width(ns);
+            if (width <= kLinearBits) return static_cast<std::size_t>(ns);
+            if (width > kMaxBits) return kBuckets - 1;
+            const int shift = width - kLinearBits;
+            return kLinear + static_cast<std::size_t>(shift - 1) * kSub
+                 + static_cast<std::size_t>((ns >> shift) - kSub);
+        }
+
+        /// Largest value that falls in bucket `b`.
+        static constexpr std::uint64_t upper_bound(std::size_t b) noexcept
+        {
+            if (b < kLinear) return b;
+            const int shift = static_cast<int>((b - kLinear) / kSub) + 1;
+            const std::uint64_t sub = (b - kLinear) % kSub + kSub;
+            return ((sub + 1) << shift) - 1;
+        }
+
+    private:
+        std::array<std::atomic<std::uint64_t>, kBuckets> counts_{};
+        std::atomic<std::uint64_t>                       max_{0};
+};
+
+/// Stage-to-stage spans of one frame's trip through the bot, and the age
+/// of the books the edge scan priced from.
+enum class Span : std::uint8_t {
+    Wire,           // kernel received the frame's last segment -> socket read completed
+    Queue,          // socket read completed -> strategy thread picked it up (pipelined mode)
+    Parse,          // socket read completed -> frame parsed
+    Book,           // parsed -> order book updated
+    Decide,         // book updated -> edge_scanner decided
+    Send,           // decided to fire -> first leg's request written
+    TickToTrade,    // socket read completed -> first leg's request written
+    WireToTrade,    // kernel received the frame -> first leg's request written
+    OrderRtt,       // order handed to a warm connection -> response received
+    FeedLag,        // exchange event -> frame received, less the clock offset (BookClock)
+    BookAge,        // oldest leg's book was current -> frame in hand received, per triangle over the threshold
+    BookSkew,       // oldest leg's book was current -> newest leg's, same triangles
+    Count
+};
+
+std::string_view to_string(Span span);
+
+/// One histogram per Span.
+class LatencyMetrics
+{
+    public:
+        void record(Span span, std::uint64_t ns) noexcept
+        {
+            spans_[static_cast<std::size_t>(span)].record(ns);
+        }
+
+        const LatencyHistogram& operator[](Span span) const
+        {
+            return spans_[static_cast<std::size_t>(span)];
+        }
+
+        /// Human-readable p50/p99/p99.9/max table, one line per span.
+        void report(std::ostream& out) const;
+
+        /// Prometheus text exposition: a summary per span.
+        std::string prometheus() const;
+
+    private:
+        std::array<LatencyHistogram, static_cast<std::size_t>(Span::Count)> spans_;
+};
+
+} // namespace triarb
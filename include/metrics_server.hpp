@@ -0,0 +1,34 @@
+#pragma once
+#include "latency.hpp"
+#include <boost/asio.hpp>
+#include <cstdint>
+
+namespace triarb {
+
+/* Metrics Endpoint
+ * ----------------
+ * Minimal HTTP/1.1 server on 127.0.0.1 that answers GET /metrics with the
+ * latency histograms in Prometheus text format, one request per
+ * connection.  Runs on the bot's io_context; scraping only reads the
+ * histograms, which never blocks the recording side.
+ */
+class MetricsServer
+{
+    public:
+        /// Binds 127.0.0.1:port; throws boost::system::system_error if the
+        /// port is taken.
+        MetricsServer(boost::asio::io_context& ioc, std::uint16_t port,
+                      const LatencyMetrics& metrics);
+
+        void start();
+
+        std::uint16_t port() const { return acceptor_.local_endpoint().port(); }
+
+    private:
+        void accept();
+
+        boost::asio::ip::tcp::acceptor acceptor_;
+        const LatencyMetrics&          metrics_;
+};
+
+} // namespace triarb
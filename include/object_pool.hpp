@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace triarb {
+
+/* Object Pool
+ * -----------
+ * A fixed number of preallocated slots handed out by index.  acquire()
+ * takes a free slot, release() gives it back; neither allocates, so state
+ * that lives from one event to a later one (a triangle from FIRE to its
+ * last fill) can be kept without touching the heap.  A slot keeps its old
+ * value until the caller overwrites it.  Single-threaded: one owner
+ * acquires and releases, though others may read a slot it has handed to
+ * them.
+ */
+template <class T>
+class ObjectPool
+{
+    public:
+        static constexpr std::uint32_t kNone = ~std::uint32_t{0};
+
+        explicit ObjectPool(std::size_t capacity)
+            : slots_(capacity)
+        {
+            free_.reserve(capacity);
+            for (std::size_t i = capacity; i > 0; --i)
+                free_.push_back(static_cast<std::uint32_t>(i - 1));
+        }
+
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        /// A free slot, lowest first after construction, or kNone when all
+        /// are in use.
+        std::uint32_t acquire() noexcept
+        {
+            if (free_.empty()) return kNone;
+            const auto slot = free_.back();
+            free_.pop_back();
+            return slot;
+        }
+
+        /// Gives back a slot acquire() returned; never reallocates.
+        void release(std::uint32_t slot) noexcept { free_.push_back(slot); }
+
+        T&       operator[](std::uint32_t slot)       { return slots_[slot]; }
+        const T& operator[](std::uint32_t slot) const { return slots_[slot]; }
+
+        std::size_t capacity() const noexcept { return slots_.size(); }
+        std::size_t in_use() const noexcept   { return slots_.size() - free_.size(); }
+
+    private:
+        std::vector<T>             slots_;
+        std::vector<std::uint32_t> free_;   // reserved for every slot
+};
+
+} // namespace triarb
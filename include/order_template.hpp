@@ -0,0 +1,83 @@
+#pragma once
+#include "fixed_point.hpp"
+#include <openssl/sha.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace triarb {
+
+/// Lower-case hex of `n` bytes into `out` (2n chars) through a byte->pair
+/// table; returns the end.
+char* hex_encode(const unsigned char* in, std::size_t n, char* out);
+
+/* HMAC-SHA256 Signer
+ * ------------------
+ * HMAC-SHA256 under one key, with the key schedule done once: the SHA-256
+ * states after the ipad and opad blocks are kept, and each signature
+ * starts from copies of them.  Signing allocates nothing and costs two
+ * SHA-256 passes over the message plus one over the inner digest.
+ */
+class HmacSha256
+{
+    public:
+        static constexpr std::size_t kHexSize = 2 * SHA256_DIGEST_LENGTH;
+
+        explicit HmacSha256(std::string_view key);
+
+        /// Writes the kHexSize-character hex signature of `msg` to `out`
+        /// and returns the end.
+        char* sign_hex(std::string_view msg, char* out) const;
+
+    private:
+        SHA256_CTX inner_;
+        SHA256_CTX outer_;
+};
+
+/* Order Template
+ * --------------
+ * The signed request bytes of LIMIT_MAKER IOC orders for one symbol and
+ * side, preformatted once.  Everything up to the first variable field
+ * (quantity for REST, price for the WebSocket API) is written into the
+ * buffers at construction; an order writes only its quantity, price,
+ * timestamp, id and signature behind it, in place.
+ *
+ * The output matches order_body() plus "&signature=..." and
+ * ws_order_request() byte for byte, and building it allocates nothing.
+ * Each call overwrites the previous request, so the view it returns is
+ * valid until the next call on the same template.
+ */
+class OrderTemplate
+{
+    public:
+        /// Throws std::length_error if the symbol or key cannot fit.
+        OrderTemplate(std::string_view symbol, std::string_view side, std::string_view api_key);
+
+        /// URL-encoded, signed body of POST /api/v3/order.
+        std::string_view rest_body(Qty qty, Price price, const SymbolScale& scale,
+                                   std::int64_t timestamp_ms, const HmacSha256& signer);
+
+        /// Signed order.place request of the WebSocket API with id `id`.
+        std::string_view ws_request(std::uint64_t id, Qty qty, Price price,
+                                    const SymbolScale& scale, std::int64_t timestamp_ms,
+                                    const HmacSha256& signer);
+
+    private:
+        // Room for the fixed text, three decimals of SymbolScale::kMaxText,
+        // two integers and a signature.
+        static constexpr std::size_t kBufferSize = 640;
+        using Buffer = std::array<char, kBufferSize>;
+
+        Buffer       rest_;
+        std::size_t  rest_head_ = 0;     // "symbol=...&quantity="
+        Buffer       ws_;
+        std::size_t  ws_head_   = 0;     // {"method":...,"price":"
+        Buffer       payload_;           // what the WebSocket signature covers
+        std::size_t  payload_head_ = 0;  // "apiKey=...&price="
+        std::string  ws_middle_;         // ...,"side":"BUY","symbol":"...",...,"timestamp":
+        std::string  payload_middle_;    // &recvWindow=5000&side=BUY&symbol=...&timestamp=
+};
+
+} // namespace triarb
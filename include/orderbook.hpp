@@ -1,25 +1,101 @@
 #pragma once
 #include "common.hpp"
+#include "fixed_point.hpp"
+#include "seqlock.hpp"
 #include <atomic>
+#include <span>
 #include <string>
 #include <mutex>
+#include <vector>
 
 namespace triarb {
 
+enum class BookSide { Bid, Ask };
+
+/// Best bid and ask published together with the update that produced them.
+struct TopOfBook {
+    Quote    bid{0.0, 0.0};
+    Quote    ask{0.0, 0.0};
+    uint64_t updateId = 0;
+};
+
+/// Price-level book for one symbol.
+///
+/// Levels are kept as whole ticks and steps of the symbol's SymbolScale and
+/// live in two flat sorted vectors with the best price at the back:
+/// bids ascending, asks descending.  Updates cluster around the touch, so
+/// inserts and erases there only move a handful of elements, and a top-N
+/// read is a contiguous copy of the last N entries.
+///
+/// Writers serialise on a mutex and, after every change, publish the top of
+/// book through a seqlock.  top(), bestBid() and bestAsk() read that copy and
+/// never take the lock.  The published copy and depth() are converted to
+/// doubles for the edge math.
 class OrderBook
 {
     public:
-        explicit OrderBook(std::string_view symbol);
-        void update(uint64_t updateId, const Quote& bid, const Quote& ask);
-        Quote bestBid() const;
-        Quote bestAsk() const;
+        explicit OrderBook(std::string_view symbol, SymbolScale scale = {});
+
+        /// Replaces the book with a single level per side, rounded to the
+        /// nearest tick and step.  Returns false, leaving the book as it
+        /// was, for an update id it has already seen.
+        bool update(uint64_t updateId, const Quote& bid, const Quote& ask);
+
+        /// Replaces the book with a full snapshot (partial depth stream or
+        /// REST /api/v3/depth).  Levels are given best first.  Returns false
+        /// for an update id the book has already seen, such as the copy of
+        /// a frame from a second feed.
+        bool apply_snapshot(uint64_t updateId,
+                            std::span<const WireLevel> bids,
+                            std::span<const WireLevel> asks);
+
+        /// Sets the best level of each side from a bookTicker update: levels
+        /// better than the new best are gone, the best level's quantity is
+        /// replaced, and deeper levels are kept.  Returns false for an update
+        /// id the book has already seen, so a ticker older than the latest
+        /// depth snapshot does not roll the top back.
+        bool apply_top(uint64_t updateId, const WireLevel& bid, const WireLevel& ask);
+
+        /// Applies a diff-depth event: each level sets the absolute quantity
+        /// at its price, and a zero quantity removes the level.
+        void apply_diff(uint64_t updateId,
+                        std::span<const WireLevel> bids,
+                        std::span<const WireLevel> asks);
+
+        /// Drops all levels and resets the update id (used before a resync).
+        void clear();
+
+        /// Lock-free, consistent bid/ask/updateId triple.
+        TopOfBook top() const { return top_.load(); }
+        Quote bestBid() const { return top().bid; }
+        Quote bestAsk() const { return top().ask; }
+
+        /// Copies up to out.size() levels of one side, best first.
+        std::size_t depth(BookSide side, std::span<Quote> out) const;
+        std::size_t levels(BookSide side) const;
+
+        uint64_t lastUpdateId() const { return lastUpdatedId_; }
+        const std::string& symbol() const { return symbol_; }
+        const SymbolScale& scale() const { return scale_; }
 
     private:
+        struct Level {
+            Price px;
+            Qty   qty;
+        };
+
+        Level level(const WireLevel& w) const { return {scale_.price(w.px), scale_.qty(w.qty)}; }
+        Quote quote(const Level& l) const { return {scale_.to_double(l.px), scale_.to_double(l.qty)}; }
+        void assign_reversed(std::vector<Level>& side, std::span<const WireLevel> levels) const;
+        void publish();   // call with mutex_ held
+
         std::string symbol_;
+        SymbolScale scale_;
         std::atomic<uint64_t> lastUpdatedId_{0};
-        Quote bestBid_ {0.0, 0.0};
-        Quote bestAsk_ {0.0, 0.0};
+        std::vector<Level> bids_;   // ascending, best bid at back()
+        std::vector<Level> asks_;   // descending, best ask at back()
         mutable std::mutex mutex_;
+        SeqLock<TopOfBook> top_;
 };
 
 } // namespace triarb
@@ -0,0 +1,93 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace triarb {
+
+/// Threading model and thread placement (THREADING, NET_CPU, STRATEGY_CPU,
+/// EGRESS_CPU, STRATEGY_BUSY_POLL, SHARDS and SHARD_CPUS environment
+/// variables).
+struct PipelineOptions {
+    bool enabled      = false;  // THREADING=pipelined; otherwise one io_context thread
+    int  net_cpu      = -1;     // CPU to pin each thread to; -1 leaves it to the scheduler
+    int  strategy_cpu = -1;
+    int  egress_cpu   = -1;
+    bool busy_poll    = false;  // strategy thread(s) spin instead of sleeping when idle
+    std::size_t      shards = 0;   // THREADING=sharded: strategy threads, each with its own feeds
+    std::vector<int> shard_cpus;   // CPU of each shard in turn; unpinned past the end
+
+    bool operator==(const PipelineOptions&) const = default;
+};
+
+/// Shards when THREADING=sharded and SHARDS is not given.
+constexpr std::size_t kDefaultShards = 2;
+
+/// Throws std::runtime_error on a CPU index the machine does not have and
+/// std::invalid_argument on a THREADING other than single, pipelined or
+/// sharded, a SHARDS below 1 or a malformed SHARD_CPUS.
+PipelineOptions load_pipeline_options_from_env();
+
+/// Returns `cpu` if this machine has it (or it is -1); throws
+/// std::runtime_error naming `name` otherwise.
+int check_cpu(int cpu, std::string_view name);
+
+/// Pins the calling thread to `cpu` (no-op for -1); false if the kernel
+/// refused.
+bool pin_current_thread(int cpu);
+
+/* Pipeline Worker
+ * ---------------
+ * One thread of the pipelined mode.  It owns an io_context for whatever
+ * asynchronous work lives on it (sockets, timers, rare cross-thread posts)
+ * and, optionally, a `poll` function that drains the lock-free queues
+ * feeding it and returns whether it found anything.
+ *
+ * Without a poll function the thread simply runs the io_context.  With
+ * one, it alternates between the queues and ready handlers; when both are
+ * dry it either spins (busy_poll) or sleeps in the io_context until a
+ * handler arrives.  Producers call wake() after publishing to a queue: it
+ * costs one atomic load while the worker is busy, and posts an empty
+ * handler only when the worker has gone to sleep.
+ */
+class Worker
+{
+    public:
+        using Poll = std::function<bool()>;
+
+        Worker(std::string name, int cpu, bool busy_poll = false);
+        ~Worker();
+
+        Worker(const Worker&) = delete;
+        Worker& operator=(const Worker&) = delete;
+
+        boost::asio::io_context& ioc() { return ioc_; }
+
+        /// Starts the thread.
+        void start(Poll poll = {});
+
+        /// Producer side: the worker's queues have something new.
+        void wake();
+
+        /// Stops the io_context and joins the thread; idempotent.
+        void stop();
+
+    private:
+        void run();
+
+        std::string             name_;
+        int                     cpu_;
+        bool                    busy_poll_;
+        Poll                    poll_;
+        boost::asio::io_context ioc_;
+        std::atomic<bool>       idle_{false};
+        std::atomic<bool>       stopped_{false};
+        std::thread             thread_;
+};
+
+} // namespace triarb
@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace triarb {
+
+/* RCU Cell
+ * --------
+ * An immutable value that one reader thread picks up with a single
+ * acquire load, and that any other thread may replace whole.
+ *
+ * publish() builds the new value, swaps the pointer and retires the old
+ * one; publishers are serialised by a mutex, since replacing the value is
+ * rare.  Retired values are freed once the reader has gone past them: the
+ * reader publishes the generation of the value it holds, and only does so
+ * when that value changes, so a steady-state read() is one load and a
+ * compare.  The reference read() returns stays valid until the reader's
+ * next read(); the reader must not keep it longer.
+ */
+template <class T>
+class RcuCell
+{
+    public:
+        explicit RcuCell(T initial)
+            : current_(new Node{std::move(initial), 0})
+            , held_(current_.load(std::memory_order_relaxed))
+        {
+        }
+
+        RcuCell(const RcuCell&) = delete;
+        RcuCell& operator=(const RcuCell&) = delete;
+
+        ~RcuCell() { delete current_.load(std::memory_order_relaxed); }
+
+        /// Reader thread only.
+        const T& read() noexcept
+        {
+            const Node* node = current_.load(std::memory_order_acquire);
+            if (node != held_) {
+                held_ = node;
+                seen_.store(node->generation, std::memory_order_release);
+            }
+            return node->value;
+        }
+
+        /// Any thread.  The reader sees `next` from its next read() on.
+        void publish(T next)
+        {
+            std::lock_guard lock(mutex_);
+            const auto* node = new Node{std::move(next), ++generation_};
+            retired_.emplace_back(current_.exchange(node, std::memory_order_acq_rel));
+            free_seen();
+        }
+
+        /// Frees the retired values the reader has gone past; publish()
+        /// does this too.
+        void collect()
+        {
+            std::lock_guard lock(mutex_);
+            free_seen();
+        }
+
+        /// Retired values still waiting for the reader.
+        std::size_t retired() const
+        {
+            std::lock_guard lock(mutex_);
+            return retired_.size();
+        }
+
+    private:
+        struct Node {
+            T             value;
+            std::uint64_t generation;
+        };
+
+        void free_seen()
+        {
+            const auto seen = seen_.load(std::memory_order_acquire);
+            std::erase_if(retired_, [seen](const std::unique_ptr<const Node>& n) {
+                return n->generation < seen;
+            });
+        }
+
+        std::atomic<const Node*>           current_;
+        const Node*                        held_;           // reader only
+        std::atomic<std::uint64_t>         seen_{0};        // generation the reader holds
+        mutable std::mutex                 mutex_;          // publishers
+        std::uint64_t                      generation_ = 0;
+        std::vector<std::unique_ptr<const Node>> retired_;
+};
+
+} // namespace triarb
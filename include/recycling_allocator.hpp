@@ -0,0 +1,201 @@
+#pragma once
+#include <boost/asio/associated_executor.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace triarb {
+
+/* Recycling Arena
+ * ---------------
+ * Per-thread free lists of memory blocks in 64-byte size classes up to
+ * 4 KiB.  A freed block goes on the list of its class and the next request
+ * of that class takes it back, so code that allocates the same shapes over
+ * and over -- asio operation state, HTTP header fields, response bodies --
+ * stops calling operator new after its first round.  Larger blocks, and
+ * blocks beyond kKeep per class, go straight back to operator delete.
+ *
+ * A block freed on another thread joins that thread's lists; blocks are
+ * plain operator new memory, so that is only a question of where they are
+ * cached.  Blocks freed after the thread's arena is gone are deleted.
+ */
+class RecyclingArena
+{
+    public:
+        static constexpr std::size_t kGranule = 64;
+        static constexpr std::size_t kClasses = 64;       // blocks up to 4 KiB
+        static constexpr std::size_t kKeep    = 64;       // cached blocks per class
+
+        /// The calling thread's arena.
+        static RecyclingArena& local() noexcept
+        {
+            thread_local RecyclingArena arena;
+            return arena;
+        }
+
+        RecyclingArena(const RecyclingArena&) = delete;
+        RecyclingArena& operator=(const RecyclingArena&) = delete;
+
+        ~RecyclingArena()
+        {
+            gone() = true;
+            for (auto& list : free_)
+                while (Block* b = list.head) {
+                    list.head = b->next;
+                    ::operator delete(b);
+                }
+        }
+
+        void* allocate(std::size_t bytes)
+        {
+            const std::size_t c = size_class(bytes);
+            if (c >= kClasses) return ::operator new(bytes);
+            auto& list = free_[c];
+            if (Block* b = list.head) {
+                list.head = b->next;
+                --list.count;
+                return b;
+            }
+            return ::operator new((c + 1) * kGranule);
+        }
+
+        void deallocate(void* p, std::size_t bytes) noexcept
+        {
+            const std::size_t c = size_class(bytes);
+            if (c >= kClasses || list_full(c)) return ::operator delete(p);
+            auto& list = free_[c];
+            list.head = ::new (p) Block{list.head};
+            ++list.count;
+        }
+
+        /// Blocks waiting on the free lists.
+        std::size_t cached() const noexcept
+        {
+            std::size_t n = 0;
+            for (const auto& list : free_) n += list.count;
+            return n;
+        }
+
+        /// Frees `p` from `bytes` through the calling thread's arena, or
+        /// deletes it if that arena has already been destroyed.
+        static void release(void* p, std::size_t bytes) noexcept
+        {
+            if (gone()) return ::operator delete(p);
+            local().deallocate(p, bytes);
+        }
+
+        static void* obtain(std::size_t bytes)
+        {
+            if (gone()) return ::operator new(bytes);
+            return local().allocate(bytes);
+        }
+
+    private:
+        RecyclingArena() = default;
+
+        struct Block {
+            Block* next;
+        };
+        struct FreeList {
+            Block*      head  = nullptr;
+            std::size_t count = 0;
+        };
+
+        static std::size_t size_class(std::size_t bytes) noexcept
+        {
+            return bytes == 0 ? 0 : (bytes - 1) / kGranule;
+        }
+
+        bool list_full(std::size_t c) const noexcept { return free_[c].count >= kKeep; }
+
+        // Trivially destructible, so still readable while thread-local
+        // objects are being destroyed
+        static bool& gone() noexcept
+        {
+            thread_local bool flag = false;
+            return flag;
+        }
+
+        FreeList free_[kClasses];
+};
+
+/// A stateless std allocator drawing from the calling thread's
+/// RecyclingArena.
+template <class T>
+class RecyclingAllocator
+{
+    public:
+        using value_type = T;
+
+        RecyclingAllocator() noexcept = default;
+        template <class U>
+        RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {}
+
+        T* allocate(std::size_t n)
+        {
+            static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                          "over-aligned types need their own allocator");
+            return static_cast<T*>(RecyclingArena::obtain(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept
+        {
+            RecyclingArena::release(p, n * sizeof(T));
+        }
+
+        template <class U>
+        bool operator==(const RecyclingAllocator<U>&) const noexcept { return true; }
+};
+
+/* Recycling Handler
+ * -----------------
+ * Wraps an asio completion handler so that RecyclingAllocator is its
+ * associated allocator.  Asio allocates the operation's state with it,
+ * and Beast the state of its composed operations (an HTTP serializer, a
+ * TLS write), so an operation started over and over reuses the same
+ * blocks instead of reaching malloc each time.  The associated executor
+ * is the wrapped handler's.
+ */
+template <class Handler>
+class RecyclingHandler
+{
+    public:
+        using allocator_type = RecyclingAllocator<void>;
+
+        explicit RecyclingHandler(Handler handler) : handler_(std::move(handler)) {}
+
+        allocator_type get_allocator() const noexcept { return {}; }
+
+        template <class... Args>
+        void operator()(Args&&... args)
+        {
+            handler_(std::forward<Args>(args)...);
+        }
+
+        const Handler& handler() const noexcept { return handler_; }
+
+    private:
+        Handler handler_;
+};
+
+template <class Handler>
+RecyclingHandler<std::decay_t<Handler>> recycling(Handler&& handler)
+{
+    return RecyclingHandler<std::decay_t<Handler>>(std::forward<Handler>(handler));
+}
+
+} // namespace triarb
+
+template <class Handler, class Executor>
+struct boost::asio::associated_executor<triarb::RecyclingHandler<Handler>, Executor>
+{
+    using type = associated_executor_t<Handler, Executor>;
+
+    static type get(const triarb::RecyclingHandler<Handler>& h,
+                    const Executor& ex = Executor()) noexcept
+    {
+        return associated_executor<Handler, Executor>::get(h.handler(), ex);
+    }
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include "journal.hpp"
+#include "triarb_bot.hpp"
+#include <boost/asio.hpp>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace triarb {
+
+/// Parses a replay speed: "max" (as fast as possible, 0), "realtime" (1)
+/// or "<N>x" such as "10x" or "0.5x".  nullopt on anything else.
+std::optional<double> parse_replay_speed(std::string_view text);
+
+/* Journal Replay
+ * --------------
+ * Feeds every record of `journal` to `bot`, which must have been built
+ * with BotOptions::replay.  With speed > 0 the records are paced so that
+ * the gap between two of them is their recorded gap divided by `speed`;
+ * with speed 0 they are fed back to back.  Handlers the bot posted to `ioc`
+ * run between records.  A pipelined bot is drained before this returns.
+ * Returns the number of records fed.
+ *
+ * The bot only sees recorded receive times, never the wall clock, so the
+ * pacing changes how long a replay takes but not what it decides.
+ */
+std::size_t replay_journal(TriArbBot& bot, boost::asio::io_context& ioc,
+                           JournalReader& journal, double speed);
+
+} // namespace triarb
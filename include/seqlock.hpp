@@ -0,0 +1,62 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace triarb {
+
+/// Single-writer sequence lock.
+///
+/// The writer bumps the sequence to odd, stores the payload and bumps it to
+/// even again; readers retry until they see the same even sequence before
+/// and after copying.  Readers never block the writer and never observe a
+/// half-written value.  The payload is kept in relaxed atomic words so the
+/// concurrent copy is well defined.
+template <class T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "SeqLock payload must be trivially copyable");
+
+    public:
+        /// Must not be called concurrently with itself.
+        void store(const T& value) noexcept
+        {
+            std::array<std::uint64_t, kWords> buf{};
+            std::memcpy(buf.data(), &value, sizeof(T));
+
+            const auto seq = seq_.load(std::memory_order_relaxed);
+            seq_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (std::size_t i = 0; i < kWords; ++i)
+                words_[i].store(buf[i], std::memory_order_relaxed);
+            seq_.store(seq + 2, std::memory_order_release);
+        }
+
+        T load() const noexcept
+        {
+            std::array<std::uint64_t, kWords> buf;
+            std::uint64_t before, after;
+            do {
+                before = seq_.load(std::memory_order_acquire);
+                for (std::size_t i = 0; i < kWords; ++i)
+                    buf[i] = words_[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = seq_.load(std::memory_order_relaxed);
+            } while (before != after || (before & 1));
+
+            T value;
+            std::memcpy(static_cast<void*>(&value), buf.data(), sizeof(T));
+            return value;
+        }
+
+    private:
+        static constexpr std::size_t kWords = (sizeof(T) + 7) / 8;
+
+        alignas(64) std::atomic<std::uint64_t> seq_{0};
+        std::array<std::atomic<std::uint64_t>, kWords> words_{};
+};
+
+} // namespace triarb
@@ -0,0 +1,36 @@
+#pragma once
+#include "common.hpp"
+#include "triangle_engine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace triarb {
+
+/* Shard Plan
+ * ----------
+ * Which strategy thread owns each symbol in the sharded mode.  The owner
+ * subscribes to the symbol's streams, applies its frames to the book and
+ * scans the triangles that trade it; every other shard only reads that
+ * book, through the OrderBook seqlock (top) and lock (depth).
+ *
+ * The cost of a symbol is the number of triangles its updates rescan, so
+ * symbols are dealt heaviest first to whichever shard carries the least
+ * so far.  Without per-symbol message rates this balances scan work rather
+ * than frames, which is what grows with the universe.  The plan depends
+ * only on the engine, so every run of the same universe shards the same.
+ */
+struct ShardPlan {
+    std::vector<std::uint32_t>         owner;     // by SymbolId
+    std::vector<std::vector<SymbolId>> symbols;   // by shard: the traded symbols it owns
+    std::vector<std::size_t>           load;      // by shard: triangles its symbols rescan
+    std::size_t                        shared = 0; // triangles with legs on more than one shard
+
+    std::size_t shards() const { return symbols.size(); }
+};
+
+/// Deals `engine`'s traded symbols across `shards` (at least 1) threads.
+/// Symbols no triangle trades belong to shard 0 and are in no list.
+ShardPlan plan_shards(const TriangleEngine& engine, std::size_t shards);
+
+} // namespace triarb
@@ -0,0 +1,175 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <boost/beast/core/error.hpp>
+#include <sys/uio.h>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace triarb {
+
+/// Kernel socket options for the feed and order connections (SOCKET_NODELAY,
+/// SOCKET_BUSY_POLL, SOCKET_RCVBUF, SOCKET_SNDBUF, SOCKET_QUICKACK and
+/// SOCKET_TIMESTAMPS environment variables).
+struct SocketOptions {
+    bool nodelay      = true;    // TCP_NODELAY: small writes go out without waiting for ACKs
+    int  busy_poll_us = 0;       // SO_BUSY_POLL: spin on the device queue of an empty read; 0 is off
+    int  rcvbuf       = 0;       // SO_RCVBUF bytes; 0 keeps the kernel's autotuning
+    int  sndbuf       = 0;       // SO_SNDBUF bytes; 0 keeps the kernel's autotuning
+    bool quickack     = false;   // TCP_QUICKACK, re-armed after every read
+    bool timestamps   = true;    // SO_TIMESTAMPING software receive stamps (feeds only)
+
+    bool operator==(const SocketOptions&) const = default;
+};
+
+/// How long the feed and order connections wait before retrying an attempt
+/// that failed.  One that was up and then closed is replaced at once.
+inline constexpr std::chrono::milliseconds kReconnectDelay{500};
+
+/// Throws std::invalid_argument on a value that is not a flag or a
+/// non-negative number.
+SocketOptions load_socket_options_from_env();
+
+/// Applies `options` to the connected socket `fd`.  Every option is tried;
+/// one the kernel refuses (SO_BUSY_POLL above net.core.busy_read needs
+/// CAP_NET_ADMIN) is named on stderr and the rest still apply.  Returns how
+/// many were refused.
+int tune_socket(int fd, const SocketOptions& options);
+
+/// Sets TCP_QUICKACK on `fd` again; the kernel drops it whenever it goes
+/// back to delaying ACKs.
+void rearm_quickack(int fd) noexcept;
+
+/// One non-blocking recvmsg() on `fd`.  If the kernel attached a software
+/// receive stamp, `kernel_ns` becomes the time the last segment read
+/// arrived, moved onto the now_ns() clock.  Re-arms TCP_QUICKACK when
+/// `quickack` is set, since the kernel clears it.  `ec` is would_block when
+/// nothing was waiting and eof when the peer has closed.
+std::size_t receive_stamped(int fd, const iovec* iov, std::size_t count, bool quickack,
+                            std::uint64_t& kernel_ns, boost::beast::error_code& ec);
+
+/* Stamped Stream
+ * --------------
+ * A stream layer over a beast::tcp_stream that, once stamping is switched
+ * on, reads with recvmsg() so that the SO_TIMESTAMPING stamp of the data
+ * comes back with it.  kernel_ns() is the arrival time of the last segment
+ * read, on the now_ns() clock; comparing it with the time a frame reaches
+ * its handler shows how long the frame waited in the kernel and in the
+ * TLS and WebSocket layers above.
+ *
+ * A read tries recvmsg() first and waits for the socket only when nothing
+ * is there, as asio's own reads do.  While stamping is off, reads go to the
+ * tcp_stream, whose expiry then covers them: switch it on once the
+ * handshakes are done and the layers above keep their own timeouts.
+ * Writes always go to the tcp_stream.
+ *
+ * TLS reads ahead, so a frame decoded from data already buffered shares
+ * the stamp of the read that brought it in.
+ */
+template <class NextLayer>
+class StampedStream
+{
+    public:
+        using next_layer_type   = NextLayer;
+        using lowest_layer_type = std::remove_reference_t<
+            decltype(std::declval<NextLayer&>().socket())>;
+        using executor_type     = typename NextLayer::executor_type;
+
+        template <class... Args>
+        explicit StampedStream(Args&&... args) : next_(std::forward<Args>(args)...) {}
+
+        executor_type get_executor() noexcept { return next_.get_executor(); }
+
+        NextLayer&       next_layer() noexcept       { return next_; }
+        const NextLayer& next_layer() const noexcept { return next_; }
+        lowest_layer_type&       lowest_layer() noexcept       { return next_.socket(); }
+        const lowest_layer_type& lowest_layer() const noexcept { return next_.socket(); }
+
+        /// Reads through recvmsg() from now on (`stamp`), re-arming
+        /// TCP_QUICKACK after each read if `quickack`.
+        void stamp(bool stamp, bool quickack = false) noexcept
+        {
+            stamping_ = stamp;
+            quickack_ = quickack;
+        }
+
+        /// now_ns() arrival time of the last segment read; 0 before the
+        /// first stamped read.
+        std::uint64_t kernel_ns() const noexcept { return kernel_ns_; }
+
+        template <class MutableBuffers, class ReadHandler>
+        auto async_read_some(const MutableBuffers& buffers, ReadHandler&& handler)
+        {
+            if (!stamping_)
+                return next_.async_read_some(buffers, std::forward<ReadHandler>(handler));
+            return boost::asio::async_compose<ReadHandler,
+                                              void(boost::beast::error_code, std::size_t)>(
+                ReadOp<MutableBuffers>(*this, buffers), handler, next_.socket());
+        }
+
+        template <class ConstBuffers, class WriteHandler>
+        auto async_write_some(const ConstBuffers& buffers, WriteHandler&& handler)
+        {
+            return next_.async_write_some(buffers, std::forward<WriteHandler>(handler));
+        }
+
+    private:
+        template <class MutableBuffers>
+        struct ReadOp {
+            enum class Step : std::uint8_t { Start, Ready, Waiting };
+
+            ReadOp(StampedStream& s, const MutableBuffers& b) : stream(s), buffers(b) {}
+
+            StampedStream&      stream;
+            MutableBuffers      buffers;
+            Step                step  = Step::Start;
+            std::size_t         bytes = 0;
+            boost::beast::error_code result;
+
+            template <class Self>
+            void operator()(Self& self, boost::beast::error_code ec = {})
+            {
+                if (step == Step::Ready) return self.complete(result, bytes);
+                if (ec) return self.complete(ec, 0);
+
+                receive();
+                if (result == boost::asio::error::would_block) {
+                    step = Step::Waiting;
+                    return stream.next_.socket().async_wait(
+                        boost::asio::socket_base::wait_read, std::move(self));
+                }
+                // Completing from inside async_read_some would run the
+                // handler before its caller returns
+                if (step == Step::Start) {
+                    step = Step::Ready;
+                    return boost::asio::post(stream.get_executor(), std::move(self));
+                }
+                self.complete(result, bytes);
+            }
+
+            void receive()
+            {
+                std::array<iovec, 8> iov;
+                std::size_t count = 0;
+                for (auto it = boost::asio::buffer_sequence_begin(buffers);
+                     it != boost::asio::buffer_sequence_end(buffers) && count < iov.size(); ++it) {
+                    const boost::asio::mutable_buffer b(*it);
+                    if (b.size() > 0) iov[count++] = {b.data(), b.size()};
+                }
+                result = {};
+                bytes  = count == 0 ? 0
+                       : receive_stamped(stream.next_.socket().native_handle(), iov.data(),
+                                         count, stream.quickack_, stream.kernel_ns_, result);
+            }
+        };
+
+        NextLayer     next_;
+        std::uint64_t kernel_ns_ = 0;
+        bool          stamping_  = false;
+        bool          quickack_  = false;
+};
+
+} // namespace triarb
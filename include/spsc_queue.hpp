@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace triarb {
+
+/* SPSC Queue
+ * ----------
+ * Bounded single-producer/single-consumer ring of preallocated slots.  The
+ * producer fills a slot in place and publishes it; the consumer reads it in
+ * place and pops it.  Nothing is allocated or copied by the queue after
+ * construction, so slots that own buffers (strings, vectors) keep their
+ * capacity from one use to the next.
+ *
+ * Each side caches the other side's index and only rereads it when the
+ * ring looks full (producer) or empty (consumer), so the common case
+ * touches no shared cache line but the one being written.
+ */
+template <class T>
+class SpscQueue
+{
+    public:
+        /// `capacity` is rounded up to a power of two (at least 2).
+        explicit SpscQueue(std::size_t capacity)
+            : slots_(std::bit_ceil(std::max<std::size_t>(capacity, 2)))
+            , mask_(slots_.size() - 1)
+        {}
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        /// Producer: the next free slot, or null when the ring is full.
+        T* claim() noexcept
+        {
+            const auto head = head_.load(std::memory_order_relaxed);
+            if (head - tail_cache_ == slots_.size()) {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+                if (head - tail_cache_ == slots_.size()) return nullptr;
+            }
+            return &slots_[head & mask_];
+        }
+
+        /// Producer: makes the slot returned by claim() visible.
+        void publish() noexcept
+        {
+            head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /// Consumer: the oldest published slot, or null when empty.
+        T* front() noexcept
+        {
+            const auto tail = tail_.load(std::memory_order_relaxed);
+            if (tail == head_cache_) {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (tail == head_cache_) return nullptr;
+            }
+            return &slots_[tail & mask_];
+        }
+
+        /// Consumer: releases the slot returned by front().
+        void pop() noexcept
+        {
+            tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /// Every slot, for preparing them before the queue is used.
+        std::vector<T>& slots() { return slots_; }
+
+        std::size_t   capacity() const { return slots_.size(); }
+        /// Slots published and popped so far; safe to read from any thread.
+        std::uint64_t pushed() const { return head_.load(std::memory_order_acquire); }
+        std::uint64_t popped() const { return tail_.load(std::memory_order_acquire); }
+        bool          empty()  const { return popped() == pushed(); }
+
+    private:
+        std::vector<T>             slots_;
+        std::size_t                mask_;
+        alignas(64) std::atomic<std::uint64_t> head_{0};   // written by the producer
+        std::uint64_t              tail_cache_ = 0;        // producer's copy of tail_
+        alignas(64) std::atomic<std::uint64_t> tail_{0};   // written by the consumer
+        std::uint64_t              head_cache_ = 0;        // consumer's copy of head_
+};
+
+} // namespace triarb
@@ -0,0 +1,114 @@
+#pragma once
+#include "common.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace triarb {
+
+/* Symbol Table
+ * ------------
+ * Resolves a symbol name ("ETHBTC", "ethbtc@depth5@100ms") to its SymbolId
+ * without hashing or comparing strings.  Names (ASCII letters and digits,
+ * matched case-insensitively) are packed into three 64-bit words once; a
+ * lookup packs the incoming name the same way and probes an open-addressing
+ * table comparing words.
+ *
+ * Built once at subscription time; lookups are read-only and allocation free.
+ */
+class SymbolTable
+{
+    public:
+        /// Longest name that can be packed; longer names are rejected.
+        static constexpr std::size_t kMaxLength = 24;
+
+        /// Adds `name`; throws std::invalid_argument if it is too long or
+        /// already present.
+        void insert(std::string_view name, SymbolId id);
+
+        std::optional<SymbolId> find(std::string_view name) const
+        {
+            Key key;
+            if (size_ == 0 || !pack(name, key)) return std::nullopt;
+
+            for (std::size_t i = home(key); slots_[i].used; i = (i + 1) & mask_)
+                if (same(slots_[i].key, key)) return slots_[i].id;
+            return std::nullopt;
+        }
+
+        /// Looks up the symbol part of a stream name (everything before '@').
+        std::optional<SymbolId> find_stream(std::string_view stream) const
+        {
+            return find(stream.substr(0, stream.find('@')));
+        }
+
+        std::size_t size() const { return size_; }
+
+    private:
+        using Key = std::array<std::uint64_t, 3>;
+
+        struct Slot {
+            Key      key{};
+            SymbolId id   = 0;
+            bool     used = false;
+        };
+
+        // Up to 8 bytes as one little-endian word, using overlapping loads
+        // instead of a byte loop.  n is 1..8.
+        static std::uint64_t load_word(const char* p, std::size_t n)
+        {
+            if (n == 8) {
+                std::uint64_t w;
+                std::memcpy(&w, p, 8);
+                return w;
+            }
+            if (n >= 4) {
+                std::uint32_t lo, hi;
+                std::memcpy(&lo, p, 4);
+                std::memcpy(&hi, p + n - 4, 4);
+                return lo | (std::uint64_t(hi) << (8 * (n - 4)));
+            }
+            const auto byte = [p](std::size_t i) { return std::uint64_t(static_cast<unsigned char>(p[i])); };
+            return byte(0) | (byte(n / 2) << (8 * (n / 2))) | (byte(n - 1) << (8 * (n - 1)));
+        }
+
+        // Setting bit 5 of every used byte lower-cases letters and leaves
+        // digits alone; unused bytes stay zero.
+        static bool pack(std::string_view name, Key& key)
+        {
+            const std::size_t n = name.size();
+            if (n == 0 || n > kMaxLength) return false;
+
+            constexpr std::uint64_t fold = 0x2020202020202020ull;
+            key = {};
+            for (std::size_t w = 0; w < key.size() && 8 * w < n; ++w) {
+                const std::size_t used = std::min<std::size_t>(8, n - 8 * w);
+                key[w] = load_word(name.data() + 8 * w, used) | (fold >> (8 * (8 - used)));
+            }
+            return true;
+        }
+
+        static bool same(const Key& a, const Key& b)
+        {
+            return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2])) == 0;
+        }
+
+        std::size_t home(const Key& key) const
+        {
+            const std::uint64_t h = key[0] ^ std::rotl(key[1], 21) ^ std::rotl(key[2], 42);
+            return static_cast<std::size_t>((h * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+        }
+
+        void grow();
+
+        std::vector<Slot> slots_;
+        std::size_t       mask_ = 0;
+        std::size_t       size_ = 0;
+};
+
+} // namespace triarb
@@ -0,0 +1,137 @@
+#pragma once
+#include "edge_evaluator.hpp"
+#include "exchange_info.hpp"
+#include "orderbook.hpp"
+#include "symbol_table.hpp"
+#include "triangle_path.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace triarb {
+
+/// One conversion step: Buy spends the quote asset for base at the ask,
+/// Sell spends the base asset for quote at the bid.
+struct TriangleLeg {
+    SymbolId symbol;
+    Side     side;
+};
+
+/// A directed cycle start -> x -> y -> start through three symbols.
+struct Triangle {
+    std::array<TriangleLeg, 3> legs;
+    AssetId                    start;
+    std::uint8_t               shape = 0;   // bit i set when leg i sells
+};
+
+/* Triangle Engine
+ * ---------------
+ * Owns one OrderBook per symbol and every triangular cycle that can be
+ * formed from the symbol set.
+ *
+ * At construction all 3-cycles are enumerated in both directions and
+ * rotated to start at the home asset when they contain it.  A flat
+ * symbol -> triangles index (CSR layout) lets a book update re-evaluate
+ * only the cycles that touch that book, so the per-tick cost depends on
+ * how connected the symbol is, not on the size of the universe.
+ *
+ * Symbols are resolved to integer ids through a SymbolTable, and edge()
+ * dispatches on the triangle's side pattern to one of eight path_edge
+ * instantiations, so the per-tick path neither hashes strings nor branches
+ * on sides inside the formula.
+ */
+class TriangleEngine
+{
+    public:
+        TriangleEngine(std::vector<SymbolInfo> symbols,
+                       std::string_view home_asset,
+                       FeeSchedule fees = {});
+
+        std::size_t symbol_count() const { return symbols_.size(); }
+        const SymbolInfo& symbol(SymbolId id) const { return symbols_[id]; }
+        OrderBook& book(SymbolId id) { return *books_[id]; }
+        const OrderBook& book(SymbolId id) const { return *books_[id]; }
+
+        /// Looks up "ETHBTC".
+        std::optional<SymbolId> find(std::string_view symbol) const
+        {
+            return symbol_ids_.find(symbol);
+        }
+        /// Looks up the symbol of a stream name such as "ethbtc@depth5@100ms".
+        std::optional<SymbolId> find_stream(std::string_view stream) const
+        {
+            return symbol_ids_.find_stream(stream);
+        }
+
+        const std::string& asset(AssetId id) const { return assets_[id]; }
+        std::size_t asset_count() const { return assets_.size(); }
+        AssetId home() const { return home_; }
+        /// Looks up "ETH".
+        std::optional<AssetId> find_asset(std::string_view name) const;
+        /// Base and quote asset of a symbol.
+        const std::array<AssetId, 2>& assets(SymbolId id) const { return symbol_assets_[id]; }
+        /// The symbol trading `a` against `b`, either way round.  A linear
+        /// scan, for setup and reporting rather than the per-tick path.
+        std::optional<SymbolId> pair(AssetId a, AssetId b) const;
+        const std::vector<Triangle>& triangles() const { return triangles_; }
+
+        /// Indices into triangles() of every cycle that trades `id`.
+        std::span<const std::uint32_t> triangles_for(SymbolId id) const
+        {
+            return {index_.data() + offsets_[id], index_.data() + offsets_[id + 1]};
+        }
+
+        /// True if the cycle starts and ends in the home asset.
+        bool anchored(const Triangle& t) const { return t.start == home_; }
+
+        /// Net return of one unit of the start asset sent around the cycle at
+        /// top of book, after fees (0.001 == 0.1 %).  Returns -1 while any
+        /// leg has no quote.
+        double edge(const Triangle& t) const { return edge(t, fees_); }
+        /// ...at `fees` rather than the engine's own.  Books are read
+        /// through their seqlock and lock, so any thread may call this.
+        double edge(const Triangle& t, const FeeSchedule& fees) const;
+
+        /// Walks up to kMaxLegLevels of each leg's book and returns the
+        /// profit-maximising notional (see size_triangle).
+        SizedEdge size(const Triangle& t, double max_notional) const
+        {
+            return size(t, max_notional, fees_);
+        }
+        SizedEdge size(const Triangle& t, double max_notional, const FeeSchedule& fees) const;
+
+        /// Fees for edge() and size() from now on; the owning thread only.
+        void set_fees(const FeeSchedule& fees) { fees_ = fees; }
+
+        /// Human readable "USDT->ETH->BTC->USDT".
+        std::string describe(const Triangle& t) const;
+
+    private:
+        AssetId intern_asset(const std::string& name);
+        static double leg_fee(const FeeSchedule& fees, std::size_t leg)
+        {
+            return leg == 0 ? fees.taker : fees.maker;
+        }
+        void enumerate();
+
+        FeeSchedule                              fees_;
+        std::vector<SymbolInfo>                  symbols_;
+        std::vector<std::unique_ptr<OrderBook>>  books_;
+        std::vector<std::string>                 assets_;
+        std::unordered_map<std::string, AssetId> asset_ids_;
+        SymbolTable                              symbol_ids_;
+        std::vector<std::array<AssetId, 2>>      symbol_assets_; // base, quote
+        AssetId                                  home_;
+
+        std::vector<Triangle>      triangles_;
+        std::vector<std::uint32_t> offsets_;   // symbol_count() + 1 entries
+        std::vector<std::uint32_t> index_;
+};
+
+} // namespace triarb
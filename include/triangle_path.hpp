@@ -0,0 +1,50 @@
+#pragma once
+#include "orderbook.hpp"
+#include <cstdint>
+#include <string_view>
+
+namespace triarb {
+
+enum class Side : std::uint8_t { Buy, Sell };
+
+constexpr std::string_view to_string(Side side)
+{
+    return side == Side::Buy ? "BUY" : "SELL";
+}
+
+/// Fee rates as fractions; a negative maker fee is a rebate.  The first leg
+/// crosses the spread (taker), the other two are priced as maker.
+struct FeeSchedule {
+    double maker = -0.0001;
+    double taker =  0.0004;
+};
+
+enum class FeeType : std::uint8_t { Maker, Taker };
+
+/// Output per unit of input at top of book after fees; 0 while the side the
+/// leg trades against is empty.
+template<Side S, FeeType F>
+inline double leg_rate(const TopOfBook& top, const FeeSchedule& fees)
+{
+    const double keep = 1.0 - (F == FeeType::Taker ? fees.taker : fees.maker);
+    if constexpr (S == Side::Buy)
+        return top.ask.px > 0 ? keep / top.ask.px : 0.0;
+    else
+        return top.bid.px > 0 ? keep * top.bid.px : 0.0;
+}
+
+/// Net return of one unit sent around a fixed-shape cycle, -1 while any leg
+/// has no quote.  Sides and fee types are template arguments, so every
+/// shape compiles to straight-line arithmetic.
+template<Side S0, FeeType F0, Side S1, FeeType F1, Side S2, FeeType F2>
+inline double path_edge(const TopOfBook& a, const TopOfBook& b, const TopOfBook& c,
+                        const FeeSchedule& fees)
+{
+    const double r0 = leg_rate<S0, F0>(a, fees);
+    const double r1 = leg_rate<S1, F1>(b, fees);
+    const double r2 = leg_rate<S2, F2>(c, fees);
+    if (r0 <= 0 || r1 <= 0 || r2 <= 0) return -1.0;
+    return r0 * r1 * r2 - 1.0;
+}
+
+} // namespace triarb
@@ -1,38 +1,307 @@
 #pragma once
 
-#include "websocket_session.hpp"
+#include "book_clock.hpp"
+#include "config.hpp"
+#include "feed_set.hpp"
 #include "gateway.hpp"
 #include "orderbook.hpp"
+#include "frame_parser.hpp"
+#include "depth_sync.hpp"
+#include "triangle_engine.hpp"
+#include "journal.hpp"
+#include "decision_log.hpp"
+#include "inventory.hpp"
+#include "latency.hpp"
+#include "metrics_server.hpp"
+#include "object_pool.hpp"
+#include "pipeline.hpp"
+#include "rcu_cell.hpp"
+#include "shard_plan.hpp"
+#include "spsc_queue.hpp"
 #include <boost/asio.hpp>
 #include <atomic>
+#include <memory>
+#include <optional>
+#include <ostream>
 #include <string_view>
-#include <cstdlib> 
+#include <vector>
+#include <cstdlib>
 
 namespace triarb {
 
+/// How the legs of a triangle go out (EXECUTION environment variable).
+enum class ExecutionMode {
+    Sequential, // each leg spends what the previous one filled (default)
+    Concurrent  // all three at once, from pre-positioned inventory
+};
+
+/// Recording, replay, threading, execution and market data (JOURNAL,
+/// DECISION_LOG, EXECUTION, the InventoryOptions variables and the threads
+/// and feeds of the Config; triarb_replay sets `replay`).
+struct BotOptions {
+    bool             replay = false; // no network, dry-run gateway, frames fed by replay()
+    std::string      journal;        // record every frame and snapshot here
+    std::string      decision_log;   // write FIRE/ORDER/FILL lines here
+    PipelineOptions  pipeline;       // pipelined or sharded threads
+    ExecutionMode    execution = ExecutionMode::Sequential;
+    InventoryOptions inventory;      // balances concurrent execution trades from
+    FeedOptions      feeds;          // redundant market data sessions
+};
+
+/// Throws std::invalid_argument on an unknown EXECUTION value, on
+/// concurrent execution without an INVENTORY, on a JOURNAL with
+/// THREADING=sharded, or on bad FEED_* or CONFIG values.
+BotOptions load_bot_options_from_env();
+
 class TriArbBot {
 public:
-    explicit TriArbBot(boost::asio::io_context& ioc);
+    /// In pipelined and sharded mode `ioc` only carries the caller's own
+    /// handlers (signals); the bot's sockets and timers live on its worker
+    /// threads.
+    explicit TriArbBot(boost::asio::io_context& ioc,
+                       BotOptions options = load_bot_options_from_env());
+    ~TriArbBot();
+
     void start();
 
+    /// Re-reads the environment and the CONFIG file and publishes the new
+    /// strategy section; the strategy thread takes it up on its next frame.
+    /// Market, feeds and threads changes need a restart and are reported.
+    /// Any thread.  Returns false, keeping the running configuration, if
+    /// the new one does not load.
+    bool reload_config();
+
+    /// The configuration the bot started with.
+    const Config& config() const { return config_; }
+
+    /// Feeds one journal record as if it had just arrived (replay mode).
+    /// In sharded mode it goes to the shard that owns its symbol, and the
+    /// decisions match a single-threaded replay only if the caller waits
+    /// for wait_idle() after each record.
+    void replay(const JournalRecord& rec);
+
+    /// Blocks until every frame handed to the pipeline has been processed,
+    /// along with the orders and fills it led to.  Returns at once in
+    /// single-threaded mode, where replay() finishes the work itself.
+    void wait_idle();
+
+    /// Joins the worker threads, prints the latency report and stops the
+    /// io_context.
+    void stop();
+
+    const LatencyMetrics& latency() const { return latency_; }
+
+    /// Market data sessions of shard `shard`; the thread running them only.
+    FeedSet& feeds(std::size_t shard = 0) { return shards_[shard]->feeds; }
+    /// Which session delivered each update first.
+    const FeedArbiter& arbiter(std::size_t shard = 0) const { return shards_[shard]->arbiter; }
+    /// How current each of the shard's books is, and the exchange clock
+    /// offset its frames show.
+    const BookClock& book_clock(std::size_t shard = 0) const { return shards_[shard]->clock; }
+
+    /// Which strategy thread owns each symbol; one shard unless sharded.
+    const ShardPlan& shard_plan() const { return plan_; }
+
+    /// Balances and leg risk of concurrent execution; disabled otherwise.
+    /// Strategy thread only, or once wait_idle() has returned.
+    const Inventory& inventory() const { return inventory_; }
+
 private:
-    void handle_frame(std::string_view msg);
-    void print_book_update(const std::string& symbol, const OrderBook& book);
-    bool edge_scanner();
+    /// A triangle worth firing and how much of the home asset to send.
+    struct Opportunity {
+        std::uint32_t triangle = 0;
+        SizedEdge     sized{};
+    };
+
+    /// The strategy section as the strategy thread reads it, with the
+    /// triangle list resolved to a flag per triangle.
+    struct LiveConfig {
+        FeeSchedule               fees;
+        double                    edge_threshold = 0.0;
+        double                    max_notional   = 0.0;
+        std::vector<std::uint8_t> trade;          // by triangle
+        std::uint64_t             max_book_age_ns  = 0;   // 0 is off
+        std::uint64_t             max_book_skew_ns = 0;
+    };
 
+    /// Stage stamps of the frame in hand, from now_ns().
+    struct FrameStamps {
+        std::uint64_t kernel  = 0;   // kernel arrival; 0 when the socket gave none
+        std::uint64_t read    = 0;
+        std::uint64_t decided = 0;
+    };
+
+    /// What the edge scan decided on a frame, on its way to execution: a
+    /// triangle to fire, or one held back (`held` says why).
+    struct Decision {
+        Opportunity  opp;
+        Ts           origin = 0;        // receive time of the frame behind it
+        FrameStamps  stamps;
+        std::size_t  leg  = 0;          // held: the leg it was held against
+        const char*  held = nullptr;    // "stale-book", "book-skew"; null to fire
+    };
+
+    /// A market data frame (or, in replay, a recorded snapshot) on its way
+    /// to the strategy thread.  Slots are reserved up front and reused.
+    struct FrameSlot {
+        RecordKind    kind = RecordKind::Frame;
+        std::string   tag;
+        std::string   payload;
+        Ts            recv_ts = 0;
+        std::uint64_t read_ns   = 0;
+        std::uint64_t kernel_ns = 0;
+        std::size_t   feed      = 0;   // FeedSet session it came from
+    };
+
+    /// A fired triangle from FIRE until its last leg has answered, in a
+    /// slot of the execution pool, so that neither the fill callbacks nor
+    /// the queues carry more than the slot's index.
+    struct Execution {
+        std::uint32_t              triangle = 0;
+        Ts                         origin   = 0;
+        std::array<double, 3>      limits{};
+        FrameStamps                stamps;
+        std::array<double, 3>      inputs{};      // concurrent: reserved per leg
+        std::array<LegOutcome, 3>  legs{};        // concurrent: what each leg did
+        std::size_t                answered = 0;  // concurrent: legs back so far
+    };
+
+    /// Triangles that can be under way at once; a FIRE beyond that is
+    /// skipped.
+    static constexpr std::size_t kExecutions = 64;
+
+    /// One leg on its way to the gateway, with what the egress thread
+    /// needs to send it.
+    struct LegOrder {
+        std::uint32_t execution = 0;   // executions_ slot
+        std::uint32_t triangle  = 0;
+        std::size_t   leg       = 0;
+        Qty           qty;
+        Price         price;
+        FrameStamps   stamps;
+    };
+    /// ...and back with its fill.
+    struct LegFill {
+        std::uint32_t execution = 0;
+        std::size_t   leg       = 0;
+        FillReport    report{};
+    };
+
+    /// Threads and queues of the pipelined mode.
+    struct Pipeline {
+        explicit Pipeline(const PipelineOptions& options);
+
+        Worker               net;       // FeedSet, metrics, reports
+        Worker               strategy;  // books, edge_scanner, decisions
+        Worker               egress;    // Gateway
+        SpscQueue<FrameSlot> frames;    // net -> strategy
+        SpscQueue<LegOrder>  orders;    // strategy -> egress
+        SpscQueue<LegFill>   fills;     // egress -> strategy
+    };
+
+    /* Shard
+     * -----
+     * What one strategy thread keeps to itself: the frame in hand, the
+     * market data sessions of the symbols it owns and the clock of their
+     * books.  The single-threaded and pipelined modes run one shard over
+     * every symbol; the sharded mode one per strategy thread, each on its
+     * own Worker, handing its decisions to the egress thread.
+     */
+    struct Shard {
+        Shard(TriArbBot& bot, std::size_t index);
+
+        std::size_t             index;
+        std::unique_ptr<Worker> worker;      // sharded mode; null otherwise
+        RcuCell<LiveConfig>     live;        // reload_config publishes to every shard
+        MarketFrame             frame;
+        MarketFrame             check_frame;
+        BookTickerFrame         ticker;
+        Ts                      current_ts = 0;   // receive time of the frame in hand
+        FrameStamps             stamps;
+        std::uint64_t           msg_count = 0;
+        FeedSet                 feeds;       // the owned symbols' streams
+        FeedArbiter             arbiter;
+        BookClock               clock;       // as_of() of the owned symbols
+        SpscQueue<FrameSlot>    frames;      // sharded replay -> shard
+        SpscQueue<Decision>     decisions;   // shard -> egress (sharded mode)
+    };
+
+    void on_frame(Shard& shard, std::size_t feed, std::string_view msg, std::uint64_t read_ns,
+                  std::uint64_t kernel_ns);
+    void push_record(SpscQueue<FrameSlot>& frames, Worker& to, const JournalRecord& rec,
+                     std::uint64_t read_ns, std::size_t feed = 0, std::uint64_t kernel_ns = 0);
+    void apply_record(Shard& shard, const JournalRecord& rec, std::uint64_t read_ns,
+                      std::size_t feed = 0, std::uint64_t kernel_ns = 0);
+    void handle_frame(Shard& shard, std::string_view msg, std::uint64_t read_ns, Ts recv_ts,
+                      std::size_t feed, std::uint64_t kernel_ns);
+    bool parse_frame(Shard& shard, std::string_view msg);
+    bool apply_frame(Shard& shard, SymbolId id);
+    bool apply_ticker(Shard& shard, SymbolId id);
+    Shard& owner(SymbolId id) { return *shards_[plan_.owner[id]]; }
+    void request_snapshot(SymbolId id);
+    void fetch_snapshot(SymbolId id);
+    void retry_snapshot(SymbolId id);
+    void apply_snapshot(SymbolId id, const std::string& body);
+    void print_book_update(SymbolId id);
+    std::optional<Opportunity> edge_scanner(Shard& shard, SymbolId changed);
+    bool books_current(Shard& shard, std::uint32_t triangle, const LiveConfig& live);
+    void decide(Shard& shard, const Decision& decision);
+    void apply_decision(const Decision& decision);
+    void execute(const Decision& decision);
+    void execute_leg(std::uint32_t execution, std::size_t leg, double amount);
+    void execute_concurrent(std::uint32_t execution, const Opportunity& opp);
+    std::optional<LegOrder> make_leg(std::uint32_t execution, std::size_t leg, double amount);
+    bool order_room(std::size_t legs) const;
+    void dispatch_leg(const LegOrder& order);
+    void send_leg(const LegOrder& order);
+    void on_fill(std::uint32_t execution, std::size_t leg, const FillReport& rep);
+    void on_concurrent_fill(std::uint32_t execution, std::size_t leg, const FillReport& rep);
+    void schedule_rebalance();
+    void rebalance();
+    void send_rebalance(SymbolId symbol, Side side, Qty qty, Price price);
+    bool drain_frames_and_fills();
+    bool drain_frames(Shard& shard, SpscQueue<FrameSlot>& frames);
+    bool drain_orders();
+    bool drain_decisions();
+    void stop_pipeline();
+    boost::asio::io_context& net_ioc();
+    boost::asio::io_context& strategy_ioc();
+    boost::asio::io_context& egress_ioc();
+    std::string stream_target(std::size_t shard) const;
+    LiveConfig live_config(const StrategyConfig& strategy) const;
+    void schedule_report();
+    void report_shards();
+    void report_shard(const Shard& shard, std::ostream& out) const;
+
+    boost::asio::io_context& ioc_;
+    BotOptions options_;
+    const Config config_;                               // as loaded at startup
+    std::unique_ptr<Pipeline> pipeline_;                // null unless pipelined
+    std::unique_ptr<Worker> egress_;                    // sharded mode: gateway, execution, reports
     Gateway gw_;
-    OrderBook btc_usdt_book_{"BTCUSDT"};
-    OrderBook eth_btc_book_{"ETHBTC"};
-    OrderBook eth_usdt_book_{"ETHUSDT"};
+    TriangleEngine engine_;
+    ShardPlan plan_;
+
+    std::vector<std::unique_ptr<DepthSync>> syncs_;     // by SymbolId
+    std::vector<TopOfBook> last_printed_;               // by SymbolId
+    std::vector<std::atomic<double>> last_edge_;        // by triangle; any shard scanning it
+    std::vector<std::string> paths_;                    // by triangle, "USDT->ETH->BTC->USDT"
 
-    std::atomic_bool got_btc_{false};
-    std::atomic_bool got_ethbtc_{false};
-    std::atomic_bool got_ethusdt_{false};
+    ObjectPool<Execution> executions_{kExecutions};     // triangles under way; strategy thread
+    Inventory inventory_;                               // enabled in concurrent mode
+    std::size_t rebalancing_ = 0;                       // rebalance orders awaiting a fill
+    boost::asio::steady_timer rebalance_timer_;
 
-    double last_edge_ = 0.0;
-    WebsocketSession session_;
+    std::unique_ptr<JournalWriter> journal_;            // null unless recording
+    DecisionLog decisions_;                             // execution's thread
+
+    LatencyMetrics latency_;
+    std::unique_ptr<MetricsServer> metrics_server_;     // null unless METRICS_PORT is set
+    std::chrono::seconds report_interval_;
+    boost::asio::steady_timer report_timer_;
+
+    std::vector<std::unique_ptr<Shard>> shards_;        // by shard index
 };
 
 } // namespace triarb
 
-
@@ -12,19 +12,48 @@
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "inline_function.hpp"
+#include "socket_tuning.hpp"
+
 // Standard headers
+#include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <functional>
 #include <chrono>
+#include <cstdint>
 
 /// Asynchronously connects to a Binance WS stream and
 /// forwards each text frame to the supplied callback.
 namespace triarb {
 
+/// Transport settings of a session (WS_COMPRESSION, WS_READ_BUFFER and the
+/// SocketOptions environment variables).
+struct WebsocketOptions {
+    bool          compression = false;      // offer permessage-deflate in the handshake
+    std::size_t   read_buffer = 64 * 1024;  // bytes reserved up front for incoming frames
+    SocketOptions socket;                   // applied once the TCP connection is up
+
+    bool operator==(const WebsocketOptions&) const = default;
+};
+
+WebsocketOptions load_websocket_options_from_env();
+
 class WebsocketSession {
 public:
-    using FrameHandler = std::function<void(std::string_view)>;
+    /// Receives each frame, the now_ns() stamp taken when its read
+    /// completed and the kernel's arrival stamp of its last segment on the
+    /// same clock: 0 when the socket gives none, as for frames that came in
+    /// with the handshake (see StampedStream).  The view points into the
+    /// session's read buffer and is only valid during the call; a handler
+    /// that keeps the frame copies it.
+    using FrameHandler = InlineFunction<void(std::string_view, std::uint64_t, std::uint64_t)>;
+    /// Called once the WebSocket handshake has completed.
+    using OpenHandler  = std::function<void()>;
+    /// Called once per run() that ends, whether the connection never came
+    /// up or dropped later, after every operation on it has finished.
+    using CloseHandler = std::function<void(boost::beast::error_code)>;
 
     /// Construct with:
     ///   - ioc: the Asio I/O context
@@ -32,16 +61,42 @@ public:
     ///   - port: "9443"
     ///   - target: e.g. "/stream?streams=btcusdt@depth5@100ms"
     ///   - on_frame: callback invoked on each full JSON frame
+    ///   - options: compression, read buffer size and socket options
     WebsocketSession(
         boost::asio::io_context& ioc,
         std::string             host,
         std::string             port,
         std::string             target,
-        FrameHandler            on_frame);
+        FrameHandler            on_frame,
+        WebsocketOptions        options = {});
 
-    /// Starts the resolve→connect→handshake chain
+    /// Starts the resolve→connect→handshake chain.  May be called again
+    /// from the close handler (or later) to reconnect.
     void run();
 
+    void set_open_handler(OpenHandler h)   { on_open_ = std::move(h); }
+    void set_close_handler(CloseHandler h) { on_close_ = std::move(h); }
+
+    /// Trusts the certificate(s) in `path` on top of the system store,
+    /// for local stand-ins.
+    void add_ca_file(const std::string& path);
+
+    /// Tries the resolved addresses starting from the n-th (mod their
+    /// count), so sessions to the same host can land on different nodes.
+    void prefer_address(std::size_t n) { prefer_ = n; }
+
+    /// Queues a text frame; frames go out one at a time, in order.  Frames
+    /// queued while the session is not open are dropped.  The text is
+    /// copied into an outbox buffer that is kept for the next frame, so
+    /// sending only allocates when more frames wait at once than ever
+    /// before, or a frame is longer than any before it.
+    void send(std::string_view text);
+
+    /// Drops the connection; the close handler reports it.
+    void close();
+
+    bool is_open() const { return open_; }
+
 private:
     // Step 1: DNS resolution callback
     void on_resolve(
@@ -64,21 +119,50 @@ private:
         boost::beast::error_code ec,
         std::size_t bytes_transferred);
 
+    // Write loop callback
+    void on_write(
+        boost::beast::error_code ec,
+        std::size_t bytes_transferred);
+
+    // Ends this run() once no read or write is pending
+    void closed(boost::beast::error_code ec);
+
     // Certificate verification callback
     bool verify_certificate(
         bool preverified,
         boost::asio::ssl::verify_context& ctx);
 
-    // Member variables
+    // Member variables.  The TCP stream is bound to the io_context's own
+    // executor rather than the type-erased default, so completions are
+    // invoked directly instead of being wrapped (and allocated) for a
+    // polymorphic executor.
+    using TcpStream = boost::beast::basic_stream<boost::asio::ip::tcp,
+                                                 boost::asio::io_context::executor_type>;
+    using Stream    = boost::beast::websocket::stream<
+        boost::beast::ssl_stream<StampedStream<TcpStream>>>;
+
+    StampedStream<TcpStream>& stamped() { return ws_->next_layer().next_layer(); }
+
+    boost::asio::io_context& ioc_;
     boost::asio::ip::tcp::resolver resolver_;
     boost::asio::ssl::context ctx_{boost::asio::ssl::context::tlsv12_client};
-    boost::beast::websocket::stream<
-        boost::beast::ssl_stream<boost::beast::tcp_stream>> ws_;
+    std::optional<Stream> ws_;               // rebuilt by every run()
     boost::beast::flat_buffer buffer_;
     std::string host_;
     std::string port_;
     std::string target_;
+    WebsocketOptions options_;
     FrameHandler handler_;
+    OpenHandler on_open_;
+    CloseHandler on_close_;
+    std::vector<std::vector<char>> outbox_;  // ring; the head is being written
+    std::size_t out_head_  = 0;
+    std::size_t out_count_ = 0;
+    std::size_t prefer_ = 0;
+    bool open_     = false;
+    bool reading_  = false;
+    bool writing_  = false;
+    boost::beast::error_code close_ec_;      // held while a write finishes
 };
 
 } // namespace triarb
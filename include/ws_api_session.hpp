@@ -0,0 +1,114 @@
+#pragma once
+#include "inline_function.hpp"
+#include "websocket_session.hpp"
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace triarb {
+
+/* WebSocket API Session
+ * ---------------------
+ * One persistent WebSocket connection carrying JSON requests, each with a
+ * numeric "id" that the server echoes in its response.  Any number of
+ * requests may be in flight; responses are matched back by id, in
+ * whatever order they arrive.
+ *
+ * The connection is opened by start() and rebuilt whenever it drops:
+ * straight away after a working connection closes, kReconnectDelay later
+ * after a failed attempt.  Requests made while it is down wait for the next one.
+ * A request already written when the connection drops, or unanswered
+ * after `request_timeout`, fails with an error and is never resent.
+ *
+ * Pending requests live in a fixed table of kSlots slots, the one for id
+ * n at n % kSlots, and a reply's id is read from the frame in place, so a
+ * request and its response allocate nothing.  A request whose slot still
+ * holds an older one fails at once with `no_buffer_space`, unsent.  The
+ * text of a request made while down is kept in its slot until the
+ * connection is back.
+ *
+ * Requests, their callbacks and the deadline sweep share the thread that
+ * runs the io_context with the WebsocketSession underneath, so the slots
+ * need no lock; async_request() must be called from that thread.  The
+ * session's handlers capture `this`, so it must outlive every run.
+ */
+class WsApiSession
+{
+    public:
+        /// `reply` is the response frame, only valid during the call; empty
+        /// when `ec` is set.
+        using Callback = InlineFunction<void(boost::beast::error_code ec,
+                                             std::string_view reply), 128>;
+
+        /// Requests in flight at once.
+        static constexpr std::size_t kSlots = 64;
+
+        WsApiSession(boost::asio::io_context& ioc,
+                     std::string host,
+                     std::string port,
+                     std::string target,
+                     std::string ca_file = {},
+                     std::chrono::milliseconds request_timeout = std::chrono::seconds(10),
+                     SocketOptions socket = {});
+
+        WsApiSession(const WsApiSession&) = delete;
+        WsApiSession& operator=(const WsApiSession&) = delete;
+
+        /// Starts connecting.
+        void start();
+
+        /// A fresh id for the next request.
+        std::uint64_t next_id() { return ++last_id_; }
+
+        /// Sends `text`, a request carrying `"id":id`, and calls `cb` with
+        /// the response of the same id.  `text` is copied before the call
+        /// returns.
+        void async_request(std::uint64_t id, std::string_view text, Callback cb);
+
+        /// Connected and handshaken right now.
+        bool ready() const { return session_.is_open(); }
+        /// Successful handshakes so far, the initial one included.
+        std::uint64_t connects() const { return connects_; }
+        /// Requests waiting for their response.
+        std::size_t in_flight() const { return in_flight_; }
+
+    private:
+        struct Slot {
+            std::uint64_t                         id = 0;       // 0: free
+            Callback                              cb;
+            std::chrono::steady_clock::time_point deadline;
+            bool                                  sent = false;
+            std::string                           text;         // while unsent
+        };
+
+        void on_open();
+        void on_close(boost::beast::error_code ec);
+        void on_frame(std::string_view frame);
+        void arm_sweep();
+        void fail(Slot& slot, boost::beast::error_code ec);
+
+        WebsocketSession                            session_;
+        std::chrono::milliseconds                   request_timeout_;
+        std::array<Slot, kSlots>                    slots_;
+        std::size_t                                 in_flight_ = 0;
+        boost::asio::steady_timer                   retry_timer_;
+        boost::asio::steady_timer                   sweep_timer_;   // request deadlines
+        bool                                        sweeping_  = false;
+        bool                                        was_open_  = false;
+        std::uint64_t                               last_id_   = 0;
+        std::uint64_t                               connects_  = 0;
+};
+
+/// The unsigned integer value of the first `"key":` in `frame` that has
+/// one, read in place; nullopt when there is none.  Keys are matched at
+/// any depth, so a key whose value elsewhere is a string or an object, as
+/// "status" is in an order result, does not get in the way.
+std::optional<std::uint64_t> uint_field(std::string_view frame, std::string_view key);
+
+} // namespace triarb
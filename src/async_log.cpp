@@ -0,0 +1,155 @@
+#include "async_log.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+
+namespace triarb {
+
+namespace {
+
+std::atomic<std::uint64_t> next_logger_id{1};
+
+// Each thread's ring of the logger it last used; switching loggers falls
+// back to add_ring(), which finds the thread's existing ring.
+struct RingCache {
+    std::uint64_t owner = 0;
+    void*         ring  = nullptr;
+};
+thread_local RingCache ring_cache;
+
+} // namespace
+
+AsyncLogger::AsyncLogger(Sink sink, std::size_t ring_slots)
+    : sink_(std::move(sink))
+    , ring_slots_(ring_slots)
+    , id_(next_logger_id.fetch_add(1, std::memory_order_relaxed))
+    , consumer_([this] { run(); })
+{
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    stop_.store(true, std::memory_order_release);
+    consumer_.join();
+}
+
+AsyncLogger::Ring& AsyncLogger::ring()
+{
+    if (ring_cache.owner == id_) return *static_cast<Ring*>(ring_cache.ring);
+    return add_ring();
+}
+
+// Slow path, on a thread's first record and whenever it switches loggers:
+// a thread keeps one ring per logger, so its records stay in order.  Rings
+// live as long as the logger, so a thread that exits leaves its remaining
+// records to be drained; a later thread given the same id reuses the ring.
+AsyncLogger::Ring& AsyncLogger::add_ring()
+{
+    const auto self = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    auto it = std::find_if(rings_.begin(), rings_.end(),
+                           [&](const auto& r) { return r->owner == self; });
+    if (it == rings_.end()) {
+        rings_.push_back(std::make_unique<Ring>(ring_slots_, self));
+        it = std::prev(rings_.end());
+    }
+    ring_cache = {id_, it->get()};
+    return **it;
+}
+
+// One pass over every ring.  Lines are gathered per stream and handed to
+// the sink in one call each, so a busy pass costs two writes, not one per
+// record.
+bool AsyncLogger::drain()
+{
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (auto& r : rings_) rings.push_back(r.get());
+    }
+
+    out_.clear();
+    err_.clear();
+    for (Ring* r : rings) {
+        const auto dropped = r->dropped.load(std::memory_order_relaxed);
+        if (dropped != r->dropped_seen) {
+            err_ += "[LOG] ";
+            append_int(err_, static_cast<std::int64_t>(dropped - r->dropped_seen));
+            err_ += " records dropped, ring full\n";
+            r->dropped_seen = dropped;
+        }
+
+        // Only what was there at the start, so a busy producer cannot keep
+        // the other rings waiting.
+        for (auto n = r->queue.pushed() - r->queue.popped(); n > 0; --n) {
+            const Slot& slot = *r->queue.front();
+            std::string& text = slot.stream == LogStream::Err ? err_ : out_;
+            slot.decode(text, slot.payload);
+            text += '\n';
+            r->queue.pop();
+        }
+    }
+
+    if (!err_.empty()) sink_(LogStream::Err, err_);
+    if (!out_.empty()) sink_(LogStream::Out, out_);
+    return !err_.empty() || !out_.empty();
+}
+
+void AsyncLogger::run()
+{
+    while (!stop_.load(std::memory_order_acquire))
+        if (!drain()) std::this_thread::sleep_for(std::chrono::microseconds(500));
+    while (drain()) {}
+}
+
+void AsyncLogger::flush()
+{
+    std::vector<std::pair<Ring*, std::uint64_t>> targets;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (auto& r : rings_) targets.emplace_back(r.get(), r->queue.pushed());
+    }
+    for (auto [r, head] : targets)
+        while (r->queue.popped() < head)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+std::uint64_t AsyncLogger::dropped() const
+{
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    std::uint64_t total = 0;
+    for (auto& r : rings_) total += r->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+AsyncLogger& logger()
+{
+    static AsyncLogger instance([](LogStream stream, std::string_view text) {
+        std::FILE* out = stream == LogStream::Err ? stderr : stdout;
+        std::fwrite(text.data(), 1, text.size(), out);
+        std::fflush(out);
+    });
+    return instance;
+}
+
+void append_fixed(std::string& out, double v, int decimals)
+{
+    char buf[64];
+    const auto r = std::to_chars(buf, buf + sizeof buf, v, std::chars_format::fixed, decimals);
+    out.append(buf, r.ec == std::errc{} ? r.ptr : buf);
+}
+
+void append_double(std::string& out, double v)
+{
+    char buf[32];
+    out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+}
+
+void append_int(std::string& out, std::int64_t v)
+{
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+}
+
+} // namespace triarb
@@ -0,0 +1,68 @@
+#include "book_clock.hpp"
+#include <algorithm>
+#include <iomanip>
+
+namespace triarb {
+
+BookClock::BookClock(std::size_t symbols)
+    : books_(symbols)
+{
+}
+
+std::optional<std::uint64_t> BookClock::observe(SymbolId symbol, std::uint64_t recv_ns,
+                                                std::uint64_t event_ms)
+{
+    auto& book = books_[symbol];
+    book.received.store(recv_ns, std::memory_order_relaxed);
+    if (event_ms == 0) {
+        book.as_of.store(recv_ns, std::memory_order_relaxed);
+        bump(unstamped_);
+        return std::nullopt;
+    }
+    bump(stamped_);
+
+    const auto event_ns = static_cast<std::int64_t>(event_ms * 1'000'000);
+    const auto apart    = static_cast<std::int64_t>(recv_ns) - event_ns;
+    if (window_start_ == 0 || recv_ns >= window_start_ + kWindowNs) {
+        previous_     = current_;
+        current_      = apart;
+        window_start_ = recv_ns;
+    }
+    else {
+        current_ = std::min(current_, apart);
+    }
+    const auto offset = std::min(previous_, current_);
+    offset_.store(offset, std::memory_order_relaxed);
+
+    // The offset is never above this frame's own difference, so the event
+    // time lands at or before the receive time
+    book.as_of.store(static_cast<std::uint64_t>(event_ns + offset), std::memory_order_relaxed);
+    return static_cast<std::uint64_t>(apart - offset);
+}
+
+std::optional<std::int64_t> BookClock::offset_ns() const
+{
+    const auto offset = offset_.load(std::memory_order_relaxed);
+    if (offset == kNoOffset) return std::nullopt;
+    return offset;
+}
+
+void BookClock::hold(Hold reason)
+{
+    bump(held_[static_cast<std::size_t>(reason)]);
+}
+
+void BookClock::report(std::ostream& out) const
+{
+    out << "[CLOCK] offset ";
+    if (const auto offset = offset_ns())
+        out << std::fixed << std::setprecision(3) << static_cast<double>(*offset) / 1e6
+            << std::defaultfloat << " ms";
+    else
+        out << "-";
+    out << ", frames with E " << stamped_.load(std::memory_order_relaxed)
+        << ", without " << unstamped_.load(std::memory_order_relaxed)
+        << ", held stale " << held(Hold::Stale) << ", skew " << held(Hold::Skew) << "\n";
+}
+
+} // namespace triarb
@@ -0,0 +1,304 @@
+#include "config.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace triarb {
+
+namespace {
+
+/* Environment
+ * -----------
+ * The variables the bot has always read, now the defaults a CONFIG file
+ * refines.  Unknown FRAME_PARSER and DEPTH_FEED values keep the default,
+ * as they always have.
+ */
+ParserMode load_parser_mode_from_env()
+{
+    const char* mode = std::getenv("FRAME_PARSER");
+    if (!mode) return ParserMode::Fast;
+
+    std::string_view m(mode);
+    if (m == "json")     return ParserMode::Json;
+    if (m == "validate") return ParserMode::Validate;
+    return ParserMode::Fast;
+}
+
+DepthFeed load_depth_feed_from_env()
+{
+    const char* feed = std::getenv("DEPTH_FEED");
+    if (!feed) return DepthFeed::Partial;
+
+    std::string_view f(feed);
+    if (f == "diff") return DepthFeed::Diff;
+    if (f == "none") return DepthFeed::None;
+    return DepthFeed::Partial;
+}
+
+MarketConfig load_market_from_env()
+{
+    MarketConfig market;
+    if (const char* path = std::getenv("EXCHANGE_INFO")) market.exchange_info = path;
+    if (const char* home = std::getenv("HOME_ASSET"))    market.home_asset = home;
+    if (const char* host = std::getenv("REST_HOST"))     market.rest_host = host;
+    market.depth_feed = load_depth_feed_from_env();
+    const char* ticker = std::getenv("BOOK_TICKER");
+    market.book_ticker = ticker && (std::string_view(ticker) == "1" || std::string_view(ticker) == "true");
+    market.parser = load_parser_mode_from_env();
+    return market;
+}
+
+StrategyConfig load_strategy_from_env()
+{
+    StrategyConfig strategy;
+    if (const char* edge = std::getenv("EDGE_THRESHOLD"))
+        strategy.edge_threshold = std::stod(edge);
+    if (const char* notional = std::getenv("MAX_NOTIONAL"))
+        strategy.max_notional = std::stod(notional);
+    if (const char* age = std::getenv("MAX_BOOK_AGE_MS"))
+        strategy.max_book_age = std::chrono::milliseconds(std::stoll(age));
+    if (const char* skew = std::getenv("MAX_BOOK_SKEW_MS"))
+        strategy.max_book_skew = std::chrono::milliseconds(std::stoll(skew));
+    return strategy;
+}
+
+/* File
+ * ----
+ * Every section and key is optional, but an unknown one is an error: a
+ * misspelt key would otherwise leave its default in place unnoticed.
+ */
+void known_keys(const json& object, std::string_view where,
+                std::initializer_list<std::string_view> keys)
+{
+    if (!object.is_object())
+        throw std::invalid_argument("config: " + std::string(where) + " must be an object");
+    for (const auto& [key, value] : object.items())
+        if (std::find(keys.begin(), keys.end(), key) == keys.end())
+            throw std::invalid_argument("config: unknown key " + std::string(where) + "." + key);
+}
+
+template <class T>
+bool read(const json& section, std::string_view where, const char* key, T& out)
+{
+    const auto it = section.find(key);
+    if (it == section.end()) return false;
+    try {
+        out = it->template get<T>();
+    }
+    catch (const json::exception&) {
+        throw std::invalid_argument("config: " + std::string(where) + "." + key +
+                                    " has the wrong type");
+    }
+    return true;
+}
+
+template <class Enum>
+void read_enum(const json& section, std::string_view where, const char* key, Enum& out,
+               std::initializer_list<std::pair<std::string_view, Enum>> names)
+{
+    std::string name;
+    if (!read(section, where, key, name)) return;
+    for (const auto& [n, value] : names)
+        if (n == name) {
+            out = value;
+            return;
+        }
+    throw std::invalid_argument("config: " + std::string(where) + "." + key + " '" + name +
+                                "' is not one of the known values");
+}
+
+void parse_market(const json& j, MarketConfig& market)
+{
+    known_keys(j, "market", {"exchange_info", "symbols", "home_asset", "rest_host",
+                             "depth_feed", "book_ticker", "parser"});
+    read(j, "market", "exchange_info", market.exchange_info);
+    read(j, "market", "symbols", market.symbols);
+    read(j, "market", "home_asset", market.home_asset);
+    read(j, "market", "rest_host", market.rest_host);
+    read_enum(j, "market", "depth_feed", market.depth_feed,
+              {{"partial", DepthFeed::Partial}, {"diff", DepthFeed::Diff}, {"none", DepthFeed::None}});
+    read(j, "market", "book_ticker", market.book_ticker);
+    read_enum(j, "market", "parser", market.parser,
+              {{"fast", ParserMode::Fast}, {"json", ParserMode::Json},
+               {"validate", ParserMode::Validate}});
+}
+
+// A tier names one entry of fee_tiers; the two only make sense together.
+void parse_strategy(const json& j, StrategyConfig& strategy)
+{
+    known_keys(j, "strategy", {"fee_tier", "fee_tiers", "edge_threshold", "max_notional",
+                               "triangles", "max_book_age_ms", "max_book_skew_ms"});
+    const bool tier  = read(j, "strategy", "fee_tier", strategy.fee_tier);
+    const auto tiers = j.find("fee_tiers");
+    if (tier != (tiers != j.end()))
+        throw std::invalid_argument("config: strategy.fee_tier and strategy.fee_tiers go together");
+    if (tier) {
+        if (!tiers->is_object())
+            throw std::invalid_argument("config: strategy.fee_tiers must be an object");
+        const auto picked = tiers->find(strategy.fee_tier);
+        if (picked == tiers->end())
+            throw std::invalid_argument("config: fee tier '" + strategy.fee_tier +
+                                        "' is not in strategy.fee_tiers");
+        const std::string where = "strategy.fee_tiers." + strategy.fee_tier;
+        known_keys(*picked, where, {"maker", "taker"});
+        if (!read(*picked, where, "maker", strategy.fees.maker) ||
+            !read(*picked, where, "taker", strategy.fees.taker))
+            throw std::invalid_argument("config: " + where + " needs maker and taker");
+    }
+    read(j, "strategy", "edge_threshold", strategy.edge_threshold);
+    read(j, "strategy", "max_notional", strategy.max_notional);
+    read(j, "strategy", "triangles", strategy.triangles);
+    if (std::int64_t ms; read(j, "strategy", "max_book_age_ms", ms))
+        strategy.max_book_age = std::chrono::milliseconds(ms);
+    if (std::int64_t ms; read(j, "strategy", "max_book_skew_ms", ms))
+        strategy.max_book_skew = std::chrono::milliseconds(ms);
+}
+
+void parse_socket(const json& j, SocketOptions& socket)
+{
+    known_keys(j, "feeds.socket", {"nodelay", "busy_poll_us", "rcvbuf", "sndbuf", "quickack",
+                                   "timestamps"});
+    read(j, "feeds.socket", "nodelay", socket.nodelay);
+    read(j, "feeds.socket", "busy_poll_us", socket.busy_poll_us);
+    read(j, "feeds.socket", "rcvbuf", socket.rcvbuf);
+    read(j, "feeds.socket", "sndbuf", socket.sndbuf);
+    read(j, "feeds.socket", "quickack", socket.quickack);
+    read(j, "feeds.socket", "timestamps", socket.timestamps);
+    if (socket.busy_poll_us < 0 || socket.rcvbuf < 0 || socket.sndbuf < 0)
+        throw std::invalid_argument("config: feeds.socket sizes must be zero or more");
+}
+
+void parse_feeds(const json& j, FeedOptions& feeds)
+{
+    known_keys(j, "feeds", {"connections", "endpoints", "stall_timeout_ms", "compression",
+                            "read_buffer", "socket"});
+    read(j, "feeds", "connections", feeds.connections);
+    std::vector<std::string> endpoints;
+    if (read(j, "feeds", "endpoints", endpoints)) {
+        if (endpoints.empty())
+            throw std::invalid_argument("config: feeds.endpoints must not be empty");
+        feeds.endpoints.clear();
+        for (const auto& e : endpoints) feeds.endpoints.push_back(parse_feed_endpoint(e));
+    }
+    if (std::int64_t ms; read(j, "feeds", "stall_timeout_ms", ms))
+        feeds.stall_timeout = std::chrono::milliseconds(ms);
+    read(j, "feeds", "compression", feeds.session.compression);
+    read(j, "feeds", "read_buffer", feeds.session.read_buffer);
+    if (const auto it = j.find("socket"); it != j.end()) parse_socket(*it, feeds.session.socket);
+    if (feeds.connections == 0)
+        throw std::invalid_argument("config: feeds.connections must be at least 1");
+}
+
+void parse_threads(const json& j, PipelineOptions& pipeline)
+{
+    known_keys(j, "threads", {"threading", "net_cpu", "strategy_cpu", "egress_cpu",
+                              "busy_poll", "shards", "shard_cpus"});
+
+    // "shards" sizes the sharded mode, whichever layer chose it
+    enum class Threading { Single, Pipelined, Sharded };
+    auto mode = pipeline.shards ? Threading::Sharded
+              : pipeline.enabled ? Threading::Pipelined : Threading::Single;
+    read_enum(j, "threads", "threading", mode,
+              {{"single", Threading::Single}, {"pipelined", Threading::Pipelined},
+               {"sharded", Threading::Sharded}});
+    std::int64_t shards = pipeline.shards ? static_cast<std::int64_t>(pipeline.shards)
+                                          : static_cast<std::int64_t>(kDefaultShards);
+    if (read(j, "threads", "shards", shards) && shards < 1)
+        throw std::invalid_argument("config: threads.shards must be at least 1");
+    pipeline.enabled = mode == Threading::Pipelined;
+    pipeline.shards  = mode == Threading::Sharded ? static_cast<std::size_t>(shards) : 0;
+    if (read(j, "threads", "shard_cpus", pipeline.shard_cpus))
+        for (const int cpu : pipeline.shard_cpus) check_cpu(cpu, "threads.shard_cpus");
+    if (read(j, "threads", "net_cpu", pipeline.net_cpu))
+        check_cpu(pipeline.net_cpu, "threads.net_cpu");
+    if (read(j, "threads", "strategy_cpu", pipeline.strategy_cpu))
+        check_cpu(pipeline.strategy_cpu, "threads.strategy_cpu");
+    if (read(j, "threads", "egress_cpu", pipeline.egress_cpu))
+        check_cpu(pipeline.egress_cpu, "threads.egress_cpu");
+    read(j, "threads", "busy_poll", pipeline.busy_poll);
+}
+
+// Fees are fractions; anything near 1 is a percentage typed by mistake.
+void validate(const StrategyConfig& strategy)
+{
+    const auto& f = strategy.fees;
+    if (!std::isfinite(f.maker) || !std::isfinite(f.taker) ||
+        std::abs(f.maker) >= 0.1 || std::abs(f.taker) >= 0.1)
+        throw std::invalid_argument("config: fees are fractions, e.g. 0.001 for 0.1 %");
+    if (!std::isfinite(strategy.edge_threshold) || strategy.edge_threshold < 0)
+        throw std::invalid_argument("config: edge_threshold must be zero or more");
+    if (!std::isfinite(strategy.max_notional) || strategy.max_notional <= 0)
+        throw std::invalid_argument("config: max_notional must be positive");
+    if (strategy.max_book_age.count() < 0 || strategy.max_book_skew.count() < 0)
+        throw std::invalid_argument("config: max_book_age_ms and max_book_skew_ms must be "
+                                    "zero or more");
+}
+
+} // namespace
+
+Config parse_config(std::string_view json_text, Config base)
+{
+    const auto j = json::parse(json_text, nullptr, false);
+    if (j.is_discarded() || !j.is_object())
+        throw std::runtime_error("config: not a JSON object");
+
+    known_keys(j, "config", {"market", "strategy", "feeds", "threads"});
+    if (const auto it = j.find("market");   it != j.end()) parse_market(*it, base.market);
+    if (const auto it = j.find("strategy"); it != j.end()) parse_strategy(*it, base.strategy);
+    if (const auto it = j.find("feeds");    it != j.end()) parse_feeds(*it, base.feeds);
+    if (const auto it = j.find("threads");  it != j.end()) parse_threads(*it, base.pipeline);
+    validate(base.strategy);
+    return base;
+}
+
+Config load_config(const std::string& path, Config base)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("config: cannot open " + path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    auto config = parse_config(ss.str(), std::move(base));
+    config.path = path;
+    return config;
+}
+
+Config load_config_from_env()
+{
+    Config config;
+    config.market   = load_market_from_env();
+    config.strategy = load_strategy_from_env();
+    config.pipeline = load_pipeline_options_from_env();
+    config.feeds    = load_feed_options_from_env();
+
+    if (const char* path = std::getenv("CONFIG"))
+        return load_config(path, std::move(config));
+    validate(config.strategy);
+    return config;
+}
+
+std::vector<SymbolInfo> load_symbols(const MarketConfig& market)
+{
+    auto all = market.exchange_info.empty() ? default_symbols()
+                                            : load_exchange_info(market.exchange_info);
+    if (market.symbols.empty()) return all;
+
+    std::vector<SymbolInfo> picked;
+    for (const auto& name : market.symbols) {
+        const auto it = std::find_if(all.begin(), all.end(),
+                                     [&](const SymbolInfo& s) { return s.symbol == name; });
+        if (it == all.end())
+            throw std::invalid_argument("config: symbol " + name + " is not in the symbol source");
+        picked.push_back(*it);
+    }
+    return picked;
+}
+
+} // namespace triarb
@@ -0,0 +1,88 @@
+#include "decision_log.hpp"
+#include <charconv>
+#include <stdexcept>
+
+namespace triarb {
+
+DecisionLog::DecisionLog(const std::string& path)
+    : out_(path, std::ios::binary | std::ios::trunc)
+{
+    if (!out_) throw std::runtime_error("decision log: cannot create " + path);
+    line_.reserve(256);
+}
+
+void DecisionLog::begin(Ts ts, std::string_view what)
+{
+    char buf[24];
+    line_.assign(buf, std::to_chars(buf, buf + sizeof buf, ts).ptr);
+    line_.append(" ").append(what);
+}
+
+void DecisionLog::put(double v)
+{
+    char buf[32];
+    line_.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+}
+
+void DecisionLog::end()
+{
+    line_ += '\n';
+    out_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+}
+
+void DecisionLog::fire(Ts ts, std::string_view path, const SizedEdge& sized)
+{
+    if (!enabled()) return;
+    begin(ts, "FIRE ");
+    line_.append(path).append(" edge=");
+    put(sized.edge);
+    line_.append(" notional=");
+    put(sized.notional);
+    line_.append(" profit=");
+    put(sized.profit);
+    end();
+}
+
+void DecisionLog::order(Ts ts, std::size_t leg, std::string_view symbol, Side side,
+                        Qty qty, Price price, const SymbolScale& scale)
+{
+    if (!enabled()) return;
+    char text[SymbolScale::kMaxText];
+    begin(ts, "ORDER ");
+    line_.append(1, static_cast<char>('0' + leg)).append(" ").append(symbol)
+         .append(" ").append(to_string(side)).append(" ");
+    line_.append(text, scale.write(text, qty)).append(" @ ");
+    line_.append(text, scale.write(text, price));
+    end();
+}
+
+void DecisionLog::fill(Ts ts, std::size_t leg, std::string_view symbol, double qty, double price)
+{
+    if (!enabled()) return;
+    begin(ts, "FILL ");
+    line_.append(1, static_cast<char>('0' + leg)).append(" ").append(symbol).append(" ");
+    put(qty);
+    line_.append(" @ ");
+    put(price);
+    end();
+}
+
+void DecisionLog::skip(Ts ts, std::size_t leg, std::string_view symbol, std::string_view reason)
+{
+    if (!enabled()) return;
+    begin(ts, "SKIP ");
+    line_.append(1, static_cast<char>('0' + leg)).append(" ").append(symbol)
+         .append(" ").append(reason);
+    end();
+}
+
+void DecisionLog::risk(Ts ts, std::size_t leg, std::string_view symbol, double exposure)
+{
+    if (!enabled()) return;
+    begin(ts, "RISK ");
+    line_.append(1, static_cast<char>('0' + leg)).append(" ").append(symbol).append(" exposure=");
+    put(exposure);
+    end();
+}
+
+} // namespace triarb
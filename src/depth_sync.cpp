@@ -0,0 +1,108 @@
+#include "depth_sync.hpp"
+#include "async_log.hpp"
+
+namespace triarb {
+
+namespace {
+
+void fmt_gap(std::string& out, const LogStr& symbol, std::uint64_t expected,
+             std::uint64_t first, std::uint64_t last)
+{
+    out.append("[DEPTH] ").append(symbol.view()).append(" gap: expected ");
+    append_int(out, static_cast<std::int64_t>(expected));
+    out += ", got ";
+    append_int(out, static_cast<std::int64_t>(first));
+    out += '-';
+    append_int(out, static_cast<std::int64_t>(last));
+    out += ", resyncing";
+}
+
+} // namespace
+
+DepthSync::DepthSync(OrderBook& book, SnapshotRequest request_snapshot,
+                     std::size_t max_buffered)
+    : book_(book)
+    , request_snapshot_(std::move(request_snapshot))
+    , max_buffered_(max_buffered)
+{}
+
+void DepthSync::start()
+{
+    state_ = State::AwaitingSnapshot;
+    buffered_.clear();
+    request_snapshot_();
+}
+
+bool DepthSync::on_diff(const MarketFrame& diff)
+{
+    switch (state_) {
+    case State::Idle:
+        return false;
+
+    case State::AwaitingSnapshot:
+        // A second feed delivers every event again; keep the first copy.
+        if (!buffered_.empty() && diff.lastUpdateId <= buffered_.back().last)
+            return false;
+        // Oldest events go first; if they were needed the straddle check
+        // after the snapshot fails and we simply fetch another one.
+        if (buffered_.size() == max_buffered_)
+            buffered_.pop_front();
+        buffered_.push_back({diff.firstUpdateId, diff.lastUpdateId, diff.bids, diff.asks});
+        return false;
+
+    case State::Synced:
+        if (diff.lastUpdateId <= last_applied_) return false; // duplicate or stale
+        apply(diff.firstUpdateId, diff.lastUpdateId, diff.bids, diff.asks);
+        return state_ == State::Synced;
+    }
+    return false;
+}
+
+void DepthSync::on_snapshot(const MarketFrame& snapshot)
+{
+    if (state_ != State::AwaitingSnapshot) return;
+
+    book_.clear();
+    book_.apply_snapshot(snapshot.lastUpdateId, snapshot.bids, snapshot.asks);
+    last_applied_ = snapshot.lastUpdateId;
+    state_ = State::Synced;
+
+    auto pending = std::move(buffered_);
+    buffered_.clear();
+    while (!pending.empty()) {
+        const auto& d = pending.front();
+        if (d.last > last_applied_) {
+            apply(d.first, d.last, d.bids, d.asks);
+            if (state_ != State::Synced) break; // resync already requested
+        }
+        pending.pop_front();
+    }
+    // Keep whatever the new snapshot may still need.
+    for (auto& d : pending)
+        buffered_.push_back(std::move(d));
+}
+
+void DepthSync::apply(std::uint64_t first, std::uint64_t last,
+                      std::span<const WireLevel> bids, std::span<const WireLevel> asks)
+{
+    // The event must cover last_applied_+1.  Overlap is harmless because
+    // diff quantities are absolute; a hole is not.
+    if (first > last_applied_ + 1) {
+        log<fmt_gap>(LogStream::Err, LogStr(book_.symbol()), last_applied_ + 1, first, last);
+        resync();
+        return;
+    }
+    book_.apply_diff(last, bids, asks);
+    last_applied_ = last;
+}
+
+void DepthSync::resync()
+{
+    ++resyncs_;
+    state_ = State::AwaitingSnapshot;
+    buffered_.clear();
+    book_.clear();
+    request_snapshot_();
+}
+
+} // namespace triarb
@@ -0,0 +1,88 @@
+#include "edge_evaluator.hpp"
+#include <algorithm>
+
+namespace triarb {
+
+namespace {
+
+// Output per unit of input at one level, after fees.
+double level_rate(const LegLevels& leg, const Quote& level)
+{
+    return (1.0 - leg.fee) * (leg.buy ? 1.0 / level.px : level.px);
+}
+
+// Input (in the leg's "from" asset) that one level can absorb.
+double level_capacity(const LegLevels& leg, const Quote& level)
+{
+    return leg.buy ? level.px * level.qty : level.qty;
+}
+
+bool usable(const Quote& level)
+{
+    return level.px > 0.0 && level.qty > 0.0;
+}
+
+} // namespace
+
+SizedEdge size_triangle(const std::array<LegLevels, 3>& legs, double max_notional)
+{
+    SizedEdge out;
+
+    std::array<std::size_t, 3> idx{};
+    std::array<double, 3> remaining{};
+    for (std::size_t i = 0; i < 3; ++i) {
+        if (legs[i].levels.empty() || !usable(legs[i].levels[0])) return out;
+        remaining[i] = level_capacity(legs[i], legs[i].levels[0]);
+    }
+
+    // Moves an exhausted ladder to its next level; false at the end of the
+    // visible depth.
+    auto advance = [&](std::size_t i) {
+        if (++idx[i] == legs[i].levels.size() || !usable(legs[i].levels[idx[i]]))
+            return false;
+        remaining[i] = level_capacity(legs[i], legs[i].levels[idx[i]]);
+        return true;
+    };
+
+    for (bool first = true;; first = false) {
+        std::array<double, 3> rate;
+        for (std::size_t i = 0; i < 3; ++i)
+            rate[i] = level_rate(legs[i], legs[i].levels[idx[i]]);
+
+        const double marginal = rate[0] * rate[1] * rate[2];
+        if (first) out.edge = marginal - 1.0;
+        if (marginal <= 1.0) break;
+
+        // Input each leg sees per unit of start asset.
+        const std::array<double, 3> scale{1.0, rate[0], rate[0] * rate[1]};
+
+        double dx = max_notional - out.notional;
+        bool capped = true;
+        for (std::size_t i = 0; i < 3; ++i) {
+            const double limit = remaining[i] / scale[i];
+            if (limit < dx) { dx = limit; capped = false; }
+        }
+        if (capped && dx <= 0.0) break;
+
+        if (dx > 0.0) {
+            out.notional += dx;
+            out.profit   += dx * (marginal - 1.0);
+            for (std::size_t i = 0; i < 3; ++i) {
+                out.legInput[i] += dx * scale[i];
+                out.limitPx[i]   = legs[i].levels[idx[i]].px;
+                remaining[i]    -= dx * scale[i];
+            }
+        }
+        if (capped) break;
+
+        // Every ladder emptied by this step (ties included) moves on.
+        bool more = true;
+        for (std::size_t i = 0; i < 3 && more; ++i)
+            if (remaining[i] <= 1e-12 * level_capacity(legs[i], legs[i].levels[idx[i]]))
+                more = advance(i);
+        if (!more) break;
+    }
+    return out;
+}
+
+} // namespace triarb
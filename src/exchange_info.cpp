@@ -0,0 +1,91 @@
+#include "exchange_info.hpp"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace triarb {
+
+static double filter_value(const json& filter, const char* key)
+{
+    Decimal d;
+    return filter.contains(key) && filter[key].is_string() &&
+           parse_fixed(filter[key].get_ref<const std::string&>(), d)
+        ? to_double(d)
+        : 0.0;
+}
+
+static Increment filter_increment(const json& filter, const char* key)
+{
+    Increment inc{0, 0};
+    if (filter.contains(key) && filter[key].is_string() &&
+        parse_increment(filter[key].get_ref<const std::string&>(), inc))
+        return inc;
+    return {0, 0};
+}
+
+std::vector<SymbolInfo> parse_exchange_info(std::string_view json_text)
+{
+    auto j = json::parse(json_text, nullptr, false);
+    if (j.is_discarded() || !j.contains("symbols") || !j["symbols"].is_array())
+        throw std::runtime_error("exchangeInfo: missing symbols array");
+
+    std::vector<SymbolInfo> out;
+    for (const auto& s : j["symbols"]) {
+        if (s.value("status", "") != "TRADING") continue;
+        if (!s.value("isSpotTradingAllowed", true)) continue;
+
+        SymbolInfo info;
+        info.symbol = s.at("symbol").get<std::string>();
+        info.base   = s.at("baseAsset").get<std::string>();
+        info.quote  = s.at("quoteAsset").get<std::string>();
+
+        for (const auto& f : s.value("filters", json::array())) {
+            const auto type = f.value("filterType", "");
+            if (type == "PRICE_FILTER") {
+                info.tickSize = filter_value(f, "tickSize");
+                info.tick     = filter_increment(f, "tickSize");
+            } else if (type == "LOT_SIZE") {
+                info.stepSize = filter_value(f, "stepSize");
+                info.step     = filter_increment(f, "stepSize");
+            }
+            else if (type == "NOTIONAL" || type == "MIN_NOTIONAL")
+                info.minNotional = filter_value(f, "minNotional");
+        }
+        out.push_back(std::move(info));
+    }
+    return out;
+}
+
+std::vector<SymbolInfo> load_exchange_info(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("exchangeInfo: cannot open " + path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return parse_exchange_info(ss.str());
+}
+
+SymbolScale symbol_scale(const SymbolInfo& info)
+{
+    auto pick = [](Increment exact, double value) {
+        if (exact.units > 0) return exact;
+        if (value > 0.0) return increment_from_double(value);
+        return Increment{};
+    };
+    return {pick(info.tick, info.tickSize), pick(info.step, info.stepSize)};
+}
+
+std::vector<SymbolInfo> default_symbols()
+{
+    return {
+        {"BTCUSDT", "BTC", "USDT", 0.01,    0.00001, 5.0,    {1, 2}, {1, 5}},
+        {"ETHBTC",  "ETH", "BTC",  0.00001, 0.0001,  0.0001, {1, 5}, {1, 4}},
+        {"ETHUSDT", "ETH", "USDT", 0.01,    0.0001,  5.0,    {1, 2}, {1, 4}},
+    };
+}
+
+} // namespace triarb
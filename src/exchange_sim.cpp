@@ -0,0 +1,784 @@
+#include "exchange_sim.hpp"
+#include "async_log.hpp"
+#include "gateway.hpp"
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+namespace beast = boost::beast;
+namespace http  = beast::http;
+namespace ssl   = boost::asio::ssl;
+namespace ws    = beast::websocket;
+using tcp       = boost::asio::ip::tcp;
+
+namespace triarb {
+
+namespace {
+
+std::int64_t wall_clock_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string_view sv(beast::string_view s)
+{
+    return {s.data(), s.size()};
+}
+
+std::string lower(std::string_view s)
+{
+    std::string out(s);
+    for (auto& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+template <class Units>
+void append_decimal(std::string& out, const SymbolScale& scale, Units value)
+{
+    char text[SymbolScale::kMaxText];
+    out.append(text, scale.write(text, value));
+}
+
+// [["0.02391","1.5"],...] as the depth payloads write levels.
+void append_levels(std::string& out, const SymbolScale& scale,
+                   const std::vector<std::pair<Price, Qty>>& levels)
+{
+    out += '[';
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        out += i ? ",[\"" : "[\"";
+        append_decimal(out, scale, levels[i].first);
+        out += "\",\"";
+        append_decimal(out, scale, levels[i].second);
+        out += "\"]";
+    }
+    out += ']';
+}
+
+void append_changes(std::string& out, const SymbolScale& scale,
+                    const std::vector<SimLevelChange>& changes, Side side)
+{
+    std::vector<std::pair<Price, Qty>> levels;
+    for (const auto& c : changes)
+        if (c.side == side) levels.emplace_back(c.price, c.qty);
+    append_levels(out, scale, levels);
+}
+
+std::string error_body(int code, std::string_view msg)
+{
+    std::string body = R"({"code":)" + std::to_string(code) + R"(,"msg":")";
+    body.append(msg).append("\"}");
+    return body;
+}
+
+std::string_view status_name(SimExecution::Status status)
+{
+    switch (status) {
+    case SimExecution::Status::Filled:  return "FILLED";
+    case SimExecution::Status::Expired: return "EXPIRED";
+    default:                            return "REJECTED";
+    }
+}
+
+/// Value of `key` in a form or query string, empty if it is not there.
+std::string_view param(std::string_view query, std::string_view key)
+{
+    for (std::size_t pos = 0; pos < query.size();) {
+        const auto amp  = std::min(query.find('&', pos), query.size());
+        const auto pair = query.substr(pos, amp - pos);
+        if (pair.size() > key.size() && pair.substr(0, key.size()) == key &&
+            pair[key.size()] == '=')
+            return pair.substr(key.size() + 1);
+        pos = amp + 1;
+    }
+    return {};
+}
+
+/// A price or quantity that must be a whole number of the symbol's tick or
+/// step; false for anything else, as the exchange's filters would say.
+template <class Units, class Convert>
+bool on_grid(std::string_view text, const SymbolScale& scale, Convert convert, Units& out)
+{
+    Decimal d, back;
+    if (!parse_fixed(text, d)) return false;
+    out = convert(scale, d);
+    char written[SymbolScale::kMaxText];
+    return parse_fixed({written, static_cast<std::size_t>(scale.write(written, out) - written)}, back) &&
+           back == d;
+}
+
+} // namespace
+
+/* Simulated Book
+ * --------------
+ */
+void SimBook::record(Side side, std::int64_t ticks, std::int64_t steps)
+{
+    if (side == Side::Buy) {
+        if (steps > 0) bids_[ticks] = steps;
+        else           bids_.erase(ticks);
+    } else {
+        if (steps > 0) asks_[ticks] = steps;
+        else           asks_.erase(ticks);
+    }
+    changes_.push_back({side, Price{ticks}, Qty{steps}});
+}
+
+void SimBook::set(Side side, Price price, Qty qty)
+{
+    record(side, price.ticks, std::max<std::int64_t>(qty.steps, 0));
+}
+
+// Only levels that differ are reported, so a frame that repeats the book
+// shows up as no change at all.
+void SimBook::replace(const std::vector<WireLevel>& bids, const std::vector<WireLevel>& asks)
+{
+    auto side = [this](Side s, auto& current, const std::vector<WireLevel>& wire) {
+        std::decay_t<decltype(current)> next;
+        for (const auto& l : wire)
+            if (const auto q = scale_.qty(l.qty); q.steps > 0) next[scale_.price(l.px).ticks] = q.steps;
+        for (const auto& [ticks, steps] : current)
+            if (!next.count(ticks)) changes_.push_back({s, Price{ticks}, Qty{0}});
+        for (const auto& [ticks, steps] : next)
+            if (const auto it = current.find(ticks); it == current.end() || it->second != steps)
+                changes_.push_back({s, Price{ticks}, Qty{steps}});
+        current = std::move(next);
+    };
+    side(Side::Buy, bids_, bids);
+    side(Side::Sell, asks_, asks);
+}
+
+void SimBook::set_top(const WireLevel& bid, const WireLevel& ask)
+{
+    const auto bid_px = scale_.price(bid.px).ticks;
+    const auto ask_px = scale_.price(ask.px).ticks;
+    while (!bids_.empty() && bids_.begin()->first > bid_px) record(Side::Buy, bids_.begin()->first, 0);
+    while (!asks_.empty() && asks_.begin()->first < ask_px) record(Side::Sell, asks_.begin()->first, 0);
+    record(Side::Buy, bid_px, scale_.qty(bid.qty).steps);
+    record(Side::Sell, ask_px, scale_.qty(ask.qty).steps);
+}
+
+SimExecution SimBook::match(Side side, Price limit, Qty qty, bool maker, double fill_ratio,
+                            MakerRule rule)
+{
+    SimExecution ex;
+    auto take = [&](auto& levels, Side level_side, auto crosses) {
+        const bool crossing = !levels.empty() && crosses(levels.begin()->first);
+        if (maker && crossing && rule == MakerRule::Reject) {
+            ex.status = SimExecution::Status::Rejected;
+            return;
+        }
+        std::int64_t left = qty.steps;
+        for (auto it = levels.begin(); left > 0 && it != levels.end() && crosses(it->first);) {
+            const auto offered = fill_ratio >= 1.0
+                ? it->second
+                : static_cast<std::int64_t>(static_cast<double>(it->second) * fill_ratio);
+            const auto n = std::min(left, offered);
+            const auto ticks = it->first;
+            if (n == 0) {
+                ++it;
+                continue;
+            }
+            ex.fills.push_back({Price{ticks}, Qty{n}});
+            ex.quote += scale_.to_double(Qty{n}) * scale_.to_double(Price{ticks});
+            left -= n;
+            ++it;
+            record(level_side, ticks, levels.at(ticks) - n);   // may erase the level
+        }
+        ex.filled = Qty{qty.steps - left};
+        ex.status = left == 0 ? SimExecution::Status::Filled : SimExecution::Status::Expired;
+    };
+
+    if (side == Side::Buy)
+        take(asks_, Side::Sell, [&](std::int64_t px) { return px <= limit.ticks; });
+    else
+        take(bids_, Side::Buy, [&](std::int64_t px) { return px >= limit.ticks; });
+    return ex;
+}
+
+std::vector<std::pair<Price, Qty>> SimBook::levels(Side side, std::size_t depth) const
+{
+    std::vector<std::pair<Price, Qty>> out;
+    auto copy = [&](const auto& levels) {
+        for (auto it = levels.begin(); it != levels.end() && out.size() < depth; ++it)
+            out.emplace_back(Price{it->first}, Qty{it->second});
+    };
+    if (side == Side::Buy) copy(bids_);
+    else                   copy(asks_);
+    return out;
+}
+
+std::vector<SimLevelChange> SimBook::flush()
+{
+    if (changes_.empty()) return {};
+    ++update_id_;
+    return std::exchange(changes_, {});
+}
+
+/* Connection
+ * ----------
+ * One TLS connection: a market data WebSocket if its first request is an
+ * upgrade, otherwise keep-alive REST requests answered one at a time.
+ * Everything it sends goes through `outbox` and leaves network_latency
+ * after it was queued.
+ */
+struct ExchangeSim::Subscription {
+    enum class Kind : std::uint8_t { Partial, Diff, Ticker };
+
+    const Market* market;
+    Kind          kind;
+    std::size_t   depth;    // levels per side of a partial depth stream
+    std::string   name;     // "ethbtc@depth5@100ms"
+};
+
+struct ExchangeSim::Connection : std::enable_shared_from_this<ExchangeSim::Connection>
+{
+    struct Outgoing {
+        std::chrono::steady_clock::time_point due;
+        std::string                           text;
+    };
+
+    Connection(ExchangeSim& sim, tcp::socket socket)
+        : sim(sim)
+        , stream(std::move(socket), sim.ctx_)
+        , timer(sim.ioc_)
+        , send_timer(sim.ioc_)
+    {
+    }
+
+    void start()
+    {
+        stream.next_layer().async_handshake(ssl::stream_base::server,
+            [self = shared_from_this()](beast::error_code ec) {
+                if (!ec) self->read_request();
+            });
+    }
+
+    void close()
+    {
+        open = false;
+        timer.cancel();
+        send_timer.cancel();
+        beast::error_code ignored;
+        beast::get_lowest_layer(stream).socket().close(ignored);
+    }
+
+    void read_request()
+    {
+        request = {};
+        http::async_read(stream.next_layer(), buffer, request,
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (!ec) self->on_request();
+            });
+    }
+
+    void on_request()
+    {
+        if (ws::is_upgrade(request)) return upgrade();
+
+        const auto target  = sv(request.target());
+        const auto inbound = sim.options_.network_latency;
+        if (request.method() == http::verb::post && target == "/api/v3/order") {
+            after(inbound + sim.options_.matching_latency, [this] {
+                int status = 200;
+                auto body = sim.handle_order(sv(request["X-MBX-APIKEY"]), request.body(), status);
+                respond(status, std::move(body));
+            });
+        } else if (request.method() == http::verb::get && target.substr(0, 14) == "/api/v3/depth?") {
+            after(inbound, [this] {
+                int status = 200;
+                auto body = sim.handle_depth(sv(request.target()), status);
+                respond(status, std::move(body));
+            });
+        } else {
+            respond(404, error_body(-1, "Unknown endpoint."));
+        }
+    }
+
+    void after(std::chrono::microseconds delay, std::function<void()> fn)
+    {
+        timer.expires_after(delay);
+        timer.async_wait([self = shared_from_this(), fn = std::move(fn)](beast::error_code ec) {
+            if (!ec) fn();
+        });
+    }
+
+    // Written out whole, so it waits in the outbox like any frame.
+    void respond(int status, std::string body)
+    {
+        const auto code = static_cast<http::status>(status);
+        std::string text = "HTTP/1.1 " + std::to_string(status) + " ";
+        text.append(sv(http::obsolete_reason(code)))
+            .append("\r\nContent-Type: application/json;charset=UTF-8\r\nContent-Length: ")
+            .append(std::to_string(body.size()))
+            .append(request.keep_alive() ? "\r\nConnection: keep-alive\r\n\r\n"
+                                         : "\r\nConnection: close\r\n\r\n")
+            .append(body);
+        send(std::move(text));
+    }
+
+    // /stream?streams=ethbtc@depth5@100ms/ethbtc@bookTicker; streams of
+    // unknown symbols or kinds are left out.
+    void upgrade()
+    {
+        const auto target = sv(request.target());
+        const auto query  = target.substr(std::min(target.find('?'), target.size()));
+        const auto list   = param(query.empty() ? query : query.substr(1), "streams");
+        for (std::size_t pos = 0; pos < list.size();) {
+            const auto slash = std::min(list.find('/', pos), list.size());
+            subscribe(list.substr(pos, slash - pos));
+            pos = slash + 1;
+        }
+        stream.async_accept(request, [self = shared_from_this()](beast::error_code ec) {
+            if (ec) return;
+            self->websocket = true;
+            self->open = true;
+            self->read_frames();
+            self->send_books();
+        });
+    }
+
+    void subscribe(std::string_view name)
+    {
+        const auto at = name.find('@');
+        if (at == std::string_view::npos) return;
+        const Market* market = nullptr;
+        for (const auto& [symbol, m] : sim.markets_)
+            if (m.stream == name.substr(0, at)) market = &m;
+        if (!market) return;
+
+        auto kind = name.substr(at + 1);
+        if (kind.size() > 6 && kind.substr(kind.size() - 6) == "@100ms") kind.remove_suffix(6);
+        if (kind == "bookTicker")
+            subscriptions.push_back({market, Subscription::Kind::Ticker, 1, std::string(name)});
+        else if (kind == "depth")
+            subscriptions.push_back({market, Subscription::Kind::Diff, 0, std::string(name)});
+        else if (kind == "depth5" || kind == "depth10" || kind == "depth20")
+            subscriptions.push_back({market, Subscription::Kind::Partial,
+                                     static_cast<std::size_t>(std::stoul(std::string(kind.substr(5)))),
+                                     std::string(name)});
+    }
+
+    // A new subscriber gets the books as they are at once, as the exchange's
+    // partial depth and bookTicker streams would give them within 100 ms;
+    // diff depth starts from a REST snapshot instead.
+    void send_books()
+    {
+        std::string text;
+        for (const auto& s : subscriptions)
+            if (s.kind != Subscription::Kind::Diff && sim.stream_frame(s, {}, text))
+                send(text);
+    }
+
+    // Keeps the session alive and notices when the client goes.
+    void read_frames()
+    {
+        stream.async_read(buffer, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            if (ec) {
+                self->open = false;
+                return;
+            }
+            self->buffer.consume(self->buffer.size());
+            self->read_frames();
+        });
+    }
+
+    void send(std::string text)
+    {
+        outbox.push_back({std::chrono::steady_clock::now() + sim.options_.network_latency,
+                          std::move(text)});
+        if (!sending) flush();
+    }
+
+    void flush()
+    {
+        if (outbox.empty()) {
+            sending = false;
+            return;
+        }
+        sending = true;
+        if (outbox.front().due > std::chrono::steady_clock::now()) {
+            send_timer.expires_at(outbox.front().due);
+            send_timer.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (!ec) self->write();
+            });
+            return;
+        }
+        write();
+    }
+
+    void write()
+    {
+        auto done = [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            if (ec) {
+                self->open = false;
+                return;
+            }
+            self->outbox.pop_front();
+            if (!self->websocket) return self->on_response_written();
+            self->flush();
+        };
+        const auto& text = outbox.front().text;
+        if (websocket)
+            stream.async_write(boost::asio::buffer(text), std::move(done));
+        else
+            boost::asio::async_write(stream.next_layer(), boost::asio::buffer(text), std::move(done));
+    }
+
+    void on_response_written()
+    {
+        sending = false;
+        if (!request.keep_alive()) {
+            stream.next_layer().async_shutdown([self = shared_from_this()](beast::error_code) {});
+            return;
+        }
+        read_request();
+    }
+
+    ExchangeSim&                                      sim;
+    ws::stream<beast::ssl_stream<beast::tcp_stream>>  stream;
+    beast::flat_buffer                                buffer;
+    http::request<http::string_body>                  request;
+    boost::asio::steady_timer                         timer;        // inbound latency, matching
+    boost::asio::steady_timer                         send_timer;   // outbound latency
+    std::deque<Outgoing>                              outbox;
+    std::vector<Subscription>                         subscriptions;
+    bool                                              websocket = false;
+    bool                                              open      = false;
+    bool                                              sending   = false;
+};
+
+/* Exchange Simulator
+ * ------------------
+ */
+ExchangeSim::ExchangeSim(boost::asio::io_context& ioc, const std::vector<SymbolInfo>& symbols,
+                         SimOptions options)
+    : ioc_(ioc)
+    , options_(std::move(options))
+    , ctx_(ssl::context::tlsv12_server)
+    , acceptor_(ioc, {boost::asio::ip::address_v4::loopback(), options_.port})
+{
+    if (options_.cert_file.empty() || options_.key_file.empty())
+        throw std::invalid_argument("exchange simulator needs a certificate and key file");
+    if (!(options_.fill_ratio > 0.0 && options_.fill_ratio <= 1.0))
+        throw std::invalid_argument("exchange simulator fill ratio must be in (0, 1]");
+    ctx_.use_certificate_chain_file(options_.cert_file);
+    ctx_.use_private_key_file(options_.key_file, ssl::context::pem);
+
+    for (const auto& info : symbols)
+        markets_.emplace(info.symbol, Market{info, lower(info.symbol), SimBook(symbol_scale(info))});
+    accept();
+}
+
+// Handlers still queued find their sockets closed and their timers
+// cancelled, and return without touching the simulator.
+ExchangeSim::~ExchangeSim()
+{
+    beast::error_code ignored;
+    acceptor_.close(ignored);
+    for (auto& weak : connections_)
+        if (auto c = weak.lock()) c->close();
+}
+
+void ExchangeSim::accept()
+{
+    acceptor_.async_accept([this](beast::error_code ec, tcp::socket socket) {
+        if (ec) return;
+        socket.set_option(tcp::no_delay(true));
+        auto c = std::make_shared<Connection>(*this, std::move(socket));
+        std::erase_if(connections_, [](const std::weak_ptr<Connection>& w) { return w.expired(); });
+        connections_.push_back(c);
+        c->start();
+        accept();
+    });
+}
+
+ExchangeSim::Market* ExchangeSim::find(std::string_view symbol)
+{
+    const auto it = markets_.find(symbol);
+    return it == markets_.end() ? nullptr : &it->second;
+}
+
+SimBook& ExchangeSim::book(std::string_view symbol)
+{
+    if (auto* m = find(symbol)) return m->book;
+    throw std::out_of_range("exchange simulator has no symbol " + std::string(symbol));
+}
+
+void ExchangeSim::set_book(std::string_view symbol, const std::vector<WireLevel>& bids,
+                           const std::vector<WireLevel>& asks)
+{
+    book(symbol).replace(bids, asks);
+    publish(symbol);
+}
+
+bool ExchangeSim::apply_frame(std::string_view text)
+{
+    if (!parse_market_frame(text, frame_) && !parse_market_frame_json(text, frame_))
+        return false;
+    const auto name = frame_.stream.substr(0, frame_.stream.find('@'));
+    Market* market = nullptr;
+    for (auto& [symbol, m] : markets_)
+        if (m.stream == name) market = &m;
+    if (!market) return false;
+
+    auto& book = market->book;
+    switch (frame_.kind) {
+    case FrameKind::PartialDepth:
+        book.replace(frame_.bids, frame_.asks);
+        break;
+    case FrameKind::DiffDepth:
+        for (const auto& l : frame_.bids) book.set(Side::Buy, book.scale().price(l.px), book.scale().qty(l.qty));
+        for (const auto& l : frame_.asks) book.set(Side::Sell, book.scale().price(l.px), book.scale().qty(l.qty));
+        break;
+    case FrameKind::BookTicker:
+        book.set_top(frame_.bids[0], frame_.asks[0]);
+        break;
+    default:
+        return false;
+    }
+    publish(market->info.symbol);
+    return true;
+}
+
+// Each stream's frame is written once per publish, whoever asked for it.
+void ExchangeSim::publish(std::string_view symbol)
+{
+    Market* m = find(symbol);
+    if (!m) return;
+    const auto changes = m->book.flush();
+    if (changes.empty()) return;
+
+    std::map<std::string, std::string, std::less<>> frames;   // by stream name
+    for (auto& weak : connections_) {
+        const auto c = weak.lock();
+        if (!c || !c->open) continue;
+        for (const auto& s : c->subscriptions) {
+            if (s.market != m) continue;
+            auto it = frames.find(s.name);
+            if (it == frames.end()) {
+                std::string text;
+                if (!stream_frame(s, changes, text)) text.clear();
+                it = frames.emplace(s.name, std::move(text)).first;
+            }
+            if (!it->second.empty()) c->send(it->second);
+        }
+    }
+}
+
+// A bookTicker frame needs both sides; false without them.
+bool ExchangeSim::stream_frame(const Subscription& s, const std::vector<SimLevelChange>& changes,
+                               std::string& out) const
+{
+    const auto& book  = s.market->book;
+    const auto& scale = book.scale();
+    const auto  id    = std::to_string(book.update_id());
+    out = R"({"stream":")" + s.name + R"(","data":{)";
+    switch (s.kind) {
+    case Subscription::Kind::Partial:
+        out += R"("lastUpdateId":)" + id + R"(,"bids":)";
+        append_levels(out, scale, book.levels(Side::Buy, s.depth));
+        out += R"(,"asks":)";
+        append_levels(out, scale, book.levels(Side::Sell, s.depth));
+        break;
+    case Subscription::Kind::Diff:
+        out += R"("e":"depthUpdate","E":)" + std::to_string(wall_clock_ms()) + R"(,"s":")" +
+               s.market->info.symbol + R"(","U":)" + id + R"(,"u":)" + id + R"(,"b":)";
+        append_changes(out, scale, changes, Side::Buy);
+        out += R"(,"a":)";
+        append_changes(out, scale, changes, Side::Sell);
+        break;
+    case Subscription::Kind::Ticker: {
+        const auto bid = book.levels(Side::Buy, 1);
+        const auto ask = book.levels(Side::Sell, 1);
+        if (bid.empty() || ask.empty()) return false;
+        out += R"("u":)" + id + R"(,"s":")" + s.market->info.symbol + R"(","b":")";
+        append_decimal(out, scale, bid[0].first);
+        out += R"(","B":")";
+        append_decimal(out, scale, bid[0].second);
+        out += R"(","a":")";
+        append_decimal(out, scale, ask[0].first);
+        out += R"(","A":")";
+        append_decimal(out, scale, ask[0].second);
+        out += '"';
+        break;
+    }
+    }
+    out += "}}";
+    return true;
+}
+
+std::size_t ExchangeSim::subscribers() const
+{
+    std::size_t n = 0;
+    for (const auto& weak : connections_)
+        if (const auto c = weak.lock(); c && c->open && c->websocket) ++n;
+    return n;
+}
+
+/* Order Entry
+ * -----------
+ * Checks an order the way the exchange would, in the same order and with
+ * the same error codes, then matches it and answers with a FULL response.
+ */
+std::string ExchangeSim::handle_order(std::string_view api_key, std::string_view body, int& status)
+{
+    auto reject = [&](int http_status, int code, std::string_view msg, SimOrderRecord rec = {}) {
+        status   = http_status;
+        rec.code = code;
+        orders_.push_back(std::move(rec));
+        return error_body(code, msg);
+    };
+
+    if (!options_.api_key.empty() && api_key != options_.api_key)
+        return reject(401, -2015, "Invalid API-key, IP, or permissions for action.");
+
+    if (!options_.api_secret.empty()) {
+        const auto at = body.rfind("&signature=");
+        if (at == std::string_view::npos ||
+            hmac_sha256(options_.api_secret, std::string(body.substr(0, at))) != body.substr(at + 11))
+            return reject(400, -1022, "Signature for this request is not valid.");
+
+        std::int64_t ts = 0, window = 5000;
+        const auto ts_text = param(body, "timestamp");
+        const auto rw_text = param(body, "recvWindow");
+        std::from_chars(ts_text.data(), ts_text.data() + ts_text.size(), ts);
+        if (!rw_text.empty()) std::from_chars(rw_text.data(), rw_text.data() + rw_text.size(), window);
+        const auto now = wall_clock_ms();
+        if (ts > now + 1000 || now - ts > window)
+            return reject(400, -1021, "Timestamp for this request is outside of the recvWindow.");
+    }
+
+    Market* m = find(param(body, "symbol"));
+    if (!m) return reject(400, -1121, "Invalid symbol.");
+
+    SimOrderRecord rec;
+    rec.symbol = m->info.symbol;
+    const auto side = param(body, "side");
+    const auto type = param(body, "type");
+    if (side != "BUY" && side != "SELL")
+        return reject(400, -1102, "Mandatory parameter 'side' was not sent, was empty/null, or malformed.", rec);
+    rec.side = side == "BUY" ? Side::Buy : Side::Sell;
+    if (type != "LIMIT" && type != "LIMIT_MAKER")
+        return reject(400, -1116, "Invalid orderType.", rec);
+    if (param(body, "timeInForce") != "IOC")
+        return reject(400, -1115, "Invalid timeInForce.", rec);
+
+    const auto& scale = m->book.scale();
+    Price price;
+    Qty   qty;
+    if (!on_grid(param(body, "price"), scale, [](const SymbolScale& s, Decimal d) { return s.price(d); }, price) ||
+        price.ticks <= 0)
+        return reject(400, -1013, "Filter failure: PRICE_FILTER", rec);
+    if (!on_grid(param(body, "quantity"), scale, [](const SymbolScale& s, Decimal d) { return s.qty(d); }, qty) ||
+        qty.steps <= 0)
+        return reject(400, -1013, "Filter failure: LOT_SIZE", rec);
+    rec.limit = scale.to_double(price);
+    rec.qty   = scale.to_double(qty);
+    if (rec.limit * rec.qty < m->info.minNotional)
+        return reject(400, -1013, "Filter failure: NOTIONAL", rec);
+
+    const auto ex = m->book.match(rec.side, price, qty, type == "LIMIT_MAKER",
+                                  options_.fill_ratio, options_.maker_rule);
+    if (ex.status == SimExecution::Status::Rejected)
+        return reject(400, -2010, "Order would immediately match and take.", rec);
+
+    rec.status = ex.status;
+    rec.filled = scale.to_double(ex.filled);
+    rec.quote  = ex.quote;
+    orders_.push_back(rec);
+    publish(m->info.symbol);
+
+    const auto order_id = next_order_id_++;
+    std::string res = R"({"symbol":")" + m->info.symbol + R"(","orderId":)" +
+                      std::to_string(order_id) + R"(,"orderListId":-1,"clientOrderId":"sim-)" +
+                      std::to_string(order_id) + R"(","transactTime":)" +
+                      std::to_string(wall_clock_ms()) + R"(,"price":")";
+    append_decimal(res, scale, price);
+    res += R"(","origQty":")";
+    append_decimal(res, scale, qty);
+    res += R"(","executedQty":")";
+    append_decimal(res, scale, ex.filled);
+    res += R"(","cummulativeQuoteQty":")";
+    append_fixed(res, ex.quote, 8);
+    res.append(R"(","status":")").append(status_name(ex.status))
+       .append(R"(","timeInForce":"IOC","type":")").append(type)
+       .append(R"(","side":")").append(side).append(R"(","fills":[)");
+    for (std::size_t i = 0; i < ex.fills.size(); ++i) {
+        res += i ? R"(,{"price":")" : R"({"price":")";
+        append_decimal(res, scale, ex.fills[i].price);
+        res += R"(","qty":")";
+        append_decimal(res, scale, ex.fills[i].qty);
+        res += R"(","commission":"0.00000000","commissionAsset":")" + m->info.quote +
+               R"(","tradeId":)" + std::to_string(order_id * 1000 + i) + "}";
+    }
+    res += "]}";
+    return res;
+}
+
+std::string ExchangeSim::handle_depth(std::string_view target, int& status)
+{
+    const auto query = target.substr(target.find('?') + 1);
+    Market* m = find(param(query, "symbol"));
+    if (!m) {
+        status = 400;
+        return error_body(-1121, "Invalid symbol.");
+    }
+    std::size_t limit = 100;
+    const auto limit_text = param(query, "limit");
+    std::from_chars(limit_text.data(), limit_text.data() + limit_text.size(), limit);
+    limit = std::clamp<std::size_t>(limit, 1, 5000);
+
+    // Anything set on the book but not yet published goes out first, so
+    // the snapshot's id covers exactly what it shows.
+    publish(m->info.symbol);
+    std::string res = R"({"lastUpdateId":)" + std::to_string(m->book.update_id()) + R"(,"bids":)";
+    append_levels(res, m->book.scale(), m->book.levels(Side::Buy, limit));
+    res += R"(,"asks":)";
+    append_levels(res, m->book.scale(), m->book.levels(Side::Sell, limit));
+    res += '}';
+    return res;
+}
+
+void ExchangeSim::report(std::ostream& out) const
+{
+    // Fill rates are averaged per order: quantities of different symbols
+    // are in different assets.
+    std::size_t filled = 0, partial = 0, expired = 0, rejected = 0, priced = 0;
+    double fill_rate = 0.0, improvement = 0.0;
+    for (const auto& o : orders_) {
+        if (o.status == SimExecution::Status::Rejected) {
+            ++rejected;
+            continue;
+        }
+        fill_rate += o.filled / o.qty;
+        if (o.status == SimExecution::Status::Filled) ++filled;
+        else if (o.filled > 0)                        ++partial;
+        else                                          ++expired;
+        if (o.filled > 0) {
+            const double avg = o.quote / o.filled;
+            improvement += (o.side == Side::Buy ? o.limit - avg : avg - o.limit) / o.limit;
+            ++priced;
+        }
+    }
+    out << "[SIM] " << orders_.size() << " orders: " << filled << " filled, " << partial
+        << " partly filled, " << expired << " expired, " << rejected << " rejected";
+    if (const auto answered = orders_.size() - rejected; answered > 0)
+        out << "; " << std::fixed << std::setprecision(1)
+            << 100.0 * fill_rate / static_cast<double>(answered) << "% filled on average";
+    if (priced > 0)
+        out << ", " << std::setprecision(2) << 1e4 * improvement / static_cast<double>(priced)
+            << " bps better than the limit";
+    out << std::defaultfloat << "\n";
+}
+
+} // namespace triarb
@@ -0,0 +1,183 @@
+#include "feed_set.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace triarb {
+
+FeedEndpoint parse_feed_endpoint(std::string_view text)
+{
+    const auto colon = text.rfind(':');
+    if (colon == 0 || colon == std::string_view::npos || colon + 1 == text.size())
+        throw std::invalid_argument("feed endpoint '" + std::string(text) + "' is not host:port");
+    return {std::string(text.substr(0, colon)), std::string(text.substr(colon + 1))};
+}
+
+FeedOptions load_feed_options_from_env()
+{
+    FeedOptions options;
+    if (const char* n = std::getenv("FEED_CONNECTIONS")) {
+        options.connections = std::stoul(n);
+        if (options.connections == 0)
+            throw std::invalid_argument("FEED_CONNECTIONS must be at least 1");
+    }
+    if (const char* list = std::getenv("FEED_ENDPOINTS")) {
+        // "stream.binance.com:9443,stream.binance.com:443"
+        options.endpoints.clear();
+        std::string_view text(list);
+        for (std::size_t pos = 0; pos <= text.size();) {
+            const auto comma = std::min(text.find(',', pos), text.size());
+            options.endpoints.push_back(parse_feed_endpoint(text.substr(pos, comma - pos)));
+            pos = comma + 1;
+        }
+    }
+    if (const char* ms = std::getenv("FEED_STALL_TIMEOUT"))
+        options.stall_timeout = std::chrono::milliseconds(std::stol(ms));
+    if (const char* ca = std::getenv("CA_FILE")) options.ca_file = ca;
+    options.session = load_websocket_options_from_env();
+    return options;
+}
+
+FeedSet::Feed::Feed(boost::asio::io_context& ioc, FeedEndpoint ep, const std::string& target,
+                    WebsocketSession::FrameHandler on_frame, const WebsocketOptions& options)
+    : endpoint(std::move(ep))
+    , session(ioc, endpoint.host, endpoint.port, target, std::move(on_frame), options)
+    , retry(ioc)
+{
+}
+
+FeedSet::FeedSet(boost::asio::io_context& ioc, FeedOptions options, std::string target,
+                 FrameHandler on_frame)
+    : ioc_(ioc)
+    , options_(std::move(options))
+    , handler_(std::move(on_frame))
+    , watchdog_(ioc)
+{
+    const auto endpoints = options_.endpoints.size();
+    for (std::size_t i = 0; i < options_.connections; ++i) {
+        feeds_.push_back(std::make_unique<Feed>(ioc, options_.endpoints[i % endpoints], target,
+            [this, i](std::string_view msg, std::uint64_t read_ns, std::uint64_t kernel_ns) {
+                auto& f = *feeds_[i];
+                f.last_frame = read_ns;
+                ++f.frames;
+                handler_(i, msg, read_ns, kernel_ns);
+            }, options_.session));
+        auto& session = feeds_.back()->session;
+        // The n-th session on a host starts from its n-th address
+        session.prefer_address(i / endpoints);
+        if (!options_.ca_file.empty()) session.add_ca_file(options_.ca_file);
+        session.set_open_handler([this, i] { feeds_[i]->up = true; });
+        session.set_close_handler([this, i](boost::beast::error_code ec) { on_close(i, ec); });
+    }
+}
+
+void FeedSet::start()
+{
+    const auto now = now_ns();
+    for (auto& f : feeds_) {
+        f->last_frame = now;
+        f->session.run();
+    }
+    schedule_watchdog();
+}
+
+// A session that had been open is rebuilt at once, so its streams are back
+// as soon as the exchange allows; one that could not connect waits first.
+void FeedSet::on_close(std::size_t feed, boost::beast::error_code ec)
+{
+    auto& f = *feeds_[feed];
+    const bool was_open = f.up;
+    f.up = false;
+    std::cerr << "[FEED] #" << feed << " " << f.endpoint.host << ":" << f.endpoint.port
+              << " closed (" << ec.message() << "), reconnecting\n";
+    if (was_open) ++f.drops;
+    ++f.reconnects;
+
+    f.retry.expires_after(was_open ? std::chrono::milliseconds(0) : options_.retry_delay);
+    f.retry.async_wait([this, feed](boost::system::error_code ec) {
+        if (ec) return;
+        auto& f = *feeds_[feed];
+        f.last_frame = now_ns();
+        f.session.run();
+    });
+}
+
+// Binance pushes every partial-depth stream every 100 ms and pings every
+// few minutes; a session silent for stall_timeout is as good as gone.
+void FeedSet::schedule_watchdog()
+{
+    if (options_.stall_timeout.count() <= 0) return;
+    watchdog_.expires_after(options_.stall_timeout / 4);
+    watchdog_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        const auto now   = now_ns();
+        const auto limit = static_cast<std::uint64_t>(
+            std::chrono::nanoseconds(options_.stall_timeout).count());
+        for (std::size_t i = 0; i < feeds_.size(); ++i) {
+            auto& f = *feeds_[i];
+            if (!f.session.is_open() || now - f.last_frame < limit) continue;
+            std::cerr << "[FEED] #" << i << " silent for " << (now - f.last_frame) / 1'000'000
+                      << " ms, dropping it\n";
+            f.session.close();
+        }
+        schedule_watchdog();
+    });
+}
+
+void FeedSet::report(std::ostream& out) const
+{
+    out << "[FEED] #  endpoint                         open       frames   drops  reconnects\n";
+    for (std::size_t i = 0; i < feeds_.size(); ++i) {
+        const auto& f = *feeds_[i];
+        out << "[FEED] " << std::left << std::setw(3) << i
+            << std::setw(33) << (f.endpoint.host + ":" + f.endpoint.port)
+            << std::setw(5) << (f.session.is_open() ? "yes" : "no") << std::right
+            << std::setw(12) << f.frames << std::setw(8) << f.drops
+            << std::setw(12) << f.reconnects << "\n";
+    }
+}
+
+FeedArbiter::FeedArbiter(std::size_t feeds, std::size_t symbols)
+    : feeds_(feeds)
+    , latest_(symbols)
+{
+}
+
+FeedArbiter::Arrival FeedArbiter::observe(std::size_t feed, SymbolId symbol,
+                                          std::uint64_t update_id, std::uint64_t read_ns)
+{
+    auto& latest = latest_[symbol];
+    auto& score  = feeds_[feed];
+    if (update_id > latest.update_id) {
+        latest = {update_id, read_ns};
+        bump(score.first);
+        return Arrival::First;
+    }
+    if (update_id == latest.update_id) {
+        bump(score.duplicate);
+        score.lag.record(read_ns > latest.read_ns ? read_ns - latest.read_ns : 0);
+        return Arrival::Duplicate;
+    }
+    bump(score.stale);
+    return Arrival::Stale;
+}
+
+void FeedArbiter::report(std::ostream& out) const
+{
+    out << "[LEAD] #        first   duplicate       stale    lead %   lag p50 ns   lag p99 ns\n";
+    for (std::size_t i = 0; i < feeds_.size(); ++i) {
+        const auto f = first(i), d = duplicate(i), s = stale(i);
+        const auto copies = f + d + s;
+        out << "[LEAD] " << std::left << std::setw(3) << i << std::right
+            << std::setw(10) << f << std::setw(12) << d << std::setw(12) << s
+            << std::setw(10) << std::fixed << std::setprecision(1)
+            << (copies ? 100.0 * static_cast<double>(f) / static_cast<double>(copies) : 0.0)
+            << std::defaultfloat
+            << std::setw(13) << feeds_[i].lag.percentile(0.5)
+            << std::setw(13) << feeds_[i].lag.percentile(0.99) << "\n";
+    }
+}
+
+} // namespace triarb
@@ -0,0 +1,72 @@
+#include "fixed_point.hpp"
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace triarb {
+
+bool parse_increment(std::string_view s, Increment& out)
+{
+    Decimal d;
+    if (!parse_fixed(s, d) || d.mantissa == 0) return false;
+    out = {d.mantissa, d.scale};
+    return true;
+}
+
+Increment increment_from_double(double value)
+{
+    for (int scale = 0; scale <= 12; ++scale) {
+        const double x = value * kPow10d[scale];
+        const double r = std::round(x);
+        if (r >= 1.0 && std::abs(x - r) <= 1e-9 * x)
+            return {static_cast<std::int64_t>(r), static_cast<std::uint8_t>(scale)};
+    }
+    return {1, 12};
+}
+
+// value / increment = mantissa * 10^(inc.scale - d.scale) / inc.units,
+// rounded half up.  Wire values sit on the increment, so the division is
+// normally exact.
+std::int64_t SymbolScale::to_units(Decimal d, Increment inc)
+{
+    if (d.scale == inc.scale && inc.units == 1) return d.mantissa;
+
+    constexpr std::int64_t kMax = std::numeric_limits<std::int64_t>::max();
+    std::int64_t num   = d.mantissa;
+    std::int64_t denom = inc.units;
+    if (inc.scale >= d.scale) {
+        const std::int64_t p = kPow10i[inc.scale - d.scale];
+        if (num > kMax / p) return kMax;
+        num *= p;
+    } else {
+        const std::int64_t p = kPow10i[d.scale - inc.scale];
+        if (denom > kMax / p) return 0;
+        denom *= p;
+    }
+    return num / denom + (num % denom >= denom - num % denom ? 1 : 0);
+}
+
+std::int64_t SymbolScale::from_double(double v, Increment inc, bool floor)
+{
+    const double x = v * kPow10d[inc.scale] / static_cast<double>(inc.units);
+    // The tolerance keeps 0.3 / 0.1 from flooring to 2.
+    return static_cast<std::int64_t>(floor ? std::floor(x + 1e-9) : std::round(x));
+}
+
+char* SymbolScale::write_units(char* out, std::int64_t n, Increment inc)
+{
+    std::int64_t v = n * inc.units;
+    if (v < 0) { *out++ = '-'; v = -v; }
+
+    const std::int64_t p = kPow10i[inc.scale];
+    out = std::to_chars(out, out + kMaxText, v / p).ptr;
+    if (inc.scale == 0) return out;
+
+    *out++ = '.';
+    std::int64_t frac = v % p;
+    for (int i = inc.scale - 1; i >= 0; --i, frac /= 10)
+        out[i] = static_cast<char>('0' + frac % 10);
+    return out + inc.scale;
+}
+
+} // namespace triarb
@@ -0,0 +1,285 @@
+#include "frame_parser.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <charconv>
+
+using json = nlohmann::json;
+
+namespace triarb {
+
+namespace {
+
+/* Frame Scanner
+ * -------------
+ * Forward-only cursor over the raw frame text.  Keys are located with
+ * string_view::find, which glibc backs with a vectorised memchr, so the
+ * parser touches each byte of the frame roughly once and never copies.
+ *
+ * Only the subset of JSON that Binance emits is accepted: no escapes inside
+ * strings and numbers either bare (ids) or quoted (prices/quantities).
+ */
+struct Scanner
+{
+    std::string_view s;
+    std::size_t      pos = 0;
+
+    void skip_ws()
+    {
+        while (pos < s.size() &&
+               (s[pos] == ' ' || s[pos] == '\n' || s[pos] == '\r' || s[pos] == '\t'))
+            ++pos;
+    }
+
+    bool expect(char c)
+    {
+        skip_ws();
+        if (pos >= s.size() || s[pos] != c) return false;
+        ++pos;
+        return true;
+    }
+
+    bool peek(char c)
+    {
+        skip_ws();
+        return pos < s.size() && s[pos] == c;
+    }
+
+    // Moves past `"key":` searching forward from `from`.
+    bool seek_key(std::string_view quotedKey, std::size_t from)
+    {
+        auto at = s.find(quotedKey, from);
+        if (at == std::string_view::npos) return false;
+        pos = at + quotedKey.size();
+        return expect(':');
+    }
+
+    bool read_string(std::string_view& out)
+    {
+        if (!expect('"')) return false;
+        auto end = s.find('"', pos);
+        if (end == std::string_view::npos) return false;
+        out = s.substr(pos, end - pos);
+        pos = end + 1;
+        return true;
+    }
+
+    bool read_uint(std::uint64_t& out)
+    {
+        skip_ws();
+        auto [ptr, ec] = std::from_chars(s.data() + pos, s.data() + s.size(), out);
+        if (ec != std::errc{}) return false;
+        pos = static_cast<std::size_t>(ptr - s.data());
+        return true;
+    }
+
+    bool read_decimal(Decimal& out)
+    {
+        std::string_view text;
+        return read_string(text) && parse_fixed(text, out);
+    }
+
+    // [["price","qty"], ...]
+    bool read_levels(std::vector<WireLevel>& out)
+    {
+        out.clear();
+        if (!expect('[')) return false;
+        if (peek(']')) return expect(']');
+        do {
+            WireLevel q;
+            if (!expect('[') || !read_decimal(q.px) ||
+                !expect(',') || !read_decimal(q.qty) || !expect(']'))
+                return false;
+            out.push_back(q);
+        } while (expect(','));
+        return expect(']');
+    }
+};
+
+} // namespace
+
+// Dispatches on the first key of a payload object; `sc` sits just past '{'.
+static bool parse_payload(Scanner& sc, MarketFrame& out)
+{
+    const std::size_t body = sc.pos;
+    std::string_view firstKey;
+    if (!sc.read_string(firstKey) || !sc.expect(':')) return false;
+
+    if (firstKey == "lastUpdateId") {
+        if (!sc.read_uint(out.lastUpdateId)) return false;
+        if (!sc.seek_key("\"bids\"", body) || !sc.read_levels(out.bids)) return false;
+        if (!sc.seek_key("\"asks\"", body) || !sc.read_levels(out.asks)) return false;
+        out.kind = FrameKind::PartialDepth;
+        return true;
+    }
+
+    if (firstKey == "e") {
+        std::string_view event;
+        if (!sc.read_string(event) || event != "depthUpdate") return false;
+        if (!sc.seek_key("\"E\"", body) || !sc.read_uint(out.eventTime))     return false;
+        if (!sc.seek_key("\"U\"", body) || !sc.read_uint(out.firstUpdateId)) return false;
+        if (!sc.seek_key("\"u\"", body) || !sc.read_uint(out.lastUpdateId))  return false;
+        if (!sc.seek_key("\"b\"", body) || !sc.read_levels(out.bids)) return false;
+        if (!sc.seek_key("\"a\"", body) || !sc.read_levels(out.asks)) return false;
+        out.kind = FrameKind::DiffDepth;
+        return true;
+    }
+
+    if (firstKey == "u") {
+        WireLevel bid, ask;
+        if (!sc.read_uint(out.lastUpdateId)) return false;
+        if (!sc.seek_key("\"b\"", body) || !sc.read_decimal(bid.px))  return false;
+        if (!sc.seek_key("\"B\"", body) || !sc.read_decimal(bid.qty)) return false;
+        if (!sc.seek_key("\"a\"", body) || !sc.read_decimal(ask.px))  return false;
+        if (!sc.seek_key("\"A\"", body) || !sc.read_decimal(ask.qty)) return false;
+        out.bids.clear();
+        out.asks.clear();
+        out.bids.push_back(bid);
+        out.asks.push_back(ask);
+        out.kind = FrameKind::BookTicker;
+        return true;
+    }
+
+    return false;
+}
+
+bool parse_market_frame(std::string_view msg, MarketFrame& out)
+{
+    out.kind = FrameKind::Invalid;
+    Scanner sc{msg};
+
+    if (!sc.seek_key("\"stream\"", 0) || !sc.read_string(out.stream))
+        return false;
+    if (!sc.seek_key("\"data\"", 0) || !sc.expect('{'))
+        return false;
+    return parse_payload(sc, out);
+}
+
+// {"stream":"ethbtc@bookTicker","data":{"u":1,"s":"ETHBTC","b":"..","B":"..","a":"..","A":".."}}
+// Each key is searched from where the previous value ended, never from the
+// start of the payload again.
+bool parse_book_ticker(std::string_view msg, BookTickerFrame& out)
+{
+    Scanner sc{msg};
+    std::string_view firstKey;
+    if (!sc.seek_key("\"stream\"", 0) || !sc.read_string(out.stream)) return false;
+    if (!sc.seek_key("\"data\"", sc.pos) || !sc.expect('{'))         return false;
+    if (!sc.read_string(firstKey) || firstKey != "u" || !sc.expect(':')) return false;
+    return sc.read_uint(out.updateId) &&
+           sc.seek_key("\"b\"", sc.pos) && sc.read_decimal(out.bid.px) &&
+           sc.seek_key("\"B\"", sc.pos) && sc.read_decimal(out.bid.qty) &&
+           sc.seek_key("\"a\"", sc.pos) && sc.read_decimal(out.ask.px) &&
+           sc.seek_key("\"A\"", sc.pos) && sc.read_decimal(out.ask.qty);
+}
+
+bool parse_depth_snapshot(std::string_view body, MarketFrame& out)
+{
+    out.kind = FrameKind::Invalid;
+    out.stream = {};
+    Scanner sc{body};
+    return sc.expect('{') && parse_payload(sc, out) &&
+           out.kind == FrameKind::PartialDepth;
+}
+
+static bool json_levels(const json& arr, std::vector<WireLevel>& out)
+{
+    out.clear();
+    if (!arr.is_array()) return false;
+    for (const auto& level : arr) {
+        if (!level.is_array() || level.size() < 2 ||
+            !level[0].is_string() || !level[1].is_string())
+            return false;
+        WireLevel q;
+        if (!parse_fixed(level[0].get_ref<const std::string&>(), q.px) ||
+            !parse_fixed(level[1].get_ref<const std::string&>(), q.qty))
+            return false;
+        out.push_back(q);
+    }
+    return true;
+}
+
+static bool json_decimal(const json& obj, const char* key, Decimal& out)
+{
+    if (!obj.contains(key) || !obj[key].is_string()) return false;
+    return parse_fixed(obj[key].get_ref<const std::string&>(), out);
+}
+
+static bool json_uint(const json& obj, const char* key, std::uint64_t& out)
+{
+    if (!obj.contains(key) || !obj[key].is_number_unsigned()) return false;
+    out = obj[key].get<std::uint64_t>();
+    return true;
+}
+
+bool parse_market_frame_json(std::string_view msg, MarketFrame& out)
+try
+{
+    out.kind = FrameKind::Invalid;
+
+    auto j = json::parse(msg, nullptr, false);
+    if (j.is_discarded() || !j.is_object())
+        return false;
+    if (!j.contains("stream") || !j["stream"].is_string())
+        return false;
+    if (!j.contains("data") || !j["data"].is_object())
+        return false;
+
+    out.streamStorage = j["stream"].get<std::string>();
+    out.stream = out.streamStorage;
+    const auto& data = j["data"];
+
+    if (data.contains("lastUpdateId")) {
+        if (!json_uint(data, "lastUpdateId", out.lastUpdateId)) return false;
+        if (!data.contains("bids") || !json_levels(data["bids"], out.bids)) return false;
+        if (!data.contains("asks") || !json_levels(data["asks"], out.asks)) return false;
+        out.kind = FrameKind::PartialDepth;
+        return true;
+    }
+
+    if (data.contains("e")) {
+        if (!data["e"].is_string() || data["e"].get<std::string>() != "depthUpdate")
+            return false;
+        if (!json_uint(data, "E", out.eventTime) ||
+            !json_uint(data, "U", out.firstUpdateId) ||
+            !json_uint(data, "u", out.lastUpdateId))
+            return false;
+        if (!data.contains("b") || !json_levels(data["b"], out.bids)) return false;
+        if (!data.contains("a") || !json_levels(data["a"], out.asks)) return false;
+        out.kind = FrameKind::DiffDepth;
+        return true;
+    }
+
+    if (data.contains("u") && data["u"].is_number_unsigned()) {
+        WireLevel bid, ask;
+        out.lastUpdateId = data["u"].get<std::uint64_t>();
+        if (!json_decimal(data, "b", bid.px) || !json_decimal(data, "B", bid.qty) ||
+            !json_decimal(data, "a", ask.px) || !json_decimal(data, "A", ask.qty))
+            return false;
+        out.bids.assign(1, bid);
+        out.asks.assign(1, ask);
+        out.kind = FrameKind::BookTicker;
+        return true;
+    }
+
+    return false;
+}
+catch (const std::exception&)   // json type errors on unexpected shapes
+{
+    out.kind = FrameKind::Invalid;
+    return false;
+}
+
+bool same_frame(const MarketFrame& a, const MarketFrame& b)
+{
+    auto same_levels = [](const std::vector<WireLevel>& x, const std::vector<WireLevel>& y) {
+        return std::equal(x.begin(), x.end(), y.begin(), y.end());
+    };
+    return a.kind == b.kind
+        && a.stream == b.stream
+        && a.lastUpdateId == b.lastUpdateId
+        && (a.kind != FrameKind::DiffDepth ||
+            (a.firstUpdateId == b.firstUpdateId && a.eventTime == b.eventTime))
+        && same_levels(a.bids, b.bids)
+        && same_levels(a.asks, b.asks);
+}
+
+} // namespace triarb
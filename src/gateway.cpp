@@ -1,9 +1,16 @@
 #include "gateway.hpp"
+#include "async_log.hpp"
 #include <boost/beast/core.hpp>
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/asio/ssl/host_name_verification.hpp>
+#include <nlohmann/json.hpp>
 #include <openssl/hmac.h>
+#include <charconv>
 #include <chrono>
+#include <cstdlib>
+#include <optional>
+#include <stdexcept>
 
 namespace beast = boost::beast;
 namespace http  = beast::http;
@@ -26,8 +33,8 @@ using tcp       = boost::asio::ip::tcp;
  * auto sig = hmac_sha256("my_secret", "symbol=BTCUSDT&side=BUY");
  * // Returns something like: "a1b2c3d4e5f6..."
  */
-static std::string hmac_sha256(const std::string& key,
-                               const std::string& msg)
+std::string hmac_sha256(const std::string& key,
+                        const std::string& msg)
 {
     unsigned char mac[EVP_MAX_MD_SIZE];
     unsigned int  len = 0;
@@ -35,37 +42,349 @@ static std::string hmac_sha256(const std::string& key,
          key.data(), key.size(),
          (unsigned char*)msg.data(), msg.size(),
          mac, &len);
-    std::ostringstream oss;
-    for(unsigned i=0;i<len;++i)
-        oss<<std::hex<<std::setw(2)<<std::setfill('0')<<(int)mac[i];
-    return oss.str();
+    std::string hex(2 * len, '\0');
+    triarb::hex_encode(mac, len, hex.data());
+    return hex;
+}
+
+namespace {
+
+void fmt_dry_run(std::string& out, bool buy, triarb::Qty qty, const triarb::LogStr& symbol,
+                 triarb::Price price, const triarb::SymbolScale& scale)
+{
+    char text[triarb::SymbolScale::kMaxText];
+    out.append("[DRY-RUN] ").append(buy ? "BUY " : "SELL ");
+    out.append(text, scale.write(text, qty));
+    out.append(" ").append(symbol.view()).append(" @ ");
+    out.append(text, scale.write(text, price));
+}
+
+/* One-shot HTTPS GET
+ * ------------------
+ * resolve -> connect -> TLS handshake -> write -> read, keeping itself alive
+ * through shared_from_this until the callback has run.
+ */
+class HttpsGet : public std::enable_shared_from_this<HttpsGet>
+{
+    public:
+        using Callback = std::function<void(bool, std::string)>;
+
+        HttpsGet(boost::asio::io_context& ioc, ssl::context& ctx,
+                 std::string host, std::string port, std::string target, Callback cb)
+            : resolver_(ioc)
+            , stream_(ioc, ctx)
+            , host_(std::move(host))
+            , port_(std::move(port))
+            , cb_(std::move(cb))
+        {
+            req_.method(http::verb::get);
+            req_.target(target);
+            req_.set(http::field::host, host_);
+            req_.set(http::field::user_agent, "TriArbBot/0.0.1");
+        }
+
+        void run()
+        {
+            if(!SSL_set_tlsext_host_name(stream_.native_handle(), host_.c_str()))
+                return fail("SNI", beast::error_code(static_cast<int>(::ERR_get_error()),
+                                                     boost::asio::error::get_ssl_category()));
+            stream_.set_verify_callback(ssl::host_name_verification(host_));
+            resolver_.async_resolve(host_, port_,
+                beast::bind_front_handler(&HttpsGet::on_resolve, shared_from_this()));
+        }
+
+    private:
+        void fail(const char* what, beast::error_code ec)
+        {
+            cb_(false, std::string(what) + ": " + ec.message());
+        }
+
+        void on_resolve(beast::error_code ec, tcp::resolver::results_type results)
+        {
+            if (ec) return fail("resolve", ec);
+            beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds(10));
+            beast::get_lowest_layer(stream_).async_connect(results,
+                beast::bind_front_handler(&HttpsGet::on_connect, shared_from_this()));
+        }
+
+        void on_connect(beast::error_code ec, tcp::endpoint)
+        {
+            if (ec) return fail("connect", ec);
+            stream_.async_handshake(ssl::stream_base::client,
+                beast::bind_front_handler(&HttpsGet::on_handshake, shared_from_this()));
+        }
+
+        void on_handshake(beast::error_code ec)
+        {
+            if (ec) return fail("handshake", ec);
+            http::async_write(stream_, req_,
+                beast::bind_front_handler(&HttpsGet::on_write, shared_from_this()));
+        }
+
+        void on_write(beast::error_code ec, std::size_t)
+        {
+            if (ec) return fail("write", ec);
+            http::async_read(stream_, buffer_, res_,
+                beast::bind_front_handler(&HttpsGet::on_read, shared_from_this()));
+        }
+
+        void on_read(beast::error_code ec, std::size_t)
+        {
+            if (ec) return fail("read", ec);
+            if (res_.result() != http::status::ok)
+                return cb_(false, "HTTP " + std::to_string(res_.result_int()) + ": " + res_.body());
+            cb_(true, std::move(res_.body()));
+            // Best-effort close; the response has already been delivered.
+            stream_.async_shutdown([self = shared_from_this()](beast::error_code) {});
+        }
+
+        tcp::resolver                         resolver_;
+        beast::ssl_stream<beast::tcp_stream>  stream_;
+        std::string                           host_;
+        std::string                           port_;
+        Callback                              cb_;
+        beast::flat_buffer                    buffer_;
+        http::request<http::empty_body>       req_;
+        http::response<http::string_body>     res_;
+};
+
+double decimal_field(const nlohmann::json& j, const char* key)
+{
+    const auto it = j.find(key);
+    if (it == j.end() || !it->is_string()) return 0.0;
+    return std::strtod(it->get_ref<const std::string&>().c_str(), nullptr);
+}
+
+/// Executed quantity and VWAP of an order object, as both transports
+/// return it.
+FillReport fill_report(const nlohmann::json& j)
+{
+    if (!j.is_object()) return {false, 0.0, 0.0};
+
+    const double qty   = decimal_field(j, "executedQty");
+    const double quote = decimal_field(j, "cummulativeQuoteQty");
+    if (!(qty > 0)) return {false, 0.0, 0.0};
+    if (quote > 0) return {true, qty, quote / qty};
+
+    // FULL responses carry the quote total; fall back to the individual
+    // fills should it ever be missing.
+    double filled = 0.0, notional = 0.0;
+    if (const auto fills = j.find("fills"); fills != j.end() && fills->is_array())
+        for (const auto& f : *fills) {
+            const double q = decimal_field(f, "qty");
+            filled   += q;
+            notional += q * decimal_field(f, "price");
+        }
+    return {true, qty, filled > 0 ? notional / filled : 0.0};
+}
+
+/// The number in the string value of `"key":"..."`, if `body` has one.
+/// Reads order responses in place; no JSON document is built.
+std::optional<double> decimal_value(std::string_view body, std::string_view key)
+{
+    for (auto pos = body.find(key); pos != std::string_view::npos; pos = body.find(key, pos + 1)) {
+        auto i = pos + key.size();
+        if (pos == 0 || body[pos - 1] != '"' || i >= body.size() || body[i] != '"') continue;
+        auto skip_space = [&] { while (i < body.size() && body[i] == ' ') ++i; };
+        ++i;
+        skip_space();
+        if (i >= body.size() || body[i++] != ':') return std::nullopt;
+        skip_space();
+        if (i >= body.size() || body[i++] != '"') return std::nullopt;
+        double v = 0.0;
+        const auto [end, ec] = std::from_chars(body.data() + i, body.data() + body.size(), v);
+        if (ec != std::errc() || end == body.data() + body.size() || *end != '"')
+            return std::nullopt;
+        return v;
+    }
+    return std::nullopt;
+}
+
+FillReport ws_fill_report(const nlohmann::json& reply)
+{
+    const auto status = reply.find("status");
+    const auto result = reply.find("result");
+    if (status == reply.end() || *status != 200 || result == reply.end())
+        return {false, 0.0, 0.0};
+    return fill_report(*result);
+}
+
+} // namespace
+
+GatewayOptions load_gateway_options_from_env()
+{
+    GatewayOptions options;
+    if (const char* transport = std::getenv("ORDER_TRANSPORT")) {
+        const std::string_view t = transport;
+        if (t == "ws")        options.transport = OrderTransport::WebSocket;
+        else if (t != "rest") throw std::invalid_argument("ORDER_TRANSPORT must be rest or ws");
+    }
+    if (const char* size = std::getenv("ORDER_POOL_SIZE"))
+        options.pool_size = std::stoul(size);
+    if (const char* secs = std::getenv("ORDER_IDLE_REFRESH"))
+        options.idle_refresh = std::chrono::seconds(std::stol(secs));
+    if (const char* port = std::getenv("REST_PORT")) options.port = port;
+    if (const char* ca = std::getenv("CA_FILE"))     options.ca_file = ca;
+    options.socket = triarb::load_socket_options_from_env();
+    options.socket.timestamps = false;
+    return options;
+}
+
+FillReport parse_order_response(std::string_view body)
+{
+    // A FULL response carries the executed quantity and its quote total;
+    // only one without them needs the whole document parsed.
+    const auto qty   = decimal_value(body, "executedQty");
+    const auto quote = decimal_value(body, "cummulativeQuoteQty");
+    if (qty && quote && body.starts_with('{')) {
+        if (!(*qty > 0))  return {false, 0.0, 0.0};
+        if (*quote > 0)   return {true, *qty, *quote / *qty};
+    }
+    return fill_report(nlohmann::json::parse(body, nullptr, false));
+}
+
+FillReport parse_ws_order_response(std::string_view frame)
+{
+    // The same fast path around the result's totals, behind the reply's
+    // own status
+    const auto status = triarb::uint_field(frame, "status");
+    const auto qty    = decimal_value(frame, "executedQty");
+    const auto quote  = decimal_value(frame, "cummulativeQuoteQty");
+    if (status && *status != 200) return {false, 0.0, 0.0};
+    if (status && qty && quote && frame.starts_with('{')) {
+        if (!(*qty > 0))  return {false, 0.0, 0.0};
+        if (*quote > 0)   return {true, *qty, *quote / *qty};
+    }
+    const auto reply = nlohmann::json::parse(frame, nullptr, false);
+    return reply.is_object() ? ws_fill_report(reply) : FillReport{false, 0.0, 0.0};
 }
 
 Gateway::Gateway(boost::asio::io_context& ioc,
                 std::string              rest_host, 
                 ApiKeys                  keys,
-                bool                     live)
+                bool                     live,
+                GatewayOptions           options)
     : host_(std::move(rest_host))                   
     , ioc_(ioc)                                      
     , live_(live)                                    
     , keys_(std::move(keys))                       
+    , signer_(keys_.secret)
     , ctx_(boost::asio::ssl::context::tlsv12_client) 
+    , options_(std::move(options))
 {
     ctx_.set_default_verify_paths();
+    ctx_.set_verify_mode(ssl::verify_peer);
+    if (!options_.ca_file.empty()) ctx_.load_verify_file(options_.ca_file);
+
+    /* Warm the order connections now, so the first order does not pay
+     * for DNS, TCP and TLS setup */
+    if (live_ && options_.transport == OrderTransport::WebSocket) {
+        ws_ = std::make_unique<triarb::WsApiSession>(ioc_, options_.ws_host, options_.ws_port,
+                                                     options_.ws_target, options_.ca_file,
+                                                     std::chrono::seconds(10), options_.socket);
+        ws_->start();
+    } else if (live_) {
+        pool_ = std::make_unique<triarb::HttpsPool>(ioc_, ctx_, host_, options_.port,
+                                                    options_.pool_size, options_.idle_refresh,
+                                                    std::chrono::seconds(10), options_.socket);
+        pool_->start();
+    }
+}
+
+std::string order_body(std::string_view symbol,
+                       std::string_view side,
+                       triarb::Qty qty,
+                       triarb::Price price,
+                       const triarb::SymbolScale& scale,
+                       std::int64_t timestamp_ms)
+{
+    /* Quantity and price as exact decimals on the symbol's step and tick */
+    char qty_text[triarb::SymbolScale::kMaxText];
+    char price_text[triarb::SymbolScale::kMaxText];
+    char ts_text[24];
+
+    /* Build the order parameters as a URL-encoded string
+     * Format: key1=value1&key2=value2&... */
+    std::string body;
+    body.reserve(256);
+    body.append("symbol=").append(symbol)
+        .append("&side=").append(side)
+        .append("&type=LIMIT_MAKER")        /* Order type that ensures we're maker not taker */
+        .append("&timeInForce=IOC")         /* Immediate-or-Cancel: fill what's possible immediately */
+        .append("&quantity=").append(qty_text, scale.write(qty_text, qty))
+        .append("&price=").append(price_text, scale.write(price_text, price))
+        .append("&recvWindow=5000")         /* How long the request is valid for */
+        .append("&timestamp=")              /* Timestamp for request validation */
+        .append(ts_text, std::to_chars(ts_text, ts_text + sizeof ts_text, timestamp_ms).ptr);
+    return body;
+}
+
+std::string ws_order_request(std::uint64_t id,
+                             std::string_view symbol,
+                             std::string_view side,
+                             triarb::Qty qty,
+                             triarb::Price price,
+                             const triarb::SymbolScale& scale,
+                             std::int64_t timestamp_ms,
+                             const ApiKeys& keys)
+{
+    char qty_text[triarb::SymbolScale::kMaxText];
+    char price_text[triarb::SymbolScale::kMaxText];
+    char ts_text[24];
+    char id_text[24];
+    const std::string_view q(qty_text, scale.write(qty_text, qty));
+    const std::string_view p(price_text, scale.write(price_text, price));
+    const std::string_view ts(ts_text,
+        std::to_chars(ts_text, ts_text + sizeof ts_text, timestamp_ms).ptr - ts_text);
+
+    /* The signed payload lists the same parameters as the JSON below,
+     * sorted by name */
+    std::string payload;
+    payload.reserve(256);
+    payload.append("apiKey=").append(keys.key)
+           .append("&price=").append(p)
+           .append("&quantity=").append(q)
+           .append("&recvWindow=5000")
+           .append("&side=").append(side)
+           .append("&symbol=").append(symbol)
+           .append("&timeInForce=IOC")
+           .append("&timestamp=").append(ts)
+           .append("&type=LIMIT_MAKER");
+
+    /* Symbols, sides, keys and decimals never need JSON escaping.  The id
+     * goes last, so everything before the price is the same for every
+     * order of the symbol and side (see OrderTemplate) */
+    std::string req;
+    req.reserve(512);
+    req.append(R"({"method":"order.place","params":{"apiKey":")").append(keys.key)
+       .append(R"(","price":")").append(p)
+       .append(R"(","quantity":")").append(q)
+       .append(R"(","recvWindow":5000,"side":")").append(side)
+       .append(R"(","symbol":")").append(symbol)
+       .append(R"(","timeInForce":"IOC","timestamp":)").append(ts)
+       .append(R"(,"type":"LIMIT_MAKER","signature":")").append(hmac_sha256(keys.secret, payload))
+       .append(R"("},"id":)")
+       .append(id_text, std::to_chars(id_text, id_text + sizeof id_text, id).ptr)
+       .append("}");
+    return req;
 }
 
 void Gateway::send_order(std::string_view symbol,
             std::string_view side, // BUY / SELL
-            double qty,
-            double price,
-            std::function<void(FillReport)> cb)
+            triarb::Qty qty,
+            triarb::Price price,
+            const triarb::SymbolScale& scale,
+            FillCallback cb,
+            SentCallback on_sent)
 {
     /* If not in live mode, simulate the order and return immediately
      * Used for testing without making real trades */
     if(!live_)
     {
-        std::cout<<"[DRY-RUN] "<<side<<" "<<qty<<" "<<symbol<<" @ "<<price<<"\n";
-        cb({true, qty, price}); // pretend filled
+        if (on_sent) on_sent();
+        triarb::log<fmt_dry_run>(triarb::LogStream::Out, side == "BUY", qty,
+                                 triarb::LogStr(symbol), price, scale);
+        cb({true, scale.to_double(qty), scale.to_double(price)}); // pretend filled
         return;
     }
 
@@ -74,33 +393,112 @@ void Gateway::send_order(std::string_view symbol,
     auto ts = std::chrono::duration_cast<std::chrono::milliseconds>(
                   std::chrono::system_clock::now().time_since_epoch()).count();
 
-    /* Build the order parameters as a URL-encoded string
-     * Format: key1=value1&key2=value2&... */
-    std::ostringstream body;
-    body<<"symbol="   <<symbol
-        <<"&side="    <<side
-        <<"&type=LIMIT_MAKER"      /* Order type that ensures we're maker not taker */
-        <<"&timeInForce=IOC"       /* Immediate-or-Cancel: fill what's possible immediately */
-        <<"&quantity="<<std::fixed<<std::setprecision(6)<<qty  /* 6 decimals for crypto quantity */
-        <<"&price="   <<std::setprecision(2)<<price            /* 2 decimals for price */
-        <<"&recvWindow=5000"       /* How long the request is valid for */
-        <<"&timestamp="<<ts;       /* Timestamp for request validation */
-
-    /* Create HMAC-SHA256 signature of the request parameters
-     * Required by Binance API for authentication */
-    auto sig = hmac_sha256(keys_.secret, body.str());
-    body<<"&signature="<<sig;
+    /* Quantity, price, timestamp and signature patched into the symbol's
+     * preformatted request; no allocation up to here */
+    auto& tmpl = order_template(symbol, side);
+    if (ws_) {
+        const auto id = ws_->next_id();
+        return send_ws(symbol, id, tmpl.ws_request(id, qty, price, scale, ts, signer_),
+                       std::move(cb), std::move(on_sent));
+    }
+    send_rest(symbol, tmpl.rest_body(qty, price, scale, ts, signer_), std::move(cb),
+              std::move(on_sent));
+}
+
+void Gateway::prepare_orders(std::string_view symbol)
+{
+    if (live_) order_template(symbol, "BUY");
+}
 
+triarb::OrderTemplate& Gateway::order_template(std::string_view symbol, std::string_view side)
+{
+    auto it = templates_.find(symbol);
+    if (it == templates_.end())
+        it = templates_.emplace(std::string(symbol),
+                                SymbolTemplates{{symbol, "BUY", keys_.key},
+                                                {symbol, "SELL", keys_.key}}).first;
+    return side == "BUY" ? it->second.buy : it->second.sell;
+}
+
+void Gateway::send_rest(std::string_view symbol,
+            std::string_view body,
+            FillCallback cb,
+            SentCallback on_sent)
+{
     /* Create and configure the HTTP POST request
      * Using Boost.Beast for HTTP functionality */
-    auto req = std::make_shared<http::request<http::string_body>>();
+    triarb::HttpsPool::Request req;
     
-    req->method(http::verb::post);               /* Set HTTP method to POST */
-    req->target("/api/v3/order");               /* Binance API endpoint for orders */
-    req->set(http::field::host, host_);         /* Set the host header (api.binance.com) */
-    req->set("X-MBX-APIKEY", keys_.key);        /* Add API key for authentication */
-    req->set(http::field::content_type,         /* Set content type for form data */
-             "application/x-www-form-urlencoded");
-    req->body() = body.str();                   /* Set the request body with parameters */
-    req->prepare_payload();                     /* Finalize the request for sending */
+    req.method(http::verb::post);                /* Set HTTP method to POST */
+    req.target("/api/v3/order");                /* Binance API endpoint for orders */
+    req.set(http::field::host, host_);          /* Set the host header (api.binance.com) */
+    req.set("X-MBX-APIKEY", keys_.key);         /* Add API key for authentication */
+    req.set(http::field::content_type,          /* Set content type for form data */
+            "application/x-www-form-urlencoded");
+    req.keep_alive(true);                       /* Reuse the connection for the next order */
+    req.body() = body;                          /* Signed parameters from the template */
+    req.prepare_payload();                      /* Finalize the request for sending */
+    if (on_sent) on_sent();
+
+    /* Send on a warm connection; the response carries the fills */
+    const auto sent = triarb::now_ns();
+    pool_->async_request(std::move(req),
+        [this, sent, symbol = triarb::LogStr(symbol), cb = std::move(cb)]
+        (beast::error_code ec, triarb::HttpsPool::Response res) {
+            if (ec) {
+                std::cerr << "[ORDER] " << symbol.view() << " got no response (" << ec.message()
+                          << "), status unknown\n";
+                return cb({false, 0.0, 0.0});
+            }
+            if (options_.latency)
+                options_.latency->record(triarb::Span::OrderRtt, triarb::now_ns() - sent);
+            if (res.result() != http::status::ok) {
+                std::cerr << "[ORDER] " << symbol.view() << " rejected: HTTP " << res.result_int()
+                          << " " << res.body() << "\n";
+                return cb({false, 0.0, 0.0});
+            }
+            cb(parse_order_response(res.body()));
+        });
+}
+
+void Gateway::send_ws(std::string_view symbol,
+            std::uint64_t id,
+            std::string_view request,
+            FillCallback cb,
+            SentCallback on_sent)
+{
+    /* One signed JSON frame; its id routes the response back here while
+     * other orders share the session */
+    if (on_sent) on_sent();
+
+    const auto sent = triarb::now_ns();
+    ws_->async_request(id, request,
+        [this, sent, symbol = triarb::LogStr(symbol), cb = std::move(cb)]
+        (beast::error_code ec, std::string_view reply) {
+            if (ec) {
+                std::cerr << "[ORDER] " << symbol.view() << " got no response (" << ec.message()
+                          << "), status unknown\n";
+                return cb({false, 0.0, 0.0});
+            }
+            if (options_.latency)
+                options_.latency->record(triarb::Span::OrderRtt, triarb::now_ns() - sent);
+            if (const auto status = triarb::uint_field(reply, "status"); status != 200u) {
+                std::cerr << "[ORDER] " << symbol.view() << " rejected: status "
+                          << status.value_or(0) << " " << reply << "\n";
+                return cb({false, 0.0, 0.0});
+            }
+            cb(parse_ws_order_response(reply));
+        });
+}
+
+void Gateway::fetch_depth(std::string_view symbol,
+            unsigned limit,
+            std::function<void(bool ok, std::string body)> cb)
+{
+    std::string target = "/api/v3/depth?symbol=";
+    target.append(symbol);
+    target += "&limit=" + std::to_string(limit);
+
+    std::make_shared<HttpsGet>(ioc_, ctx_, host_, options_.port, std::move(target),
+                               std::move(cb))->run();
 }
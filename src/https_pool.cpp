@@ -0,0 +1,339 @@
+#include "https_pool.hpp"
+#include <boost/asio/ssl/host_name_verification.hpp>
+#include <boost/beast/ssl.hpp>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+namespace triarb {
+
+namespace beast = boost::beast;
+namespace http  = beast::http;
+namespace ssl   = boost::asio::ssl;
+using tcp       = boost::asio::ip::tcp;
+
+/* Pool Connection
+ * ---------------
+ * resolve -> connect -> TLS handshake -> Ready, then an endless read for
+ * the next response.  A request is just a write on a Ready connection;
+ * the read that is already pending picks up its response.
+ *
+ * The stream is rebuilt for every connection attempt, and only once no
+ * operation on the old one is pending: every failure path closes the
+ * socket and lets the last outstanding handler call restart().  The
+ * operations each request repeats (write, read, deadline, idle wait) take
+ * their state from the RecyclingArena.
+ */
+class HttpsPool::Connection : public std::enable_shared_from_this<Connection>
+{
+    public:
+        explicit Connection(HttpsPool& pool)
+            : pool_(&pool)
+            , resolver_(pool.ioc_)
+            , idle_timer_(pool.ioc_)
+            , retry_timer_(pool.ioc_)
+            , deadline_(pool.ioc_)
+        {}
+
+        bool ready() const { return state_ == State::Ready; }
+
+        void connect()
+        {
+            state_ = State::Connecting;
+            stream_.emplace(pool_->ioc_, pool_->ctx_);
+            buffer_.clear();
+
+            if (!SSL_set_tlsext_host_name(stream_->native_handle(), pool_->host_.c_str()))
+                return fail("SNI", beast::error_code(static_cast<int>(::ERR_get_error()),
+                                                     boost::asio::error::get_ssl_category()));
+            stream_->set_verify_callback(ssl::host_name_verification(pool_->host_));
+
+            resolver_.async_resolve(pool_->host_, pool_->port_,
+                beast::bind_front_handler(&Connection::on_resolve, shared_from_this()));
+        }
+
+        void send(Pending p)
+        {
+            state_ = State::Busy;
+            ++uses_;
+            idle_timer_.cancel();
+            req_      = std::move(p.req);
+            inflight_ = std::move(p.cb);
+
+            deadline_.expires_at(p.deadline);
+            deadline_.async_wait(recycling([self = shared_from_this(), uses = uses_](beast::error_code ec) {
+                if (!ec && self->uses_ == uses && self->inflight_) self->close();
+            }));
+
+            writing_ = true;
+            http::async_write(*stream_, req_,
+                recycling(beast::bind_front_handler(&Connection::on_write, shared_from_this())));
+        }
+
+        /// The pool is going away: stop reconnecting and drop the socket.
+        void detach()
+        {
+            pool_ = nullptr;
+            resolver_.cancel();
+            idle_timer_.cancel();
+            retry_timer_.cancel();
+            deadline_.cancel();
+            close();
+        }
+
+    private:
+        enum class State { Down, Connecting, Ready, Busy };
+
+        void on_resolve(beast::error_code ec, tcp::resolver::results_type results)
+        {
+            if (!pool_) return;
+            if (ec) return fail("resolve", ec);
+            beast::get_lowest_layer(*stream_).expires_after(pool_->request_timeout_);
+            beast::get_lowest_layer(*stream_).async_connect(results,
+                beast::bind_front_handler(&Connection::on_connect, shared_from_this()));
+        }
+
+        void on_connect(beast::error_code ec, tcp::endpoint)
+        {
+            if (!pool_) return;
+            if (ec) return fail("connect", ec);
+            tune_socket(beast::get_lowest_layer(*stream_).socket().native_handle(), pool_->socket_);
+            stream_->async_handshake(ssl::stream_base::client,
+                beast::bind_front_handler(&Connection::on_handshake, shared_from_this()));
+        }
+
+        void on_handshake(beast::error_code ec)
+        {
+            if (!pool_) return;
+            if (ec) return fail("handshake", ec);
+
+            // Idle reads must not time out; requests have their own deadline.
+            beast::get_lowest_layer(*stream_).expires_never();
+            ++pool_->connects_;
+            state_ = State::Ready;
+            arm_read();
+            wait_idle();
+            pool_->on_ready(*this);
+        }
+
+        void arm_read()
+        {
+            res_ = {};
+            reading_ = true;
+            http::async_read(*stream_, buffer_, res_,
+                recycling(beast::bind_front_handler(&Connection::on_read, shared_from_this())));
+        }
+
+        void on_write(beast::error_code ec, std::size_t)
+        {
+            writing_ = false;
+            if (!pool_) return;
+            if (ec) close();                 // the pending read reports the failure
+            if (state_ == State::Down) restart(std::chrono::milliseconds(0));
+        }
+
+        void on_read(beast::error_code ec, std::size_t)
+        {
+            reading_ = false;
+            deadline_.cancel();
+            if (!pool_) return;
+
+            auto cb = std::move(inflight_);
+
+            // Closed under us, timed out, or an answer nobody asked for
+            // (servers send one just before dropping an idle connection).
+            if (ec || !cb) {
+                state_ = State::Down;
+                close();
+                if (cb) cb(ec ? ec : beast::error_code(http::error::end_of_stream), {});
+                if (pool_) restart(std::chrono::milliseconds(0));
+                return;
+            }
+
+            if (pool_->socket_.quickack)
+                rearm_quickack(beast::get_lowest_layer(*stream_).socket().native_handle());
+
+            Response res = std::move(res_);
+            const bool keep = res.keep_alive();
+            if (keep) {
+                state_ = State::Ready;
+                arm_read();
+                wait_idle();
+            } else {
+                state_ = State::Down;
+                close();
+            }
+
+            cb({}, std::move(res));
+
+            // The callback may already have sent the next request on us.
+            if (!pool_) return;
+            if (!keep)                        restart(std::chrono::milliseconds(0));
+            else if (state_ == State::Ready) pool_->on_ready(*this);
+        }
+
+        void wait_idle()
+        {
+            idle_timer_.expires_after(pool_->idle_limit_);
+            idle_timer_.async_wait(recycling([self = shared_from_this(), uses = uses_](beast::error_code ec) {
+                if (ec || !self->pool_ || self->uses_ != uses || self->state_ != State::Ready)
+                    return;
+                self->close();               // the pending read reconnects
+            }));
+        }
+
+        void fail(const char* what, beast::error_code ec)
+        {
+            std::cerr << "[ORDER] " << pool_->host_ << ":" << pool_->port_ << " " << what
+                      << " failed: " << ec.message() << ", retrying\n";
+            state_ = State::Down;
+            close();
+            restart(kReconnectDelay);
+        }
+
+        // Reconnects once nothing is pending on the old stream.
+        void restart(std::chrono::milliseconds delay)
+        {
+            state_ = State::Down;
+            if (reading_ || writing_) return;
+            if (delay.count() == 0) return connect();
+
+            retry_timer_.expires_after(delay);
+            retry_timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+                if (!ec && self->pool_) self->connect();
+            });
+        }
+
+        void close()
+        {
+            if (!stream_) return;
+            beast::error_code ignored;
+            beast::get_lowest_layer(*stream_).socket().close(ignored);
+        }
+
+        // Bound to the io_context's own executor rather than the
+        // type-erased default, so completions are invoked directly instead
+        // of being wrapped (and allocated) for a polymorphic executor.
+        using Executor = boost::asio::io_context::executor_type;
+        using Stream   = beast::ssl_stream<beast::basic_stream<tcp, Executor>>;
+        using Timer    = boost::asio::basic_waitable_timer<std::chrono::steady_clock,
+                             boost::asio::wait_traits<std::chrono::steady_clock>, Executor>;
+
+        HttpsPool*                   pool_;
+        tcp::resolver                resolver_;
+        std::optional<Stream>        stream_;
+        beast::flat_buffer           buffer_;
+        Request                      req_;
+        Response                     res_;
+        Callback                     inflight_;
+        State                        state_   = State::Down;
+        bool                         reading_ = false;
+        bool                         writing_ = false;
+        std::uint64_t                uses_    = 0;    // invalidates stale idle/deadline waits
+        Timer                        idle_timer_;
+        Timer                        retry_timer_;
+        Timer                        deadline_;
+};
+
+HttpsPool::HttpsPool(boost::asio::io_context& ioc,
+                     boost::asio::ssl::context& ctx,
+                     std::string host,
+                     std::string port,
+                     std::size_t size,
+                     std::chrono::milliseconds idle_limit,
+                     std::chrono::milliseconds request_timeout,
+                     SocketOptions socket)
+    : ioc_(ioc)
+    , ctx_(ctx)
+    , host_(std::move(host))
+    , port_(std::move(port))
+    , idle_limit_(idle_limit)
+    , request_timeout_(request_timeout)
+    , socket_(socket)
+    , expiry_(ioc)
+{
+    if (size == 0) throw std::invalid_argument("HttpsPool needs at least one connection");
+    for (std::size_t i = 0; i < size; ++i)
+        conns_.push_back(std::make_shared<Connection>(*this));
+}
+
+// Handlers still queued on the io_context keep their connection alive but
+// find it detached and do nothing.
+HttpsPool::~HttpsPool()
+{
+    expiry_.cancel();
+    for (auto& c : conns_) c->detach();
+}
+
+void HttpsPool::start()
+{
+    for (auto& c : conns_) c->connect();
+}
+
+void HttpsPool::async_request(Request req, Callback cb)
+{
+    const auto deadline = Clock::now() + request_timeout_;
+    for (auto& c : conns_)
+        if (c->ready()) return c->send({std::move(req), std::move(cb), deadline});
+    if (waiting_count_ == kMaxWaiting) {
+        std::cerr << "[ORDER] " << host_ << ":" << port_ << " " << kMaxWaiting
+                  << " requests already waiting, not sent\n";
+        return cb(boost::asio::error::no_buffer_space, {});
+    }
+    waiting_[(waiting_head_ + waiting_count_++) % kMaxWaiting] =
+        {std::move(req), std::move(cb), deadline};
+    if (waiting_count_ == 1) arm_expiry();
+}
+
+void HttpsPool::on_ready(Connection& conn)
+{
+    expire_waiting();
+    // A failed request's callback may already have sent the next one on us.
+    if (waiting_count_ == 0 || !conn.ready()) return;
+    Pending p = take_waiting();
+    arm_expiry();
+    conn.send(std::move(p));
+}
+
+HttpsPool::Pending HttpsPool::take_waiting()
+{
+    Pending p = std::move(waiting_[waiting_head_]);
+    waiting_head_ = (waiting_head_ + 1) % kMaxWaiting;
+    --waiting_count_;
+    return p;
+}
+
+// Every request gets the same timeout, so the queue is in deadline order
+// and only its oldest entry needs a timer.  A request that expired while
+// queued carries a signed timestamp and a price nobody should act on any
+// more.
+void HttpsPool::expire_waiting()
+{
+    const auto now = Clock::now();
+    while (waiting_count_ != 0 && waiting_[waiting_head_].deadline <= now) {
+        Pending p = take_waiting();
+        std::cerr << "[ORDER] " << host_ << ":" << port_
+                  << " no connection before the request timeout, not sent\n";
+        p.cb(boost::asio::error::timed_out, {});
+    }
+}
+
+void HttpsPool::arm_expiry()
+{
+    if (waiting_count_ == 0) return void(expiry_.cancel());
+    expiry_.expires_at(waiting_[waiting_head_].deadline);
+    expiry_.async_wait([this](beast::error_code ec) {
+        if (ec) return;                  // re-armed, or the pool is going away
+        expire_waiting();
+        arm_expiry();
+    });
+}
+
+std::size_t HttpsPool::ready() const
+{
+    std::size_t n = 0;
+    for (const auto& c : conns_) n += c->ready();
+    return n;
+}
+
+} // namespace triarb
@@ -0,0 +1,170 @@
+#include "inventory.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <stdexcept>
+#include <string_view>
+
+namespace triarb {
+
+namespace {
+
+// "USDT:150,ETH:0.05,BTC:0.0015"
+std::vector<std::pair<std::string, double>> parse_targets(std::string_view text)
+{
+    std::vector<std::pair<std::string, double>> targets;
+    for (std::size_t pos = 0; pos <= text.size();) {
+        const auto comma = std::min(text.find(',', pos), text.size());
+        const auto item  = text.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        const auto colon = item.find(':');
+        double amount = 0;
+        const char* end = item.data() + item.size();
+        const auto [ptr, ec] = colon == std::string_view::npos
+            ? std::from_chars_result{item.data(), std::errc::invalid_argument}
+            : std::from_chars(item.data() + colon + 1, end, amount);
+        if (colon == 0 || ec != std::errc{} || ptr != end || amount < 0)
+            throw std::invalid_argument("INVENTORY entry '" + std::string(item) +
+                                        "' is not ASSET:amount");
+        targets.emplace_back(std::string(item.substr(0, colon)), amount);
+    }
+    return targets;
+}
+
+} // namespace
+
+InventoryOptions load_inventory_options_from_env()
+{
+    InventoryOptions options;
+    if (const char* targets = std::getenv("INVENTORY"))
+        options.targets = parse_targets(targets);
+    if (const char* threshold = std::getenv("REBALANCE_THRESHOLD"))
+        options.threshold = std::stod(threshold);
+    if (const char* secs = std::getenv("REBALANCE_INTERVAL"))
+        options.interval = std::chrono::seconds(std::stol(secs));
+    return options;
+}
+
+Inventory::Inventory(const TriangleEngine& engine, const InventoryOptions& options)
+    : engine_(&engine)
+    , threshold_(options.threshold)
+    , balance_(engine.asset_count(), 0.0)
+    , target_(engine.asset_count(), 0.0)
+    , reserved_(engine.asset_count(), 0.0)
+    , held_(engine.asset_count(), false)
+    , home_pair_(engine.asset_count())
+{
+    for (const auto& [name, amount] : options.targets) {
+        const auto a = engine.find_asset(name);
+        if (!a) throw std::invalid_argument("INVENTORY asset " + name + " is not traded");
+        balance_[*a] = target_[*a] = amount;
+        held_[*a] = true;
+    }
+    for (AssetId a = 0; a < engine.asset_count(); ++a)
+        if (a != engine.home()) home_pair_[a] = engine.pair(a, engine.home());
+}
+
+std::size_t Inventory::reserve(const Triangle& t, const std::array<double, 3>& inputs)
+{
+    // A cycle sells three different assets, so the legs never compete
+    for (std::size_t leg = 0; leg < 3; ++leg) {
+        const auto& l = t.legs[leg];
+        const AssetId sold = engine_->assets(l.symbol)[l.side == Side::Buy ? 1 : 0];
+        if (available(sold) < inputs[leg]) return leg;
+    }
+    for (std::size_t leg = 0; leg < 3; ++leg) {
+        const auto& l = t.legs[leg];
+        reserved_[engine_->assets(l.symbol)[l.side == Side::Buy ? 1 : 0]] += inputs[leg];
+    }
+    return 3;
+}
+
+void Inventory::release(AssetId a, double amount)
+{
+    reserved_[a] = std::max(0.0, reserved_[a] - amount);
+}
+
+void Inventory::apply_fill(SymbolId symbol, Side side, double qty, double px)
+{
+    const auto [base, quote] = engine_->assets(symbol);
+    const double sign = side == Side::Buy ? 1.0 : -1.0;
+    balance_[base]  += sign * qty;
+    balance_[quote] -= sign * qty * px;
+}
+
+LegRisk Inventory::leg_risk(const Triangle& t, const std::array<LegOutcome, 3>& legs) const
+{
+    // Leg i sells the cycle's i-th asset, which leg i-1 bought
+    LegRisk risk;
+    for (std::size_t i = 0; i < 3; ++i) {
+        risk.delta[i] = legs[(i + 2) % 3].got - legs[i].spent;
+        const auto& l = t.legs[i];
+        const AssetId a = engine_->assets(l.symbol)[l.side == Side::Buy ? 1 : 0];
+        if (a != engine_->home()) risk.exposure += std::abs(home_value(a, risk.delta[i]));
+    }
+    return risk;
+}
+
+double Inventory::home_value(AssetId a, double amount) const
+{
+    if (a == engine_->home()) return amount;
+    const auto& pair = home_pair_[a];
+    if (!pair) return 0.0;
+
+    const auto top = engine_->book(*pair).top();
+    if (top.bid.px <= 0 || top.ask.px <= 0) return 0.0;
+    const double mid = 0.5 * (top.bid.px + top.ask.px);
+    return engine_->assets(*pair)[0] == a ? amount * mid : amount / mid;
+}
+
+std::vector<Inventory::Rebalance> Inventory::rebalance_plan() const
+{
+    std::vector<Rebalance> plan;
+    for (AssetId a = 0; a < balance_.size(); ++a) {
+        const double d = drift(a);
+        if (!held_[a] || !home_pair_[a] || std::abs(d) <= threshold_ * target_[a]) continue;
+
+        const SymbolId s = *home_pair_[a];
+        const auto top = engine_->book(s).top();
+        if (top.bid.px <= 0 || top.ask.px <= 0) continue;
+
+        // Selling a surplus or buying a shortfall of `a`; when the home
+        // asset is the base, that is buying or selling home instead.
+        if (engine_->assets(s)[0] == a)
+            plan.push_back(d > 0 ? Rebalance{s, Side::Sell, d, top.bid.px}
+                                 : Rebalance{s, Side::Buy, -d, top.ask.px});
+        else
+            plan.push_back(d > 0 ? Rebalance{s, Side::Buy, d / top.ask.px, top.ask.px}
+                                 : Rebalance{s, Side::Sell, -d / top.bid.px, top.bid.px});
+    }
+    return plan;
+}
+
+void Inventory::record_triangle(const LegRisk& risk, bool broken)
+{
+    ++triangles_;
+    if (broken) ++broken_;
+    exposure_sum_ += risk.exposure;
+    exposure_max_  = std::max(exposure_max_, risk.exposure);
+}
+
+void Inventory::report(std::ostream& out) const
+{
+    if (!enabled()) return;
+    out << "[INVENTORY] asset        balance         target          drift       reserved\n";
+    for (AssetId a = 0; a < balance_.size(); ++a) {
+        if (!held_[a] && balance_[a] == 0.0) continue;
+        out << "[INVENTORY] " << std::left << std::setw(6) << engine_->asset(a) << std::right;
+        for (double v : {balance_[a], target_[a], drift(a), reserved_[a]})
+            out << std::setw(15) << v;
+        out << "\n";
+    }
+    out << "[LEG RISK] triangles " << triangles_ << " broken " << broken_
+        << " exposure total " << exposure_sum_ << " max " << exposure_max_
+        << " " << engine_->asset(engine_->home()) << "\n";
+}
+
+} // namespace triarb
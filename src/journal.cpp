@@ -0,0 +1,148 @@
+#include "journal.hpp"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace triarb {
+
+namespace {
+
+constexpr char          kMagic[8] = {'T', 'R', 'I', 'A', 'R', 'B', 'J', '1'};
+constexpr std::uint32_t kVersion  = 1;
+constexpr std::size_t   kHeaderSize = 16;
+
+struct RecordHeader {
+    std::uint64_t recvNs;
+    std::uint32_t payloadSize;
+    std::uint16_t kind;        // 0 marks the end of the written data
+    std::uint16_t tagSize;
+};
+static_assert(sizeof(RecordHeader) == 16);
+
+constexpr std::size_t padded(std::size_t n) { return (n + 7) & ~std::size_t{7}; }
+
+[[noreturn]] void fail(const std::string& what)
+{
+    throw std::runtime_error("journal: " + what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+std::uint64_t journal_clock_ns()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+JournalWriter::JournalWriter(const std::string& path, std::size_t chunk_bytes)
+    : chunk_(padded(chunk_bytes))
+{
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) fail("cannot create " + path);
+
+    grow(kHeaderSize);
+    std::memcpy(base_, kMagic, sizeof(kMagic));
+    std::memcpy(base_ + 8, &kVersion, sizeof(kVersion));
+    used_ = kHeaderSize;
+}
+
+JournalWriter::~JournalWriter()
+{
+    if (base_) ::munmap(base_, mapped_);
+    if (fd_ >= 0) {
+        if (::ftruncate(fd_, static_cast<off_t>(used_)) != 0) { /* keep the zero tail */ }
+        ::close(fd_);
+    }
+}
+
+void JournalWriter::grow(std::size_t at_least)
+{
+    std::size_t size = mapped_;
+    while (size < at_least) size += chunk_;
+
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) fail("cannot extend file");
+    void* p = base_
+        ? ::mremap(base_, mapped_, size, MREMAP_MAYMOVE)
+        : ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, 0);
+    if (p == MAP_FAILED) fail("cannot map file");
+
+    base_   = static_cast<char*>(p);
+    mapped_ = size;
+}
+
+void JournalWriter::append(RecordKind kind, std::string_view tag,
+                           std::string_view payload, std::uint64_t recv_ns)
+{
+    const std::size_t bytes = sizeof(RecordHeader) + padded(tag.size() + payload.size());
+    if (used_ + bytes > mapped_) grow(used_ + bytes);
+
+    char* at = base_ + used_;
+    std::memcpy(at + sizeof(RecordHeader), tag.data(), tag.size());
+    std::memcpy(at + sizeof(RecordHeader) + tag.size(), payload.data(), payload.size());
+
+    // The kind goes in last: a reader that sees it sees the whole record.
+    RecordHeader h{recv_ns, static_cast<std::uint32_t>(payload.size()),
+                   0, static_cast<std::uint16_t>(tag.size())};
+    std::memcpy(at, &h, sizeof(h));
+    const auto k = static_cast<std::uint16_t>(kind);
+    std::memcpy(at + offsetof(RecordHeader, kind), &k, sizeof(k));
+
+    used_ += bytes;
+}
+
+JournalReader::JournalReader(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) fail("cannot open " + path);
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) { ::close(fd); fail("cannot stat " + path); }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ < kHeaderSize) { ::close(fd); throw std::runtime_error("journal: " + path + " is too short"); }
+
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) fail("cannot map " + path);
+    base_ = static_cast<const char*>(p);
+
+    if (std::memcmp(base_, kMagic, sizeof(kMagic)) != 0) {
+        ::munmap(const_cast<char*>(base_), size_);
+        base_ = nullptr;
+        throw std::runtime_error("journal: " + path + " is not a journal");
+    }
+    pos_ = kHeaderSize;
+}
+
+JournalReader::~JournalReader()
+{
+    if (base_) ::munmap(const_cast<char*>(base_), size_);
+}
+
+bool JournalReader::next(JournalRecord& out)
+{
+    if (pos_ + sizeof(RecordHeader) > size_) return false;
+
+    RecordHeader h;
+    std::memcpy(&h, base_ + pos_, sizeof(h));
+    const std::size_t body = std::size_t{h.tagSize} + h.payloadSize;
+    if (h.kind == 0 || pos_ + sizeof(h) + body > size_) return false;
+
+    const char* at = base_ + pos_ + sizeof(h);
+    out.recvNs  = h.recvNs;
+    out.kind    = static_cast<RecordKind>(h.kind);
+    out.tag     = {at, h.tagSize};
+    out.payload = {at + h.tagSize, h.payloadSize};
+    pos_ += sizeof(h) + padded(body);
+    return true;
+}
+
+void JournalReader::rewind()
+{
+    pos_ = kHeaderSize;
+}
+
+} // namespace triarb
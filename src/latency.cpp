@@ -0,0 +1,106 @@
+#include "latency.hpp"
+#include <charconv>
+#include <iomanip>
+
+namespace triarb {
+
+namespace {
+
+constexpr std::array<double, 3> kQuantiles = {0.5, 0.99, 0.999};
+constexpr std::array<std::string_view, 3> kQuantileText = {"0.5", "0.99", "0.999"};
+
+void append_number(std::string& out, std::uint64_t v)
+{
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+}
+
+} // namespace
+
+std::uint64_t LatencyHistogram::count() const noexcept
+{
+    std::uint64_t total = 0;
+    for (const auto& c : counts_) total += c.load(std::memory_order_relaxed);
+    return total;
+}
+
+std::uint64_t LatencyHistogram::percentile(double q) const noexcept
+{
+    const std::uint64_t total = count();
+    if (total == 0) return 0;
+
+    const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total) + 0.5);
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        seen += counts_[b].load(std::memory_order_relaxed);
+        if (seen >= rank && seen > 0) {
+            const std::uint64_t bound = upper_bound(b);
+            const std::uint64_t top = max();
+            return bound < top ? bound : top;
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::reset() noexcept
+{
+    for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+std::string_view to_string(Span span)
+{
+    switch (span) {
+    case Span::Wire:        return "wire";
+    case Span::Queue:       return "queue";
+    case Span::Parse:       return "parse";
+    case Span::Book:        return "book";
+    case Span::Decide:      return "decide";
+    case Span::Send:        return "send";
+    case Span::TickToTrade: return "tick_to_trade";
+    case Span::WireToTrade: return "wire_to_trade";
+    case Span::OrderRtt:    return "order_rtt";
+    case Span::FeedLag:     return "feed_lag";
+    case Span::BookAge:     return "book_age";
+    case Span::BookSkew:    return "book_skew";
+    default:                return "unknown";
+    }
+}
+
+void LatencyMetrics::report(std::ostream& out) const
+{
+    out << "[LATENCY] ns          count        p50        p99      p99.9        max\n";
+    for (std::size_t s = 0; s < spans_.size(); ++s) {
+        const auto& h = spans_[s];
+        out << "[LATENCY] " << std::left << std::setw(13) << to_string(static_cast<Span>(s))
+            << std::right << std::setw(10) << h.count();
+        for (double q : kQuantiles) out << std::setw(11) << h.percentile(q);
+        out << std::setw(11) << h.max() << "\n";
+    }
+}
+
+std::string LatencyMetrics::prometheus() const
+{
+    std::string out;
+    out.reserve(2048);
+    out += "# HELP triarb_latency_ns Stage-to-stage latency of market data frames and the age of the books priced.\n"
+           "# TYPE triarb_latency_ns summary\n";
+    for (std::size_t s = 0; s < spans_.size(); ++s) {
+        const auto& h = spans_[s];
+        const std::string_view name = to_string(static_cast<Span>(s));
+        for (std::size_t q = 0; q < kQuantiles.size(); ++q) {
+            out.append("triarb_latency_ns{stage=\"").append(name)
+               .append("\",quantile=\"").append(kQuantileText[q]).append("\"} ");
+            append_number(out, h.percentile(kQuantiles[q]));
+            out += '\n';
+        }
+        out.append("triarb_latency_ns_count{stage=\"").append(name).append("\"} ");
+        append_number(out, h.count());
+        out.append("\ntriarb_latency_ns_max{stage=\"").append(name).append("\"} ");
+        append_number(out, h.max());
+        out += '\n';
+    }
+    return out;
+}
+
+} // namespace triarb
@@ -1,14 +1,32 @@
 #include "common.hpp"
 #include "triarb_bot.hpp"
 #include <boost/asio.hpp>
+#include <csignal>
+#include <functional>
 #include <iostream>
 
 int main() {
     std::cout << "Hello, Binance! running " << triarb::version << '\n';
     boost::asio::io_context ioc;
     triarb::TriArbBot bot{ioc};
+
+    // Ctrl-C / SIGTERM: dump the latency histograms and leave the loop.
+    boost::asio::signal_set signals(ioc, SIGINT, SIGTERM);
+    signals.async_wait([&bot](boost::system::error_code ec, int) {
+        if (!ec) bot.stop();
+    });
+
+    // SIGHUP: re-read CONFIG; the strategy picks it up on its next frame.
+    boost::asio::signal_set hangup(ioc, SIGHUP);
+    std::function<void(boost::system::error_code, int)> on_hangup =
+        [&](boost::system::error_code ec, int) {
+            if (ec) return;
+            bot.reload_config();
+            hangup.async_wait(on_hangup);
+        };
+    hangup.async_wait(on_hangup);
+
     bot.start();
     ioc.run();
     return 0;
 }
-
@@ -0,0 +1,92 @@
+#include "metrics_server.hpp"
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <iostream>
+#include <memory>
+
+namespace triarb {
+
+namespace beast = boost::beast;
+namespace http  = beast::http;
+using tcp       = boost::asio::ip::tcp;
+
+namespace {
+
+/// read request -> write response -> close, kept alive by shared_from_this.
+class MetricsSession : public std::enable_shared_from_this<MetricsSession>
+{
+    public:
+        MetricsSession(tcp::socket socket, const LatencyMetrics& metrics)
+            : stream_(std::move(socket))
+            , metrics_(metrics)
+        {}
+
+        void run()
+        {
+            stream_.expires_after(std::chrono::seconds(5));
+            http::async_read(stream_, buffer_, req_,
+                beast::bind_front_handler(&MetricsSession::on_read, shared_from_this()));
+        }
+
+    private:
+        void on_read(beast::error_code ec, std::size_t)
+        {
+            if (ec) return;
+
+            res_.version(req_.version());
+            res_.keep_alive(false);
+            if (req_.method() == http::verb::get && req_.target() == "/metrics") {
+                res_.result(http::status::ok);
+                res_.set(http::field::content_type, "text/plain; version=0.0.4");
+                res_.body() = metrics_.prometheus();
+            } else {
+                res_.result(http::status::not_found);
+                res_.body() = "not found\n";
+            }
+            res_.prepare_payload();
+
+            http::async_write(stream_, res_,
+                beast::bind_front_handler(&MetricsSession::on_write, shared_from_this()));
+        }
+
+        void on_write(beast::error_code, std::size_t)
+        {
+            beast::error_code ignored;
+            stream_.socket().shutdown(tcp::socket::shutdown_send, ignored);
+        }
+
+        beast::tcp_stream                  stream_;
+        const LatencyMetrics&              metrics_;
+        beast::flat_buffer                 buffer_;
+        http::request<http::empty_body>    req_;
+        http::response<http::string_body>  res_;
+};
+
+} // namespace
+
+MetricsServer::MetricsServer(boost::asio::io_context& ioc, std::uint16_t port,
+                             const LatencyMetrics& metrics)
+    : acceptor_(ioc, tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port))
+    , metrics_(metrics)
+{
+}
+
+void MetricsServer::start()
+{
+    std::cout << "Metrics on http://127.0.0.1:" << port() << "/metrics\n";
+    accept();
+}
+
+void MetricsServer::accept()
+{
+    acceptor_.async_accept([this](beast::error_code ec, tcp::socket socket) {
+        if (ec) {
+            std::cerr << "[METRICS] accept error: " << ec.message() << "\n";
+            return;
+        }
+        std::make_shared<MetricsSession>(std::move(socket), metrics_)->run();
+        accept();
+    });
+}
+
+} // namespace triarb
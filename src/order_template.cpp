@@ -0,0 +1,171 @@
+// The SHA256_* calls below are deprecated in OpenSSL 3 in favour of EVP,
+// but EVP digests cannot be copied without allocating, and copying the
+// keyed states is the whole point of HmacSha256.
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include "order_template.hpp"
+#include <openssl/crypto.h>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace triarb {
+
+namespace {
+
+// Two hex digits for every byte value.
+constexpr auto kHexPairs = [] {
+    constexpr char digits[] = "0123456789abcdef";
+    std::array<char, 512> t{};
+    for (int i = 0; i < 256; ++i) {
+        t[2 * i]     = digits[i >> 4];
+        t[2 * i + 1] = digits[i & 15];
+    }
+    return t;
+}();
+
+// Widest text of an order id or timestamp.
+constexpr std::size_t kMaxInt = 20;
+
+char* put(char* out, std::string_view text)
+{
+    std::memcpy(out, text.data(), text.size());
+    return out + text.size();
+}
+
+char* put_int(char* out, std::uint64_t v) { return std::to_chars(out, out + kMaxInt, v).ptr; }
+char* put_int(char* out, std::int64_t v)  { return std::to_chars(out, out + kMaxInt, v).ptr; }
+
+/* The fixed text of both request layouts, in the order it is written */
+constexpr std::string_view kRestPrice      = "&price=";
+constexpr std::string_view kRestTimestamp  = "&recvWindow=5000&timestamp=";
+constexpr std::string_view kRestSignature  = "&signature=";
+constexpr std::string_view kWsQuantity     = R"(","quantity":")";
+constexpr std::string_view kWsSignature    = R"(,"type":"LIMIT_MAKER","signature":")";
+constexpr std::string_view kWsId           = R"("},"id":)";
+constexpr std::string_view kPayloadQty     = "&quantity=";
+constexpr std::string_view kPayloadType    = "&type=LIMIT_MAKER";
+
+} // namespace
+
+char* hex_encode(const unsigned char* in, std::size_t n, char* out)
+{
+    for (std::size_t i = 0; i < n; ++i, out += 2)
+        std::memcpy(out, &kHexPairs[2 * std::size_t{in[i]}], 2);
+    return out;
+}
+
+HmacSha256::HmacSha256(std::string_view key)
+{
+    // RFC 2104: keys longer than a block are hashed first, shorter ones
+    // zero-padded.
+    unsigned char block[SHA256_CBLOCK] = {};
+    if (key.size() > sizeof block)
+        SHA256(reinterpret_cast<const unsigned char*>(key.data()), key.size(), block);
+    else
+        std::memcpy(block, key.data(), key.size());
+
+    unsigned char pad[SHA256_CBLOCK];
+    for (std::size_t i = 0; i < sizeof pad; ++i) pad[i] = block[i] ^ 0x36;
+    SHA256_Init(&inner_);
+    SHA256_Update(&inner_, pad, sizeof pad);
+    for (std::size_t i = 0; i < sizeof pad; ++i) pad[i] = block[i] ^ 0x5c;
+    SHA256_Init(&outer_);
+    SHA256_Update(&outer_, pad, sizeof pad);
+
+    OPENSSL_cleanse(block, sizeof block);
+    OPENSSL_cleanse(pad, sizeof pad);
+}
+
+char* HmacSha256::sign_hex(std::string_view msg, char* out) const
+{
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+
+    SHA256_CTX ctx = inner_;
+    SHA256_Update(&ctx, msg.data(), msg.size());
+    SHA256_Final(digest, &ctx);
+
+    ctx = outer_;
+    SHA256_Update(&ctx, digest, sizeof digest);
+    SHA256_Final(digest, &ctx);
+
+    return hex_encode(digest, sizeof digest, out);
+}
+
+OrderTemplate::OrderTemplate(std::string_view symbol, std::string_view side,
+                             std::string_view api_key)
+{
+    const std::string s(symbol), d(side), k(api_key);
+
+    const std::string rest_head =
+        "symbol=" + s + "&side=" + d + "&type=LIMIT_MAKER&timeInForce=IOC&quantity=";
+    const std::string ws_head =
+        R"({"method":"order.place","params":{"apiKey":")" + k + R"(","price":")";
+    const std::string payload_head = "apiKey=" + k + "&price=";
+    ws_middle_ = R"(","recvWindow":5000,"side":")" + d + R"(","symbol":")" + s +
+                 R"(","timeInForce":"IOC","timestamp":)";
+    payload_middle_ = "&recvWindow=5000&side=" + d + "&symbol=" + s + "&timeInForce=IOC&timestamp=";
+
+    constexpr std::size_t kDecimals = 2 * SymbolScale::kMaxText;
+    const std::size_t rest_size = rest_head.size() + kDecimals + kRestPrice.size() +
+        kRestTimestamp.size() + kMaxInt + kRestSignature.size() + HmacSha256::kHexSize;
+    const std::size_t ws_size = ws_head.size() + kDecimals + kWsQuantity.size() +
+        ws_middle_.size() + kMaxInt + kWsSignature.size() + HmacSha256::kHexSize +
+        kWsId.size() + kMaxInt + 1;
+    const std::size_t payload_size = payload_head.size() + kDecimals + kPayloadQty.size() +
+        payload_middle_.size() + kMaxInt + kPayloadType.size();
+    if (rest_size > kBufferSize || ws_size > kBufferSize || payload_size > kBufferSize)
+        throw std::length_error("order template for " + s + " does not fit");
+
+    rest_head_    = static_cast<std::size_t>(put(rest_.data(), rest_head) - rest_.data());
+    ws_head_      = static_cast<std::size_t>(put(ws_.data(), ws_head) - ws_.data());
+    payload_head_ = static_cast<std::size_t>(put(payload_.data(), payload_head) - payload_.data());
+}
+
+std::string_view OrderTemplate::rest_body(Qty qty, Price price, const SymbolScale& scale,
+                                          std::int64_t timestamp_ms, const HmacSha256& signer)
+{
+    char* const begin = rest_.data();
+    char* out = begin + rest_head_;
+    out = scale.write(out, qty);
+    out = put(out, kRestPrice);
+    out = scale.write(out, price);
+    out = put(out, kRestTimestamp);
+    out = put_int(out, timestamp_ms);
+
+    // The signature covers everything before it
+    const std::string_view params(begin, static_cast<std::size_t>(out - begin));
+    out = put(out, kRestSignature);
+    out = signer.sign_hex(params, out);
+    return {begin, static_cast<std::size_t>(out - begin)};
+}
+
+std::string_view OrderTemplate::ws_request(std::uint64_t id, Qty qty, Price price,
+                                           const SymbolScale& scale, std::int64_t timestamp_ms,
+                                           const HmacSha256& signer)
+{
+    /* The signed payload: the same parameters, sorted by name */
+    char* const pay = payload_.data();
+    char* p = pay + payload_head_;
+    p = scale.write(p, price);
+    p = put(p, kPayloadQty);
+    p = scale.write(p, qty);
+    p = put(p, payload_middle_);
+    p = put_int(p, timestamp_ms);
+    p = put(p, kPayloadType);
+
+    char* const begin = ws_.data();
+    char* out = begin + ws_head_;
+    out = scale.write(out, price);
+    out = put(out, kWsQuantity);
+    out = scale.write(out, qty);
+    out = put(out, ws_middle_);
+    out = put_int(out, timestamp_ms);
+    out = put(out, kWsSignature);
+    out = signer.sign_hex({pay, static_cast<std::size_t>(p - pay)}, out);
+    out = put(out, kWsId);
+    out = put_int(out, id);
+    *out++ = '}';
+    return {begin, static_cast<std::size_t>(out - begin)};
+}
+
+} // namespace triarb
@@ -1,31 +1,143 @@
 #include "orderbook.hpp"
+#include <algorithm>
+#include <functional>
 
 namespace triarb {
 
-OrderBook::OrderBook(std::string_view symbol)
-    : symbol_(std::move(symbol)) 
-{}
+namespace {
 
-void OrderBook::update(uint64_t updateId, const Quote& bid, const Quote& ask)
+constexpr std::size_t kReservedLevels = 256;
+
+// Sets the quantity at q.px, inserting or erasing the level as needed.
+// `worse` orders prices from worst to best for this side.
+template <class Level, class Worse>
+void upsert(std::vector<Level>& side, const Level& q, Worse worse)
+{
+    auto it = std::lower_bound(side.begin(), side.end(), q.px,
+        [&](const Level& level, Price px) { return worse(level.px, px); });
+    const bool found = it != side.end() && it->px == q.px;
+
+    if (q.qty.steps == 0) {
+        if (found) side.erase(it);
+    } else if (found) {
+        it->qty = q.qty;
+    } else {
+        side.insert(it, q);
+    }
+}
+
+// Makes `q` the best level: drops the levels better than it and sets it
+// at the back, leaving the deeper ones alone.
+template <class Level, class Worse>
+void set_best(std::vector<Level>& side, const Level& q, Worse worse)
+{
+    while (!side.empty() && worse(q.px, side.back().px)) side.pop_back();
+    if (!side.empty() && side.back().px == q.px) side.pop_back();
+    if (q.qty.steps != 0) side.push_back(q);
+}
+
+} // namespace
+
+OrderBook::OrderBook(std::string_view symbol, SymbolScale scale)
+    : symbol_(std::move(symbol))
+    , scale_(scale)
+{
+    bids_.reserve(kReservedLevels);
+    asks_.reserve(kReservedLevels);
+}
+
+// Snapshots arrive best first; storage keeps the best level at the back.
+void OrderBook::assign_reversed(std::vector<Level>& side, std::span<const WireLevel> levels) const
+{
+    side.clear();
+    for (auto it = levels.rbegin(); it != levels.rend(); ++it) {
+        const Level l = level(*it);
+        if (l.qty.steps != 0) side.push_back(l);
+    }
+}
+
+bool OrderBook::update(uint64_t updateId, const Quote& bid, const Quote& ask)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(updateId <= lastUpdatedId_) return false; // skip the old updates
+    bids_.clear();
+    asks_.clear();
+    const Level b{scale_.price_near(bid.px), scale_.qty_near(bid.qty)};
+    const Level a{scale_.price_near(ask.px), scale_.qty_near(ask.qty)};
+    if (b.qty.steps != 0) bids_.push_back(b);
+    if (a.qty.steps != 0) asks_.push_back(a);
+    lastUpdatedId_ = updateId;
+    publish();
+    return true;
+}
+
+bool OrderBook::apply_snapshot(uint64_t updateId,
+                               std::span<const WireLevel> bids,
+                               std::span<const WireLevel> asks)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(updateId <= lastUpdatedId_) return false; // skip the old updates
+    assign_reversed(bids_, bids);
+    assign_reversed(asks_, asks);
+    lastUpdatedId_ = updateId;
+    publish();
+    return true;
+}
+
+bool OrderBook::apply_top(uint64_t updateId, const WireLevel& bid, const WireLevel& ask)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(updateId <= lastUpdatedId_) return false; // skip the old updates
+    set_best(bids_, level(bid), std::less<Price>{});
+    set_best(asks_, level(ask), std::greater<Price>{});
+    lastUpdatedId_ = updateId;
+    publish();
+    return true;
+}
+
+void OrderBook::apply_diff(uint64_t updateId,
+                           std::span<const WireLevel> bids,
+                           std::span<const WireLevel> asks)
 {
     std::lock_guard<std::mutex> lock(mutex_);
     if(updateId <= lastUpdatedId_) return; // skip the old updates
-    bestBid_ = bid;
-    bestAsk_ = ask;
+    for (const auto& w : bids) upsert(bids_, level(w), std::less<Price>{});
+    for (const auto& w : asks) upsert(asks_, level(w), std::greater<Price>{});
     lastUpdatedId_ = updateId;
+    publish();
 }
 
-Quote OrderBook::bestBid() const 
-{ 
+void OrderBook::clear()
+{
     std::lock_guard<std::mutex> lock(mutex_);
-    return bestBid_;
+    bids_.clear();
+    asks_.clear();
+    lastUpdatedId_ = 0;
+    publish();
 }
 
-Quote OrderBook::bestAsk() const
+void OrderBook::publish()
+{
+    top_.store(TopOfBook{
+        bids_.empty() ? Quote{0.0, 0.0} : quote(bids_.back()),
+        asks_.empty() ? Quote{0.0, 0.0} : quote(asks_.back()),
+        lastUpdatedId_});
+}
+
+std::size_t OrderBook::depth(BookSide side, std::span<Quote> out) const
 {
     std::lock_guard<std::mutex> lock(mutex_);
-    return bestAsk_;
+    const auto& levels = side == BookSide::Bid ? bids_ : asks_;
+    const std::size_t n = std::min(out.size(), levels.size());
+    std::transform(levels.rbegin(), levels.rbegin() + n, out.begin(),
+                   [this](const Level& l) { return quote(l); });
+    return n;
 }
 
-} // namespace triarb
+std::size_t OrderBook::levels(BookSide side) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return side == BookSide::Bid ? bids_.size() : asks_.size();
+}
 
+} // namespace triarb
@@ -0,0 +1,160 @@
+#include "pipeline.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+namespace triarb {
+
+namespace {
+
+int load_cpu_from_env(const char* name)
+{
+    const char* value = std::getenv(name);
+    if (!value) return -1;
+
+    return check_cpu(std::stoi(value), name);
+}
+
+// "2,3,4,5"
+std::vector<int> load_cpu_list_from_env(const char* name)
+{
+    std::vector<int> cpus;
+    const char* value = std::getenv(name);
+    if (!value) return cpus;
+
+    std::string_view list(value);
+    while (!list.empty()) {
+        const auto comma = list.find(',');
+        const std::string item(list.substr(0, comma));
+        std::size_t used = 0;
+        int cpu = -1;
+        try {
+            cpu = std::stoi(item, &used);
+        }
+        catch (const std::logic_error&) {
+        }
+        if (item.empty() || used != item.size())
+            throw std::invalid_argument(std::string(name) + " must be a comma-separated CPU list");
+        cpus.push_back(check_cpu(cpu, name));
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+    }
+    return cpus;
+}
+
+bool load_flag_from_env(const char* name)
+{
+    const char* value = std::getenv(name);
+    return value && (std::string_view(value) == "true" || std::string_view(value) == "1");
+}
+
+} // namespace
+
+PipelineOptions load_pipeline_options_from_env()
+{
+    PipelineOptions options;
+    const char* env = std::getenv("THREADING");
+    const std::string_view mode = env ? env : "single";
+    if (mode != "single" && mode != "pipelined" && mode != "sharded")
+        throw std::invalid_argument("THREADING must be single, pipelined or sharded, not '" +
+                                    std::string(mode) + "'");
+    options.enabled      = mode == "pipelined";
+    options.net_cpu      = load_cpu_from_env("NET_CPU");
+    options.strategy_cpu = load_cpu_from_env("STRATEGY_CPU");
+    options.egress_cpu   = load_cpu_from_env("EGRESS_CPU");
+    options.busy_poll    = load_flag_from_env("STRATEGY_BUSY_POLL");
+    options.shard_cpus   = load_cpu_list_from_env("SHARD_CPUS");
+    if (mode == "sharded") {
+        const char* shards = std::getenv("SHARDS");
+        const long n = shards ? std::stol(shards) : static_cast<long>(kDefaultShards);
+        if (n < 1) throw std::invalid_argument("SHARDS must be at least 1");
+        options.shards = static_cast<std::size_t>(n);
+    }
+    return options;
+}
+
+int check_cpu(int cpu, std::string_view name)
+{
+    const auto cpus = static_cast<int>(std::thread::hardware_concurrency());
+    if (cpu < -1 || (cpus > 0 && cpu >= cpus))
+        throw std::runtime_error(std::string(name) + "=" + std::to_string(cpu) +
+                                 " but this machine has " + std::to_string(cpus) + " CPUs");
+    return cpu;
+}
+
+bool pin_current_thread(int cpu)
+{
+    if (cpu < 0) return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+}
+
+Worker::Worker(std::string name, int cpu, bool busy_poll)
+    : name_(std::move(name))
+    , cpu_(cpu)
+    , busy_poll_(busy_poll)
+{
+}
+
+Worker::~Worker()
+{
+    stop();
+}
+
+void Worker::start(Poll poll)
+{
+    poll_ = std::move(poll);
+    thread_ = std::thread([this] { run(); });
+}
+
+void Worker::run()
+{
+    pthread_setname_np(pthread_self(), name_.substr(0, 15).c_str());
+    if (!pin_current_thread(cpu_))
+        std::cerr << "Warning: could not pin " << name_ << " to CPU " << cpu_ << "\n";
+
+    if (!poll_) {
+        auto guard = boost::asio::make_work_guard(ioc_);
+        ioc_.run();
+        return;
+    }
+
+    auto guard = boost::asio::make_work_guard(ioc_);
+    while (!stopped_.load(std::memory_order_relaxed)) {
+        bool busy = poll_();
+        busy |= ioc_.poll() > 0;
+        if (busy || busy_poll_) continue;
+
+        // Announce the nap, then look once more: a producer that published
+        // before seeing idle_ is caught here, one that publishes after will
+        // see idle_ and post.
+        idle_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (poll_()) {
+            idle_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        ioc_.run_one();
+        idle_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Worker::wake()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_.load(std::memory_order_relaxed) && idle_.exchange(false, std::memory_order_relaxed))
+        boost::asio::post(ioc_, [] {});
+}
+
+void Worker::stop()
+{
+    stopped_.store(true, std::memory_order_relaxed);
+    ioc_.stop();
+    if (thread_.joinable()) thread_.join();
+}
+
+} // namespace triarb
@@ -0,0 +1,46 @@
+#include "replay.hpp"
+#include <charconv>
+#include <chrono>
+#include <thread>
+
+namespace triarb {
+
+std::optional<double> parse_replay_speed(std::string_view text)
+{
+    if (text == "max")      return 0.0;
+    if (text == "realtime") return 1.0;
+    if (text.size() < 2 || text.back() != 'x') return std::nullopt;
+
+    double speed = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size() - 1, speed);
+    if (ec != std::errc{} || end != text.data() + text.size() - 1 || !(speed > 0))
+        return std::nullopt;
+    return speed;
+}
+
+std::size_t replay_journal(TriArbBot& bot, boost::asio::io_context& ioc,
+                           JournalReader& journal, double speed)
+{
+    using clock = std::chrono::steady_clock;
+
+    const auto start = clock::now();
+    std::uint64_t first_ns = 0;
+    std::size_t fed = 0;
+
+    JournalRecord rec;
+    while (journal.next(rec)) {
+        if (fed == 0) first_ns = rec.recvNs;
+        if (speed > 0 && rec.recvNs > first_ns) {
+            const double offset = static_cast<double>(rec.recvNs - first_ns) / speed;
+            std::this_thread::sleep_until(
+                start + std::chrono::nanoseconds(static_cast<std::int64_t>(offset)));
+        }
+        bot.replay(rec);
+        ioc.poll();
+        ++fed;
+    }
+    bot.wait_idle();
+    return fed;
+}
+
+} // namespace triarb
@@ -0,0 +1,76 @@
+#include "async_log.hpp"
+#include "common.hpp"
+#include "replay.hpp"
+#include <boost/asio.hpp>
+#include <cstring>
+#include <iostream>
+
+// triarb_replay <journal> [--speed max|realtime|<N>x] [--decisions <path>]
+//
+// Runs a recorded session through the bot offline.  The bot is configured
+// from the environment and CONFIG file as usual (EXCHANGE_INFO, DEPTH_FEED,
+// MAX_NOTIONAL, ...), which should match the recording session.
+// THREADING=sharded is refused: its shards race each other to the decision
+// log, so two runs of the same journal could disagree.
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0]
+                  << " <journal> [--speed max|realtime|<N>x] [--decisions <path>]\n";
+        return 2;
+    }
+
+    triarb::BotOptions options;
+    try {
+        options = triarb::load_bot_options_from_env();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    if (options.pipeline.shards) {
+        std::cerr << "THREADING=sharded does not replay deterministically; use single or pipelined\n";
+        return 2;
+    }
+    options.replay  = true;
+    options.journal.clear();
+    double speed = 0.0;
+
+    for (int i = 2; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            std::cerr << "missing value for " << argv[i] << "\n";
+            return 2;
+        }
+        if (std::strcmp(argv[i], "--speed") == 0) {
+            const auto parsed = triarb::parse_replay_speed(argv[i + 1]);
+            if (!parsed) {
+                std::cerr << "bad --speed " << argv[i + 1] << "\n";
+                return 2;
+            }
+            speed = *parsed;
+        } else if (std::strcmp(argv[i], "--decisions") == 0) {
+            options.decision_log = argv[i + 1];
+        } else {
+            std::cerr << "unknown option " << argv[i] << "\n";
+            return 2;
+        }
+    }
+
+    try {
+        std::cout << "Replaying " << argv[1] << " with " << triarb::version << '\n';
+        triarb::JournalReader journal(argv[1]);
+        boost::asio::io_context ioc;
+        triarb::TriArbBot bot{ioc, options};
+        bot.start();
+        const auto fed = triarb::replay_journal(bot, ioc, journal, speed);
+        triarb::logger().flush();
+        std::cout << "Replayed " << fed << " records\n";
+        bot.latency().report(std::cout);
+        bot.inventory().report(std::cout);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
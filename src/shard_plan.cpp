@@ -0,0 +1,40 @@
+#include "shard_plan.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace triarb {
+
+ShardPlan plan_shards(const TriangleEngine& engine, std::size_t shards)
+{
+    shards = std::max<std::size_t>(shards, 1);
+    ShardPlan plan;
+    plan.owner.assign(engine.symbol_count(), 0);
+    plan.symbols.resize(shards);
+    plan.load.assign(shards, 0);
+
+    std::vector<SymbolId> order(engine.symbol_count());
+    std::iota(order.begin(), order.end(), SymbolId{0});
+    std::stable_sort(order.begin(), order.end(), [&engine](SymbolId a, SymbolId b) {
+        return engine.triangles_for(a).size() > engine.triangles_for(b).size();
+    });
+
+    for (const SymbolId id : order) {
+        const auto cost = engine.triangles_for(id).size();
+        if (cost == 0) break;
+        const auto shard = static_cast<std::size_t>(
+            std::min_element(plan.load.begin(), plan.load.end()) - plan.load.begin());
+        plan.owner[id] = static_cast<std::uint32_t>(shard);
+        plan.symbols[shard].push_back(id);
+        plan.load[shard] += cost;
+    }
+    for (auto& symbols : plan.symbols) std::sort(symbols.begin(), symbols.end());
+
+    for (const auto& tri : engine.triangles()) {
+        const auto first = plan.owner[tri.legs[0].symbol];
+        plan.shared += plan.owner[tri.legs[1].symbol] != first ||
+                       plan.owner[tri.legs[2].symbol] != first;
+    }
+    return plan;
+}
+
+} // namespace triarb
@@ -0,0 +1,110 @@
+#include "config.hpp"
+#include "exchange_sim.hpp"
+#include "journal.hpp"
+#include "replay.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// triarb_sim <journal> --cert <pem> --key <pem> [--port N]
+//            [--speed max|realtime|<N>x] [--latency-us N] [--matching-us N]
+//            [--fill-ratio R] [--maker reject|take]
+//
+// Serves a recorded session as a local exchange: once a bot has subscribed
+// to the market data, the journal's frames set the simulator's books at
+// the recorded pace, and the bot's orders are matched against them.  The
+// symbols come from the environment and CONFIG file, as for the bot, and
+// BINANCE_API_KEY / BINANCE_API_SECRET, if set, are the only keys accepted.
+// Point the bot at it with FEED_ENDPOINTS=localhost:<port>, REST_HOST=localhost,
+// REST_PORT=<port> and CA_FILE=<the certificate>.  The certificate and key
+// are required rather than defaulted, so the simulator runs from any
+// directory.  Ctrl-C prints the fill-quality report.
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc % 2 != 0) {
+        std::cerr << "usage: " << argv[0]
+                  << " <journal> --cert <pem> --key <pem> [--port N] [--speed max|realtime|<N>x]"
+                     " [--latency-us N] [--matching-us N] [--fill-ratio R] [--maker reject|take]\n";
+        return 2;
+    }
+
+    triarb::SimOptions options;
+    if (const char* key = std::getenv("BINANCE_API_KEY"))       options.api_key = key;
+    if (const char* secret = std::getenv("BINANCE_API_SECRET")) options.api_secret = secret;
+    double speed = 1.0;
+
+    try {
+        for (int i = 2; i < argc; i += 2) {
+            const std::string_view flag = argv[i];
+            const char* value = argv[i + 1];
+            if (flag == "--port") {
+                options.port = static_cast<std::uint16_t>(std::stoul(value));
+            } else if (flag == "--speed") {
+                const auto parsed = triarb::parse_replay_speed(value);
+                if (!parsed) throw std::invalid_argument(std::string("bad --speed ") + value);
+                speed = *parsed;
+            } else if (flag == "--latency-us") {
+                options.network_latency = std::chrono::microseconds(std::stol(value));
+            } else if (flag == "--matching-us") {
+                options.matching_latency = std::chrono::microseconds(std::stol(value));
+            } else if (flag == "--fill-ratio") {
+                options.fill_ratio = std::stod(value);
+            } else if (flag == "--maker") {
+                if (std::strcmp(value, "take") == 0)        options.maker_rule = triarb::MakerRule::Take;
+                else if (std::strcmp(value, "reject") != 0) throw std::invalid_argument("--maker must be reject or take");
+            } else if (flag == "--cert") {
+                options.cert_file = value;
+            } else if (flag == "--key") {
+                options.key_file = value;
+            } else {
+                throw std::invalid_argument("unknown option " + std::string(flag));
+            }
+        }
+        if (options.cert_file.empty() || options.key_file.empty())
+            throw std::invalid_argument("--cert and --key are required");
+
+        boost::asio::io_context ioc;
+        triarb::JournalReader journal(argv[1]);
+        triarb::ExchangeSim sim(ioc, triarb::load_symbols(triarb::load_config_from_env().market),
+                                options);
+        std::cout << "Exchange simulator on localhost:" << sim.port() << ", waiting for a subscriber\n";
+
+        bool stopped = false;
+        boost::asio::signal_set signals(ioc, SIGINT, SIGTERM);
+        signals.async_wait([&](const boost::system::error_code&, int) { stopped = true; });
+        while (!stopped && sim.subscribers() == 0) ioc.run_one_for(std::chrono::milliseconds(100));
+
+        // Frames go out at their recorded gaps divided by `speed`; the
+        // network and order handlers run in between.
+        const auto start = std::chrono::steady_clock::now();
+        std::uint64_t first_ns = 0;
+        std::size_t played = 0;
+        triarb::JournalRecord rec;
+        while (!stopped && journal.next(rec)) {
+            if (played == 0) first_ns = rec.recvNs;
+            if (speed > 0)
+                ioc.run_until(start + std::chrono::nanoseconds(static_cast<std::int64_t>(
+                                          static_cast<double>(rec.recvNs - first_ns) / speed)));
+            if (rec.kind == triarb::RecordKind::Frame) {
+                sim.apply_frame(rec.payload);
+            } else {
+                triarb::MarketFrame snapshot;
+                if (triarb::parse_depth_snapshot(rec.payload, snapshot))
+                    sim.set_book(rec.tag, snapshot.bids, snapshot.asks);
+            }
+            ioc.poll();
+            ++played;
+        }
+        std::cout << "Played " << played << " records; serving the last book until stopped\n";
+        while (!stopped) ioc.run_one();
+        sim.report(std::cout);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "socket_tuning.hpp"
+#include "latency.hpp"
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace triarb {
+
+namespace {
+
+bool load_flag_from_env(const char* name, bool fallback)
+{
+    const char* value = std::getenv(name);
+    if (!value) return fallback;
+
+    const std::string_view v(value);
+    if (v == "1" || v == "true")  return true;
+    if (v == "0" || v == "false") return false;
+    throw std::invalid_argument(std::string(name) + " must be 0, 1, true or false");
+}
+
+int load_size_from_env(const char* name)
+{
+    const char* value = std::getenv(name);
+    if (!value) return 0;
+
+    std::size_t used = 0;
+    int n = -1;
+    try {
+        n = std::stoi(value, &used);
+    }
+    catch (const std::exception&) {
+    }
+    if (n < 0 || used != std::string_view(value).size())
+        throw std::invalid_argument(std::string(name) + " must be a non-negative number");
+    return n;
+}
+
+bool set(int fd, int level, int option, int value, const char* name)
+{
+    if (::setsockopt(fd, level, option, &value, sizeof value) == 0) return true;
+    std::cerr << "[SOCKET] " << name << "=" << value << " refused: " << std::strerror(errno)
+              << "\n";
+    return false;
+}
+
+std::int64_t to_ns(const timespec& ts)
+{
+    return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+} // namespace
+
+SocketOptions load_socket_options_from_env()
+{
+    SocketOptions options;
+    options.nodelay      = load_flag_from_env("SOCKET_NODELAY", options.nodelay);
+    options.busy_poll_us = load_size_from_env("SOCKET_BUSY_POLL");
+    options.rcvbuf       = load_size_from_env("SOCKET_RCVBUF");
+    options.sndbuf       = load_size_from_env("SOCKET_SNDBUF");
+    options.quickack     = load_flag_from_env("SOCKET_QUICKACK", options.quickack);
+    options.timestamps   = load_flag_from_env("SOCKET_TIMESTAMPS", options.timestamps);
+    return options;
+}
+
+int tune_socket(int fd, const SocketOptions& options)
+{
+    int refused = 0;
+    refused += !set(fd, IPPROTO_TCP, TCP_NODELAY, options.nodelay, "TCP_NODELAY");
+    if (options.busy_poll_us > 0)
+        refused += !set(fd, SOL_SOCKET, SO_BUSY_POLL, options.busy_poll_us, "SO_BUSY_POLL");
+    if (options.rcvbuf > 0)
+        refused += !set(fd, SOL_SOCKET, SO_RCVBUF, options.rcvbuf, "SO_RCVBUF");
+    if (options.sndbuf > 0)
+        refused += !set(fd, SOL_SOCKET, SO_SNDBUF, options.sndbuf, "SO_SNDBUF");
+    if (options.quickack)
+        refused += !set(fd, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+    if (options.timestamps)
+        refused += !set(fd, SOL_SOCKET, SO_TIMESTAMPING,
+                        SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE,
+                        "SO_TIMESTAMPING");
+    return refused;
+}
+
+void rearm_quickack(int fd) noexcept
+{
+    const int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof on);
+}
+
+std::size_t receive_stamped(int fd, const iovec* iov, std::size_t count, bool quickack,
+                            std::uint64_t& kernel_ns, boost::beast::error_code& ec)
+{
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+    msghdr msg{};
+    msg.msg_iov        = const_cast<iovec*>(iov);
+    msg.msg_iovlen     = count;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof control;
+
+    ssize_t n;
+    do n = ::recvmsg(fd, &msg, MSG_DONTWAIT);
+    while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) ec = boost::asio::error::would_block;
+        else ec.assign(errno, boost::system::system_category());
+        return 0;
+    }
+    if (n == 0) {
+        ec = boost::asio::error::eof;
+        return 0;
+    }
+    if (quickack) rearm_quickack(fd);
+
+    // The stamp is CLOCK_REALTIME; its age now, taken off now_ns(), puts it
+    // on the clock every other stamp uses
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPING) continue;
+        scm_timestamping stamps;
+        std::memcpy(&stamps, CMSG_DATA(c), sizeof stamps);
+        const std::int64_t arrived = to_ns(stamps.ts[0]);
+        if (arrived == 0) break;
+
+        timespec wall;
+        ::clock_gettime(CLOCK_REALTIME, &wall);
+        const std::uint64_t now = now_ns();
+        const std::int64_t  age = to_ns(wall) - arrived;
+        kernel_ns = age > 0 ? now - static_cast<std::uint64_t>(age) : now;
+        break;
+    }
+    return static_cast<std::size_t>(n);
+}
+
+} // namespace triarb
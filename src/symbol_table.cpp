@@ -0,0 +1,38 @@
+#include "symbol_table.hpp"
+#include <stdexcept>
+#include <string>
+
+namespace triarb {
+
+void SymbolTable::grow()
+{
+    std::vector<Slot> old = std::move(slots_);
+    slots_.assign(old.empty() ? 16 : old.size() * 2, Slot{});
+    mask_ = slots_.size() - 1;
+    for (const auto& s : old) {
+        if (!s.used) continue;
+        std::size_t i = home(s.key);
+        while (slots_[i].used) i = (i + 1) & mask_;
+        slots_[i] = s;
+    }
+}
+
+void SymbolTable::insert(std::string_view name, SymbolId id)
+{
+    Key key;
+    if (!pack(name, key))
+        throw std::invalid_argument("symbol name not packable: " + std::string(name));
+
+    // Keep the load factor at or below one half.
+    if (2 * (size_ + 1) > slots_.size()) grow();
+
+    std::size_t i = home(key);
+    for (; slots_[i].used; i = (i + 1) & mask_)
+        if (slots_[i].key == key)
+            throw std::invalid_argument("duplicate symbol: " + std::string(name));
+
+    slots_[i] = {key, id, true};
+    ++size_;
+}
+
+} // namespace triarb
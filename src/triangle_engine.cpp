@@ -0,0 +1,182 @@
+#include "triangle_engine.hpp"
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+namespace triarb {
+
+namespace {
+
+std::uint64_t pair_key(AssetId a, AssetId b)
+{
+    if (a > b) std::swap(a, b);
+    return (static_cast<std::uint64_t>(a) << 32) | b;
+}
+
+using EdgeKernel = double (*)(const TopOfBook&, const TopOfBook&, const TopOfBook&,
+                              const FeeSchedule&);
+
+template<std::uint8_t Shape>
+double shape_edge(const TopOfBook& a, const TopOfBook& b, const TopOfBook& c,
+                  const FeeSchedule& fees)
+{
+    constexpr auto side = [](int leg) { return (Shape >> leg) & 1 ? Side::Sell : Side::Buy; };
+    return path_edge<side(0), FeeType::Taker, side(1), FeeType::Maker, side(2), FeeType::Maker>(
+        a, b, c, fees);
+}
+
+// One kernel per buy/sell pattern, indexed by Triangle::shape.
+template<std::size_t... Shape>
+constexpr std::array<EdgeKernel, sizeof...(Shape)> make_kernels(std::index_sequence<Shape...>)
+{
+    return {&shape_edge<static_cast<std::uint8_t>(Shape)>...};
+}
+
+constexpr auto kEdgeKernels = make_kernels(std::make_index_sequence<8>{});
+
+} // namespace
+
+TriangleEngine::TriangleEngine(std::vector<SymbolInfo> symbols,
+                               std::string_view home_asset,
+                               FeeSchedule fees)
+    : fees_(fees)
+    , symbols_(std::move(symbols))
+{
+    home_ = intern_asset(std::string(home_asset));
+
+    books_.reserve(symbols_.size());
+    symbol_assets_.reserve(symbols_.size());
+    for (SymbolId id = 0; id < symbols_.size(); ++id) {
+        const auto& s = symbols_[id];
+        books_.push_back(std::make_unique<OrderBook>(s.symbol, symbol_scale(s)));
+        symbol_assets_.push_back({intern_asset(s.base), intern_asset(s.quote)});
+        symbol_ids_.insert(s.symbol, id);
+    }
+    enumerate();
+}
+
+AssetId TriangleEngine::intern_asset(const std::string& name)
+{
+    auto [it, inserted] = asset_ids_.emplace(name, static_cast<AssetId>(assets_.size()));
+    if (inserted) assets_.push_back(name);
+    return it->second;
+}
+
+std::optional<AssetId> TriangleEngine::find_asset(std::string_view name) const
+{
+    const auto it = asset_ids_.find(std::string(name));
+    if (it == asset_ids_.end()) return std::nullopt;
+    return it->second;
+}
+
+std::optional<SymbolId> TriangleEngine::pair(AssetId a, AssetId b) const
+{
+    for (SymbolId id = 0; id < symbol_assets_.size(); ++id) {
+        const auto [base, quote] = symbol_assets_[id];
+        if ((base == a && quote == b) || (base == b && quote == a)) return id;
+    }
+    return std::nullopt;
+}
+
+void TriangleEngine::enumerate()
+{
+    std::unordered_map<std::uint64_t, SymbolId> pairs;
+    std::vector<std::vector<AssetId>> neighbours(assets_.size());
+    for (SymbolId id = 0; id < symbols_.size(); ++id) {
+        const auto [base, quote] = symbol_assets_[id];
+        if (pairs.emplace(pair_key(base, quote), id).second) {
+            neighbours[base].push_back(quote);
+            neighbours[quote].push_back(base);
+        }
+    }
+
+    auto leg = [&](AssetId from, AssetId to) {
+        const SymbolId id = pairs.at(pair_key(from, to));
+        return TriangleLeg{id, symbol_assets_[id][0] == from ? Side::Sell : Side::Buy};
+    };
+
+    // Each unordered triangle is found once, from its lowest symbol id.
+    for (const auto& [key, s1] : pairs) {
+        const auto [a, b] = symbol_assets_[s1];
+        for (AssetId c : neighbours[a]) {
+            if (c == b) continue;
+            auto bc = pairs.find(pair_key(b, c));
+            if (bc == pairs.end()) continue;
+            const SymbolId s2 = pairs.at(pair_key(a, c));
+            const SymbolId s3 = bc->second;
+            if (s2 < s1 || s3 < s1) continue;
+
+            std::array<AssetId, 3> assets{a, b, c};
+            const AssetId start = std::find(assets.begin(), assets.end(), home_) != assets.end()
+                ? home_ : *std::min_element(assets.begin(), assets.end());
+            std::array<AssetId, 2> others{};
+            std::size_t n = 0;
+            for (AssetId x : assets)
+                if (x != start) others[n++] = x;
+
+            // Both directions around the cycle.
+            triangles_.push_back({{leg(start, others[0]), leg(others[0], others[1]),
+                                   leg(others[1], start)}, start});
+            triangles_.push_back({{leg(start, others[1]), leg(others[1], others[0]),
+                                   leg(others[0], start)}, start});
+        }
+    }
+
+    for (auto& t : triangles_)
+        for (std::size_t i = 0; i < t.legs.size(); ++i)
+            if (t.legs[i].side == Side::Sell) t.shape |= static_cast<std::uint8_t>(1u << i);
+
+    // Stable order regardless of hash map iteration.
+    std::sort(triangles_.begin(), triangles_.end(), [](const Triangle& x, const Triangle& y) {
+        return std::tie(x.legs[0].symbol, x.legs[1].symbol, x.legs[2].symbol)
+             < std::tie(y.legs[0].symbol, y.legs[1].symbol, y.legs[2].symbol);
+    });
+
+    offsets_.assign(symbols_.size() + 1, 0);
+    for (const auto& t : triangles_)
+        for (const auto& l : t.legs)
+            ++offsets_[l.symbol + 1];
+    for (std::size_t i = 1; i < offsets_.size(); ++i)
+        offsets_[i] += offsets_[i - 1];
+
+    index_.resize(offsets_.back());
+    auto fill = offsets_;
+    for (std::uint32_t t = 0; t < triangles_.size(); ++t)
+        for (const auto& l : triangles_[t].legs)
+            index_[fill[l.symbol]++] = t;
+}
+
+double TriangleEngine::edge(const Triangle& t, const FeeSchedule& fees) const
+{
+    return kEdgeKernels[t.shape](books_[t.legs[0].symbol]->top(),
+                                 books_[t.legs[1].symbol]->top(),
+                                 books_[t.legs[2].symbol]->top(), fees);
+}
+
+SizedEdge TriangleEngine::size(const Triangle& t, double max_notional,
+                               const FeeSchedule& fees) const
+{
+    std::array<std::array<Quote, kMaxLegLevels>, 3> levels;
+    std::array<LegLevels, 3> legs;
+    for (std::size_t i = 0; i < 3; ++i) {
+        const bool buy = t.legs[i].side == Side::Buy;
+        const auto n = books_[t.legs[i].symbol]->depth(
+            buy ? BookSide::Ask : BookSide::Bid, levels[i]);
+        legs[i] = {buy, leg_fee(fees, i), {levels[i].data(), n}};
+    }
+    return size_triangle(legs, max_notional);
+}
+
+std::string TriangleEngine::describe(const Triangle& t) const
+{
+    std::string out = assets_[t.start];
+    AssetId at = t.start;
+    for (const auto& leg : t.legs) {
+        const auto [base, quote] = symbol_assets_[leg.symbol];
+        at = (at == base) ? quote : base;
+        out += "->" + assets_[at];
+    }
+    return out;
+}
+
+} // namespace triarb
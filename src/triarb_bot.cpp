@@ -1,13 +1,127 @@
 #include "triarb_bot.hpp"
-#include <nlohmann/json.hpp>
+#include "async_log.hpp"
 #include <iostream>
-#include <iomanip>
-#include <unordered_map>
-
-using json = nlohmann::json;
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <sstream>
+#include <thread>
 
 namespace triarb {
 
+namespace {
+
+/* Log formats
+ * -----------
+ * Run on the logger's thread; the trading thread only copies the arguments.
+ */
+void fmt_book_update(std::string& out, const LogStr& symbol, int precision, const TopOfBook& top)
+{
+    out.append(symbol.view()).append(" - Best bid: ");
+    append_fixed(out, top.bid.px, precision);
+    out += " (";
+    append_fixed(out, top.bid.qty, precision);
+    out += ")\nBest ask: ";
+    append_fixed(out, top.ask.px, precision);
+    out += " (";
+    append_fixed(out, top.ask.qty, precision);
+    out += ")\nSpread: ";
+    append_fixed(out, top.ask.px - top.bid.px, precision);
+    out += '\n';
+}
+
+void fmt_fire(std::string& out, const LogStr& path, double edge, double notional, double profit)
+{
+    out += "Edge ";
+    append_double(out, edge * 100);
+    out.append("% on ").append(path.view()).append(" size ");
+    append_double(out, notional);
+    out += " profit ";
+    append_double(out, profit);
+    out += " -> FIRE\nArbitrage opportunity found!";
+}
+
+void fmt_leg_abandoned(std::string& out, std::size_t leg, const LogStr& symbol)
+{
+    out += "[GATE] Step ";
+    append_int(out, static_cast<std::int64_t>(leg + 1));
+    out.append(": ").append(symbol.view())
+       .append(" order below the exchange minimum, triangle abandoned");
+}
+
+void fmt_leg_filled(std::string& out, std::size_t leg, Side side, const LogStr& symbol,
+                    double qty, double px)
+{
+    out += "[GATE] Step ";
+    append_int(out, static_cast<std::int64_t>(leg + 1));
+    out.append(": ").append(to_string(side)).append(" ").append(symbol.view()).append(": ");
+    append_double(out, qty);
+    out += " @ ";
+    append_double(out, px);
+}
+
+void fmt_leg_dropped(std::string& out, std::size_t leg, const LogStr& symbol)
+{
+    out += "[GATE] Step ";
+    append_int(out, static_cast<std::int64_t>(leg + 1));
+    out.append(": ").append(symbol.view())
+       .append(" order queue full, triangle abandoned");
+}
+
+void fmt_executions_full(std::string& out, const LogStr& symbol)
+{
+    out.append("[GATE] Step 1: ").append(symbol.view())
+       .append(" too many triangles under way, triangle abandoned");
+}
+
+void fmt_inventory_short(std::string& out, std::size_t leg, const LogStr& symbol)
+{
+    out += "[GATE] Step ";
+    append_int(out, static_cast<std::int64_t>(leg + 1));
+    out.append(": ").append(symbol.view())
+       .append(" inventory short, triangle abandoned");
+}
+
+void fmt_leg_missed(std::string& out, std::size_t leg, const LogStr& symbol, double exposure,
+                    const LogStr& home)
+{
+    out += "[RISK] Step ";
+    append_int(out, static_cast<std::int64_t>(leg + 1));
+    out.append(": ").append(symbol.view()).append(" did not fill, exposure ");
+    append_double(out, exposure);
+    out.append(" ").append(home.view());
+}
+
+void fmt_rebalanced(std::string& out, Side side, const LogStr& symbol, double qty, double px)
+{
+    out.append("[REBALANCE] ").append(to_string(side)).append(" ").append(symbol.view())
+       .append(": ");
+    append_double(out, qty);
+    out += " @ ";
+    append_double(out, px);
+}
+
+void fmt_processed(std::string& out, std::uint64_t count)
+{
+    out += "Processed ";
+    append_int(out, static_cast<std::int64_t>(count));
+    out += " messages";
+}
+
+// The stream name of a combined-stream frame, without parsing the rest:
+// "ethbtc@depth5@100ms" from {"stream":"ethbtc@depth5@100ms","data":...}.
+std::string_view peek_stream(std::string_view msg)
+{
+    constexpr std::string_view key = "\"stream\":\"";
+    const auto at = msg.find(key);
+    if (at == std::string_view::npos) return {};
+    const auto from = at + key.size();
+    const auto to   = msg.find('"', from);
+    return to == std::string_view::npos ? std::string_view{} : msg.substr(from, to - from);
+}
+
+} // namespace
+
 bool load_live_toggle_from_env()
 {
     const char* live = std::getenv("LIVE");
@@ -32,170 +146,1058 @@ ApiKeys load_keys_from_env()
     return ApiKeys{api_key, api_secret};
 }
 
-TriArbBot::TriArbBot(boost::asio::io_context& ioc)
-    : gw_(ioc, 
-         "api.binance.com", 
-         load_keys_from_env(),
-         load_live_toggle_from_env())
-    , session_(ioc,
-              "stream.binance.com",
-              "9443",
-              "/stream?streams=btcusdt@depth5@100ms/ethbtc@depth5@100ms/ethusdt@depth5@100ms",
-              [this](std::string_view msg) { handle_frame(msg); })
+ExecutionMode load_execution_mode_from_env()
 {
-    // Check MAX_NOTIONAL
-    if (!std::getenv("MAX_NOTIONAL")) {
-        std::cerr << "Warning: MAX_NOTIONAL unset—defaulting to 15 USDT\n";
-    }
+    const char* mode = std::getenv("EXECUTION");
+    if (!mode) return ExecutionMode::Sequential;
+
+    const std::string_view m(mode);
+    if (m == "concurrent") return ExecutionMode::Concurrent;
+    if (m != "sequential") throw std::invalid_argument("EXECUTION must be sequential or concurrent");
+    return ExecutionMode::Sequential;
 }
 
-void TriArbBot::start() { session_.run(); }
+BotOptions load_bot_options_from_env()
+{
+    BotOptions options;
+    if (const char* path = std::getenv("JOURNAL"))      options.journal = path;
+    if (const char* path = std::getenv("DECISION_LOG")) options.decision_log = path;
+    const Config config = load_config_from_env();
+    options.pipeline  = config.pipeline;
+    options.execution = load_execution_mode_from_env();
+    options.inventory = load_inventory_options_from_env();
+    options.feeds     = config.feeds;
+    if (options.execution == ExecutionMode::Concurrent && options.inventory.targets.empty())
+        throw std::invalid_argument("EXECUTION=concurrent needs INVENTORY balances to trade from");
+    if (options.pipeline.shards && !options.journal.empty())
+        throw std::invalid_argument("JOURNAL records one stream of frames; use THREADING=single "
+                                    "or pipelined to record");
+    return options;
+}
 
-void TriArbBot::print_book_update(const std::string& symbol, const OrderBook& book)
+std::uint16_t load_metrics_port_from_env()
 {
-    static std::unordered_map<std::string, Quote> lastBids;
-    static std::unordered_map<std::string, Quote> lastAsks;
+    const char* port = std::getenv("METRICS_PORT");
+    return port ? static_cast<std::uint16_t>(std::stoul(port)) : 0;
+}
 
-    const auto bestBid = book.bestBid();
-    const auto bestAsk = book.bestAsk();
+std::chrono::seconds load_metrics_interval_from_env()
+{
+    const char* secs = std::getenv("METRICS_INTERVAL");
+    return std::chrono::seconds(secs ? std::stol(secs) : 60);
+}
 
-    if(bestBid.px != lastBids[symbol].px || bestBid.qty != lastBids[symbol].qty ||
-       bestAsk.px != lastAsks[symbol].px || bestAsk.qty != lastAsks[symbol].qty)
-    {
-        lastBids[symbol] = bestBid;
-        lastAsks[symbol] = bestAsk;
-        auto precision = (symbol == "ETH-BTC") ? 8 : 2;
-        std::cout << std::fixed << std::setprecision(precision)
-                  << symbol << " - "
-                  << "Best bid: " << bestBid.px << " (" << bestBid.qty << ")\n"
-                  << "Best ask: " << bestAsk.px << " (" << bestAsk.qty << ")\n"
-                  << "Spread: " << (bestAsk.px - bestBid.px) << "\n\n";
+// Order round trips go into the bot's latency report.  Concurrent
+// execution sends three orders at once, so REST needs three connections
+// for none of them to wait.
+GatewayOptions gateway_options(LatencyMetrics& latency, ExecutionMode execution)
+{
+    GatewayOptions options = load_gateway_options_from_env();
+    options.latency = &latency;
+    if (execution == ExecutionMode::Concurrent)
+        options.pool_size = std::max<std::size_t>(options.pool_size, 3);
+    return options;
+}
+
+// Frame slots start with room for a large depth frame; the few that see a
+// bigger one grow once and keep the capacity.
+TriArbBot::Pipeline::Pipeline(const PipelineOptions& options)
+    : net("triarb-net", options.net_cpu)
+    , strategy("triarb-strategy", options.strategy_cpu, options.busy_poll)
+    , egress("triarb-egress", options.egress_cpu)
+    , frames(256)
+    , orders(64)
+    , fills(64)
+{
+    for (auto& slot : frames.slots()) slot.payload.reserve(8192);
+}
+
+// Sharded strategy threads are pinned to SHARD_CPUS in turn and spin like
+// the pipelined strategy thread when STRATEGY_BUSY_POLL is set.  Only the
+// sharded mode fills the queues, so only it reserves frame slots.
+TriArbBot::Shard::Shard(TriArbBot& bot, std::size_t index)
+    : index(index)
+    , worker(bot.egress_
+        ? std::make_unique<Worker>("triarb-shard" + std::to_string(index),
+                                   index < bot.options_.pipeline.shard_cpus.size()
+                                       ? bot.options_.pipeline.shard_cpus[index] : -1,
+                                   bot.options_.pipeline.busy_poll)
+        : nullptr)
+    , live(bot.live_config(bot.config_.strategy))
+    , feeds(worker ? worker->ioc() : bot.net_ioc(),
+            bot.options_.feeds,
+            bot.stream_target(index),
+            [&bot, this](std::size_t feed, std::string_view msg, std::uint64_t read_ns,
+                         std::uint64_t kernel_ns) {
+                bot.on_frame(*this, feed, msg, read_ns, kernel_ns);
+            })
+    , arbiter(feeds.size(), bot.engine_.symbol_count())
+    , clock(bot.engine_.symbol_count())
+    , frames(bot.egress_ ? 256 : 2)
+    , decisions(bot.egress_ ? 256 : 2)
+{
+    if (worker)
+        for (auto& slot : frames.slots()) slot.payload.reserve(8192);
+}
+
+// A replay never touches the network, so it needs no keys and never trades.
+TriArbBot::TriArbBot(boost::asio::io_context& ioc, BotOptions options)
+    : ioc_(ioc)
+    , options_(std::move(options))
+    , config_(load_config_from_env())
+    , pipeline_(options_.pipeline.enabled ? std::make_unique<Pipeline>(options_.pipeline) : nullptr)
+    , egress_(!pipeline_ && options_.pipeline.shards
+                  ? std::make_unique<Worker>("triarb-egress", options_.pipeline.egress_cpu)
+                  : nullptr)
+    , gw_(egress_ioc(), 
+         config_.market.rest_host,
+         options_.replay ? ApiKeys{} : load_keys_from_env(),
+         options_.replay ? false : load_live_toggle_from_env(),
+         gateway_options(latency_, options_.execution))
+    , engine_(load_symbols(config_.market), config_.market.home_asset, config_.strategy.fees)
+    , last_printed_(engine_.symbol_count())
+    , last_edge_(engine_.triangles().size())
+    , rebalance_timer_(strategy_ioc())
+    , report_interval_(load_metrics_interval_from_env())
+    , report_timer_(net_ioc())
+{
+    // A ticker overwrites the top of book; diff depth has to see every
+    // change to a level itself, so the two cannot share a book.
+    const auto& market = config_.market;
+    if (market.book_ticker && market.depth_feed == DepthFeed::Diff)
+        throw std::invalid_argument("BOOK_TICKER runs alongside DEPTH_FEED=partial or none, not diff");
+    if (!market.book_ticker && market.depth_feed == DepthFeed::None)
+        throw std::invalid_argument("DEPTH_FEED=none needs BOOK_TICKER for the top of book");
+
+    if (egress_ && !options_.journal.empty())
+        throw std::invalid_argument("JOURNAL does not run with THREADING=sharded");
+    if (!options_.journal.empty() && !options_.replay)
+        journal_ = std::make_unique<JournalWriter>(options_.journal);
+    if (!options_.decision_log.empty())
+        decisions_ = DecisionLog(options_.decision_log);
+    if (const auto port = load_metrics_port_from_env(); port && !options_.replay)
+        metrics_server_ = std::make_unique<MetricsServer>(net_ioc(), port, latency_);
+    if (options_.execution == ExecutionMode::Concurrent)
+        inventory_ = Inventory(engine_, options_.inventory);
+    for (const auto& t : engine_.triangles()) paths_.push_back(engine_.describe(t));
+
+    // No more shards than symbols to deal out
+    std::size_t traded = 0;
+    for (SymbolId id = 0; id < engine_.symbol_count(); ++id)
+        traded += !engine_.triangles_for(id).empty();
+    plan_ = plan_shards(engine_, egress_ ? std::clamp<std::size_t>(options_.pipeline.shards, 1,
+                                                                   std::max<std::size_t>(traded, 1))
+                                         : 1);
+    for (std::size_t shard = 0; shard < plan_.shards(); ++shard)
+        shards_.push_back(std::make_unique<Shard>(*this, shard));
+
+    for (SymbolId id = 0; id < engine_.symbol_count(); ++id) {
+        syncs_.push_back(std::make_unique<DepthSync>(
+            engine_.book(id), [this, id] { request_snapshot(id); }));
+        if (!engine_.triangles_for(id).empty()) gw_.prepare_orders(engine_.symbol(id).symbol);
     }
+
+    std::cout << "Watching " << engine_.triangles().size() << " triangles across "
+              << engine_.symbol_count() << " symbols";
+    if (pipeline_) std::cout << " (pipelined)";
+    if (egress_)   std::cout << " (" << plan_.shards() << " shards, " << plan_.shared
+                             << " triangles across shards)";
+    std::cout << (inventory_.enabled() ? " (concurrent legs)" : "") << ", up to "
+              << config_.strategy.max_notional << " " << config_.market.home_asset
+              << " per triangle above a " << config_.strategy.edge_threshold * 100 << "% edge\n";
 }
 
-bool TriArbBot::edge_scanner()
+// Resolves the triangle list against the engine's own names; an unknown
+// name is an error rather than a triangle silently left out.
+TriArbBot::LiveConfig TriArbBot::live_config(const StrategyConfig& strategy) const
 {
-    if(!got_btc_ || !got_ethbtc_ || !got_ethusdt_)
-        return false;
+    LiveConfig live{strategy.fees, strategy.edge_threshold, strategy.max_notional,
+                    std::vector<std::uint8_t>(engine_.triangles().size(),
+                                              strategy.triangles.empty())};
+    live.max_book_age_ns  = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(strategy.max_book_age).count());
+    live.max_book_skew_ns = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(strategy.max_book_skew).count());
+    for (const auto& name : strategy.triangles) {
+        std::size_t found = 0;
+        for (std::size_t t = 0; t < engine_.triangles().size(); ++t)
+            if (engine_.describe(engine_.triangles()[t]) == name) {
+                live.trade[t] = 1;
+                ++found;
+            }
+        if (!found)
+            throw std::invalid_argument("config: no triangle " + name + " among the symbols traded");
+    }
+    return live;
+}
 
-    if (eth_usdt_book_.bestAsk().px <= 0 ||
-        eth_btc_book_.bestBid().px <= 0 ||
-        btc_usdt_book_.bestBid().px <= 0)
+bool TriArbBot::reload_config()
+{
+    try {
+        const Config next = load_config_from_env();
+        if (!(next.market == config_.market) || !(next.feeds == config_.feeds) ||
+            !(next.pipeline == config_.pipeline))
+            std::cerr << "[CONFIG] market, feeds and threads changes take a restart; "
+                         "keeping the running ones\n";
+        const auto live = live_config(next.strategy);
+        for (auto& shard : shards_) shard->live.publish(live);
+        std::cout << "[CONFIG] reloaded " << (next.path.empty() ? "the environment" : next.path)
+                  << ": up to " << next.strategy.max_notional << " " << config_.market.home_asset
+                  << " above a " << next.strategy.edge_threshold * 100 << "% edge\n";
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[CONFIG] reload failed, keeping the running configuration: "
+                  << e.what() << "\n";
         return false;
+    }
+}
 
-    double maker = -0.0001;
-    double taker =  0.0004;
+// The workers run handlers that use the members declared after pipeline_,
+// so they are joined before any of those are destroyed.
+TriArbBot::~TriArbBot()
+{
+    stop_pipeline();
+}
+
+// In sharded mode the egress thread also keeps the reports and the
+// triangles under way: the strategy work there is the shards'.
+boost::asio::io_context& TriArbBot::net_ioc()
+{
+    return pipeline_ ? pipeline_->net.ioc() : egress_ ? egress_->ioc() : ioc_;
+}
+
+boost::asio::io_context& TriArbBot::strategy_ioc()
+{
+    return pipeline_ ? pipeline_->strategy.ioc() : egress_ ? egress_->ioc() : ioc_;
+}
+
+boost::asio::io_context& TriArbBot::egress_ioc()
+{
+    return pipeline_ ? pipeline_->egress.ioc() : egress_ ? egress_->ioc() : ioc_;
+}
+
+// Combined-stream path for every symbol of `shard` that takes part in a
+// triangle: its depth stream, its bookTicker stream, or both.
+std::string TriArbBot::stream_target(std::size_t shard) const
+{
+    std::vector<const char*> suffixes;
+    const auto& market = config_.market;
+    if (market.depth_feed != DepthFeed::None)
+        suffixes.push_back(market.depth_feed == DepthFeed::Diff ? "@depth@100ms" : "@depth5@100ms");
+    if (market.book_ticker)
+        suffixes.push_back("@bookTicker");
+
+    std::string target = "/stream?streams=";
+    std::size_t streams = 0;
+    for (const SymbolId id : plan_.symbols[shard]) {
+        for (const char* suffix : suffixes) {
+            if (streams++) target += '/';
+            for (char c : engine_.symbol(id).symbol)
+                target += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            target += suffix;
+        }
+    }
+    if (streams > 1024)
+        std::cerr << "Warning: " << streams
+                  << " streams exceed Binance's 1024-per-connection limit\n";
+    return target;
+}
+
+void TriArbBot::start()
+{
+    if (config_.market.depth_feed == DepthFeed::Diff) {
+        for (SymbolId id = 0; id < engine_.symbol_count(); ++id)
+            if (!engine_.triangles_for(id).empty())
+                syncs_[id]->start();
+    }
+    if (!options_.replay) {
+        if (metrics_server_) metrics_server_->start();
+        schedule_report();
+        if (inventory_.enabled()) schedule_rebalance();
+        for (auto& shard : shards_) shard->feeds.start();
+    }
+
+    // Everything above only queued work on the workers' io_contexts.
+    if (pipeline_) {
+        pipeline_->egress.start([this] { return drain_orders(); });
+        pipeline_->strategy.start([this] { return drain_frames_and_fills(); });
+        pipeline_->net.start();
+    }
+    if (egress_) {
+        egress_->start([this] { return drain_decisions(); });
+        for (auto& shard : shards_)
+            shard->worker->start([this, &s = *shard] { return drain_frames(s, s.frames); });
+    }
+}
+
+void TriArbBot::schedule_report()
+{
+    if (report_interval_.count() <= 0) return;
+    report_timer_.expires_after(report_interval_);
+    report_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        logger().flush();
+        latency_.report(std::cout);
+        report_shards();
+        schedule_report();
+    });
+}
+
+// A shard's sessions belong to its own thread, so in sharded mode each
+// shard writes its part there, in one piece.
+void TriArbBot::report_shards()
+{
+    for (auto& shard : shards_) {
+        if (!shard->worker) {
+            report_shard(*shard, std::cout);
+            continue;
+        }
+        boost::asio::post(shard->worker->ioc(), [this, &s = *shard] {
+            std::ostringstream out;
+            report_shard(s, out);
+            std::cout << out.str() << std::flush;
+        });
+    }
+}
+
+void TriArbBot::report_shard(const Shard& shard, std::ostream& out) const
+{
+    if (shards_.size() > 1)
+        out << "[SHARD " << shard.index << "] " << plan_.symbols[shard.index].size()
+            << " symbols, " << plan_.load[shard.index] << " triangle scans per round\n";
+    shard.feeds.report(out);
+    shard.arbiter.report(out);
+    shard.clock.report(out);
+}
+
+void TriArbBot::stop()
+{
+    stop_pipeline();
+    logger().flush();
+    latency_.report(std::cout);
+    for (const auto& shard : shards_) report_shard(*shard, std::cout);
+    inventory_.report(std::cout);
+    ioc_.stop();
+}
+
+// Net thread first, so no frame arrives for a strategy that has gone; in
+// sharded mode the shards first, so none waits on the egress queue of a
+// thread that has gone.
+void TriArbBot::stop_pipeline()
+{
+    if (pipeline_) {
+        pipeline_->net.stop();
+        pipeline_->strategy.stop();
+        pipeline_->egress.stop();
+    }
+    if (egress_) {
+        for (auto& shard : shards_) shard->worker->stop();
+        egress_->stop();
+    }
+}
+
+// Replays deliver the recorded snapshots themselves, in their original
+// order relative to the frames.
+void TriArbBot::request_snapshot(SymbolId id)
+{
+    if (options_.replay) return;
+
+    if (pipeline_ || egress_)
+        boost::asio::post(egress_ioc(), [this, id] { fetch_snapshot(id); });
+    else
+        fetch_snapshot(id);
+}
+
+// Runs where the gateway lives; the body is handed to the thread that owns
+// the book.  Snapshots are rare, so a post is good enough for the hop.
+void TriArbBot::fetch_snapshot(SymbolId id)
+{
+    gw_.fetch_depth(engine_.symbol(id).symbol, 1000,
+        [this, id](bool ok, std::string body) {
+            if (!ok) {
+                std::cerr << "[DEPTH] " << engine_.symbol(id).symbol << " snapshot failed: "
+                          << body << ", retrying\n";
+                return retry_snapshot(id);
+            }
+            if (!pipeline_ && !egress_) return apply_snapshot(id, body);
+            auto& to = egress_ ? owner(id).worker->ioc() : strategy_ioc();
+            boost::asio::post(to, [this, id, body = std::move(body)] { apply_snapshot(id, body); });
+        });
+}
+
+void TriArbBot::retry_snapshot(SymbolId id)
+{
+    auto timer = std::make_shared<boost::asio::steady_timer>(
+        egress_ioc(), std::chrono::seconds(1));
+    timer->async_wait([this, timer, id](boost::system::error_code ec) {
+        if (!ec) fetch_snapshot(id);
+    });
+}
 
-    auto edge =
-        (1.0)
-        /  eth_usdt_book_.bestAsk().px * (1.0 + taker)
-        *  eth_btc_book_.bestBid().px * (1.0 - maker)
-        *  btc_usdt_book_.bestBid().px * (1.0 - maker)
-        - 1.0;
+void TriArbBot::apply_snapshot(SymbolId id, const std::string& body)
+{
+    MarketFrame snapshot;
+    if (!parse_depth_snapshot(body, snapshot)) {
+        std::cerr << "[DEPTH] " << engine_.symbol(id).symbol
+                  << " snapshot failed: unparseable body, retrying\n";
+        return retry_snapshot(id);
+    }
+    const auto recv_ts = journal_clock_ns();
+    if (journal_)
+        journal_->append(RecordKind::Snapshot, engine_.symbol(id).symbol, body, recv_ts);
+    syncs_[id]->on_snapshot(snapshot);
+    owner(id).clock.snapshot(id, recv_ts);
+}
 
-    constexpr double EDGE_THRESHOLD = 0.0008;
-    if(edge > EDGE_THRESHOLD && std::abs(edge - last_edge_) > 1e-6)
+void TriArbBot::print_book_update(SymbolId id)
+{
+    const auto top = engine_.book(id).top();
+    auto& last = last_printed_[id];
+
+    if(top.bid.px != last.bid.px || top.bid.qty != last.bid.qty ||
+       top.ask.px != last.ask.px || top.ask.qty != last.ask.qty)
     {
-        last_edge_ = edge;
-        std::cout << "Edge " << edge*100 << "% -> FIRE\n";
+        last = top;
+        const int precision = engine_.book(id).scale().tick().scale;
+        log<fmt_book_update>(LogStream::Out, LogStr(engine_.symbol(id).symbol), precision, top);
+    }
+}
+
+// Re-evaluates only the triangles that trade the symbol that just changed.
+// The top-of-book edge is a cheap filter; triangles that pass it are sized
+// against the visible depth and the most profitable one is returned.  The
+// configuration is one pointer load; a reload shows up as a new pointer.
+// Books other shards own are read through their seqlock and lock, and the
+// last edge seen of a triangle is swapped atomically, so a change reaching
+// the triangle from two shards at once is fresh to only one of them.
+std::optional<TriArbBot::Opportunity> TriArbBot::edge_scanner(Shard& shard, SymbolId changed)
+{
+    const LiveConfig& live = shard.live.read();
+    std::optional<Opportunity> best;
+
+    for (std::uint32_t t : engine_.triangles_for(changed)) {
+        const auto& tri = engine_.triangles()[t];
+        if (!engine_.anchored(tri)) continue;    // max_notional is in the home asset
+
+        const double edge = engine_.edge(tri, live.fees);
+        const double last = last_edge_[t].exchange(edge, std::memory_order_relaxed);
+        const bool fresh = std::abs(edge - last) > 1e-6;
+        if (edge <= live.edge_threshold || !fresh || !live.trade[t]) continue;
+        if (!books_current(shard, t, live)) continue;
+
+        const auto sized = engine_.size(tri, live.max_notional, live.fees);
+        if (sized.profit > 0.0 && (!best || sized.profit > best->sized.profit))
+            best = Opportunity{t, sized};
+    }
+    return best;
+}
+
+// Ages the books of a triangle that cleared the threshold, up to the
+// receive time of the frame in hand, and holds the triangle back when its
+// oldest leg is older than max_book_age or its legs were current further
+// apart than max_book_skew.  The hold is logged against the oldest leg.
+bool TriArbBot::books_current(Shard& shard, std::uint32_t triangle, const LiveConfig& live)
+{
+    const auto& tri = engine_.triangles()[triangle];
+    std::array<std::uint64_t, 3> as_of;
+    for (std::size_t leg = 0; leg < 3; ++leg)
+        as_of[leg] = owner(tri.legs[leg].symbol).clock.as_of(tri.legs[leg].symbol);
+    const auto oldest = static_cast<std::size_t>(
+        std::min_element(as_of.begin(), as_of.end()) - as_of.begin());
+    const auto from   = as_of[oldest];
+    const auto newest = *std::max_element(as_of.begin(), as_of.end());
+    const auto age    = shard.current_ts > from ? shard.current_ts - from : 0;
+    latency_.record(Span::BookAge, age);
+    latency_.record(Span::BookSkew, newest - from);
+
+    const char* reason;
+    if (live.max_book_age_ns && age > live.max_book_age_ns) {
+        shard.clock.hold(BookClock::Hold::Stale);
+        reason = "stale-book";
+    }
+    else if (live.max_book_skew_ns && newest - from > live.max_book_skew_ns) {
+        shard.clock.hold(BookClock::Hold::Skew);
+        reason = "book-skew";
+    }
+    else {
         return true;
     }
-    last_edge_ = edge;
+    decide(shard, Decision{{triangle, {}}, shard.current_ts, shard.stamps, oldest, reason});
     return false;
 }
 
-void TriArbBot::handle_frame(std::string_view msg)
+// Hands a decision on: at once, or in sharded mode through the shard's
+// queue to the egress thread, which keeps the decision log and the
+// triangles under way for every shard.  A full queue holds the shard back
+// rather than dropping the decision.
+void TriArbBot::decide(Shard& shard, const Decision& decision)
 {
-    try {
-        static int msg_count = 0;
-        if (++msg_count % 100 == 0)
-            std::cout << "Processed " << msg_count << " messages\n";
+    if (!egress_) return apply_decision(decision);
 
-        auto j = json::parse(msg);
+    Decision* slot;
+    while (!(slot = shard.decisions.claim())) std::this_thread::yield();
+    *slot = decision;
+    shard.decisions.publish();
+    egress_->wake();
+}
 
-        if (!j.contains("stream") || !j["stream"].is_string())
-            return;
-        if (!j.contains("data") || !j["data"].is_object())
-            return;
-        auto& data = j["data"];
-        auto stream = j["stream"].get<std::string>();
-        auto id = data["lastUpdateId"].get<uint64_t>();
-        if (!data.contains("bids") || !data["bids"].is_array() || data["bids"].empty())
-            return;
-        if (!data.contains("asks") || !data["asks"].is_array() || data["asks"].empty())
-            return;
+void TriArbBot::apply_decision(const Decision& decision)
+{
+    if (!decision.held) return execute(decision);
 
-        Quote bid {
-            std::stod(data["bids"][0][0].get<std::string>()),
-            std::stod(data["bids"][0][1].get<std::string>())
-        };
-        Quote ask {
-            std::stod(data["asks"][0][0].get<std::string>()),
-            std::stod(data["asks"][0][1].get<std::string>())
+    const auto& leg = engine_.triangles()[decision.opp.triangle].legs[decision.leg];
+    decisions_.skip(decision.origin, decision.leg, engine_.symbol(leg.symbol).symbol,
+                    decision.held);
+}
+
+bool TriArbBot::parse_frame(Shard& shard, std::string_view msg)
+{
+    auto& frame = shard.frame;
+    switch (config_.market.parser) {
+    case ParserMode::Json:
+        return parse_market_frame_json(msg, frame);
+
+    case ParserMode::Validate: {
+        const bool fast = parse_market_frame(msg, frame);
+        const bool slow = parse_market_frame_json(msg, shard.check_frame);
+        if (fast != slow || (fast && !same_frame(frame, shard.check_frame)))
+            std::cerr << "[PARSER] fast/json mismatch on frame: " << msg << "\n";
+        return fast;
+    }
+
+    case ParserMode::Fast:
+    default:
+        return parse_market_frame(msg, frame) ||
+               parse_market_frame_json(msg, frame);
+    }
+}
+
+// Applies the shard's frame to a book; returns true if it changed the book
+// and the book has both sides.  A copy of an update already applied
+// returns false.
+bool TriArbBot::apply_frame(Shard& shard, SymbolId id)
+{
+    const auto& frame = shard.frame;
+    auto& book = engine_.book(id);
+    switch (frame.kind) {
+    case FrameKind::PartialDepth:
+        if (frame.bids.empty() || frame.asks.empty()) return false;
+        if (!book.apply_snapshot(frame.lastUpdateId, frame.bids, frame.asks)) return false;
+        break;
+    case FrameKind::DiffDepth:
+        if (!syncs_[id]->on_diff(frame)) return false;
+        break;
+    case FrameKind::BookTicker:
+        if (!book.apply_top(frame.lastUpdateId, frame.bids[0], frame.asks[0])) return false;
+        break;
+    default:
+        return false;
+    }
+    const auto top = book.top();
+    return top.bid.px > 0 && top.ask.px > 0;
+}
+
+// Applies the shard's ticker to a book; same contract as apply_frame.
+bool TriArbBot::apply_ticker(Shard& shard, SymbolId id)
+{
+    auto& book = engine_.book(id);
+    const auto& ticker = shard.ticker;
+    if (!book.apply_top(ticker.updateId, ticker.bid, ticker.ask)) return false;
+    const auto top = book.top();
+    return top.bid.px > 0 && top.ask.px > 0;
+}
+
+/* Logs the FIRE, then takes a slot of the execution pool for the triangle
+ * and starts it.  The slot holds what its legs need from FIRE to the last
+ * fill, and goes back to the pool when the triangle ends, however it ends.
+ */
+void TriArbBot::execute(const Decision& decision)
+{
+    const auto& opp  = decision.opp;
+    const auto& path = paths_[opp.triangle];
+    decisions_.fire(decision.origin, path, opp.sized);
+    log<fmt_fire>(LogStream::Out, LogStr(path), opp.sized.edge, opp.sized.notional,
+                  opp.sized.profit);
+
+    const auto slot = executions_.acquire();
+    if (slot == ObjectPool<Execution>::kNone) {
+        const auto& first = engine_.symbol(engine_.triangles()[opp.triangle].legs[0].symbol).symbol;
+        decisions_.skip(decision.origin, 0, first, "too-many-triangles");
+        log<fmt_executions_full>(LogStream::Err, LogStr(first));
+        return;
+    }
+    executions_[slot] = Execution{opp.triangle, decision.origin, opp.sized.limitPx,
+                                  decision.stamps, {}, {}, 0};
+
+    if (inventory_.enabled()) execute_concurrent(slot, opp);
+    else                      execute_leg(slot, 0, opp.sized.notional);
+}
+
+/* Sends leg `leg` of the triangle in slot `execution` with `amount` of the
+ * asset that leg spends; its fill chains the next leg.  The slot carries
+ * the triangle, origin and stamps, and is released here if the leg cannot
+ * go out.
+ */
+void TriArbBot::execute_leg(std::uint32_t execution, std::size_t leg, double amount)
+{
+    const auto order = make_leg(execution, leg, amount);
+    if (!order) return executions_.release(execution);
+
+    if (!order_room(1)) {
+        const auto& e    = executions_[execution];
+        const auto& info = engine_.symbol(engine_.triangles()[e.triangle].legs[leg].symbol);
+        decisions_.skip(e.origin, leg, info.symbol, "order-queue-full");
+        log<fmt_leg_dropped>(LogStream::Err, leg, LogStr(info.symbol));
+        return executions_.release(execution);
+    }
+    dispatch_leg(*order);
+}
+
+/* Sends all three legs at once, each spending its planned input from the
+ * inventory rather than the previous leg's fill.  The whole triangle is
+ * skipped if any leg is below the exchange minimum, short of inventory or
+ * without room in the order queue, so it never goes out partly by choice;
+ * a leg the exchange does not fill is reported as leg risk once all three
+ * have answered (on_concurrent_fill).
+ */
+void TriArbBot::execute_concurrent(std::uint32_t execution, const Opportunity& opp)
+{
+    auto& e = executions_[execution];
+    const auto& tri = engine_.triangles()[opp.triangle];
+    std::array<LegOrder, 3> orders;
+    for (std::size_t leg = 0; leg < 3; ++leg) {
+        const auto order = make_leg(execution, leg, opp.sized.legInput[leg]);
+        if (!order) return executions_.release(execution);
+        const auto& scale = engine_.book(tri.legs[leg].symbol).scale();
+        const double qty  = scale.to_double(order->qty);
+        e.inputs[leg] = tri.legs[leg].side == Side::Buy ? qty * scale.to_double(order->price) : qty;
+        orders[leg] = *order;
+    }
+
+    const auto& first = engine_.symbol(tri.legs[0].symbol).symbol;
+    if (!order_room(3)) {
+        decisions_.skip(e.origin, 0, first, "order-queue-full");
+        log<fmt_leg_dropped>(LogStream::Err, 0, LogStr(first));
+        return executions_.release(execution);
+    }
+    if (const auto leg = inventory_.reserve(tri, e.inputs); leg < 3) {
+        const auto& symbol = engine_.symbol(tri.legs[leg].symbol).symbol;
+        decisions_.skip(e.origin, leg, symbol, "inventory-short");
+        log<fmt_inventory_short>(LogStream::Err, leg, LogStr(symbol));
+        return executions_.release(execution);
+    }
+
+    for (const auto& order : orders) dispatch_leg(order);
+}
+
+/* Builds leg `leg` of a triangle under way spending `amount` of the asset
+ * it sells.  Buy legs spend quote and receive base; sell legs spend base
+ * and receive quote.  Each leg is priced at the deepest level the sizing
+ * walked, so it can fill the whole planned amount.  The price is put on
+ * tick and the quantity rounded down to the step, so the order is valid
+ * for the exchange and never spends more than `amount`.  Logs a SKIP and
+ * returns nothing if that leaves it below the exchange minimum.
+ */
+std::optional<TriArbBot::LegOrder> TriArbBot::make_leg(std::uint32_t execution, std::size_t leg,
+                                                       double amount)
+{
+    const auto& e     = executions_[execution];
+    const auto& l     = engine_.triangles()[e.triangle].legs[leg];
+    const auto& info  = engine_.symbol(l.symbol);
+    const auto& scale = engine_.book(l.symbol).scale();
+
+    const Price price = scale.price_near(e.limits[leg]);
+    const double px   = scale.to_double(price);
+    const Qty   qty   = scale.qty_floor(l.side == Side::Buy ? amount / px : amount);
+
+    if (qty.steps <= 0 || scale.to_double(qty) * px < info.minNotional) {
+        decisions_.skip(e.origin, leg, info.symbol, "below-min-notional");
+        log<fmt_leg_abandoned>(LogStream::Err, leg, LogStr(info.symbol));
+        return std::nullopt;
+    }
+    return LegOrder{execution, e.triangle, leg, qty, price, e.stamps};
+}
+
+// True if `legs` more orders fit in the queue to the egress thread.
+bool TriArbBot::order_room(std::size_t legs) const
+{
+    if (!pipeline_) return true;
+    const auto& q = pipeline_->orders;
+    return q.capacity() - (q.pushed() - q.popped()) >= legs;
+}
+
+// Hands an order to the gateway: directly, or through the order queue,
+// which order_room() has checked.
+void TriArbBot::dispatch_leg(const LegOrder& order)
+{
+    const auto& l = engine_.triangles()[order.triangle].legs[order.leg];
+    decisions_.order(executions_[order.execution].origin, order.leg,
+                     engine_.symbol(l.symbol).symbol, l.side, order.qty, order.price,
+                     engine_.book(l.symbol).scale());
+    if (!pipeline_) return send_leg(order);
+
+    *pipeline_->orders.claim() = order;
+    pipeline_->orders.publish();
+    pipeline_->egress.wake();
+}
+
+// Runs where the gateway lives, from the order alone: the execution slot
+// belongs to the strategy thread.  In pipelined mode the fill goes back
+// to the strategy thread, waiting for room if it has to: the strategy
+// never waits on egress, so the wait is short.  Both callbacks fit the
+// gateway's inline buffers.
+void TriArbBot::send_leg(const LegOrder& order)
+{
+    const auto& l = engine_.triangles()[order.triangle].legs[order.leg];
+
+    // Tick-to-trade ends when the first leg's request is written.
+    Gateway::SentCallback on_sent;
+    if (order.leg == 0)
+        on_sent = [this, stamps = order.stamps] {
+            const auto sent = now_ns();
+            latency_.record(Span::Send, sent - stamps.decided);
+            latency_.record(Span::TickToTrade, sent - stamps.read);
+            if (stamps.kernel) latency_.record(Span::WireToTrade, sent - stamps.kernel);
         };
 
-        if (stream == "btcusdt@depth5@100ms") {
-            btc_usdt_book_.update(id, bid, ask);
-            print_book_update("BTC-USDT", btc_usdt_book_);
-            got_btc_ = true;
-        } else if (stream == "ethbtc@depth5@100ms") {
-            eth_btc_book_.update(id, bid, ask);
-            print_book_update("ETH-BTC", eth_btc_book_);
-            got_ethbtc_ = true;
-        } else if (stream == "ethusdt@depth5@100ms") {
-            eth_usdt_book_.update(id, bid, ask);
-            print_book_update("ETH-USDT", eth_usdt_book_);
-            got_ethusdt_ = true;
-        }
+    gw_.send_order(engine_.symbol(l.symbol).symbol, to_string(l.side), order.qty, order.price,
+        engine_.book(l.symbol).scale(),
+        [this, execution = order.execution, leg = order.leg](FillReport rep) {
+            if (!pipeline_) return on_fill(execution, leg, rep);
+
+            LegFill* slot;
+            while (!(slot = pipeline_->fills.claim())) std::this_thread::yield();
+            *slot = {execution, leg, rep};
+            pipeline_->fills.publish();
+            pipeline_->strategy.wake();
+        },
+        std::move(on_sent));
+}
+
+void TriArbBot::on_fill(std::uint32_t execution, std::size_t leg, const FillReport& rep)
+{
+    if (inventory_.enabled()) return on_concurrent_fill(execution, leg, rep);
+
+    if (!rep.success) return executions_.release(execution);
+    const auto& e    = executions_[execution];
+    const auto& done = engine_.triangles()[e.triangle].legs[leg];
+    decisions_.fill(e.origin, leg, engine_.symbol(done.symbol).symbol,
+                    rep.qty_filled, rep.price_avg);
+    log<fmt_leg_filled>(LogStream::Out, leg, done.side,
+                        LogStr(engine_.symbol(done.symbol).symbol),
+                        rep.qty_filled, rep.price_avg);
 
-        if (edge_scanner()) {
-            std::cout << "Arbitrage opportunity found!\n";
-
-            // Load triangle size from environment
-            const char* env_qty = std::getenv("MAX_NOTIONAL");
-            double max_notional = env_qty ? std::stod(env_qty) : 15.0;
-            double qty = max_notional;  // USDT to spend on ETHUSDT
-
-            double eth_usdt_ask = eth_usdt_book_.bestAsk().px;
-            gw_.send_order("ETHUSDT", "BUY",
-                qty/eth_usdt_ask,
-                eth_usdt_ask,
-                [&](FillReport rep) {
-                    if (!rep.success) return;
-                    std::cout << "[GATE] Step 1: Bought ETH with USDT: " 
-                             << rep.qty_filled << " ETH @ " << rep.price_avg << " USDT\n";
-
-                    // Step 2: Sell ETH for BTC
-                    double eth_btc_bid = eth_btc_book_.bestBid().px;
-                    gw_.send_order("ETHBTC", "SELL", 
-                        rep.qty_filled,
-                        eth_btc_bid,
-                        [&](FillReport rep2) {
-                            if (!rep2.success) return;
-                            std::cout << "[GATE] Step 2: Sold ETH for BTC: " 
-                                     << rep2.qty_filled << " ETH @ " << rep2.price_avg << " BTC\n";
-
-                            // Step 3: Sell BTC for USDT
-                            double btc_amount = rep2.qty_filled * rep2.price_avg;
-                            double btc_usdt_bid = btc_usdt_book_.bestBid().px;
-                            gw_.send_order("BTCUSDT", "SELL",    
-                                btc_amount,
-                                btc_usdt_bid,
-                                [&](FillReport rep3) {
-                                    std::cout << "[GATE] Step 3: Sold BTC for USDT: "
-                                             << rep3.qty_filled << " BTC @ " << rep3.price_avg << " USDT\n";
-                                });
-                        });
-                });
+    if (leg + 1 == 3) return executions_.release(execution);
+    const double received = done.side == Side::Buy
+        ? rep.qty_filled
+        : rep.qty_filled * rep.price_avg;
+    execute_leg(execution, leg + 1, received);
+}
+
+// A leg of a concurrent triangle answered, filled or not: its reservation
+// is released and what it traded booked.  Once all three have answered,
+// whatever the cycle left in its non-home assets is its leg risk.
+void TriArbBot::on_concurrent_fill(std::uint32_t execution, std::size_t leg,
+                                   const FillReport& rep)
+{
+    auto& e = executions_[execution];
+    const auto& tri  = engine_.triangles()[e.triangle];
+    const auto& done = tri.legs[leg];
+    const auto& symbol = engine_.symbol(done.symbol).symbol;
+    inventory_.release(engine_.assets(done.symbol)[done.side == Side::Buy ? 1 : 0],
+                       e.inputs[leg]);
+
+    if (rep.success) {
+        inventory_.apply_fill(done.symbol, done.side, rep.qty_filled, rep.price_avg);
+        const double notional = rep.qty_filled * rep.price_avg;
+        e.legs[leg] = done.side == Side::Buy
+            ? LegOutcome{true, notional, rep.qty_filled}
+            : LegOutcome{true, rep.qty_filled, notional};
+        decisions_.fill(e.origin, leg, symbol, rep.qty_filled, rep.price_avg);
+        log<fmt_leg_filled>(LogStream::Out, leg, done.side, LogStr(symbol),
+                            rep.qty_filled, rep.price_avg);
+    }
+    if (++e.answered < 3) return;
+
+    const auto risk = inventory_.leg_risk(tri, e.legs);
+    bool broken = false;
+    for (std::size_t l = 0; l < 3; ++l) {
+        if (e.legs[l].filled) continue;
+        broken = true;
+        const auto& missed = engine_.symbol(tri.legs[l].symbol).symbol;
+        decisions_.risk(e.origin, l, missed, risk.exposure);
+        log<fmt_leg_missed>(LogStream::Err, l, LogStr(missed), risk.exposure,
+                            LogStr(engine_.asset(engine_.home())));
+    }
+    inventory_.record_triangle(risk, broken);
+    executions_.release(execution);
+}
+
+void TriArbBot::schedule_rebalance()
+{
+    if (options_.inventory.interval.count() <= 0) return;
+    rebalance_timer_.expires_after(options_.inventory.interval);
+    rebalance_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        rebalance();
+        schedule_rebalance();
+    });
+}
+
+// Strategy thread, off the frame path.  Only between triangles, so a
+// rebalance never competes with legs for the same balances, and one round
+// at a time, so an order still out is not sent twice.
+void TriArbBot::rebalance()
+{
+    if (rebalancing_ > 0 || executions_.in_use() > 0) return;
+
+    for (const auto& r : inventory_.rebalance_plan()) {
+        const auto& scale = engine_.book(r.symbol).scale();
+        const Price price = scale.price_near(r.price);
+        const Qty   qty   = scale.qty_floor(r.qty);
+        if (qty.steps <= 0 ||
+            scale.to_double(qty) * scale.to_double(price) < engine_.symbol(r.symbol).minNotional)
+            continue;
+
+        ++rebalancing_;
+        if (pipeline_)
+            boost::asio::post(egress_ioc(), [this, r, qty, price] {
+                send_rebalance(r.symbol, r.side, qty, price);
+            });
+        else
+            send_rebalance(r.symbol, r.side, qty, price);
+    }
+}
+
+// Runs where the gateway lives; the fill is booked on the strategy thread.
+// Rebalances are rare, so a post is good enough for both hops.
+void TriArbBot::send_rebalance(SymbolId symbol, Side side, Qty qty, Price price)
+{
+    gw_.send_order(engine_.symbol(symbol).symbol, to_string(side), qty, price,
+        engine_.book(symbol).scale(),
+        [this, symbol, side](FillReport rep) {
+            auto book = [this, symbol, side, rep] {
+                --rebalancing_;
+                if (!rep.success) return;
+                inventory_.apply_fill(symbol, side, rep.qty_filled, rep.price_avg);
+                log<fmt_rebalanced>(LogStream::Out, side, LogStr(engine_.symbol(symbol).symbol),
+                                    rep.qty_filled, rep.price_avg);
+            };
+            if (pipeline_) boost::asio::post(strategy_ioc(), book);
+            else book();
+        });
+}
+
+// Network thread, or in sharded mode the shard's own thread.  In pipelined
+// mode the frame is copied into a queue slot and the read loop goes on; a
+// full queue holds the read loop back rather than dropping market data.
+// The wire span is the frame's wait in the kernel and the TLS and
+// WebSocket layers.
+void TriArbBot::on_frame(Shard& shard, std::size_t feed, std::string_view msg,
+                         std::uint64_t read_ns, std::uint64_t kernel_ns)
+{
+    if (kernel_ns) latency_.record(Span::Wire, read_ns - kernel_ns);
+
+    const Ts recv_ts = journal_clock_ns();
+    if (pipeline_)
+        push_record(pipeline_->frames, pipeline_->strategy, {recv_ts, RecordKind::Frame, {}, msg},
+                    read_ns, feed, kernel_ns);
+    else
+        handle_frame(shard, msg, read_ns, recv_ts, feed, kernel_ns);
+}
+
+void TriArbBot::push_record(SpscQueue<FrameSlot>& frames, Worker& to, const JournalRecord& rec,
+                            std::uint64_t read_ns, std::size_t feed, std::uint64_t kernel_ns)
+{
+    FrameSlot* slot;
+    while (!(slot = frames.claim())) std::this_thread::yield();
+    slot->kind    = rec.kind;
+    slot->tag.assign(rec.tag);
+    slot->payload.assign(rec.payload);
+    slot->recv_ts = rec.recvNs;
+    slot->read_ns   = read_ns;
+    slot->kernel_ns = kernel_ns;
+    slot->feed      = feed;
+    frames.publish();
+    to.wake();
+}
+
+// Strategy thread's poll.  Fills first, since they finish triangles already
+// under way; frames only up to what was queued on entry, so a burst of
+// market data cannot hold back the fills that arrive meanwhile.
+bool TriArbBot::drain_frames_and_fills()
+{
+    bool busy = false;
+    while (LegFill* f = pipeline_->fills.front()) {
+        on_fill(f->execution, f->leg, f->report);
+        pipeline_->fills.pop();
+        busy = true;
+    }
+
+    return drain_frames(*shards_[0], pipeline_->frames) || busy;
+}
+
+// Frames only up to what was queued on entry.  In sharded mode this is the
+// shard thread's poll, fed by replay().
+bool TriArbBot::drain_frames(Shard& shard, SpscQueue<FrameSlot>& frames)
+{
+    bool busy = false;
+    for (auto n = frames.pushed() - frames.popped(); n > 0; --n) {
+        const FrameSlot& f = *frames.front();
+        latency_.record(Span::Queue, now_ns() - f.read_ns);
+        apply_record(shard, {f.recv_ts, f.kind, f.tag, f.payload}, f.read_ns, f.feed,
+                     f.kernel_ns);
+        frames.pop();
+        busy = true;
+    }
+    return busy;
+}
+
+// Egress thread's poll.
+bool TriArbBot::drain_orders()
+{
+    bool busy = false;
+    while (LegOrder* o = pipeline_->orders.front()) {
+        send_leg(*o);
+        pipeline_->orders.pop();
+        busy = true;
+    }
+    return busy;
+}
+
+// Egress thread's poll in sharded mode: each shard's decisions in turn,
+// so the decision log and the execution pool see one thread.  The order of
+// lines from different shards follows their threads' timing, and so do
+// edges of triangles that read other shards' books, which is why
+// triarb_replay refuses this mode.
+bool TriArbBot::drain_decisions()
+{
+    bool busy = false;
+    for (auto& shard : shards_) {
+        while (Decision* d = shard->decisions.front()) {
+            apply_decision(*d);
+            shard->decisions.pop();
+            busy = true;
         }
+    }
+    return busy;
+}
+
+void TriArbBot::wait_idle()
+{
+    if (!pipeline_ && !egress_) return;
+
+    // Every hand-off between threads is a push, and a slot is popped only
+    // once its work is done, so all queues empty with no push in between
+    // means nothing is left in flight.
+    auto pushes = [this] {
+        std::uint64_t n = 0;
+        if (pipeline_) n += pipeline_->frames.pushed() + pipeline_->orders.pushed() +
+                            pipeline_->fills.pushed();
+        for (const auto& s : shards_) n += s->frames.pushed() + s->decisions.pushed();
+        return n;
+    };
+    auto empty = [this] {
+        bool all = !pipeline_ || (pipeline_->frames.empty() && pipeline_->orders.empty() &&
+                                  pipeline_->fills.empty());
+        for (const auto& s : shards_) all = all && s->frames.empty() && s->decisions.empty();
+        return all;
+    };
+    for (;;) {
+        const auto before = pushes();
+        if (empty() && pushes() == before) return;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+// Every copy of a frame is journaled; only the first copy of an update
+// reaches the books and the edge scan.
+void TriArbBot::handle_frame(Shard& shard, std::string_view msg, std::uint64_t read_ns,
+                             Ts recv_ts, std::size_t feed, std::uint64_t kernel_ns)
+{
+    shard.stamps.kernel = kernel_ns;
+    shard.stamps.read   = read_ns;
+    shard.current_ts    = recv_ts;
+    if (journal_) journal_->append(RecordKind::Frame, {}, msg, recv_ts);
 
+    try {
+        if (++shard.msg_count % 100 == 0)
+            log<fmt_processed>(LogStream::Out, shard.msg_count);
+
+        // bookTicker frames take the specialised parser straight to the
+        // book, unless FRAME_PARSER asks for the reference parser
+        const bool ticker = config_.market.book_ticker &&
+                            config_.market.parser == ParserMode::Fast &&
+                            parse_book_ticker(msg, shard.ticker);
+        if (!ticker && !parse_frame(shard, msg))
+            return;
+        const auto parsed = now_ns();
+        latency_.record(Span::Parse, parsed - read_ns);
+
+        const auto& frame = shard.frame;
+        const auto id = engine_.find_stream(ticker ? shard.ticker.stream : frame.stream);
+        if (!id) return;
+        shard.arbiter.observe(feed, *id, ticker ? shard.ticker.updateId : frame.lastUpdateId,
+                              read_ns);
+        if (!(ticker ? apply_ticker(shard, *id) : apply_frame(shard, *id)))
+            return;
+        const auto booked = now_ns();
+        latency_.record(Span::Book, booked - parsed);
+        const bool stamped = !ticker && frame.kind == FrameKind::DiffDepth;
+        if (const auto lag = shard.clock.observe(*id, recv_ts, stamped ? frame.eventTime : 0))
+            latency_.record(Span::FeedLag, *lag);
+        print_book_update(*id);
 
+        const auto opp = edge_scanner(shard, *id);
+        shard.stamps.decided = now_ns();
+        latency_.record(Span::Decide, shard.stamps.decided - booked);
+
+        if (opp) decide(shard, Decision{*opp, recv_ts, shard.stamps});
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
     }
 }
 
-} // namespace triarb
+// Called from the replay loop, which plays the network thread's part.  In
+// sharded mode it also plays the feeds' part in routing: a record goes to
+// the shard owning its symbol, and one for no known symbol to shard 0,
+// which reports it as a live frame would be.
+void TriArbBot::replay(const JournalRecord& rec)
+{
+    if (pipeline_)
+        return push_record(pipeline_->frames, pipeline_->strategy, rec, now_ns());
+    if (!egress_)
+        return apply_record(*shards_[0], rec, now_ns());
 
+    const auto id = rec.kind == RecordKind::Snapshot ? engine_.find(rec.tag)
+                                                     : engine_.find_stream(peek_stream(rec.payload));
+    auto& shard = id ? owner(*id) : *shards_[0];
+    push_record(shard.frames, *shard.worker, rec, now_ns());
+}
+
+void TriArbBot::apply_record(Shard& shard, const JournalRecord& rec, std::uint64_t read_ns,
+                             std::size_t feed, std::uint64_t kernel_ns)
+{
+    switch (rec.kind) {
+    case RecordKind::Frame:
+        handle_frame(shard, rec.payload, read_ns, rec.recvNs, feed, kernel_ns);
+        break;
+    case RecordKind::Snapshot: {
+        shard.current_ts = rec.recvNs;
+        const auto id = engine_.find(rec.tag);
+        MarketFrame snapshot;
+        if (id && parse_depth_snapshot(rec.payload, snapshot)) {
+            syncs_[*id]->on_snapshot(snapshot);
+            shard.clock.snapshot(*id, rec.recvNs);
+        }
+        else
+            std::cerr << "[REPLAY] unusable snapshot for " << rec.tag << "\n";
+        break;
+    }
+    }
+}
+
+} // namespace triarb
 
@@ -1,5 +1,11 @@
 #include "websocket_session.hpp"
+#include "latency.hpp"
+#include "recycling_allocator.hpp"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <vector>
 
 namespace triarb {
 
@@ -10,27 +16,54 @@ namespace net   = boost::asio;
 namespace ssl   = net::ssl;
 using tcp       = net::ip::tcp;
 
+WebsocketOptions load_websocket_options_from_env()
+{
+    WebsocketOptions options;
+    if (const char* on = std::getenv("WS_COMPRESSION"))
+        options.compression = std::string(on) == "1" || std::string(on) == "true";
+    if (const char* bytes = std::getenv("WS_READ_BUFFER"))
+        options.read_buffer = std::stoul(bytes);
+    options.socket = load_socket_options_from_env();
+    return options;
+}
+
 WebsocketSession::WebsocketSession(
     net::io_context& ioc,
     std::string host,
     std::string port,
     std::string target,
-    FrameHandler on_frame)
-    : resolver_(ioc)
+    FrameHandler on_frame,
+    WebsocketOptions options)
+    : ioc_(ioc)
+    , resolver_(ioc)
     , ctx_(ssl::context::tlsv12_client)
-    , ws_(ioc, ctx_)
     , host_(std::move(host))
     , port_(std::move(port))
     , target_(std::move(target))
+    , options_(options)
     , handler_(std::move(on_frame))
 {
+    // Sized once; frames are read into it in place and handed on as views,
+    // so a steady stream never reallocates it
+    buffer_.reserve(options_.read_buffer);
+
     // These are required for Binance's SSL certificate validation
     ctx_.set_verify_mode(ssl::verify_peer);
     ctx_.set_default_verify_paths();
 }
 
+void WebsocketSession::add_ca_file(const std::string& path)
+{
+    ctx_.load_verify_file(path);
+}
+
 void WebsocketSession::run()
 {
+    // A fresh stream for every connection attempt; a websocket stream
+    // cannot be reused once it has failed or closed
+    ws_.emplace(ioc_, ctx_);
+    buffer_.clear();
+
     // Start the asynchronous DNS resolution for host_:port_
     resolver_.async_resolve(
         host_,
@@ -46,16 +79,22 @@ void WebsocketSession::on_resolve(
 {
     if (ec) {
         std::cerr << "Resolve error: " << ec.message() << "\n";
-        return;
+        return closed(ec);
     }
     std::cout << "DNS resolved successfully\n";  // Add debug print
 
     // Set a 30‐second timeout on the underlying TCP layer
-    beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
+    beast::get_lowest_layer(*ws_).expires_after(std::chrono::seconds(30));
 
-    // Attempt to connect the TCP socket to one of the resolved endpoints
-    beast::get_lowest_layer(ws_).async_connect(
-        results,
+    // Attempt to connect the TCP socket to one of the resolved endpoints,
+    // starting from the preferred one
+    std::vector<tcp::endpoint> endpoints(results.begin(), results.end());
+    if (!endpoints.empty())
+        std::rotate(endpoints.begin(),
+                    endpoints.begin() + static_cast<std::ptrdiff_t>(prefer_ % endpoints.size()),
+                    endpoints.end());
+    beast::get_lowest_layer(*ws_).async_connect(
+        endpoints,
         beast::bind_front_handler(
             &WebsocketSession::on_connect,
             this));
@@ -67,36 +106,37 @@ void WebsocketSession::on_connect(
 {
     if (ec) {
         std::cerr << "Connect error: " << ec.message() << "\n";
-        return;
+        return closed(ec);
     }
     std::cout << "TCP connected to " << endpoint << "\n";  // Add debug print
+    tune_socket(beast::get_lowest_layer(*ws_).socket().native_handle(), options_.socket);
 
     // Set SNI Hostname (many hosts need this to handshake successfully)
     if(!SSL_set_tlsext_host_name(
-        ws_.next_layer().native_handle(), host_.c_str()))
+        ws_->next_layer().native_handle(), host_.c_str()))
     {
         ec = beast::error_code(
             static_cast<int>(::ERR_get_error()),
             net::error::get_ssl_category());
         std::cerr << "SSL SNI error: " << ec.message() << "\n";
-        return;
+        return closed(ec);
     }
 
     // Update the hostname in handshake (SSL)
-    ws_.next_layer().set_verify_callback(
+    ws_->next_layer().set_verify_callback(
         [this](bool preverified, ssl::verify_context& ctx) {
             return this->verify_certificate(preverified, ctx);
         });
 
     // Perform the SSL handshake
-    ws_.next_layer().async_handshake(
+    ws_->next_layer().async_handshake(
         ssl::stream_base::client,
         beast::bind_front_handler(
             &WebsocketSession::on_ssl_handshake,
             this));
 
     // just set a User-Agent
-    ws_.set_option(ws::stream_base::decorator(
+    ws_->set_option(ws::stream_base::decorator(
         [](ws::request_type& r){
             r.set(http::field::user_agent, "TriArbBot/0.0.1");
         }));
@@ -115,27 +155,30 @@ void WebsocketSession::on_ssl_handshake(beast::error_code ec)
 {
     if (ec) {
         std::cerr << "SSL handshake error: " << ec.message() << "\n";
-        return;
+        return closed(ec);
     }
     std::cout << "SSL handshake completed\n";  // Add debug print
 
     // Turn off the timeout on the tcp_stream, because
     // the websocket stream has its own timeout system.
-    beast::get_lowest_layer(ws_).expires_never();
+    beast::get_lowest_layer(*ws_).expires_never();
 
     // Enable binary frames
-    ws_.binary(false);
+    ws_->binary(false);
 
     // Set suggested timeout settings for the websocket
-    ws_.set_option(
+    ws_->set_option(
         ws::stream_base::timeout::suggested(
             beast::role_type::client));
 
-    // Specify permessage-deflate settings
-    ws_.set_option(ws::permessage_deflate{});
+    // Compression saves bandwidth at the cost of inflating every frame;
+    // the server may still decline it
+    ws::permessage_deflate deflate;
+    deflate.client_enable = options_.compression;
+    ws_->set_option(deflate);
 
     // Set a decorator to change the User-Agent and other headers
-    ws_.set_option(ws::stream_base::decorator(
+    ws_->set_option(ws::stream_base::decorator(
         [](ws::request_type& req) {
             req.set(http::field::user_agent, "TriArbBot/0.0.1");
             req.set(http::field::upgrade, "websocket");
@@ -144,7 +187,7 @@ void WebsocketSession::on_ssl_handshake(beast::error_code ec)
         }));
 
     // Perform the websocket handshake
-    ws_.async_handshake(host_, target_,
+    ws_->async_handshake(host_, target_,
         beast::bind_front_handler(
             &WebsocketSession::on_handshake,
             this));
@@ -154,16 +197,25 @@ void WebsocketSession::on_handshake(beast::error_code ec)
 {
     if (ec) {
         std::cerr << "WebSocket handshake error: " << ec.message() << "\n";
-        return;
+        return closed(ec);
     }
     std::cout << "WebSocket connected successfully!\n";  // Add debug print
 
+    // The tcp_stream's expiry is off from here on, so reads can go
+    // through recvmsg() and bring the kernel's receive stamps with them
+    if (options_.socket.timestamps || options_.socket.quickack)
+        stamped().stamp(true, options_.socket.quickack);
+
     // We’re now connected and handshaken. Start reading messages into our buffer:
-    ws_.async_read(
+    open_    = true;
+    reading_ = true;
+    ws_->async_read(
         buffer_,
-        beast::bind_front_handler(
+        recycling(beast::bind_front_handler(
             &WebsocketSession::on_read,
-            this));
+            this)));
+
+    if (on_open_) on_open_();
 }
 
 void WebsocketSession::on_read(
@@ -171,24 +223,102 @@ void WebsocketSession::on_read(
     std::size_t bytes_transferred)
 {
     boost::ignore_unused(bytes_transferred);
+    const std::uint64_t read_ns = now_ns();
 
     if (ec) {
         std::cerr << "Read error: " << ec.message() << "\n";
-        return;
+        reading_ = false;
+        return closed(ec);
     }
 
-    // Convert the buffer to a string and call the user callback
-    handler_(beast::buffers_to_string(buffer_.data()));
+    // Hand the frame on in place; a flat_buffer is one contiguous block
+    const auto frame = buffer_.cdata();
+    handler_(std::string_view(static_cast<const char*>(frame.data()), frame.size()), read_ns,
+             stamped().kernel_ns());
 
     // Clear the buffer for the next frame
     buffer_.consume(buffer_.size());
 
     // Read again—loop forever until error or program exit
-    ws_.async_read(
+    ws_->async_read(
         buffer_,
-        beast::bind_front_handler(
+        recycling(beast::bind_front_handler(
             &WebsocketSession::on_read,
-            this));
+            this)));
+}
+
+void WebsocketSession::send(std::string_view text)
+{
+    if (!open_) return;
+
+    // Grow the ring when full.  Moving a vector keeps its data where it
+    // is, so the frame being written stays valid.
+    if (out_count_ == outbox_.size()) {
+        std::vector<std::vector<char>> grown(std::max<std::size_t>(4, 2 * outbox_.size()));
+        for (std::size_t i = 0; i < out_count_; ++i)
+            grown[i] = std::move(outbox_[(out_head_ + i) % outbox_.size()]);
+        outbox_   = std::move(grown);
+        out_head_ = 0;
+    }
+    outbox_[(out_head_ + out_count_++) % outbox_.size()].assign(text.begin(), text.end());
+    if (writing_) return;
+
+    // Only one write may be in flight on a websocket stream
+    writing_ = true;
+    ws_->text(true);
+    ws_->async_write(
+        net::buffer(outbox_[out_head_]),
+        recycling(beast::bind_front_handler(
+            &WebsocketSession::on_write,
+            this)));
+}
+
+void WebsocketSession::on_write(
+    beast::error_code ec,
+    std::size_t bytes_transferred)
+{
+    boost::ignore_unused(bytes_transferred);
+    writing_ = false;
+
+    // The pending read sees the failure too and reports it
+    if (ec || !open_) {
+        out_head_ = out_count_ = 0;
+        if (open_) return close();
+        if (!reading_) closed(close_ec_);
+        return;
+    }
+
+    // Back to the first buffer whenever the ring empties, so one frame at
+    // a time keeps reusing the same one
+    out_head_ = --out_count_ == 0 ? 0 : (out_head_ + 1) % outbox_.size();
+    if (out_count_ == 0) return;
+
+    writing_ = true;
+    ws_->async_write(
+        net::buffer(outbox_[out_head_]),
+        recycling(beast::bind_front_handler(
+            &WebsocketSession::on_write,
+            this)));
+}
+
+void WebsocketSession::close()
+{
+    beast::error_code ignored;
+    if (ws_) beast::get_lowest_layer(*ws_).socket().close(ignored);
+}
+
+void WebsocketSession::closed(beast::error_code ec)
+{
+    open_ = false;
+    close();
+
+    // A write still in flight holds the stream; on_write reports for it
+    if (writing_) {
+        close_ec_ = ec;
+        return;
+    }
+    out_head_ = out_count_ = 0;
+    if (on_close_) on_close_(ec);
 }
 
 } // namespace triarb
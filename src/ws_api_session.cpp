@@ -0,0 +1,162 @@
+#include "ws_api_session.hpp"
+#include "recycling_allocator.hpp"
+#include <boost/beast/http/error.hpp>
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <utility>
+
+namespace triarb {
+
+namespace beast = boost::beast;
+
+WsApiSession::WsApiSession(boost::asio::io_context& ioc,
+                           std::string host,
+                           std::string port,
+                           std::string target,
+                           std::string ca_file,
+                           std::chrono::milliseconds request_timeout,
+                           SocketOptions socket)
+    : session_(ioc, std::move(host), std::move(port), std::move(target),
+               [this](std::string_view frame, std::uint64_t, std::uint64_t) { on_frame(frame); },
+               WebsocketOptions{.socket = socket})
+    , request_timeout_(request_timeout)
+    , retry_timer_(ioc)
+    , sweep_timer_(ioc)
+{
+    if (!ca_file.empty()) session_.add_ca_file(ca_file);
+    session_.set_open_handler([this] { on_open(); });
+    session_.set_close_handler([this](beast::error_code ec) { on_close(ec); });
+}
+
+void WsApiSession::start()
+{
+    session_.run();
+}
+
+void WsApiSession::async_request(std::uint64_t id, std::string_view text, Callback cb)
+{
+    auto& slot = slots_[id % kSlots];
+    if (slot.id != 0) {
+        std::cerr << "[ORDER] ws-api request " << id << " not sent, " << kSlots
+                  << " slots in use\n";
+        return cb(boost::asio::error::no_buffer_space, {});
+    }
+    slot.id       = id;
+    slot.cb       = std::move(cb);
+    slot.deadline = std::chrono::steady_clock::now() + request_timeout_;
+    slot.sent     = ready();
+    ++in_flight_;
+    if (slot.sent) session_.send(text);
+    else           slot.text.assign(text);
+    arm_sweep();
+}
+
+void WsApiSession::on_open()
+{
+    ++connects_;
+    was_open_ = true;
+
+    // Requests made while down go out now, oldest first; any whose
+    // deadline passed have already failed and left their slot
+    std::array<Slot*, kSlots> unsent;
+    std::size_t n = 0;
+    for (auto& slot : slots_)
+        if (slot.id != 0 && !slot.sent) unsent[n++] = &slot;
+    std::sort(unsent.begin(), unsent.begin() + n,
+              [](const Slot* a, const Slot* b) { return a->id < b->id; });
+    for (std::size_t i = 0; i < n; ++i) {
+        unsent[i]->sent = true;
+        session_.send(unsent[i]->text);
+    }
+}
+
+// Whatever was written on the lost connection may have been acted on, so
+// it fails rather than being sent again.
+void WsApiSession::on_close(beast::error_code ec)
+{
+    if (!ec) ec = beast::http::error::end_of_stream;
+
+    // The callbacks may make new requests, so the slots are freed first
+    std::array<Callback, kSlots> lost;
+    std::size_t n = 0;
+    for (auto& slot : slots_) {
+        if (slot.id == 0 || !slot.sent) continue;
+        lost[n++] = std::move(slot.cb);
+        slot.id = 0;
+        --in_flight_;
+    }
+
+    const auto delay = was_open_ ? std::chrono::milliseconds(0) : kReconnectDelay;
+    was_open_ = false;
+    retry_timer_.expires_after(delay);
+    retry_timer_.async_wait([this](beast::error_code wait_ec) {
+        if (!wait_ec) session_.run();
+    });
+
+    for (std::size_t i = 0; i < n; ++i) lost[i](ec, {});
+}
+
+void WsApiSession::on_frame(std::string_view frame)
+{
+    const auto id = uint_field(frame, "id");
+    if (!id) {
+        std::cerr << "[ORDER] ws-api message without a request id: " << frame << "\n";
+        return;
+    }
+
+    auto& slot = slots_[*id % kSlots];
+    if (slot.id != *id) {
+        std::cerr << "[ORDER] ws-api reply to expired request " << *id << ": " << frame << "\n";
+        return;
+    }
+    auto cb = std::move(slot.cb);
+    slot.id = 0;
+    --in_flight_;
+    cb({}, frame);
+}
+
+// One timer checks every deadline, ten times per timeout, while anything
+// is pending.
+void WsApiSession::arm_sweep()
+{
+    if (sweeping_ || in_flight_ == 0) return;
+    sweeping_ = true;
+    sweep_timer_.expires_after(request_timeout_ / 10);
+    sweep_timer_.async_wait(recycling([this](beast::error_code ec) {
+        if (ec) return;
+        sweeping_ = false;
+
+        const auto now = std::chrono::steady_clock::now();
+        for (auto& slot : slots_)
+            if (slot.id != 0 && slot.deadline <= now) fail(slot, boost::asio::error::timed_out);
+        arm_sweep();
+    }));
+}
+
+void WsApiSession::fail(Slot& slot, beast::error_code ec)
+{
+    auto cb = std::move(slot.cb);
+    slot.id = 0;
+    --in_flight_;
+    cb(ec, {});
+}
+
+std::optional<std::uint64_t> uint_field(std::string_view frame, std::string_view key)
+{
+    for (auto pos = frame.find(key); pos != std::string_view::npos; pos = frame.find(key, pos + 1)) {
+        auto i = pos + key.size();
+        if (pos == 0 || frame[pos - 1] != '"' || i >= frame.size() || frame[i] != '"') continue;
+        auto skip_space = [&] { while (i < frame.size() && frame[i] == ' ') ++i; };
+        ++i;
+        skip_space();
+        if (i >= frame.size() || frame[i++] != ':') continue;
+        skip_space();
+        std::uint64_t v = 0;
+        const auto [end, ec] = std::from_chars(frame.data() + i, frame.data() + frame.size(), v);
+        if (ec == std::errc() && end != frame.data() + frame.size()) return v;
+    }
+    return std::nullopt;
+}
+
+} // namespace triarb
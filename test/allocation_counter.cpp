@@ -0,0 +1,22 @@
+#include "allocation_counter.hpp"
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local std::uint64_t t_allocations = 0;
+}
+
+std::uint64_t thread_allocations()
+{
+    return t_allocations;
+}
+
+void* operator new(std::size_t size)
+{
+    ++t_allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+
+/* Allocation Counter
+ * ------------------
+ * allocation_counter.cpp replaces the global operator new for the whole
+ * test binary, counting the calls made on each thread.  Tests read the
+ * difference around the code that must not allocate.
+ */
+std::uint64_t thread_allocations();
@@ -0,0 +1,213 @@
+#include "async_log.hpp"
+#include "latency.hpp"
+#include "orderbook.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace triarb;
+
+namespace {
+
+void fmt_item(std::string& out, int thread, int seq, const LogStr& tag)
+{
+    append_int(out, thread);
+    out += ':';
+    append_int(out, seq);
+    out += ' ';
+    out.append(tag.view());
+}
+
+void fmt_book(std::string& out, const LogStr& symbol, int precision, const TopOfBook& top)
+{
+    out.append(symbol.view()).append(" - Best bid: ");
+    append_fixed(out, top.bid.px, precision);
+    out += " (";
+    append_fixed(out, top.bid.qty, precision);
+    out += ")\nBest ask: ";
+    append_fixed(out, top.ask.px, precision);
+    out += " (";
+    append_fixed(out, top.ask.qty, precision);
+    out += ")\nSpread: ";
+    append_fixed(out, top.ask.px - top.bid.px, precision);
+    out += '\n';
+}
+
+/// Sink that keeps everything, split into lines per stream.
+struct Capture {
+    std::mutex mutex;
+    std::string out, err;
+
+    AsyncLogger::Sink sink()
+    {
+        return [this](LogStream s, std::string_view text) {
+            std::lock_guard<std::mutex> lock(mutex);
+            (s == LogStream::Err ? err : out).append(text);
+        };
+    }
+
+    static std::vector<std::string> lines(const std::string& text)
+    {
+        std::vector<std::string> v;
+        std::istringstream in(text);
+        for (std::string l; std::getline(in, l);) v.push_back(l);
+        return v;
+    }
+};
+
+} // namespace
+
+TEST_CASE("Logger formats records off the calling thread, in order", "[log]") {
+    Capture cap;
+    {
+        AsyncLogger log(cap.sink(), 1024);
+        for (int i = 0; i < 1000; ++i)
+            log.write<fmt_item>(i % 10 == 0 ? LogStream::Err : LogStream::Out, 0, i, LogStr("ETHBTC"));
+        log.flush();
+        CHECK(log.dropped() == 0);
+    }
+
+    const auto out = Capture::lines(cap.out);
+    const auto err = Capture::lines(cap.err);
+    REQUIRE(out.size() == 900);
+    REQUIRE(err.size() == 100);
+    CHECK(out.front() == "0:1 ETHBTC");
+    CHECK(out.back() == "0:999 ETHBTC");
+    CHECK(err[3] == "0:30 ETHBTC");
+}
+
+TEST_CASE("Logger drops and counts records when a ring is full", "[log]") {
+    Capture cap;
+    std::atomic<bool> entered{false}, release{false};
+    AsyncLogger::Sink slow = [&, inner = cap.sink()](LogStream s, std::string_view text) {
+        entered = true;
+        while (!release) std::this_thread::yield();
+        inner(s, text);
+    };
+
+    {
+        AsyncLogger log(slow, 8);
+        log.write<fmt_item>(LogStream::Out, 0, -1, LogStr("first"));
+        while (!entered) std::this_thread::yield();
+
+        // The consumer is stuck in the sink: 8 records fit, the rest go.
+        for (int i = 0; i < 100; ++i)
+            log.write<fmt_item>(LogStream::Out, 0, i, LogStr("x"));
+        CHECK(log.dropped() == 92);
+
+        release = true;
+        log.flush();
+    }
+
+    const auto out = Capture::lines(cap.out);
+    REQUIRE(out.size() == 9);
+    CHECK(out[1] == "0:0 x");
+    CHECK(out[8] == "0:7 x");
+    CHECK(cap.err == "[LOG] 92 records dropped, ring full\n");
+}
+
+TEST_CASE("Each thread gets its own ring", "[log]") {
+    Capture cap;
+    {
+        AsyncLogger log(cap.sink(), 1024);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t)
+            producers.emplace_back([&log, t] {
+                for (int i = 0; i < 500; ++i) {
+                    log.write<fmt_item>(LogStream::Out, t, i, LogStr("p"));
+                    if (i % 64 == 0) std::this_thread::yield();
+                }
+            });
+        for (auto& p : producers) p.join();
+        log.flush();
+        REQUIRE(log.dropped() == 0);
+    }
+
+    std::vector<int> next(4, 0);
+    for (const auto& line : Capture::lines(cap.out)) {
+        const int t = line[0] - '0';
+        REQUIRE(line == std::to_string(t) + ":" + std::to_string(next[t]) + " p");
+        ++next[t];
+    }
+    CHECK(next == std::vector<int>{500, 500, 500, 500});
+}
+
+TEST_CASE("A thread alternating loggers keeps one ring in each", "[log]") {
+    Capture cap_a, cap_b;
+    std::atomic<bool> entered{false}, release{false};
+    AsyncLogger::Sink slow = [&, inner = cap_a.sink()](LogStream s, std::string_view text) {
+        entered = true;
+        while (!release) std::this_thread::yield();
+        inner(s, text);
+    };
+
+    {
+        AsyncLogger a(slow, 8);
+        AsyncLogger b(cap_b.sink(), 8);
+        a.write<fmt_item>(LogStream::Out, 0, -1, LogStr("first"));
+        while (!entered) std::this_thread::yield();
+
+        // Switching to b and back must land in the same ring of a, so a
+        // still holds only 8 records while its consumer is stuck.
+        for (int i = 0; i < 100; ++i) {
+            a.write<fmt_item>(LogStream::Out, 0, i, LogStr("a"));
+            b.write<fmt_item>(LogStream::Out, 0, i, LogStr("b"));
+            if (i % 4 == 3) b.flush();
+        }
+        CHECK(a.dropped() == 92);
+        CHECK(b.dropped() == 0);
+
+        release = true;
+        a.flush();
+    }
+
+    const auto out = Capture::lines(cap_a.out);
+    REQUIRE(out.size() == 9);
+    CHECK(out[8] == "0:7 a");
+    CHECK(Capture::lines(cap_b.out).size() == 100);
+}
+
+TEST_CASE("Long text is truncated, not overrun", "[log]") {
+    const LogStr s(std::string(200, 'a'));
+    CHECK(s.view().size() == LogStr::kMax);
+}
+
+TEST_CASE("Hot-path cost of a book update line", "[.][benchmark][log]") {
+    const TopOfBook top{{104312.01, 3.21874}, {104312.02, 4.07716}, 71258836592};
+
+    std::atomic<std::uint64_t> written{0};
+    AsyncLogger log([&](LogStream, std::string_view text) { written += text.size(); }, 1 << 16);
+
+    BENCHMARK("ostringstream (old print_book_update, no I/O)") {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2)
+           << "BTCUSDT" << " - "
+           << "Best bid: " << top.bid.px << " (" << top.bid.qty << ")\n"
+           << "Best ask: " << top.ask.px << " (" << top.ask.qty << ")\n"
+           << "Spread: " << (top.ask.px - top.bid.px) << "\n\n";
+        return os.str().size();
+    };
+    // Catch2 would run write() far faster than the consumer drains, so
+    // most calls would take the cheaper drop path.  Time bursts that fit
+    // the ring instead, flushing between them.
+    constexpr int kBurst = 4096, kBursts = 200;
+    std::vector<double> per_op;
+    for (int b = 0; b < kBursts; ++b) {
+        const auto start = now_ns();
+        for (int i = 0; i < kBurst; ++i)
+            log.write<fmt_book>(LogStream::Out, LogStr("BTCUSDT"), 2, top);
+        per_op.push_back(static_cast<double>(now_ns() - start) / kBurst);
+        log.flush();
+    }
+    std::sort(per_op.begin(), per_op.end());
+    REQUIRE(log.dropped() == 0);
+    WARN("AsyncLogger::write, " << kBurst << "-record bursts: median "
+         << per_op[per_op.size() / 2] << " ns, min " << per_op.front() << " ns");
+}
@@ -0,0 +1,141 @@
+#include "book_clock.hpp"
+#include "triarb_bot.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <boost/asio.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace triarb;
+
+namespace {
+
+constexpr std::uint64_t kMs = 1'000'000;
+
+} // namespace
+
+TEST_CASE("BookClock follows the exchange clock offset and the lag behind it", "[clock]") {
+    BookClock clock(3);
+    CHECK_FALSE(clock.offset_ns());
+    CHECK(clock.as_of(0) == 0);
+
+    // Frames without an event time are current when they arrive
+    const std::uint64_t t0 = 1'750'000'000'000 * kMs;
+    CHECK_FALSE(clock.observe(0, t0, 0));
+    CHECK(clock.as_of(0) == t0);
+    CHECK_FALSE(clock.offset_ns());
+
+    // The receive clock runs 40 ms ahead; the fastest frame sets the offset
+    const std::uint64_t e = 1'750'000'000'000;
+    CHECK(clock.observe(1, (e + 45) * kMs, e) == 0u);
+    CHECK(clock.offset_ns() == std::int64_t(45 * kMs));
+    CHECK(clock.observe(1, (e + 100 + 52) * kMs, e + 100) == 7 * kMs);
+    CHECK(clock.as_of(1) == (e + 100 + 45) * kMs);
+    CHECK(clock.observe(2, (e + 200 + 40) * kMs, e + 200) == 0u);
+    CHECK(clock.offset_ns() == std::int64_t(40 * kMs));
+    CHECK(clock.as_of(2) == (e + 240) * kMs);
+    CHECK(clock.received(1) == (e + 152) * kMs);
+
+    // The 40 ms frame counts for one more window, then drops out
+    const auto later = e + 2 * BookClock::kWindowNs / kMs + 1000;
+    clock.observe(1, (later + 60) * kMs, later);
+    CHECK(clock.offset_ns() == std::int64_t(40 * kMs));
+    clock.observe(1, (later + BookClock::kWindowNs / kMs + 65) * kMs,
+                  later + BookClock::kWindowNs / kMs);
+    CHECK(clock.offset_ns() == std::int64_t(60 * kMs));
+
+    clock.snapshot(2, later * kMs);
+    CHECK(clock.as_of(2) == later * kMs);
+
+    clock.hold(BookClock::Hold::Stale);
+    clock.hold(BookClock::Hold::Stale);
+    clock.hold(BookClock::Hold::Skew);
+    CHECK(clock.held(BookClock::Hold::Stale) == 2);
+    CHECK(clock.held(BookClock::Hold::Skew) == 1);
+
+    std::ostringstream report;
+    clock.report(report);
+    CHECK(report.str() == "[CLOCK] offset 60.000 ms, frames with E 5, without 1, "
+                          "held stale 2, skew 1\n");
+}
+
+TEST_CASE("Old or far-apart books hold a triangle back", "[clock]") {
+    // USDT->ETH->BTC->USDT is worth about 6 % once the ETHBTC book is in,
+    // 1.5 s after the ETHUSDT one
+    const std::vector<std::string> frames{
+        depth5("ethusdt@depth5@100ms", "1999.00", "2000.00"),
+        depth5("btcusdt@depth5@100ms", "100000.00", "100010.00"),
+        depth5("ethbtc@depth5@100ms", "0.02100", "0.02190")};
+    const std::vector<std::uint64_t> at{0, 1490 * kMs, 1500 * kMs};
+
+    struct Limits {
+        const char* age;
+        const char* skew;
+        const char* expect;
+    };
+    for (const auto& limits : {Limits{nullptr, nullptr, " FIRE "},
+                               Limits{"1000", nullptr, " SKIP 0 ETHUSDT stale-book"},
+                               Limits{"2000", "1000", " SKIP 0 ETHUSDT book-skew"},
+                               Limits{"2000", "2000", " FIRE "}}) {
+        INFO("age " << (limits.age ? limits.age : "off") << ", skew "
+                    << (limits.skew ? limits.skew : "off"));
+        if (limits.age) ::setenv("MAX_BOOK_AGE_MS", limits.age, 1);
+        if (limits.skew) ::setenv("MAX_BOOK_SKEW_MS", limits.skew, 1);
+
+        const auto decisions = temp_path("clock_decisions.log");
+        BotOptions options;
+        options.replay       = true;
+        options.decision_log = decisions;
+        boost::asio::io_context ioc;
+        {
+            TriArbBot bot{ioc, options};
+            bot.start();
+            const std::uint64_t t0 = 1'700'000'000'000 * kMs;
+            for (std::size_t i = 0; i < frames.size(); ++i)
+                bot.replay(JournalRecord{t0 + at[i], RecordKind::Frame, {}, frames[i]});
+
+            const auto& age = bot.latency()[Span::BookAge];
+            REQUIRE(age.count() == 1);
+            CHECK(age.max() == 1500 * kMs);
+            CHECK(bot.latency()[Span::BookSkew].max() == 1500 * kMs);
+            CHECK(bot.latency()[Span::FeedLag].count() == 0);   // depth5 has no E
+            CHECK_FALSE(bot.book_clock().offset_ns());
+        }
+        CHECK(count_lines(decisions, limits.expect) == 1);
+        std::filesystem::remove(decisions);
+        ::unsetenv("MAX_BOOK_AGE_MS");
+        ::unsetenv("MAX_BOOK_SKEW_MS");
+    }
+}
+
+TEST_CASE("Diff depth frames report their lag behind the exchange", "[clock]") {
+    const auto diffs = read_lines(data_file("ethbtc_depth_diffs.jsonl"));
+    REQUIRE(diffs.size() == 4);
+    ::setenv("DEPTH_FEED", "diff", 1);
+
+    // E runs 1750000000100 to ...400 ms; the frames arrive 5 ms after it,
+    // then 12 ms after
+    const std::uint64_t e = 1'750'000'000'000;
+    BotOptions options;
+    options.replay = true;
+    boost::asio::io_context ioc;
+    {
+        TriArbBot bot{ioc, options};
+        bot.start();
+        bot.replay(JournalRecord{(e + 105) * kMs, RecordKind::Frame, {}, diffs[0]});
+        bot.replay(JournalRecord{(e + 205) * kMs, RecordKind::Frame, {}, diffs[1]});
+        bot.replay(JournalRecord{(e + 250) * kMs, RecordKind::Snapshot, "ETHBTC",
+                                 read_file(data_file("ethbtc_depth_snapshot.json"))});
+        bot.replay(JournalRecord{(e + 305) * kMs, RecordKind::Frame, {}, diffs[2]});
+        bot.replay(JournalRecord{(e + 412) * kMs, RecordKind::Frame, {}, diffs[3]});
+
+        const auto& lag = bot.latency()[Span::FeedLag];
+        CHECK(lag.count() == 2);
+        CHECK(lag.max() == 7 * kMs);
+        CHECK(bot.book_clock().offset_ns() == std::int64_t(5 * kMs));
+    }
+    ::unsetenv("DEPTH_FEED");
+}
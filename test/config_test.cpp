@@ -0,0 +1,275 @@
+#include "config.hpp"
+#include "rcu_cell.hpp"
+#include "triarb_bot.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace triarb;
+
+namespace {
+
+void write_file(const std::string& path, const std::string& text)
+{
+    std::ofstream(path) << text;
+}
+
+/// Counts the live copies of itself, to see when RcuCell frees one.
+struct Tracked {
+    explicit Tracked(int v) : value(v), twice(2 * v) { ++alive; }
+    Tracked(const Tracked& o) : value(o.value), twice(o.twice) { ++alive; }
+    ~Tracked() { --alive; }
+
+    int value;
+    int twice;
+    static inline std::atomic<int> alive{0};
+};
+
+} // namespace
+
+TEST_CASE("Config files are laid over the environment defaults", "[config]") {
+    Config base;
+    base.strategy.max_notional = 40;
+    base.feeds.connections = 3;
+
+    const auto config = parse_config(R"({
+        "market":   {"symbols": ["ETHBTC", "BTCUSDT", "ETHUSDT"], "home_asset": "BTC",
+                     "rest_host": "localhost", "depth_feed": "none", "book_ticker": true,
+                     "parser": "validate"},
+        "strategy": {"fee_tier": "vip1",
+                     "fee_tiers": {"vip0": {"maker": 0.001, "taker": 0.001},
+                                   "vip1": {"maker": 0.0009, "taker": 0.001}},
+                     "edge_threshold": 0.002, "triangles": ["BTC->ETH->USDT->BTC"],
+                     "max_book_age_ms": 1500},
+        "feeds":    {"endpoints": ["a.example:9443", "b.example:443"], "stall_timeout_ms": 2500,
+                     "compression": true, "socket": {"busy_poll_us": 50, "timestamps": false}},
+        "threads":  {"threading": "pipelined", "net_cpu": 0, "busy_poll": true}
+    })", base);
+
+    CHECK(config.market.symbols.size() == 3);
+    CHECK(config.market.home_asset == "BTC");
+    CHECK(config.market.rest_host == "localhost");
+    CHECK(config.market.depth_feed == DepthFeed::None);
+    CHECK(config.market.book_ticker);
+    CHECK(config.market.parser == ParserMode::Validate);
+    CHECK(config.strategy.fee_tier == "vip1");
+    CHECK(config.strategy.fees.maker == 0.0009);
+    CHECK(config.strategy.fees.taker == 0.001);
+    CHECK(config.strategy.edge_threshold == 0.002);
+    CHECK(config.strategy.max_notional == 40);              // left out: kept
+    CHECK(config.strategy.triangles == std::vector<std::string>{"BTC->ETH->USDT->BTC"});
+    CHECK(config.strategy.max_book_age.count() == 1500);
+    CHECK(config.strategy.max_book_skew.count() == 0);     // left out: off
+    CHECK(config.feeds.connections == 3);                   // left out: kept
+    REQUIRE(config.feeds.endpoints.size() == 2);
+    CHECK(config.feeds.endpoints[1] == FeedEndpoint{"b.example", "443"});
+    CHECK(config.feeds.stall_timeout.count() == 2500);
+    CHECK(config.feeds.session.compression);
+    CHECK(config.feeds.session.socket.busy_poll_us == 50);
+    CHECK_FALSE(config.feeds.session.socket.timestamps);
+    CHECK(config.feeds.session.socket.nodelay);            // left out: kept
+    CHECK(config.pipeline.enabled);
+    CHECK(config.pipeline.net_cpu == 0);
+    CHECK(config.pipeline.strategy_cpu == -1);
+    CHECK(config.pipeline.busy_poll);
+
+    // An empty document changes nothing
+    const auto same = parse_config("{}", base);
+    CHECK(same.market == base.market);
+    CHECK(same.feeds == base.feeds);
+    CHECK(same.strategy.max_notional == 40);
+}
+
+TEST_CASE("Bad configuration is rejected", "[config]") {
+    for (const char* bad : {
+             R"({"strategy": {"edge_treshold": 0.001}})",
+             R"({"risk": {}})",
+             R"({"market": {"depth_feed": "full"}})",
+             R"({"market": {"book_ticker": "yes"}})",
+             R"({"feeds": {"socket": {"rcvbuf": -1}}})",
+             R"({"feeds": {"socket": {"quick_ack": true}}})",
+             R"({"strategy": {"max_notional": 0}})",
+             R"({"strategy": {"edge_threshold": -0.001}})",
+             R"({"strategy": {"max_book_skew_ms": -1}})",
+             R"({"strategy": {"fee_tier": "vip9", "fee_tiers": {"vip0": {"maker": 0, "taker": 0}}}})",
+             R"({"strategy": {"fee_tier": "vip0"}})",
+             R"({"strategy": {"fee_tier": "vip0", "fee_tiers": {"vip0": {"maker": 0.1, "taker": 0.1}}}})",
+             R"({"strategy": {"fee_tier": "vip0", "fee_tiers": {"vip0": {"maker": 0.001}}}})",
+             R"({"feeds": {"endpoints": ["no-port"]}})",
+             R"({"feeds": {"connections": 0}})",
+             R"({"threads": {"threading": "many"}})",
+             R"({"threads": {"egress_cpu": 100000}})"}) {
+        INFO(bad);
+        CHECK_THROWS(parse_config(bad, {}));
+    }
+    CHECK_THROWS_AS(parse_config(R"({"market": {"parser": "slow"}})", {}), std::invalid_argument);
+    CHECK_THROWS_AS(parse_config("[1, 2]", {}), std::runtime_error);
+    CHECK_THROWS_AS(parse_config("{\"market\":", {}), std::runtime_error);
+    CHECK_THROWS_AS(load_config(temp_path("no_such_config.json"), {}), std::runtime_error);
+}
+
+TEST_CASE("CONFIG refines the environment and picks the symbols", "[config]") {
+    const auto path = temp_path("config_env.json");
+    write_file(path, R"({"strategy": {"max_notional": 25}, "market": {"symbols": ["ETHBTC"]}})");
+
+    ::setenv("EDGE_THRESHOLD", "0.0015", 1);
+    ::setenv("MAX_NOTIONAL", "30", 1);
+    ::setenv("HOME_ASSET", "BTC", 1);
+    auto config = load_config_from_env();
+    CHECK(config.path.empty());
+    CHECK(config.strategy.edge_threshold == 0.0015);
+    CHECK(config.strategy.max_notional == 30);
+    CHECK(config.market.home_asset == "BTC");
+    CHECK(load_symbols(config.market).size() == 3);
+
+    ::setenv("CONFIG", path.c_str(), 1);
+    config = load_config_from_env();
+    CHECK(config.path == path);
+    CHECK(config.strategy.edge_threshold == 0.0015);        // from the environment
+    CHECK(config.strategy.max_notional == 25);              // from the file
+    const auto symbols = load_symbols(config.market);
+    REQUIRE(symbols.size() == 1);
+    CHECK(symbols[0].symbol == "ETHBTC");
+
+    config.market.symbols = {"ETHBTC", "DOGEBTC"};
+    CHECK_THROWS_AS(load_symbols(config.market), std::invalid_argument);
+
+    ::setenv("EDGE_THRESHOLD", "-1", 1);
+    CHECK_THROWS_AS(load_config_from_env(), std::invalid_argument);
+
+    for (const char* name : {"EDGE_THRESHOLD", "MAX_NOTIONAL", "HOME_ASSET", "CONFIG"})
+        ::unsetenv(name);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("RcuCell frees a value once the reader has moved past it", "[config]") {
+    {
+        RcuCell<Tracked> cell(Tracked(1));
+        CHECK(cell.read().value == 1);
+
+        cell.publish(Tracked(2));
+        CHECK(cell.retired() == 1);          // the reader still holds 1
+        CHECK(Tracked::alive == 2);
+
+        CHECK(cell.read().value == 2);
+        cell.collect();
+        CHECK(cell.retired() == 0);
+        CHECK(Tracked::alive == 1);
+
+        // Values the reader never saw go as soon as it has seen a later one
+        cell.publish(Tracked(3));
+        cell.publish(Tracked(4));
+        CHECK(cell.retired() == 2);
+        CHECK(cell.read().value == 4);
+        cell.publish(Tracked(5));
+        CHECK(cell.retired() == 1);          // 4, still held
+        CHECK(Tracked::alive == 2);
+    }
+    CHECK(Tracked::alive == 0);
+}
+
+TEST_CASE("RcuCell readers see whole values while publishers replace them", "[config]") {
+    {
+        RcuCell<Tracked> cell(Tracked(0));
+        std::atomic<bool> done{false};
+        std::size_t torn = 0, changes = 0;
+
+        std::thread reader([&] {
+            int last = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                const auto& v = cell.read();
+                if (v.twice != 2 * v.value) ++torn;
+                if (v.value != last) ++changes;
+                last = v.value;
+            }
+        });
+        std::vector<std::thread> publishers;
+        for (int p = 0; p < 2; ++p)
+            publishers.emplace_back([&, p] {
+                for (int i = 1; i <= 20'000; ++i) cell.publish(Tracked(i * 2 + p));
+            });
+        for (auto& t : publishers) t.join();
+        done = true;
+        reader.join();
+
+        CHECK(torn == 0);
+        CHECK(changes > 0);
+        cell.read();
+        cell.collect();
+        CHECK(cell.retired() == 0);
+    }
+    CHECK(Tracked::alive == 0);
+}
+
+TEST_CASE("A reload changes the strategy between frames", "[config]") {
+    const auto path      = temp_path("config_reload.json");
+    const auto decisions = temp_path("config_decisions.log");
+    write_file(path, R"({"strategy": {"edge_threshold": 0.10}})");
+    ::setenv("CONFIG", path.c_str(), 1);
+
+    // USDT->ETH->BTC->USDT is worth about 5 % from the third frame on, and
+    // every ETHBTC frame after that moves it
+    std::vector<std::string> frames{
+        depth5("ethusdt@depth5@100ms", 1, "1999.00", "2000.00"),
+        depth5("btcusdt@depth5@100ms", 1, "100000.00", "100010.00"),
+        depth5("ethbtc@depth5@100ms",  1, "0.02100", "0.02110")};
+    for (int i = 0; i < 4; ++i)
+        frames.push_back(depth5("ethbtc@depth5@100ms", 2 + i,
+                                "0.021" + std::to_string(2 + i) + "0", "0.02190"));
+
+    BotOptions options;
+    options.replay = true;
+    options.decision_log = decisions;
+    boost::asio::io_context ioc;
+    std::vector<std::size_t> fired;
+    {
+        TriArbBot bot{ioc, options};
+        bot.start();
+        std::size_t next = 0;
+        auto play = [&](std::size_t n) {
+            for (; n > 0; --n, ++next)
+                bot.replay(JournalRecord{1'700'000'000'000'000'000 + next, RecordKind::Frame, {},
+                                         frames[next]});
+        };
+        auto reload = [&](const char* text) {
+            write_file(path, text);
+            REQUIRE(bot.reload_config());
+        };
+
+        play(3);                                                        // 10 %: nothing
+        reload(R"({"strategy": {"edge_threshold": 0.055}})");
+        play(1);                                                        // ~6 %: fires
+        reload(R"({"strategy": {"edge_threshold": 0, "fee_tier": "retail",
+                                "fee_tiers": {"retail": {"maker": 0.03, "taker": 0.03}}}})");
+        play(1);                                                        // fees eat it
+        reload(R"({"strategy": {"edge_threshold": 0,
+                                "triangles": ["USDT->BTC->ETH->USDT"]}})");
+        play(1);                                                        // not traded
+
+        // A bad file or a market change leaves the strategy as it was
+        write_file(path, R"({"strategy": {"triangles": ["USDT->DOGE->BTC->USDT"]}})");
+        CHECK_FALSE(bot.reload_config());
+        reload(R"({"strategy": {"edge_threshold": 0}, "market": {"home_asset": "BTC"}})");
+        CHECK(bot.config().market.home_asset == "USDT");
+        play(1);                                                        // fires
+    }
+    std::ifstream in(decisions);
+    std::stringstream log;
+    log << in.rdbuf();
+    in.close();
+
+    CHECK(count(log.str(), " FIRE USDT->ETH->BTC->USDT") == 2);
+    CHECK(count(log.str(), " FIRE ") == 2);
+
+    ::unsetenv("CONFIG");
+    std::filesystem::remove(path);
+    std::filesystem::remove(decisions);
+}
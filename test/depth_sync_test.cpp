@@ -0,0 +1,140 @@
+#include "depth_sync.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+using namespace triarb;
+
+/// Stands in for the exchange: serves the recorded snapshot on request and
+/// feeds recorded diff frames in order.
+struct StandInExchange
+{
+    OrderBook book{"ETHBTC"};
+    int       snapshot_requests = 0;
+    DepthSync sync{book, [this] { ++snapshot_requests; }};
+
+    bool feed(const std::string& msg)
+    {
+        MarketFrame f;
+        REQUIRE(parse_market_frame(msg, f));
+        REQUIRE(f.kind == FrameKind::DiffDepth);
+        return sync.on_diff(f);
+    }
+
+    void feed_diff(std::uint64_t first, std::uint64_t last,
+                   std::vector<WireLevel> bids, std::vector<WireLevel> asks)
+    {
+        MarketFrame f;
+        f.kind = FrameKind::DiffDepth;
+        f.firstUpdateId = first;
+        f.lastUpdateId  = last;
+        f.bids = std::move(bids);
+        f.asks = std::move(asks);
+        sync.on_diff(f);
+    }
+
+    void serve_snapshot(const std::string& body)
+    {
+        MarketFrame snap;
+        REQUIRE(parse_depth_snapshot(body, snap));
+        sync.on_snapshot(snap);
+    }
+};
+
+TEST_CASE("DepthSync replays recorded diffs onto the REST snapshot", "[depth]") {
+    const auto diffs = read_lines(data_file("ethbtc_depth_diffs.jsonl"));
+    REQUIRE(diffs.size() == 4);
+
+    StandInExchange ex;
+    ex.sync.start();
+    REQUIRE(ex.snapshot_requests == 1);
+
+    // Stream events keep arriving while the snapshot is in flight.
+    ex.feed(diffs[0]);
+    ex.feed(diffs[1]);
+    REQUIRE_FALSE(ex.sync.synced());
+    REQUIRE(ex.book.levels(BookSide::Bid) == 0);
+
+    ex.serve_snapshot(read_file(data_file("ethbtc_depth_snapshot.json")));
+    REQUIRE(ex.sync.synced());
+    REQUIRE(ex.book.lastUpdateId() == 8152605003ull);
+
+    ex.feed(diffs[2]);
+    ex.feed(diffs[3]);
+    REQUIRE(ex.sync.synced());
+    REQUIRE(ex.sync.resyncs() == 0);
+
+    Quote bids[8], asks[8];
+    REQUIRE(ex.book.depth(BookSide::Bid, bids) == 5);
+    REQUIRE(ex.book.depth(BookSide::Ask, asks) == 6);
+
+    REQUIRE(bids[0].px == 0.02391);  REQUIRE(bids[0].qty == 41.0);
+    REQUIRE(bids[1].px == 0.02389);
+    REQUIRE(bids[4].px == 0.02386);  REQUIRE(bids[4].qty == 12.5);
+    REQUIRE(asks[0].px == 0.023925); REQUIRE(asks[0].qty == 1.25);
+    REQUIRE(asks[1].px == 0.02393);  REQUIRE(asks[1].qty == 30.0);
+    REQUIRE(asks[5].px == 0.02397);  REQUIRE(asks[5].qty == 9.0);
+}
+
+TEST_CASE("DepthSync ignores duplicate events", "[depth]") {
+    const auto diffs = read_lines(data_file("ethbtc_depth_diffs.jsonl"));
+    StandInExchange ex;
+    ex.sync.start();
+    ex.serve_snapshot(read_file(data_file("ethbtc_depth_snapshot.json")));
+    REQUIRE(ex.feed(diffs[1]));
+    REQUIRE(ex.feed(diffs[2]));
+    REQUIRE_FALSE(ex.feed(diffs[2]));
+    REQUIRE_FALSE(ex.feed(diffs[1]));
+    REQUIRE(ex.sync.synced());
+    REQUIRE(ex.snapshot_requests == 1);
+    REQUIRE(ex.book.bestAsk().px == 0.023925);
+}
+
+TEST_CASE("DepthSync buffers one copy of each event while awaiting a snapshot", "[depth]") {
+    const auto diffs = read_lines(data_file("ethbtc_depth_diffs.jsonl"));
+    StandInExchange ex;
+    ex.sync.start();
+    for (const auto& d : {diffs[0], diffs[0], diffs[1], diffs[0], diffs[1], diffs[2]})
+        REQUIRE_FALSE(ex.feed(d));
+
+    // Copies from a second feed are not buffered again, so they cannot
+    // crowd older events out of max_buffered
+    ex.serve_snapshot(read_file(data_file("ethbtc_depth_snapshot.json")));
+    REQUIRE(ex.sync.synced());
+    REQUIRE(ex.snapshot_requests == 1);
+    REQUIRE(ex.book.bestAsk().px == 0.023925);
+}
+
+TEST_CASE("DepthSync detects a gap and resyncs", "[depth]") {
+    const auto diffs = read_lines(data_file("ethbtc_depth_diffs.jsonl"));
+    StandInExchange ex;
+    ex.sync.start();
+    ex.serve_snapshot(read_file(data_file("ethbtc_depth_snapshot.json")));
+    ex.feed(diffs[1]);
+    REQUIRE(ex.sync.synced());
+
+    // 8152605004..8152605010 never arrives.
+    ex.feed(diffs[3]);
+    REQUIRE_FALSE(ex.sync.synced());
+    REQUIRE(ex.sync.resyncs() == 1);
+    REQUIRE(ex.snapshot_requests == 2);
+    REQUIRE(ex.book.bestBid().px == 0.0);   // never trade on a broken book
+
+    ex.feed_diff(8152605016, 8152605020, {{{239, 4}, {5, 0}}}, {});
+    ex.serve_snapshot(
+        R"({"lastUpdateId":8152605017,"bids":[["0.02389000","1.00000000"]],)"
+        R"("asks":[["0.02393000","2.00000000"]]})");
+    REQUIRE(ex.sync.synced());
+    REQUIRE(ex.book.bestBid().px == 0.02390);
+    REQUIRE(ex.book.bestAsk().px == 0.02393);
+}
+
+TEST_CASE("DepthSync refetches a snapshot older than the stream", "[depth]") {
+    StandInExchange ex;
+    ex.sync.start();
+    ex.feed_diff(8152605100, 8152605105, {{{239, 4}, {5, 0}}}, {});
+    ex.serve_snapshot(read_file(data_file("ethbtc_depth_snapshot.json")));   // L = 8152605000
+    REQUIRE_FALSE(ex.sync.synced());
+    REQUIRE(ex.snapshot_requests == 2);
+}
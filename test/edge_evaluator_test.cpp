@@ -0,0 +1,162 @@
+#include "edge_evaluator.hpp"
+#include "triangle_engine.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace triarb;
+
+namespace {
+
+// Converts `amount` through one leg by filling level after level; the part
+// beyond the visible depth is lost.
+double fill_leg(const LegLevels& leg, double amount)
+{
+    double out = 0.0;
+    for (const auto& l : leg.levels) {
+        if (amount <= 0.0) break;
+        const double cap  = leg.buy ? l.px * l.qty : l.qty;
+        const double take = std::min(amount, cap);
+        out    += (1.0 - leg.fee) * (leg.buy ? take / l.px : take * l.px);
+        amount -= take;
+    }
+    return amount > 1e-12 ? 0.0 : out;
+}
+
+double cycle_profit(const std::array<LegLevels, 3>& legs, double notional)
+{
+    double x = notional;
+    for (const auto& leg : legs) x = fill_leg(leg, x);
+    return x - notional;
+}
+
+// USDT -> ETH (buy ETHUSDT) -> BTC (sell ETHBTC) -> USDT (sell BTCUSDT)
+struct Ladders {
+    std::vector<Quote> ethusdtAsks, ethbtcBids, btcusdtBids;
+
+    std::array<LegLevels, 3> legs(double taker = 0.0004, double maker = -0.0001) const
+    {
+        return {LegLevels{true,  taker, ethusdtAsks},
+                LegLevels{false, maker, ethbtcBids},
+                LegLevels{false, maker, btcusdtBids}};
+    }
+};
+
+} // namespace
+
+TEST_CASE("Ample depth sizes up to max_notional", "[edge]") {
+    Ladders b{{{2000.0, 100.0}}, {{0.0505, 100.0}}, {{40000.0, 100.0}}};
+
+    const auto s = size_triangle(b.legs(), 15.0);
+    REQUIRE(s.notional == Catch::Approx(15.0));
+    REQUIRE(s.edge > 0.0);
+    REQUIRE(s.profit == Catch::Approx(15.0 * s.edge));
+    REQUIRE(s.limitPx[0] == 2000.0);
+    REQUIRE(s.limitPx[1] == 0.0505);
+    REQUIRE(s.limitPx[2] == 40000.0);
+    REQUIRE(s.legInput[1] == Catch::Approx(15.0 / 2000.0 * (1 - 0.0004)));
+}
+
+TEST_CASE("A thin leg bounds the notional", "[edge]") {
+    // Only 0.002 ETH on the ETHBTC bid: the cycle stops there.
+    Ladders b{{{2000.0, 100.0}}, {{0.0505, 0.002}}, {{40000.0, 100.0}}};
+
+    const auto s = size_triangle(b.legs(), 1000.0);
+    REQUIRE(s.legInput[1] == Catch::Approx(0.002));
+    REQUIRE(s.notional == Catch::Approx(0.002 * 2000.0 / (1 - 0.0004)));
+    REQUIRE(s.profit == Catch::Approx(cycle_profit(b.legs(), s.notional)));
+}
+
+TEST_CASE("Deeper levels are used only while the marginal rate pays", "[edge]") {
+    Ladders b{{{2000.0, 0.01}, {2001.0, 0.01}, {2050.0, 10.0}},
+              {{0.0505, 100.0}},
+              {{40000.0, 100.0}}};
+
+    const auto s = size_triangle(b.legs(), 1e6);
+    REQUIRE(s.limitPx[0] == 2001.0);                   // 2050 no longer pays
+    REQUIRE(s.notional == Catch::Approx(0.01 * 2000.0 + 0.01 * 2001.0));
+    REQUIRE(s.profit == Catch::Approx(cycle_profit(b.legs(), s.notional)));
+}
+
+TEST_CASE("Unprofitable or empty cycles size to zero", "[edge]") {
+    Ladders loss{{{2000.0, 1.0}}, {{0.0500, 1.0}}, {{40000.0, 1.0}}};
+    auto s = size_triangle(loss.legs(), 15.0);
+    REQUIRE(s.notional == 0.0);
+    REQUIRE(s.profit == 0.0);
+    REQUIRE(s.edge < 0.0);
+
+    Ladders empty{{}, {{0.0505, 1.0}}, {{40000.0, 1.0}}};
+    s = size_triangle(empty.legs(), 15.0);
+    REQUIRE(s.notional == 0.0);
+    REQUIRE(s.edge == -1.0);
+}
+
+TEST_CASE("Sized profit matches a brute-force VWAP search", "[edge]") {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> qty(0.001, 0.05);
+    std::uniform_real_distribution<double> tick(0.0, 0.0008);
+
+    for (int round = 0; round < 50; ++round) {
+        Ladders b;
+        double ask = 2000.0, bid1 = 0.0506, bid2 = 40000.0;
+        for (std::size_t i = 0; i < kMaxLegLevels; ++i) {
+            b.ethusdtAsks.push_back({ask, qty(rng)});
+            b.ethbtcBids.push_back({bid1, qty(rng)});
+            b.btcusdtBids.push_back({bid2, qty(rng) / 20});
+            ask  *= 1 + tick(rng);
+            bid1 *= 1 - tick(rng);
+            bid2 *= 1 - tick(rng);
+        }
+        const double cap = 500.0;
+        const auto s = size_triangle(b.legs(), cap);
+
+        double best = 0.0;
+        for (int k = 1; k <= 2000; ++k)
+            best = std::max(best, cycle_profit(b.legs(), cap * k / 2000));
+
+        REQUIRE(s.notional <= cap + 1e-9);
+        REQUIRE(s.profit >= best - 1e-9);
+        REQUIRE(s.profit == Catch::Approx(cycle_profit(b.legs(), s.notional)).margin(1e-9));
+    }
+}
+
+TEST_CASE("Engine sizes a triangle from its books", "[edge]") {
+    TriangleEngine engine(default_symbols(), "USDT");
+    const auto btcusdt = *engine.find("BTCUSDT");
+    const auto ethbtc  = *engine.find("ETHBTC");
+    const auto ethusdt = *engine.find("ETHUSDT");
+
+    engine.book(btcusdt).update(1, Quote{40000.0, 1.0}, Quote{40001.0, 1.0});
+    engine.book(ethbtc).update(1, Quote{0.0505, 0.002}, Quote{0.0506, 1.0});
+    engine.book(ethusdt).update(1, Quote{1999.0, 1.0}, Quote{2000.0, 1.0});
+
+    const auto& tris = engine.triangles();
+    auto it = std::find_if(tris.begin(), tris.end(), [&](const Triangle& t) {
+        return engine.describe(t) == "USDT->ETH->BTC->USDT";
+    });
+    REQUIRE(it != tris.end());
+
+    const auto s = engine.size(*it, 1000.0);
+    REQUIRE(s.edge == Catch::Approx(engine.edge(*it)));
+    REQUIRE(s.legInput[1] == Catch::Approx(0.002));
+    REQUIRE(s.profit > 0.0);
+}
+
+TEST_CASE("size_triangle microbenchmark", "[.][benchmark][edge]") {
+    Ladders b;
+    double ask = 2000.0, bid1 = 0.0506, bid2 = 40000.0;
+    for (std::size_t i = 0; i < kMaxLegLevels; ++i) {
+        b.ethusdtAsks.push_back({ask, 0.01});
+        b.ethbtcBids.push_back({bid1, 0.01});
+        b.btcusdtBids.push_back({bid2, 0.0005});
+        ask *= 1.0001; bid1 *= 0.9999; bid2 *= 0.9999;
+    }
+    const auto legs = b.legs();
+
+    BENCHMARK("10 levels per leg") {
+        return size_triangle(legs, 1e6).profit;
+    };
+}
@@ -0,0 +1,337 @@
+#include "exchange_sim.hpp"
+#include "frame_parser.hpp"
+#include "gateway.hpp"
+#include "triarb_bot.hpp"
+#include "websocket_session.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace triarb;
+
+namespace {
+
+WireLevel level(const char* px, const char* qty)
+{
+    WireLevel l;
+    parse_fixed(px, l.px);
+    parse_fixed(qty, l.qty);
+    return l;
+}
+
+SimOptions sim_options(MakerRule rule = MakerRule::Reject)
+{
+    SimOptions options;
+    options.maker_rule = rule;
+    options.api_key    = "sim-key";
+    options.api_secret = "sim-secret";
+    options.cert_file  = data_file("standin_cert.pem");
+    options.key_file   = data_file("standin_key.pem");
+    return options;
+}
+
+GatewayOptions sim_gateway(const ExchangeSim& sim, LatencyMetrics* latency = nullptr)
+{
+    GatewayOptions options;
+    options.port      = std::to_string(sim.port());
+    options.pool_size = 1;
+    options.ca_file   = data_file("standin_cert.pem");
+    options.latency   = latency;
+    return options;
+}
+
+/// Sends one order and runs the io_context until it has answered.
+std::optional<FillReport> send(boost::asio::io_context& ioc, Gateway& gw, const char* side,
+                               double qty, double px)
+{
+    const auto scale = symbol_scale(default_symbols()[0]);
+    std::optional<FillReport> fill;
+    run_until(ioc, [&] { return gw.warm_connections() == 1; });
+    gw.send_order("BTCUSDT", side, scale.qty_near(qty), scale.price_near(px), scale,
+                  [&](FillReport r) { fill = r; });
+    run_until(ioc, [&] { return fill.has_value(); });
+    return fill;
+}
+
+// USDT->ETH->BTC->USDT is worth about 5 % before fees.  The ETHUSDT ask
+// holds 0.01 ETH, so the first leg (15 USDT, 0.0075 ETH) is the one a
+// fill ratio below 0.75 cuts short.
+void arbitrage_books(ExchangeSim& sim)
+{
+    sim.set_book("ETHUSDT", {level("1999.00", "1.0000")}, {level("2000.00", "0.0100")});
+    sim.set_book("ETHBTC",  {level("0.02100", "1.0000")}, {level("0.02110", "1.0000")});
+    sim.set_book("BTCUSDT", {level("100000.00", "1.00000")}, {level("100010.00", "1.00000")});
+}
+
+/// Runs a live bot against `sim` until `done`, with the environment
+/// pointing every connection at the simulator, and returns its decision
+/// log.  `check` sees the bot before it is stopped.
+template <class Pred, class Check>
+std::string run_bot(boost::asio::io_context& ioc, ExchangeSim& sim, Pred done, Check check)
+{
+    const auto decisions = temp_path("sim_decisions.log");
+    const auto port = std::to_string(sim.port());
+    const auto endpoint = "localhost:" + port;
+    const auto ca = data_file("standin_cert.pem");
+    ::setenv("LIVE", "1", 1);
+    ::setenv("BINANCE_API_KEY", "sim-key", 1);
+    ::setenv("BINANCE_API_SECRET", "sim-secret", 1);
+    ::setenv("FEED_ENDPOINTS", endpoint.c_str(), 1);
+    ::setenv("REST_HOST", "localhost", 1);
+    ::setenv("REST_PORT", port.c_str(), 1);
+    ::setenv("CA_FILE", ca.c_str(), 1);
+    ::setenv("METRICS_INTERVAL", "0", 1);
+    {
+        auto options = load_bot_options_from_env();
+        options.decision_log = decisions;
+        TriArbBot bot{ioc, options};
+        bot.start();
+        REQUIRE(run_until(ioc, [&] { return done(bot); }));
+        check(bot);
+    }
+    for (const char* name : {"LIVE", "BINANCE_API_KEY", "BINANCE_API_SECRET", "FEED_ENDPOINTS",
+                             "REST_HOST", "REST_PORT", "CA_FILE", "METRICS_INTERVAL"})
+        ::unsetenv(name);
+
+    std::ifstream in(decisions);
+    std::stringstream log;
+    log << in.rdbuf();
+    in.close();
+    std::filesystem::remove(decisions);
+    return log.str();
+}
+
+} // namespace
+
+TEST_CASE("The simulated book fills orders at their limit or better", "[sim]") {
+    SimBook book(symbol_scale(default_symbols()[0]));        // BTCUSDT: 0.01 tick, 0.00001 step
+    const auto& s = book.scale();
+    book.replace({level("99990.00", "0.50000")},
+                 {level("100000.00", "0.01000"), level("100001.00", "0.02000"),
+                  level("100005.00", "1.00000")});
+    CHECK(book.flush().size() == 4);
+    CHECK(book.update_id() == 2);
+
+    // Best level first, each at its own price
+    auto ex = book.match(Side::Buy, s.price_near(100001), s.qty_near(0.025), false, 1.0,
+                         MakerRule::Reject);
+    CHECK(ex.status == SimExecution::Status::Filled);
+    CHECK(ex.filled == s.qty_near(0.025));
+    REQUIRE(ex.fills.size() == 2);
+    CHECK(ex.fills[0].price == s.price_near(100000));
+    CHECK(ex.fills[0].qty == s.qty_near(0.01));
+    CHECK(ex.fills[1].qty == s.qty_near(0.015));
+    CHECK(ex.quote == Catch::Approx(0.01 * 100000 + 0.015 * 100001));
+    auto changes = book.flush();
+    REQUIRE(changes.size() == 2);
+    CHECK(changes[0].side == Side::Sell);
+    CHECK(changes[0].qty.steps == 0);                       // the 100000 level is gone
+    CHECK(changes[1].qty == s.qty_near(0.005));
+    CHECK(book.update_id() == 3);
+
+    // What is not there under the limit expires
+    ex = book.match(Side::Buy, s.price_near(100001), s.qty_near(0.01), false, 1.0,
+                    MakerRule::Reject);
+    CHECK(ex.status == SimExecution::Status::Expired);
+    CHECK(ex.filled == s.qty_near(0.005));
+    ex = book.match(Side::Sell, s.price_near(99995), s.qty_near(0.1), false, 1.0,
+                    MakerRule::Reject);
+    CHECK(ex.status == SimExecution::Status::Expired);
+    CHECK(ex.filled.steps == 0);
+    CHECK(ex.fills.empty());
+
+    // A fill ratio leaves part of each level to others
+    ex = book.match(Side::Sell, s.price_near(99990), s.qty_near(0.4), false, 0.5,
+                    MakerRule::Reject);
+    CHECK(ex.status == SimExecution::Status::Expired);
+    CHECK(ex.filled == s.qty_near(0.25));
+    CHECK(book.levels(Side::Buy, 1)[0].second == s.qty_near(0.25));
+
+    // A LIMIT_MAKER order that would take is refused, or taken, by rule
+    book.flush();
+    ex = book.match(Side::Sell, s.price_near(99990), s.qty_near(0.1), true, 1.0,
+                    MakerRule::Reject);
+    CHECK(ex.status == SimExecution::Status::Rejected);
+    CHECK(book.flush().empty());
+    ex = book.match(Side::Sell, s.price_near(99995), s.qty_near(0.1), true, 1.0,
+                    MakerRule::Reject);
+    CHECK(ex.status == SimExecution::Status::Expired);
+    ex = book.match(Side::Sell, s.price_near(99990), s.qty_near(0.1), true, 1.0,
+                    MakerRule::Take);
+    CHECK(ex.status == SimExecution::Status::Filled);
+
+    // A ticker update moves the top and clears what was better
+    book.set_top(level("99980.00", "1.00000"), level("100002.00", "2.00000"));
+    CHECK(book.levels(Side::Buy, 5).size() == 1);
+    const auto asks = book.levels(Side::Sell, 5);
+    REQUIRE(asks.size() == 2);
+    CHECK(asks[0].first == s.price_near(100002));
+    CHECK(asks[1].first == s.price_near(100005));
+}
+
+TEST_CASE("Simulated order entry checks orders as the exchange does", "[sim]") {
+    boost::asio::io_context ioc;
+    ExchangeSim strict(ioc, default_symbols(), sim_options());
+    ExchangeSim taking(ioc, default_symbols(), sim_options(MakerRule::Take));
+    for (auto* sim : {&strict, &taking})
+        sim->set_book("BTCUSDT", {level("99990.00", "1.00000")}, {level("100000.00", "0.00200")});
+
+    // The bot's LIMIT_MAKER orders take liquidity, which Binance refuses
+    LatencyMetrics metrics;
+    Gateway gw(ioc, "localhost", {"sim-key", "sim-secret"}, true, sim_gateway(strict, &metrics));
+    auto fill = send(ioc, gw, "BUY", 0.001, 100000);
+    REQUIRE(fill);
+    CHECK_FALSE(fill->success);
+    CHECK(strict.orders().back().code == -2010);
+    fill = send(ioc, gw, "BUY", 0.001, 99995);
+    REQUIRE(fill);
+    CHECK_FALSE(fill->success);
+    CHECK(strict.orders().back().status == SimExecution::Status::Expired);
+    CHECK(metrics[Span::OrderRtt].count() == 2);
+
+    // Taken, the order fills what the level holds and the rest expires
+    Gateway taker(ioc, "localhost", {"sim-key", "sim-secret"}, true, sim_gateway(taking));
+    fill = send(ioc, taker, "BUY", 0.003, 100000);
+    REQUIRE(fill);
+    CHECK(fill->success);
+    CHECK(fill->qty_filled == Catch::Approx(0.002));
+    CHECK(fill->price_avg == Catch::Approx(100000));
+    CHECK(taking.orders().back().status == SimExecution::Status::Expired);
+    CHECK(taking.book("BTCUSDT").levels(Side::Sell, 5).empty());
+
+    // Wrong keys never reach the book
+    Gateway forger(ioc, "localhost", {"sim-key", "guessed"}, true, sim_gateway(taking));
+    CHECK_FALSE(send(ioc, forger, "SELL", 0.001, 99990)->success);
+    CHECK(taking.orders().back().code == -1022);
+    Gateway stranger(ioc, "localhost", {"other-key", "sim-secret"}, true, sim_gateway(taking));
+    CHECK_FALSE(send(ioc, stranger, "SELL", 0.001, 99990)->success);
+    CHECK(taking.orders().back().code == -2015);
+    CHECK(taking.book("BTCUSDT").levels(Side::Buy, 1)[0].second.steps == 100000);
+
+    // REST snapshots carry the id of the book they show
+    std::optional<std::string> body;
+    gw.fetch_depth("BTCUSDT", 5, [&](bool ok, std::string b) { if (ok) body = std::move(b); });
+    REQUIRE(run_until(ioc, [&] { return body.has_value(); }));
+    MarketFrame snapshot;
+    REQUIRE(parse_depth_snapshot(*body, snapshot));
+    CHECK(snapshot.lastUpdateId == strict.book("BTCUSDT").update_id());
+    CHECK(snapshot.bids.size() == 1);
+    CHECK(snapshot.asks.size() == 1);
+
+    std::ostringstream report;
+    taking.report(report);
+    CHECK(report.str().find("3 orders: 0 filled, 1 partly filled, 0 expired, 2 rejected") !=
+          std::string::npos);
+}
+
+TEST_CASE("Simulated market data follows the book, network latency later", "[sim]") {
+    boost::asio::io_context ioc;
+    auto options = sim_options();
+    options.network_latency = std::chrono::milliseconds(20);
+    ExchangeSim sim(ioc, default_symbols(), options);
+    sim.set_book("BTCUSDT", {level("99990.00", "1.00000")}, {level("100000.00", "0.50000")});
+
+    std::vector<std::pair<std::string, std::uint64_t>> frames;
+    WebsocketSession session(ioc, "localhost", std::to_string(sim.port()),
+        "/stream?streams=btcusdt@depth5@100ms/btcusdt@bookTicker/btcusdt@depth@100ms/dogebtc@depth",
+        [&frames](std::string_view msg, std::uint64_t read_ns, std::uint64_t) {
+            frames.emplace_back(std::string(msg), read_ns);
+        });
+    session.add_ca_file(data_file("standin_cert.pem"));
+    session.run();
+
+    // A new subscriber gets the partial depth and the ticker at once
+    REQUIRE(run_until(ioc, [&] { return frames.size() == 2; }));
+    MarketFrame frame;
+    REQUIRE(parse_market_frame(frames[0].first, frame));
+    CHECK(frame.kind == FrameKind::PartialDepth);
+    CHECK(frame.lastUpdateId == sim.book("BTCUSDT").update_id());
+    BookTickerFrame ticker;
+    REQUIRE(parse_book_ticker(frames[1].first, ticker));
+    CHECK(ticker.ask.px == level("100000.00", "0").px);
+
+    // A change goes to all three streams; the diff carries just the change
+    const auto& s = sim.book("BTCUSDT").scale();
+    sim.book("BTCUSDT").set(Side::Sell, s.price_near(99995), s.qty_near(0.1));
+    const auto published = now_ns();
+    sim.publish("BTCUSDT");
+    REQUIRE(run_until(ioc, [&] { return frames.size() == 5; }));
+    CHECK(frames[2].second - published >= 20'000'000);
+    REQUIRE(parse_market_frame(frames[4].first, frame));
+    CHECK(frame.kind == FrameKind::DiffDepth);
+    CHECK(frame.firstUpdateId == frame.lastUpdateId);
+    CHECK(frame.bids.empty());
+    REQUIRE(frame.asks.size() == 1);
+    CHECK(frame.asks[0].px == level("99995.00", "0").px);
+    REQUIRE(parse_book_ticker(frames[3].first, ticker));
+    CHECK(ticker.ask.px == level("99995.00", "0").px);
+
+    // Recorded frames drive the books the same way
+    CHECK(sim.apply_frame(R"({"stream":"btcusdt@bookTicker","data":{"u":400,"s":"BTCUSDT",)"
+                          R"("b":"99991.00","B":"2.00000","a":"99994.00","A":"1.00000"}})"));
+    CHECK(sim.book("BTCUSDT").levels(Side::Sell, 1)[0].first == s.price_near(99994));
+    CHECK_FALSE(sim.apply_frame(R"({"stream":"dogebtc@depth5","data":{"lastUpdateId":1,)"
+                                R"("bids":[],"asks":[]}})"));
+    REQUIRE(run_until(ioc, [&] { return frames.size() == 8; }));
+    session.close();
+}
+
+TEST_CASE("The bot trades a triangle end to end against the simulator", "[sim]") {
+    boost::asio::io_context ioc;
+    auto options = sim_options(MakerRule::Take);
+    options.network_latency  = std::chrono::milliseconds(2);
+    options.matching_latency = std::chrono::milliseconds(1);
+    options.fill_ratio       = 0.5;
+    ExchangeSim sim(ioc, default_symbols(), options);
+    arbitrage_books(sim);
+
+    const auto log = run_bot(ioc, sim,
+        [](const TriArbBot& bot) { return bot.latency()[Span::OrderRtt].count() == 3; },
+        [](const TriArbBot& bot) {
+            CHECK(bot.latency()[Span::TickToTrade].count() == 1);
+            // Two network legs and the match, on every order
+            CHECK(bot.latency()[Span::OrderRtt].percentile(0.0) >= 5'000'000);
+        });
+
+    CHECK(count(log, " FIRE USDT->ETH->BTC->USDT") == 1);
+    CHECK(count(log, " ORDER ") == 3);
+    CHECK(count(log, " FILL ") == 3);
+    CHECK(log.find("FILL 0 ETHUSDT 0.005 @ 2000") != std::string::npos);   // half the level
+    CHECK(log.find("ORDER 1 ETHBTC SELL 0.0050 @ ") != std::string::npos);  // spends the fill
+
+    REQUIRE(sim.orders().size() == 3);
+    CHECK(sim.orders()[0].status == SimExecution::Status::Expired);
+    CHECK(sim.orders()[0].filled == Catch::Approx(0.005));
+    CHECK(sim.orders()[1].status == SimExecution::Status::Filled);
+    CHECK(sim.orders()[2].status == SimExecution::Status::Filled);
+    std::ostringstream report;
+    sim.report(report);
+    CHECK(report.str().find("3 orders: 2 filled, 1 partly filled") != std::string::npos);
+}
+
+TEST_CASE("Under the exchange's maker rule the first leg is refused", "[sim]") {
+    boost::asio::io_context ioc;
+    ExchangeSim sim(ioc, default_symbols(), sim_options());
+    arbitrage_books(sim);
+
+    const auto log = run_bot(ioc, sim,
+        [&](const TriArbBot&) { return !sim.orders().empty(); },
+        [&](const TriArbBot& bot) {
+            REQUIRE(run_until(ioc, [&] { return bot.latency()[Span::OrderRtt].count() == 1; }));
+        });
+
+    CHECK(count(log, " FIRE ") == 1);
+    CHECK(count(log, " ORDER ") == 1);
+    CHECK(count(log, " FILL ") == 0);
+    REQUIRE(sim.orders().size() == 1);
+    CHECK(sim.orders()[0].code == -2010);
+    CHECK(sim.book("ETHUSDT").levels(Side::Sell, 1)[0].second == sim.book("ETHUSDT").scale().qty_near(0.01));
+}
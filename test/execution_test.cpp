@@ -0,0 +1,220 @@
+#include "allocation_counter.hpp"
+#include "exchange_sim.hpp"
+#include "gateway.hpp"
+#include "object_pool.hpp"
+#include "recycling_allocator.hpp"
+#include "triarb_bot.hpp"
+#include "test_support.hpp"
+#include "ws_api_standin.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <boost/asio.hpp>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace triarb;
+
+TEST_CASE("ObjectPool hands out each slot once", "[execution]") {
+    ObjectPool<int> pool(3);
+    CHECK(pool.capacity() == 3);
+
+    const auto a = pool.acquire();
+    const auto b = pool.acquire();
+    const auto c = pool.acquire();
+    CHECK(a == 0);
+    CHECK(b == 1);
+    CHECK(c == 2);
+    CHECK(pool.acquire() == ObjectPool<int>::kNone);
+    CHECK(pool.in_use() == 3);
+
+    pool[b] = 42;
+    const auto before = thread_allocations();
+    pool.release(b);
+    const auto again = pool.acquire();
+    CHECK(thread_allocations() == before);
+    CHECK(again == b);
+    CHECK(pool[again] == 42);              // kept until overwritten
+
+    pool.release(a);
+    pool.release(c);
+    pool.release(again);
+    CHECK(pool.in_use() == 0);
+}
+
+TEST_CASE("RecyclingAllocator reuses freed blocks", "[execution]") {
+    RecyclingAllocator<char> alloc;
+    char* a = alloc.allocate(100);
+    alloc.deallocate(a, 100);
+
+    const auto before = thread_allocations();
+    char* b = alloc.allocate(120);         // same 64-byte class
+    CHECK(b == a);
+    CHECK(thread_allocations() == before);
+    alloc.deallocate(b, 120);
+
+    char* big = alloc.allocate(10'000);    // past the largest class
+    CHECK(thread_allocations() == before + 1);
+    alloc.deallocate(big, 10'000);
+
+    // Asio takes the operation state from the handler's allocator
+    auto handler = recycling([] {});
+    STATIC_REQUIRE(std::is_same_v<boost::asio::associated_allocator_t<decltype(handler)>,
+                                  RecyclingAllocator<void>>);
+
+    boost::asio::io_context ioc;
+    std::array<char, 512> payload{};
+    std::size_t runs = 0;
+    auto post = [&] {
+        boost::asio::post(ioc, recycling([&runs, payload] { runs += payload.size(); }));
+        ioc.run();
+        ioc.restart();
+    };
+    post();
+    const auto warm = thread_allocations();
+    for (int i = 0; i < 10; ++i) post();
+    CHECK(thread_allocations() == warm);
+    CHECK(runs == 11 * payload.size());
+}
+
+TEST_CASE("A triangle allocates nothing from FIRE to its last fill", "[execution]") {
+    // USDT->ETH->BTC->USDT is worth about 6 %, and every ETHBTC frame after
+    // the third moves it and fires it again
+    std::vector<std::string> frames{depth5("ethusdt@depth5@100ms", 1, "1999.00", "2000.00"),
+                                    depth5("btcusdt@depth5@100ms", 1, "100000.00", "100010.00"),
+                                    depth5("ethbtc@depth5@100ms",  1, "0.02100", "0.02190")};
+    for (int i = 0; i < 24; ++i)
+        frames.push_back(depth5("ethbtc@depth5@100ms", 2 + i,
+                                "0.021" + std::to_string(20 + i) + "0", "0.02190"));
+
+    for (const auto execution : {ExecutionMode::Sequential, ExecutionMode::Concurrent}) {
+        INFO((execution == ExecutionMode::Sequential ? "sequential" : "concurrent"));
+        const auto decisions = temp_path("execution_decisions.log");
+        BotOptions options;
+        options.replay       = true;
+        options.decision_log = decisions;
+        options.execution    = execution;
+        if (execution == ExecutionMode::Concurrent)
+            options.inventory = {{{"USDT", 1000}, {"ETH", 1}, {"BTC", 0.1}}, 0.25,
+                                 std::chrono::seconds(0)};
+
+        boost::asio::io_context ioc;
+        std::uint64_t allocations = 0;
+        {
+            TriArbBot bot{ioc, options};
+            bot.start();
+            std::uint64_t ts = 1'700'000'000'000'000'000;
+            auto play = [&](std::size_t from, std::size_t to) {
+                for (std::size_t i = from; i < to; ++i)
+                    bot.replay(JournalRecord{ts += 1'000'000, RecordKind::Frame, {}, frames[i]});
+            };
+
+            play(0, 5);                    // books, and two triangles to warm up
+            const auto before = thread_allocations();
+            play(5, frames.size());
+            allocations = thread_allocations() - before;
+        }
+        CHECK(allocations == 0);
+
+        // Every frame from the third on fired a whole triangle
+        const auto fires = frames.size() - 2;
+        CHECK(count_lines(decisions, " FIRE ") == fires);
+        CHECK(count_lines(decisions, " ORDER ") == 3 * fires);
+        CHECK(count_lines(decisions, " FILL ") == 3 * fires);
+        std::filesystem::remove(decisions);
+    }
+}
+
+TEST_CASE("Orders on a warm REST connection allocate nothing", "[execution]") {
+    // The exchange runs on its own thread, so only the gateway's
+    // allocations count here
+    SimOptions sim_options;
+    sim_options.maker_rule = MakerRule::Take;
+    sim_options.api_key    = "sim-key";
+    sim_options.api_secret = "sim-secret";
+    sim_options.cert_file  = data_file("standin_cert.pem");
+    sim_options.key_file   = data_file("standin_key.pem");
+
+    boost::asio::io_context sim_ioc;
+    auto guard = boost::asio::make_work_guard(sim_ioc);
+    ExchangeSim sim(sim_ioc, default_symbols(), sim_options);
+    auto& book = sim.book("BTCUSDT");
+    book.set(Side::Buy,  book.scale().price_near(99990.0),  book.scale().qty_near(100.0));
+    book.set(Side::Sell, book.scale().price_near(100000.0), book.scale().qty_near(100.0));
+    std::thread exchange([&] { sim_ioc.run(); });
+
+    std::size_t filled = 0;
+    std::uint64_t allocations = 0;
+    {
+        boost::asio::io_context ioc;
+        GatewayOptions options;
+        options.port      = std::to_string(sim.port());
+        options.pool_size = 1;
+        options.ca_file   = data_file("standin_cert.pem");
+        Gateway gw(ioc, "localhost", {"sim-key", "sim-secret"}, true, options);
+        REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 1; }));
+
+        const auto& scale = book.scale();
+        auto order = [&] {
+            const auto target = filled + 1;
+            gw.send_order("BTCUSDT", "BUY", scale.qty_near(0.001), scale.price_near(100000.0),
+                          scale, [&filled](FillReport rep) { filled += rep.success; });
+            return run_until(ioc, [&] { return filled == target; });
+        };
+
+        for (int i = 0; i < 3; ++i) REQUIRE(order());
+        const auto before = thread_allocations();
+        for (int i = 0; i < 20; ++i) REQUIRE(order());
+        allocations = thread_allocations() - before;
+    }
+    guard.reset();
+    sim_ioc.stop();
+    exchange.join();
+
+    CHECK(filled == 23);
+    CHECK(allocations == 0);
+}
+
+TEST_CASE("Orders on a warm WebSocket API session allocate nothing", "[execution]") {
+    // The stand-in runs on its own thread, as the simulator does above
+    boost::asio::io_context server_ioc;
+    auto guard = boost::asio::make_work_guard(server_ioc);
+    WsApiStandIn standin(server_ioc);
+    std::thread server([&] { server_ioc.run(); });
+
+    const SymbolScale scale{{1, 2}, {1, 5}};       // BTCUSDT
+    std::size_t filled = 0;
+    std::uint64_t allocations = 0;
+    {
+        boost::asio::io_context ioc;
+        GatewayOptions options;
+        options.transport = OrderTransport::WebSocket;
+        options.ws_host   = "localhost";
+        options.ws_port   = standin.port();
+        options.ca_file   = data_file("standin_cert.pem");
+        Gateway gw(ioc, "localhost", {"key", "secret"}, true, options);
+        REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 1; }));
+
+        auto order = [&] {
+            const auto target = filled + 1;
+            gw.send_order("BTCUSDT", "BUY", scale.qty_near(0.001), scale.price_near(100000.0),
+                          scale, [&filled](FillReport rep) { filled += rep.success; });
+            return run_until(ioc, [&] { return filled == target; });
+        };
+
+        // Request ids are in the frame, so the write buffers grow once
+        // more when they reach two digits
+        for (int i = 0; i < 10; ++i) REQUIRE(order());
+        const auto before = thread_allocations();
+        for (int i = 0; i < 20; ++i) REQUIRE(order());
+        allocations = thread_allocations() - before;
+    }
+    guard.reset();
+    server_ioc.stop();
+    server.join();
+
+    CHECK(filled == 30);
+    CHECK(allocations == 0);
+}
@@ -0,0 +1,524 @@
+#include "feed_set.hpp"
+#include "frame_parser.hpp"
+#include "orderbook.hpp"
+#include "replay.hpp"
+#include "test_support.hpp"
+#include "tls_standin.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <openssl/ssl.h>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace triarb;
+
+namespace beast = boost::beast;
+namespace http  = beast::http;
+namespace ssl   = boost::asio::ssl;
+namespace ws    = beast::websocket;
+using tcp       = boost::asio::ip::tcp;
+
+namespace {
+
+/*
+ * Local WSS server in place of the market data stream.  It accepts any
+ * number of sessions, remembers the target each one asked for, and sends
+ * broadcast() frames to every open session.  With `compression` set it
+ * accepts permessage-deflate; `wire_bytes` counts the TLS records sent.
+ */
+class StreamStandIn
+{
+    public:
+        explicit StreamStandIn(boost::asio::io_context& ioc)
+            : server_(ioc, [this](tcp::socket socket, ssl::context& ctx) {
+                  return std::make_shared<Session>(*this, std::move(socket), ctx);
+              })
+        {}
+
+        std::string port() const { return server_.port(); }
+        int connections() const { return server_.connections(); }
+
+        void broadcast(const std::string& text)
+        {
+            server_.for_each([&](Session& s) { if (s.open) s.write(text); });
+        }
+
+        std::size_t open_sessions() const
+        {
+            std::size_t n = 0;
+            server_.for_each([&](const Session& s) { n += s.open; });
+            return n;
+        }
+
+        std::vector<std::string> targets;   // requested by each handshake
+        bool                     compression = false;
+        std::uint64_t            wire_bytes  = 0;
+
+    private:
+        struct Session : WsStandInSession<Session> {
+            Session(StreamStandIn& owner, tcp::socket socket, ssl::context& ctx)
+                : WsStandInSession(std::move(socket), ctx), owner(owner) {}
+
+            void on_upgrade()
+            {
+                owner.targets.emplace_back(request.target());
+                ws::permessage_deflate deflate;
+                deflate.server_enable = owner.compression;
+                stream.set_option(deflate);
+            }
+            void on_open()
+            {
+                open = true;
+                read();
+            }
+            void on_written()
+            {
+                const auto total = BIO_number_written(SSL_get_wbio(stream.next_layer().native_handle()));
+                owner.wire_bytes += total - written;
+                written = total;
+            }
+            // Holds the session alive and notices when the client goes
+            void read()
+            {
+                stream.async_read(buffer, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                    if (ec) { self->open = false; return; }
+                    self->buffer.consume(self->buffer.size());
+                    self->read();
+                });
+            }
+
+            StreamStandIn& owner;
+            std::uint64_t  written = 0;   // by the TLS layer
+            bool           open = false;
+        };
+
+        TlsServer<Session> server_;
+};
+
+FeedOptions standin_feeds(const StreamStandIn& standin, std::size_t connections)
+{
+    FeedOptions options;
+    options.connections = connections;
+    options.endpoints   = {{"localhost", standin.port()}};
+    options.retry_delay = std::chrono::milliseconds(20);
+    options.ca_file     = data_file("standin_cert.pem");
+    return options;
+}
+
+std::vector<std::string> captured_frames()
+{
+    std::ifstream in(data_file("frames.jsonl"));
+    std::vector<std::string> frames;
+    for (std::string line; std::getline(in, line);)
+        if (!line.empty()) frames.push_back(line);
+    return frames;
+}
+
+std::string book_ticker(const char* stream, std::uint64_t id, const std::string& bid,
+                        const std::string& ask)
+{
+    std::string symbol(stream, std::string_view(stream).find('@'));
+    for (auto& c : symbol) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return std::string(R"({"stream":")") + stream + R"(","data":{"u":)" + std::to_string(id) +
+           R"(,"s":")" + symbol + R"(","b":")" + bid + R"(","B":"1.00000000","a":")" + ask +
+           R"(","A":"1.00000000"}})";
+}
+
+/// Replays `frames` through a bot, each journaled `copies` times as that
+/// many feeds would deliver it, and returns the decision log.  Copies share
+/// a receive time, so the logs of two runs compare equal.  `check` sees the
+/// bot once the replay is done.
+std::string replay_decisions(const std::vector<std::string>& frames, std::size_t copies = 1,
+                             const std::function<void(const TriArbBot&)>& check = {})
+{
+    const auto journal   = temp_path("feed_journal.bin");
+    const auto decisions = temp_path("feed_decisions.log");
+    {
+        JournalWriter w(journal);
+        std::uint64_t ts = 1'700'000'000'000'000'000;
+        for (const auto& f : frames) {
+            ts += 1'000'000;
+            for (std::size_t c = 0; c < copies; ++c) w.append(RecordKind::Frame, {}, f, ts);
+        }
+    }
+    BotOptions options;
+    options.replay = true;
+    options.decision_log = decisions;
+    boost::asio::io_context ioc;
+    {
+        TriArbBot bot{ioc, options};
+        bot.start();
+        JournalReader r(journal);
+        REQUIRE(replay_journal(bot, ioc, r, 0.0) == frames.size() * copies);
+        if (check) check(bot);
+    }
+    std::ifstream in(decisions);
+    std::stringstream lines;
+    lines << in.rdbuf();
+    in.close();
+    std::filesystem::remove(journal);
+    std::filesystem::remove(decisions);
+    return lines.str();
+}
+
+struct Received {
+    std::size_t feed;
+    std::string text;
+};
+
+} // namespace
+
+TEST_CASE("Feed options come from the environment", "[feed]") {
+    ::setenv("FEED_CONNECTIONS", "3", 1);
+    ::setenv("FEED_ENDPOINTS", "stream.binance.com:9443,stream.binance.com:443", 1);
+    ::setenv("FEED_STALL_TIMEOUT", "2500", 1);
+    auto options = load_feed_options_from_env();
+    CHECK(options.connections == 3);
+    REQUIRE(options.endpoints.size() == 2);
+    CHECK(options.endpoints[1].host == "stream.binance.com");
+    CHECK(options.endpoints[1].port == "443");
+    CHECK(options.stall_timeout.count() == 2500);
+
+    for (const char* bad : {"stream.binance.com", ":9443", "host:", "a:1,", ""}) {
+        ::setenv("FEED_ENDPOINTS", bad, 1);
+        CHECK_THROWS_AS(load_feed_options_from_env(), std::invalid_argument);
+    }
+    ::setenv("FEED_ENDPOINTS", "a:1", 1);
+    ::setenv("FEED_CONNECTIONS", "0", 1);
+    CHECK_THROWS_AS(load_feed_options_from_env(), std::invalid_argument);
+
+    for (const char* name : {"FEED_CONNECTIONS", "FEED_ENDPOINTS", "FEED_STALL_TIMEOUT"})
+        ::unsetenv(name);
+    options = load_feed_options_from_env();
+    CHECK(options.connections == 1);
+    REQUIRE(options.endpoints.size() == 1);
+    CHECK(options.endpoints[0].port == "9443");
+    CHECK_FALSE(options.session.compression);
+
+    ::setenv("WS_COMPRESSION", "true", 1);
+    ::setenv("WS_READ_BUFFER", "4096", 1);
+    options = load_feed_options_from_env();
+    CHECK(options.session.compression);
+    CHECK(options.session.read_buffer == 4096);
+    ::unsetenv("WS_COMPRESSION");
+    ::unsetenv("WS_READ_BUFFER");
+}
+
+TEST_CASE("Frames arrive intact with and without compression", "[feed]") {
+    const auto frames = captured_frames();
+    REQUIRE(frames.size() > 5);
+
+    auto deliver = [&](bool compression) {
+        boost::asio::io_context ioc;
+        StreamStandIn standin(ioc);
+        standin.compression = compression;
+        auto options = standin_feeds(standin, 1);
+        options.session.compression = compression;
+        options.session.read_buffer = 512;   // smaller than a frame: the buffer grows
+        std::vector<std::string> got;
+        FeedSet feeds(ioc, options, "/stream?streams=btcusdt@depth5@100ms",
+                      [&](std::size_t, std::string_view msg, std::uint64_t, std::uint64_t) {
+                          got.emplace_back(msg);
+                      });
+        feeds.start();
+        REQUIRE(run_until(ioc, [&] { return standin.open_sessions() == 1; }));
+        for (int round = 0; round < 20; ++round)
+            for (const auto& f : frames) standin.broadcast(f);
+        REQUIRE(run_until(ioc, [&] { return got.size() == 20 * frames.size(); }));
+        for (std::size_t i = 0; i < got.size(); ++i)
+            REQUIRE(got[i] == frames[i % frames.size()]);
+        return standin.wire_bytes;
+    };
+
+    const auto plain    = deliver(false);
+    const auto deflated = deliver(true);
+    // Depth frames repeat much of their text from one to the next
+    CHECK(deflated * 4 < plain * 3);
+}
+
+TEST_CASE("The arbiter credits the first copy of each update", "[feed]") {
+    FeedArbiter arbiter(2, 3);
+    using A = FeedArbiter::Arrival;
+
+    CHECK(arbiter.observe(0, 1, 100, 1'000) == A::First);
+    CHECK(arbiter.observe(1, 1, 100, 1'400) == A::Duplicate);
+    CHECK(arbiter.observe(1, 1, 101, 2'000) == A::First);
+    CHECK(arbiter.observe(0, 1, 101, 2'900) == A::Duplicate);
+    CHECK(arbiter.observe(0, 1, 100, 3'000) == A::Stale);
+    // Each symbol keeps its own sequence
+    CHECK(arbiter.observe(0, 2, 7, 3'100) == A::First);
+
+    CHECK(arbiter.first(0) == 2);
+    CHECK(arbiter.duplicate(0) == 1);
+    CHECK(arbiter.stale(0) == 1);
+    CHECK(arbiter.first(1) == 1);
+    CHECK(arbiter.duplicate(1) == 1);
+    CHECK(arbiter.lag(1).count() == 1);
+    CHECK(arbiter.lag(1).percentile(0.5) >= 400);
+    CHECK(arbiter.lag(0).percentile(0.5) >= 900);
+
+    std::ostringstream report;
+    arbiter.report(report);
+    CHECK(report.str().find("[LEAD] 0") != std::string::npos);
+    CHECK(report.str().find("[LEAD] 1") != std::string::npos);
+}
+
+TEST_CASE("A dropped feed reconnects while the other keeps the data flowing", "[feed]") {
+    boost::asio::io_context ioc;
+    StreamStandIn standin(ioc);
+    std::vector<Received> got;
+    FeedSet feeds(ioc, standin_feeds(standin, 2), "/stream?streams=ethbtc@depth5@100ms",
+                  [&](std::size_t feed, std::string_view msg, std::uint64_t, std::uint64_t) {
+                      got.push_back({feed, std::string(msg)});
+                  });
+    REQUIRE(feeds.size() == 2);
+    feeds.start();
+    REQUIRE(run_until(ioc, [&] { return feeds.open(0) && feeds.open(1) && standin.open_sessions() == 2; }));
+
+    standin.broadcast("one");
+    REQUIRE(run_until(ioc, [&] { return got.size() == 2; }));
+    CHECK(feeds.frames(0) == 1);
+    CHECK(feeds.frames(1) == 1);
+
+    // Broadcast while feed 0 is still on its way back
+    feeds.drop(0);
+    REQUIRE(run_until(ioc, [&] { return feeds.reconnects(0) == 1; }));
+    CHECK_FALSE(feeds.open(0));
+    standin.broadcast("two");
+    REQUIRE(run_until(ioc, [&] { return got.size() == 3; }));
+    CHECK(got[2].feed == 1);
+    CHECK(got[2].text == "two");
+
+    // Back with the same subscription
+    REQUIRE(run_until(ioc, [&] { return feeds.open(0) && standin.open_sessions() == 2; }));
+    CHECK(feeds.drops(0) == 1);
+    CHECK(feeds.reconnects(0) == 1);
+    CHECK(feeds.reconnects(1) == 0);
+    REQUIRE(standin.targets.size() == 3);
+    CHECK(standin.targets[2] == standin.targets[0]);
+
+    standin.broadcast("three");
+    REQUIRE(run_until(ioc, [&] { return got.size() == 5; }));
+    CHECK(feeds.frames(0) == 2);
+
+    std::ostringstream report;
+    feeds.report(report);
+    CHECK(report.str().find("[FEED] 0  localhost:" + standin.port()) != std::string::npos);
+}
+
+TEST_CASE("A silent feed is dropped and reconnected", "[feed]") {
+    boost::asio::io_context ioc;
+    StreamStandIn standin(ioc);
+    auto options = standin_feeds(standin, 1);
+    options.stall_timeout = std::chrono::milliseconds(200);
+    FeedSet feeds(ioc, options, "/stream?streams=ethbtc@depth5@100ms",
+                  [](std::size_t, std::string_view, std::uint64_t, std::uint64_t) {});
+    feeds.start();
+    REQUIRE(run_until(ioc, [&] { return feeds.open(0); }));
+
+    REQUIRE(run_until(ioc, [&] { return feeds.reconnects(0) == 1 && feeds.open(0); }));
+    CHECK(feeds.drops(0) == 1);
+    CHECK(standin.connections() == 2);
+}
+
+TEST_CASE("Duplicate frames from a second feed change nothing downstream", "[feed]") {
+    const std::vector<std::string> frames{
+        depth5("ethusdt@depth5@100ms", 1, "1999.00", "2000.00"),
+        depth5("ethbtc@depth5@100ms",  1, "0.02100", "0.02110"),
+        depth5("btcusdt@depth5@100ms", 1, "100000.00", "100010.00"),
+        depth5("ethbtc@depth5@100ms",  2, "0.02120", "0.02130")};
+
+    const auto once = replay_decisions(frames);
+    CHECK(once.find(" FIRE ") != std::string::npos);
+    CHECK(replay_decisions(frames, 2, [&](const TriArbBot& bot) {
+        CHECK(bot.arbiter().first(0) == frames.size());
+        CHECK(bot.arbiter().duplicate(0) == frames.size());
+    }) == once);
+}
+
+TEST_CASE("Feed modes: bookTicker alone or alongside depth", "[feed]") {
+    // One level per side: depth5 and bookTicker carry the same book
+    const std::vector<std::pair<const char*, std::array<const char*, 2>>> quotes{
+        {"ethusdt", {"1999.00", "2000.00"}},
+        {"ethbtc",  {"0.02100", "0.02110"}},
+        {"btcusdt", {"100000.00", "100010.00"}},
+        {"ethbtc",  {"0.02120", "0.02130"}}};
+    std::vector<std::string> depth, tickers;
+    std::uint64_t id = 0;
+    for (const auto& [symbol, q] : quotes) {
+        ++id;
+        depth.push_back(depth5((std::string(symbol) + "@depth5@100ms").c_str(), id, q[0], q[1]));
+        tickers.push_back(book_ticker((std::string(symbol) + "@bookTicker").c_str(), id, q[0], q[1]));
+    }
+    const auto from_depth = replay_decisions(depth);
+    REQUIRE(from_depth.find(" FIRE ") != std::string::npos);
+
+    ::setenv("DEPTH_FEED", "none", 1);
+    ::setenv("BOOK_TICKER", "1", 1);
+    CHECK(replay_decisions(tickers) == from_depth);
+
+    // Alongside depth5, a ticker older than the snapshot is ignored and a
+    // newer one moves the top
+    ::setenv("DEPTH_FEED", "partial", 1);
+    const std::vector<std::string> calm{
+        depth5("ethusdt@depth5@100ms", 10, "1999.00", "2000.00"),
+        depth5("ethbtc@depth5@100ms",  10, "0.01990", "0.02010"),
+        depth5("btcusdt@depth5@100ms", 10, "99990.00", "100010.00")};
+    auto mixed = calm;
+    mixed.push_back(book_ticker("ethbtc@bookTicker", 9, "0.02100", "0.02110"));
+    CHECK(replay_decisions(calm).find(" FIRE ") == std::string::npos);
+    CHECK(replay_decisions(mixed).find(" FIRE ") == std::string::npos);
+    mixed.push_back(book_ticker("ethbtc@bookTicker", 11, "0.02100", "0.02110"));
+    CHECK(replay_decisions(mixed).find(" FIRE ") != std::string::npos);
+
+    // A ticker cannot share a book with diff depth, and no feed at all
+    // leaves nothing to trade on
+    boost::asio::io_context ioc;
+    BotOptions options;
+    options.replay = true;
+    ::setenv("DEPTH_FEED", "diff", 1);
+    CHECK_THROWS_AS(TriArbBot(ioc, options), std::invalid_argument);
+    ::setenv("DEPTH_FEED", "none", 1);
+    ::unsetenv("BOOK_TICKER");
+    CHECK_THROWS_AS(TriArbBot(ioc, options), std::invalid_argument);
+    ::unsetenv("DEPTH_FEED");
+}
+
+TEST_CASE("Market data delivery, compressed vs plain", "[.][benchmark][feed]") {
+    const auto frames = captured_frames();
+    constexpr std::size_t kRounds = 2000;
+
+    // A burst of frames per round, timed from the first write to the last
+    // frame handed over; both ends of the loopback run on this thread, so
+    // the time includes deflating as well as inflating.
+    auto measure = [&](bool compression, std::size_t read_buffer) {
+        boost::asio::io_context ioc;
+        StreamStandIn standin(ioc);
+        standin.compression = compression;
+        auto options = standin_feeds(standin, 1);
+        options.session.compression = compression;
+        options.session.read_buffer = read_buffer;
+        std::size_t got = 0;
+        FeedSet feeds(ioc, options, "/stream?streams=btcusdt@depth5@100ms",
+                      [&](std::size_t, std::string_view msg, std::uint64_t, std::uint64_t) {
+                          got += !msg.empty();
+                      });
+        feeds.start();
+        REQUIRE(run_until(ioc, [&] { return standin.open_sessions() == 1; }));
+
+        LatencyHistogram burst;
+        for (std::size_t round = 0; round < kRounds; ++round) {
+            const auto start = now_ns();
+            const auto want  = got + frames.size();
+            for (const auto& f : frames) standin.broadcast(f);
+            REQUIRE(run_until(ioc, [&] { return got == want; }));
+            burst.record((now_ns() - start) / frames.size());
+        }
+        return std::make_pair(burst.percentile(0.5),
+                              standin.wire_bytes / (kRounds * frames.size()));
+    };
+
+    const auto plain     = measure(false, 64 * 1024);
+    const auto small     = measure(false, 1024);
+    const auto deflated  = measure(true, 64 * 1024);
+    WARN("per frame, ns p50 / wire bytes: plain " << plain.first << " / " << plain.second
+         << ", plain with 1 KiB initial buffer " << small.first << " / " << small.second
+         << ", permessage-deflate " << deflated.first << " / " << deflated.second);
+}
+
+TEST_CASE("Top of book from depth5 vs bookTicker", "[.][benchmark][feed]") {
+    // The stand-in's best bid and ask change every 2 ms.  depth5 publishes
+    // them every 100 ms, bookTicker on every change.  A change's staleness
+    // is how long after it the client's book first showed it or a later
+    // one; changes overtaken before the client saw them count too.
+    constexpr std::uint64_t kChanges = 1500;
+    auto measure = [&](bool ticker) {
+        boost::asio::io_context ioc;
+        StreamStandIn standin(ioc);
+        // What the client knows, in one place for an InlineFunction to capture
+        struct Client {
+            bool                       ticker;
+            OrderBook                  book{"BTCUSDT"};
+            std::vector<std::uint64_t> changed_at;   // by update id - 1
+            LatencyHistogram           staleness;
+            std::uint64_t              updates = 0;
+            MarketFrame                frame;
+            BookTickerFrame            top;
+
+            void on_frame(std::string_view msg, std::uint64_t read_ns)
+            {
+                const auto before = book.lastUpdateId();
+                const bool applied = ticker
+                    ? parse_book_ticker(msg, top) && book.apply_top(top.updateId, top.bid, top.ask)
+                    : parse_market_frame(msg, frame) &&
+                      book.apply_snapshot(frame.lastUpdateId, frame.bids, frame.asks);
+                if (!applied) return;
+                ++updates;
+                for (auto id = before + 1; id <= book.lastUpdateId(); ++id)
+                    staleness.record(read_ns - changed_at[id - 1]);
+            }
+        } client{ticker};
+        auto& book       = client.book;
+        auto& changed_at = client.changed_at;
+
+        FeedSet feeds(ioc, standin_feeds(standin, 1),
+                      ticker ? "/stream?streams=btcusdt@bookTicker" : "/stream?streams=btcusdt@depth5@100ms",
+                      [&client](std::size_t, std::string_view msg, std::uint64_t read_ns, std::uint64_t) {
+                          client.on_frame(msg, read_ns);
+                      });
+        feeds.start();
+        REQUIRE(run_until(ioc, [&] { return standin.open_sessions() == 1; }));
+
+        auto quote = [](std::uint64_t id, int offset) {
+            return std::to_string(100000 + static_cast<int>(id % 50) + offset) + ".00";
+        };
+        boost::asio::steady_timer change(ioc), snapshot(ioc);
+        std::function<void()> next_change = [&] {
+            change.expires_after(std::chrono::milliseconds(2));
+            change.async_wait([&](boost::system::error_code ec) {
+                if (ec || changed_at.size() == kChanges) return;
+                changed_at.push_back(now_ns());
+                const auto id = changed_at.size();
+                if (ticker) standin.broadcast(book_ticker("btcusdt@bookTicker", id, quote(id, 0), quote(id, 1)));
+                next_change();
+            });
+        };
+        std::function<void()> next_snapshot = [&] {
+            snapshot.expires_after(std::chrono::milliseconds(100));
+            snapshot.async_wait([&](boost::system::error_code ec) {
+                if (ec) return;
+                const auto id = changed_at.size();
+                if (id) standin.broadcast(depth5("btcusdt@depth5@100ms", id, quote(id, 0), quote(id, 1)));
+                next_snapshot();
+            });
+        };
+        const auto start = now_ns();
+        next_change();
+        if (!ticker) next_snapshot();
+        REQUIRE(run_until(ioc, [&] { return book.lastUpdateId() == kChanges; }, std::chrono::seconds(30)));
+        const double secs = static_cast<double>(now_ns() - start) / 1e9;
+        snapshot.cancel();
+        return std::make_tuple(static_cast<double>(client.updates) / secs,
+                               client.staleness.percentile(0.5), client.staleness.percentile(0.99));
+    };
+
+    const auto [depth_rate, depth_p50, depth_p99] = measure(false);
+    const auto [ticker_rate, ticker_p50, ticker_p99] = measure(true);
+    WARN("book updates/s, staleness ns p50/p99: depth5 " << depth_rate << ", " << depth_p50 << "/"
+         << depth_p99 << "; bookTicker " << ticker_rate << ", " << ticker_p50 << "/" << ticker_p99);
+}
@@ -0,0 +1,135 @@
+#include "fixed_point.hpp"
+#include "exchange_info.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace triarb;
+
+namespace {
+
+std::string text(const SymbolScale& scale, Price p)
+{
+    char buf[SymbolScale::kMaxText];
+    return {buf, scale.write(buf, p)};
+}
+
+std::string text(const SymbolScale& scale, Qty q)
+{
+    char buf[SymbolScale::kMaxText];
+    return {buf, scale.write(buf, q)};
+}
+
+Decimal dec(const char* s)
+{
+    Decimal d;
+    REQUIRE(parse_fixed(s, d));
+    return d;
+}
+
+} // namespace
+
+TEST_CASE("Increments parse exactly from filter strings", "[fixed]") {
+    Increment inc;
+    REQUIRE(parse_increment("0.01000000", inc));
+    REQUIRE(inc.units == 1);  REQUIRE(inc.scale == 2);
+    REQUIRE(parse_increment("0.00000500", inc));
+    REQUIRE(inc.units == 5);  REQUIRE(inc.scale == 6);
+    REQUIRE(parse_increment("10.00000000", inc));
+    REQUIRE(inc.units == 10); REQUIRE(inc.scale == 0);
+    REQUIRE_FALSE(parse_increment("0.00000000", inc));
+
+    inc = increment_from_double(0.00001);
+    REQUIRE(inc.units == 1);  REQUIRE(inc.scale == 5);
+    inc = increment_from_double(0.0005);
+    REQUIRE(inc.units == 5);  REQUIRE(inc.scale == 4);
+}
+
+TEST_CASE("SymbolScale converts wire decimals to ticks and steps", "[fixed]") {
+    const SymbolScale ethbtc{{1, 5}, {1, 4}};
+
+    REQUIRE(ethbtc.price(dec("0.02391000")).ticks == 2391);
+    REQUIRE(ethbtc.price(dec("0.02391")).ticks == 2391);
+    REQUIRE(ethbtc.qty(dec("41.61180000")).steps == 416118);
+    REQUIRE(ethbtc.qty(dec("0.00000000")).steps == 0);
+    REQUIRE(ethbtc.to_double(Price{2391}) == 0.02391);
+    REQUIRE(ethbtc.to_double(Qty{416118}) == 41.6118);
+
+    // A tick that is not a power of ten.
+    const SymbolScale odd{{5, 6}, {1, 0}};
+    REQUIRE(odd.price(dec("0.00012500")).ticks == 25);
+    REQUIRE(odd.to_double(Price{25}) == 0.000125);
+    REQUIRE(text(odd, Price{25}) == "0.000125");
+    REQUIRE(text(odd, Qty{1500}) == "1500");
+}
+
+TEST_CASE("Orders are written on tick and step without iostreams", "[fixed]") {
+    // The old formatting used two decimals for every price.
+    const SymbolScale ethbtc{{1, 5}, {1, 4}};
+    REQUIRE(text(ethbtc, ethbtc.price_near(0.02391)) == "0.02391");
+    REQUIRE(text(ethbtc, ethbtc.qty_floor(0.62689999)) == "0.6268");
+    REQUIRE(text(ethbtc, ethbtc.qty_floor(0.3)) == "0.3000");
+
+    const SymbolScale btcusdt{{1, 2}, {1, 5}};
+    REQUIRE(text(btcusdt, btcusdt.price_near(104312.014999)) == "104312.01");
+    REQUIRE(text(btcusdt, btcusdt.price_near(0.5)) == "0.50");
+    REQUIRE(text(btcusdt, btcusdt.qty_floor(0.000149)) == "0.00014");
+    REQUIRE(text(btcusdt, Price{-150}) == "-1.50");
+
+    // Every written price re-parses to the same tick.
+    for (std::int64_t t : {0LL, 1LL, 99LL, 100LL, 10431201LL, 123456789012345LL})
+        REQUIRE(btcusdt.price(dec(text(btcusdt, Price{t}).c_str())).ticks == t);
+}
+
+TEST_CASE("Symbol scales come from exchangeInfo", "[fixed]") {
+    const auto symbols = load_exchange_info(std::string(TRIARB_TEST_DATA_DIR) + "/exchange_info.json");
+    auto ethbtc = std::find_if(symbols.begin(), symbols.end(),
+        [](const SymbolInfo& s) { return s.symbol == "ETHBTC"; });
+    REQUIRE(ethbtc != symbols.end());
+
+    const auto scale = symbol_scale(*ethbtc);
+    REQUIRE(scale.tick().units == 1); REQUIRE(scale.tick().scale == 5);
+    REQUIRE(scale.step().units == 1); REQUIRE(scale.step().scale == 4);
+
+    // Hand-written entries without exact increments fall back to the doubles.
+    const auto derived = symbol_scale({"XUSDT", "X", "USDT", 0.001, 0.1, 5.0});
+    REQUIRE(derived.tick().scale == 3);
+    REQUIRE(derived.step().scale == 1);
+}
+
+TEST_CASE("Fixed-point parsing and order formatting", "[.][benchmark][fixed]") {
+    const SymbolScale btcusdt{{1, 2}, {1, 5}};
+    const char* px = "104312.01000000";
+
+    BENCHMARK("strtod price") {
+        return std::strtod(px, nullptr);
+    };
+    BENCHMARK("parse_fixed + ticks") {
+        Decimal d;
+        parse_fixed(px, d);
+        return btcusdt.price(d).ticks;
+    };
+
+    const double qty = 0.00123, price = 104312.01;
+    BENCHMARK("ostringstream qty+price") {
+        std::ostringstream body;
+        body << "&quantity=" << std::fixed << std::setprecision(6) << qty
+             << "&price=" << std::setprecision(2) << price;
+        return body.str().size();
+    };
+    const Qty q = btcusdt.qty_floor(qty);
+    const Price p = btcusdt.price_near(price);
+    BENCHMARK("SymbolScale::write qty+price") {
+        char buf[2 * SymbolScale::kMaxText + 32];
+        char* out = buf;
+        out = std::copy_n("&quantity=", 10, out);
+        out = btcusdt.write(out, q);
+        out = std::copy_n("&price=", 7, out);
+        out = btcusdt.write(out, p);
+        return static_cast<std::size_t>(out - buf);
+    };
+}
@@ -0,0 +1,152 @@
+#include "frame_parser.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace triarb;
+
+static std::vector<std::string> load_frames(const std::string& name)
+{
+    std::ifstream in(std::string(TRIARB_TEST_DATA_DIR) + "/" + name);
+    std::vector<std::string> frames;
+    for (std::string line; std::getline(in, line); )
+        if (!line.empty()) frames.push_back(line);
+    return frames;
+}
+
+TEST_CASE("parse_fixed reads decimals exactly", "[parser]") {
+    const char* samples[] = {
+        "0", "0.00000000", "104312.01000000", "0.02391000", "2494.57000000",
+        "0.00000001", "92233720.3685477", "123456789012.00000000", "17", "3.5"
+    };
+    for (const char* s : samples) {
+        INFO(s);
+        Decimal d;
+        REQUIRE(parse_fixed(s, d));
+        REQUIRE(to_double(d) == std::strtod(s, nullptr));
+    }
+
+    Decimal d;
+    REQUIRE(parse_fixed("0.02391000", d));
+    REQUIRE(d == Decimal{2391, 5});
+    REQUIRE(parse_fixed("104312.01000000", d));
+    REQUIRE(d == Decimal{10431201, 2});
+    REQUIRE(parse_fixed("500.00000000", d));
+    REQUIRE(d == Decimal{500, 0});
+
+    REQUIRE_FALSE(parse_fixed("", d));
+    REQUIRE_FALSE(parse_fixed(".", d));
+    REQUIRE_FALSE(parse_fixed("1.2.3", d));
+    REQUIRE_FALSE(parse_fixed("12a", d));
+    REQUIRE_FALSE(parse_fixed("-1", d));
+    REQUIRE_FALSE(parse_fixed("12345678901234567890", d));   // beyond int64
+}
+
+TEST_CASE("Fast parser extracts depth levels", "[parser]") {
+    const auto frames = load_frames("frames.jsonl");
+    REQUIRE_FALSE(frames.empty());
+
+    MarketFrame f;
+    REQUIRE(parse_market_frame(frames.front(), f));
+    REQUIRE(f.kind == FrameKind::PartialDepth);
+    REQUIRE(f.stream == "btcusdt@depth5@100ms");
+    REQUIRE(f.lastUpdateId == 71258836592ull);
+    REQUIRE(f.bids.size() == 5);
+    REQUIRE(f.asks.size() == 5);
+    REQUIRE(to_double(f.bids[0].px)  == 104312.01);
+    REQUIRE(to_double(f.bids[0].qty) == 3.21874);
+    REQUIRE(to_double(f.asks[4].px)  == 104312.95);
+}
+
+TEST_CASE("Fast parser extracts bookTicker", "[parser]") {
+    MarketFrame f;
+    REQUIRE(parse_market_frame(
+        R"({"stream":"ethbtc@bookTicker","data":{"u":8152604230,"s":"ETHBTC",)"
+        R"("b":"0.02391000","B":"41.61180000","a":"0.02392000","A":"21.44130000"}})", f));
+    REQUIRE(f.kind == FrameKind::BookTicker);
+    REQUIRE(f.stream == "ethbtc@bookTicker");
+    REQUIRE(f.lastUpdateId == 8152604230ull);
+    REQUIRE(f.bids.size() == 1);
+    REQUIRE(f.bids[0].px  == Decimal{2391, 5});
+    REQUIRE(to_double(f.asks[0].qty) == 21.4413);
+}
+
+TEST_CASE("bookTicker parser agrees with the general parser", "[parser]") {
+    const auto frames = load_frames("frames.jsonl");
+    std::size_t tickers = 0;
+    for (const auto& msg : frames) {
+        MarketFrame general;
+        BookTickerFrame t;
+        REQUIRE(parse_market_frame(msg, general));
+        const bool parsed = parse_book_ticker(msg, t);
+        REQUIRE(parsed == (general.kind == FrameKind::BookTicker));
+        if (!parsed) continue;
+        ++tickers;
+        CHECK(t.stream == general.stream);
+        CHECK(t.updateId == general.lastUpdateId);
+        CHECK(t.bid.px  == general.bids[0].px);
+        CHECK(t.bid.qty == general.bids[0].qty);
+        CHECK(t.ask.px  == general.asks[0].px);
+        CHECK(t.ask.qty == general.asks[0].qty);
+    }
+    CHECK(tickers == 3);
+
+    BookTickerFrame t;
+    CHECK_FALSE(parse_book_ticker(R"({"stream":"ethbtc@bookTicker","data":{"u":1,"s":"ETHBTC","b":"0.1"}})", t));
+    CHECK_FALSE(parse_book_ticker(R"({"stream":"x","data":{"e":"depthUpdate"}})", t));
+}
+
+TEST_CASE("Fast parser extracts diff depth and REST snapshots", "[parser]") {
+    const auto diffs = load_frames("ethbtc_depth_diffs.jsonl");
+    REQUIRE_FALSE(diffs.empty());
+
+    MarketFrame f;
+    REQUIRE(parse_market_frame(diffs[1], f));
+    REQUIRE(f.kind == FrameKind::DiffDepth);
+    REQUIRE(f.stream == "ethbtc@depth@100ms");
+    REQUIRE(f.eventTime == 1750000000200ull);
+    REQUIRE(f.firstUpdateId == 8152604997ull);
+    REQUIRE(f.lastUpdateId == 8152605003ull);
+    REQUIRE(f.bids.size() == 2);
+    REQUIRE(f.asks.size() == 1);
+    REQUIRE(f.asks[0].qty.mantissa == 0);
+
+    REQUIRE(parse_depth_snapshot(
+        R"({"lastUpdateId":1027024,"bids":[["4.00000000","431.00000000"]],"asks":[]})", f));
+    REQUIRE(f.kind == FrameKind::PartialDepth);
+    REQUIRE(f.lastUpdateId == 1027024);
+    REQUIRE(f.bids.size() == 1);
+    REQUIRE(f.asks.empty());
+}
+
+TEST_CASE("Fast and json parsers agree on captured frames", "[parser]") {
+    auto frames = load_frames("frames.jsonl");
+    for (auto& diff : load_frames("ethbtc_depth_diffs.jsonl"))
+        frames.push_back(std::move(diff));
+    REQUIRE_FALSE(frames.empty());
+
+    MarketFrame fast, slow;
+    for (const auto& msg : frames) {
+        INFO(msg);
+        REQUIRE(parse_market_frame(msg, fast));
+        REQUIRE(parse_market_frame_json(msg, slow));
+        REQUIRE(same_frame(fast, slow));
+    }
+}
+
+TEST_CASE("Both parsers reject unknown or broken frames", "[parser]") {
+    const char* bad[] = {
+        R"({"result":null,"id":1})",
+        R"({"stream":"btcusdt@trade","data":{"e":"trade","p":"1.0"}})",
+        R"({"stream":"btcusdt@depth5@100ms","data":{"lastUpdateId":1,"bids":[["1.0","2.0"])",
+        R"({"stream":"btcusdt@depth5@100ms","data":{"lastUpdateId":1,"bids":[["x","2.0"]],"asks":[]}})",
+    };
+    MarketFrame f;
+    for (const char* msg : bad) {
+        INFO(msg);
+        REQUIRE_FALSE(parse_market_frame(msg, f));
+        REQUIRE_FALSE(parse_market_frame_json(msg, f));
+    }
+}
@@ -0,0 +1,502 @@
+#include "gateway.hpp"
+#include "test_support.hpp"
+#include "tls_standin.hpp"
+#include "ws_api_standin.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace triarb;
+
+namespace beast = boost::beast;
+namespace http  = beast::http;
+namespace ssl   = boost::asio::ssl;
+namespace ws    = beast::websocket;
+using tcp       = boost::asio::ip::tcp;
+using json      = nlohmann::json;
+
+namespace {
+
+/// Value of `key` in a URL-encoded body.
+std::string form_value(const std::string& body, const std::string& key)
+{
+    const auto at = ("&" + body).find("&" + key + "=");
+    if (at == std::string::npos) return {};
+    const auto start = at + key.size() + 1;
+    return body.substr(start, body.find('&', start) - start);
+}
+
+/* TLS Stand-In
+ * ------------
+ * Local HTTPS/1.1 server in place of the REST API, on the test's
+ * io_context.  By default it fills every signed order completely at its
+ * limit price and keeps connections alive; `handler` can answer
+ * differently, or return nullopt to drop the connection unanswered.
+ */
+class TlsStandIn
+{
+    public:
+        using Request  = http::request<http::string_body>;
+        using Response = http::response<http::string_body>;
+        using Handler  = std::function<std::optional<Response>(const Request&)>;
+
+        explicit TlsStandIn(boost::asio::io_context& ioc)
+            : server_(ioc, [this](tcp::socket socket, ssl::context& ctx) {
+                  return std::make_shared<Session>(*this, std::move(socket), ctx);
+              })
+        {}
+
+        std::string port() const { return server_.port(); }
+        int connections() const { return server_.connections(); }
+
+        /// Closes every connection from the server side.
+        void drop_all() { server_.drop_all(); }
+
+        static std::optional<Response> fill_order(const Request& req)
+        {
+            Response res{http::status::ok, req.version()};
+            const auto& body = req.body();
+            if (req.target() != "/api/v3/order" || req["X-MBX-APIKEY"].empty() ||
+                form_value(body, "signature").empty()) {
+                res.result(http::status::unauthorized);
+                res.body() = R"({"code":-2014,"msg":"API-key format invalid."})";
+                return res;
+            }
+            const auto qty   = form_value(body, "quantity");
+            const auto price = form_value(body, "price");
+            res.body() = R"({"symbol":")" + form_value(body, "symbol") +
+                R"(","orderId":1,"status":"FILLED","executedQty":")" + qty +
+                R"(","cummulativeQuoteQty":")" + std::to_string(std::stod(qty) * std::stod(price)) +
+                R"(","fills":[{"price":")" + price + R"(","qty":")" + qty + R"("}]})";
+            return res;
+        }
+
+        int     requests    = 0;
+        Handler handler     = fill_order;
+        std::chrono::microseconds delay{0};  // before each answer, as the exchange takes
+
+    private:
+        struct Session : std::enable_shared_from_this<Session> {
+            Session(TlsStandIn& owner, tcp::socket socket, ssl::context& ctx)
+                : owner(owner), stream(std::move(socket), ctx) {}
+
+            void start()
+            {
+                stream.async_handshake(ssl::stream_base::server,
+                    [self = shared_from_this()](beast::error_code ec) {
+                        if (!ec) self->read();
+                    });
+            }
+            void read()
+            {
+                req = {};
+                http::async_read(stream, buffer, req,
+                    [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                        if (ec) return;
+                        ++self->owner.requests;
+                        auto answer = self->owner.handler(self->req);
+                        if (!answer) return self->close();
+                        self->res = std::move(*answer);
+                        self->res.keep_alive(self->req.keep_alive());
+                        self->res.prepare_payload();
+                        if (self->owner.delay.count() == 0) return self->write();
+                        self->timer.expires_after(self->owner.delay);
+                        self->timer.async_wait([self](beast::error_code) { self->write(); });
+                    });
+            }
+            void write()
+            {
+                http::async_write(stream, res,
+                    [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                        if (!ec && self->res.keep_alive()) self->read();
+                    });
+            }
+            void close()
+            {
+                beast::error_code ignored;
+                beast::get_lowest_layer(stream).socket().close(ignored);
+            }
+
+            TlsStandIn&                          owner;
+            beast::ssl_stream<beast::tcp_stream> stream;
+            beast::flat_buffer                   buffer;
+            Request                              req;
+            Response                             res;
+            boost::asio::steady_timer            timer{stream.get_executor()};
+        };
+
+        TlsServer<Session> server_;
+};
+
+GatewayOptions standin_options(const TlsStandIn& standin, std::size_t pool_size,
+                               LatencyMetrics* latency = nullptr)
+{
+    GatewayOptions options;
+    options.port      = standin.port();
+    options.pool_size = pool_size;
+    options.ca_file   = data_file("standin_cert.pem");
+    options.latency   = latency;
+    return options;
+}
+
+GatewayOptions ws_options(const WsApiStandIn& standin, LatencyMetrics* latency = nullptr)
+{
+    GatewayOptions options;
+    options.transport = OrderTransport::WebSocket;
+    options.ws_host   = "localhost";
+    options.ws_port   = standin.port();
+    options.ca_file   = data_file("standin_cert.pem");
+    options.latency   = latency;
+    return options;
+}
+
+const SymbolScale btcusdt{{1, 2}, {1, 5}};
+
+} // namespace
+
+TEST_CASE("Order responses become fill reports", "[gateway]") {
+    const auto full = parse_order_response(R"({"symbol":"BTCUSDT","status":"FILLED",
+        "executedQty":"0.00300000","cummulativeQuoteQty":"300.03000000",
+        "fills":[{"price":"100000.00","qty":"0.002"},{"price":"100010.00","qty":"0.001"}]})");
+    CHECK(full.success);
+    CHECK(full.qty_filled == Catch::Approx(0.003));
+    CHECK(full.price_avg == Catch::Approx(100010.0));
+
+    const auto from_fills = parse_order_response(R"({"executedQty":"0.003",
+        "fills":[{"price":"100000.00","qty":"0.002"},{"price":"100030.00","qty":"0.001"}]})");
+    CHECK(from_fills.success);
+    CHECK(from_fills.price_avg == Catch::Approx(100010.0));
+
+    CHECK_FALSE(parse_order_response(R"({"status":"EXPIRED","executedQty":"0.00000000",
+        "cummulativeQuoteQty":"0.00000000","fills":[]})").success);
+    CHECK_FALSE(parse_order_response(R"({"code":-2010,"msg":"Account has insufficient balance."})").success);
+    CHECK_FALSE(parse_order_response("<html>502</html>").success);
+}
+
+TEST_CASE("Orders go out on warm keep-alive connections", "[gateway]") {
+    boost::asio::io_context ioc;
+    TlsStandIn standin(ioc);
+    LatencyMetrics metrics;
+    Gateway gw(ioc, "localhost", {"key", "secret"}, true, standin_options(standin, 2, &metrics));
+
+    REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 2; }));
+    CHECK(standin.connections() == 2);
+
+    // Each order is sent from the previous one's fill, as the legs are.
+    std::vector<FillReport> fills;
+    std::function<void()> next = [&] {
+        gw.send_order("BTCUSDT", "BUY", btcusdt.qty_floor(0.00123), btcusdt.price_near(104312.01),
+                      btcusdt, [&](FillReport rep) {
+                          fills.push_back(rep);
+                          if (fills.size() < 20) next();
+                      });
+    };
+    next();
+    REQUIRE(run_until(ioc, [&] { return fills.size() == 20; }));
+
+    for (const auto& f : fills) {
+        CHECK(f.success);
+        CHECK(f.qty_filled == Catch::Approx(0.00123));
+        CHECK(f.price_avg == Catch::Approx(104312.01));
+    }
+    CHECK(standin.requests == 20);
+    CHECK(standin.connections() == 2);            // no connection set up on the order path
+    CHECK(metrics[Span::OrderRtt].count() == 20);
+}
+
+TEST_CASE("Connections the server drops are rebuilt in the background", "[gateway]") {
+    boost::asio::io_context ioc;
+    TlsStandIn standin(ioc);
+    Gateway gw(ioc, "localhost", {"key", "secret"}, true, standin_options(standin, 2));
+    REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 2; }));
+
+    standin.drop_all();
+    REQUIRE(run_until(ioc, [&] { return standin.connections() == 4 && gw.warm_connections() == 2; }));
+
+    std::optional<FillReport> fill;
+    gw.send_order("BTCUSDT", "SELL", btcusdt.qty_floor(0.001), btcusdt.price_near(100000),
+                  btcusdt, [&](FillReport rep) { fill = rep; });
+    REQUIRE(run_until(ioc, [&] { return fill.has_value(); }));
+    CHECK(fill->success);
+    CHECK(standin.connections() == 4);
+}
+
+TEST_CASE("Idle connections are refreshed before they go stale", "[gateway]") {
+    boost::asio::io_context ioc;
+    TlsStandIn standin(ioc);
+    auto options = standin_options(standin, 1);
+    options.idle_refresh = std::chrono::milliseconds(100);
+    Gateway gw(ioc, "localhost", {"key", "secret"}, true, options);
+
+    REQUIRE(run_until(ioc, [&] { return standin.connections() >= 3; }));
+    REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 1; }));
+}
+
+TEST_CASE("Rejected and unanswered orders report no fill", "[gateway]") {
+    boost::asio::io_context ioc;
+    TlsStandIn standin(ioc);
+    Gateway gw(ioc, "localhost", {"key", "secret"}, true, standin_options(standin, 1));
+    REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 1; }));
+
+    std::optional<FillReport> fill;
+    auto send = [&] {
+        fill.reset();
+        gw.send_order("BTCUSDT", "BUY", btcusdt.qty_floor(0.001), btcusdt.price_near(100000),
+                      btcusdt, [&](FillReport rep) { fill = rep; });
+        return run_until(ioc, [&] { return fill.has_value(); });
+    };
+
+    standin.handler = [](const TlsStandIn::Request& req) -> std::optional<TlsStandIn::Response> {
+        TlsStandIn::Response res{http::status::bad_request, req.version()};
+        res.body() = R"({"code":-2010,"msg":"Order would immediately match and take."})";
+        return res;
+    };
+    REQUIRE(send());
+    CHECK_FALSE(fill->success);
+    CHECK(standin.connections() == 1);            // a rejection keeps the connection
+
+    standin.handler = [](const TlsStandIn::Request&) { return std::optional<TlsStandIn::Response>{}; };
+    REQUIRE(send());
+    CHECK_FALSE(fill->success);
+    CHECK(standin.requests == 2);               // not resent
+
+    standin.handler = TlsStandIn::fill_order;
+    REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 1; }));
+    REQUIRE(send());
+    CHECK(fill->success);
+    CHECK(standin.connections() == 2);
+}
+
+TEST_CASE("Orders queued with no connection up time out unsent", "[gateway]") {
+    boost::asio::io_context ioc;
+    std::string port;
+    {
+        tcp::acceptor closed(ioc, {boost::asio::ip::address_v4::loopback(), 0});
+        port = std::to_string(closed.local_endpoint().port());
+    }
+    ssl::context ctx(ssl::context::tlsv12_client);
+    HttpsPool pool(ioc, ctx, "localhost", port, 1, std::chrono::seconds(50),
+                   std::chrono::milliseconds(200));
+    pool.start();
+
+    std::optional<beast::error_code> result;
+    const auto queued = std::chrono::steady_clock::now();
+    HttpsPool::Request req;
+    req.method(http::verb::post);
+    req.target("/api/v3/order");
+    pool.async_request(std::move(req),
+        [&](beast::error_code ec, HttpsPool::Response) { result = ec; });
+
+    REQUIRE(run_until(ioc, [&] { return result.has_value(); }, std::chrono::seconds(2)));
+    CHECK(*result == boost::asio::error::timed_out);
+    CHECK(std::chrono::steady_clock::now() - queued >= std::chrono::milliseconds(200));
+    CHECK(pool.ready() == 0);
+}
+
+TEST_CASE("Order transport comes from the environment", "[gateway]") {
+    CHECK(load_gateway_options_from_env().transport == OrderTransport::Rest);
+    ::setenv("ORDER_TRANSPORT", "ws", 1);
+    CHECK(load_gateway_options_from_env().transport == OrderTransport::WebSocket);
+    ::setenv("ORDER_TRANSPORT", "fix", 1);
+    CHECK_THROWS(load_gateway_options_from_env());
+    ::unsetenv("ORDER_TRANSPORT");
+}
+
+TEST_CASE("WebSocket API responses become fill reports", "[gateway]") {
+    const auto filled = parse_ws_order_response(R"({"id":7,"status":200,"result":{
+        "symbol":"BTCUSDT","status":"FILLED","executedQty":"0.00300000",
+        "cummulativeQuoteQty":"300.03000000"},"rateLimits":[]})");
+    CHECK(filled.success);
+    CHECK(filled.qty_filled == Catch::Approx(0.003));
+    CHECK(filled.price_avg == Catch::Approx(100010.0));
+
+    CHECK_FALSE(parse_ws_order_response(R"({"id":8,"status":200,"result":{
+        "status":"EXPIRED","executedQty":"0.00000000","cummulativeQuoteQty":"0.00000000"}})").success);
+    CHECK_FALSE(parse_ws_order_response(R"({"id":9,"status":400,
+        "error":{"code":-2010,"msg":"Order would immediately match and take."}})").success);
+    CHECK_FALSE(parse_ws_order_response("not json").success);
+}
+
+TEST_CASE("WebSocket orders are signed, in flight together and matched by id", "[gateway]") {
+    boost::asio::io_context ioc;
+    WsApiStandIn standin(ioc);
+    standin.batch = 5;
+    LatencyMetrics metrics;
+    Gateway gw(ioc, "localhost", {"key", "secret"}, true, ws_options(standin, &metrics));
+
+    // Sent before the session is up: they wait for it, then go out together
+    // and their replies come back newest first.
+    std::vector<std::optional<FillReport>> fills(5);
+    for (std::size_t i = 0; i < fills.size(); ++i)
+        gw.send_order("BTCUSDT", "BUY", btcusdt.qty_floor(0.001 * (i + 1)), btcusdt.price_near(100000),
+                      btcusdt, [&, i](FillReport rep) { fills[i] = rep; });
+    REQUIRE(run_until(ioc, [&] {
+        return std::all_of(fills.begin(), fills.end(), [](const auto& f) { return f.has_value(); });
+    }));
+
+    for (std::size_t i = 0; i < fills.size(); ++i) {
+        CHECK(fills[i]->success);
+        CHECK(fills[i]->qty_filled == Catch::Approx(0.001 * (i + 1)));
+        CHECK(fills[i]->price_avg == Catch::Approx(100000.0));
+    }
+    CHECK(standin.connections() == 1);
+    CHECK(gw.warm_connections() == 1);
+    CHECK(metrics[Span::OrderRtt].count() == 5);
+
+    std::optional<FillReport> bad;
+    Gateway wrong_key(ioc, "localhost", {"key", "not-the-secret"}, true, ws_options(standin));
+    standin.batch = 0;
+    wrong_key.send_order("BTCUSDT", "BUY", btcusdt.qty_floor(0.001), btcusdt.price_near(100000),
+                         btcusdt, [&](FillReport rep) { bad = rep; });
+    REQUIRE(run_until(ioc, [&] { return bad.has_value(); }));
+    CHECK_FALSE(bad->success);
+}
+
+TEST_CASE("A lost WebSocket session fails its orders and reconnects", "[gateway]") {
+    boost::asio::io_context ioc;
+    WsApiStandIn standin(ioc);
+    Gateway gw(ioc, "localhost", {"key", "secret"}, true, ws_options(standin));
+    REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 1; }));
+
+    std::optional<FillReport> fill;
+    auto send = [&] {
+        fill.reset();
+        gw.send_order("BTCUSDT", "SELL", btcusdt.qty_floor(0.001), btcusdt.price_near(100000),
+                      btcusdt, [&](FillReport rep) { fill = rep; });
+        return run_until(ioc, [&] { return fill.has_value(); });
+    };
+
+    standin.handler = [](const json&) { return std::optional<json>{}; };
+    REQUIRE(send());
+    CHECK_FALSE(fill->success);
+    CHECK(standin.requests == 1);               // not resent
+
+    standin.handler = WsApiStandIn::fill_order;
+    REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 1; }));
+    REQUIRE(send());
+    CHECK(fill->success);
+    CHECK(standin.connections() == 2);
+}
+
+TEST_CASE("Order round trip, warm pool vs fresh connection", "[.][benchmark][gateway]") {
+    boost::asio::io_context ioc;
+    TlsStandIn standin(ioc);
+    const Qty qty     = btcusdt.qty_floor(0.001);
+    const Price price = btcusdt.price_near(100000);
+
+    LatencyMetrics warm;
+    {
+        Gateway gw(ioc, "localhost", {"key", "secret"}, true, standin_options(standin, 2, &warm));
+        REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 2; }));
+        for (int i = 0; i < 500; ++i) {
+            bool done = false;
+            gw.send_order("BTCUSDT", "BUY", qty, price, btcusdt, [&](FillReport) { done = true; });
+            REQUIRE(run_until(ioc, [&] { return done; }));
+        }
+    }
+
+    // A gateway whose pool has not connected yet: the order waits for DNS,
+    // TCP and the TLS handshake, as a connection-per-order client would.
+    LatencyHistogram cold;
+    for (int i = 0; i < 50; ++i) {
+        Gateway gw(ioc, "localhost", {"key", "secret"}, true, standin_options(standin, 1));
+        bool done = false;
+        const auto start = now_ns();
+        gw.send_order("BTCUSDT", "BUY", qty, price, btcusdt, [&](FillReport) { done = true; });
+        REQUIRE(run_until(ioc, [&] { return done; }));
+        cold.record(now_ns() - start);
+    }
+
+    const auto& w = warm[Span::OrderRtt];
+    WARN("order round trip, ns p50/p99: warm " << w.percentile(0.5) << "/" << w.percentile(0.99)
+         << ", fresh connection " << cold.percentile(0.5) << "/" << cold.percentile(0.99));
+}
+
+TEST_CASE("Order round trip, REST pool vs WebSocket API", "[.][benchmark][gateway]") {
+    const Qty qty     = btcusdt.qty_floor(0.001);
+    const Price price = btcusdt.price_near(100000);
+
+    // Each transport on its own io_context, sequential orders as the legs
+    // of one triangle are.
+    auto sequential = [&](boost::asio::io_context& ioc, GatewayOptions options) {
+        LatencyMetrics metrics;
+        options.latency = &metrics;
+        Gateway gw(ioc, "localhost", {"key", "secret"}, true, options);
+        REQUIRE(run_until(ioc, [&] { return gw.warm_connections() >= 1; }));
+        for (int i = 0; i < 500; ++i) {
+            bool done = false;
+            gw.send_order("BTCUSDT", "BUY", qty, price, btcusdt, [&](FillReport) { done = true; });
+            REQUIRE(run_until(ioc, [&] { return done; }));
+        }
+        const auto& rtt = metrics[Span::OrderRtt];
+        return std::make_pair(rtt.percentile(0.5), rtt.percentile(0.99));
+    };
+
+    boost::asio::io_context rest_ioc;
+    TlsStandIn rest(rest_ioc);
+    const auto r = sequential(rest_ioc, standin_options(rest, 2));
+
+    boost::asio::io_context ws_ioc;
+    WsApiStandIn wsapi(ws_ioc);
+    // Skip the stand-in's signature check, which the REST one does not do
+    wsapi.handler = [](const json& req) -> std::optional<json> {
+        const auto& params = req.at("params");
+        return json{{"id", req["id"]}, {"status", 200},
+                    {"result", {{"executedQty", params["quantity"]},
+                                {"cummulativeQuoteQty", "100.00000000"}}}};
+    };
+    const auto w = sequential(ws_ioc, ws_options(wsapi));
+
+    WARN("order round trip, ns p50/p99: REST " << r.first << "/" << r.second
+         << ", WebSocket API " << w.first << "/" << w.second);
+}
+
+TEST_CASE("Triangle execution, chained vs concurrent legs", "[.][benchmark][gateway]") {
+    boost::asio::io_context ioc;
+    TlsStandIn standin(ioc);
+    // Loopback round trips cost what this process spends on them; the
+    // exchange's are mostly spent waiting, which concurrent legs overlap.
+    standin.delay = std::chrono::microseconds(200);
+    const Qty qty     = btcusdt.qty_floor(0.001);
+    const Price price = btcusdt.price_near(100000);
+    Gateway gw(ioc, "localhost", {"key", "secret"}, true, standin_options(standin, 3));
+    REQUIRE(run_until(ioc, [&] { return gw.warm_connections() == 3; }));
+
+    // Chained: each leg waits for the previous fill, as sequential execution
+    // does.  Concurrent: all three on their own warm connections at once.
+    LatencyHistogram chained, concurrent;
+    for (int i = 0; i < 200; ++i) {
+        const auto start = now_ns();
+        for (int leg = 0; leg < 3; ++leg) {
+            bool done = false;
+            gw.send_order("BTCUSDT", "BUY", qty, price, btcusdt, [&](FillReport) { done = true; });
+            REQUIRE(run_until(ioc, [&] { return done; }));
+        }
+        chained.record(now_ns() - start);
+    }
+    for (int i = 0; i < 200; ++i) {
+        const auto start = now_ns();
+        int done = 0;
+        for (int leg = 0; leg < 3; ++leg)
+            gw.send_order("BTCUSDT", "BUY", qty, price, btcusdt, [&](FillReport) { ++done; });
+        REQUIRE(run_until(ioc, [&] { return done == 3; }));
+        concurrent.record(now_ns() - start);
+    }
+
+    WARN("three legs answered, ns p50/p99: chained " << chained.percentile(0.5) << "/"
+         << chained.percentile(0.99) << ", concurrent " << concurrent.percentile(0.5) << "/"
+         << concurrent.percentile(0.99));
+}
@@ -0,0 +1,63 @@
+#include "inline_function.hpp"
+#include "allocation_counter.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+
+using namespace triarb;
+
+TEST_CASE("InlineFunction calls what it holds", "[inline_function]") {
+    int calls = 0;
+    InlineFunction<int(int, int)> add = [&calls](int a, int b) { ++calls; return a + b; };
+    REQUIRE(add);
+    CHECK(add(2, 3) == 5);
+    CHECK(calls == 1);
+
+    InlineFunction<void(std::string_view)> empty;
+    CHECK_FALSE(empty);
+}
+
+TEST_CASE("InlineFunction moves and destroys its callable once", "[inline_function]") {
+    auto counted = std::make_shared<int>(7);
+    {
+        InlineFunction<int()> a = [counted] { return *counted; };
+        CHECK(counted.use_count() == 2);
+
+        InlineFunction<int()> b = std::move(a);
+        CHECK_FALSE(a);
+        CHECK(b() == 7);
+        CHECK(counted.use_count() == 2);
+
+        InlineFunction<int()> c = [] { return 1; };
+        c = std::move(b);
+        CHECK(c() == 7);
+        CHECK(counted.use_count() == 2);
+
+        c.reset();
+        CHECK_FALSE(c);
+        CHECK(counted.use_count() == 1);
+
+        a = [counted] { return *counted + 1; };
+        CHECK(a() == 8);
+    }
+    CHECK(counted.use_count() == 1);
+}
+
+TEST_CASE("InlineFunction never allocates", "[inline_function]") {
+    std::array<char, 24> captured{};
+    captured[0] = 'x';
+    std::string sink;
+    sink.reserve(64);
+
+    const auto before = thread_allocations();
+    {
+        InlineFunction<void(std::string_view), 32> f =
+            [captured, &sink](std::string_view s) { sink.assign(s); sink += captured[0]; };
+        InlineFunction<void(std::string_view), 32> g = std::move(f);
+        g("frame");
+    }
+    CHECK(thread_allocations() == before);
+    CHECK(sink == "framex");
+}
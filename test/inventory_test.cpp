@@ -0,0 +1,251 @@
+#include "inventory.hpp"
+#include "replay.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace triarb;
+using Catch::Approx;
+
+static std::size_t count_with(const std::vector<std::string>& lines, const std::string& what)
+{
+    return static_cast<std::size_t>(std::count_if(lines.begin(), lines.end(),
+        [&](const std::string& l) { return l.find(what) != std::string::npos; }));
+}
+
+namespace {
+
+struct Books {
+    TriangleEngine engine{default_symbols(), "USDT"};
+    SymbolId ethusdt = *engine.find("ETHUSDT");
+    SymbolId ethbtc  = *engine.find("ETHBTC");
+    SymbolId btcusdt = *engine.find("BTCUSDT");
+    AssetId  usdt = *engine.find_asset("USDT");
+    AssetId  eth  = *engine.find_asset("ETH");
+    AssetId  btc  = *engine.find_asset("BTC");
+
+    Books()
+    {
+        engine.book(ethusdt).update(1, {1999.0, 1.0}, {2001.0, 1.0});
+        engine.book(ethbtc).update(1, {0.0199, 1.0}, {0.0201, 1.0});
+        engine.book(btcusdt).update(1, {99990.0, 1.0}, {100010.0, 1.0});
+    }
+
+    /// USDT -> ETH -> BTC -> USDT
+    const Triangle& usdt_eth_btc() const
+    {
+        for (const auto& t : engine.triangles())
+            if (engine.describe(t) == "USDT->ETH->BTC->USDT") return t;
+        throw std::logic_error("no USDT->ETH->BTC->USDT triangle");
+    }
+};
+
+InventoryOptions targets(double usdt, double eth, double btc)
+{
+    InventoryOptions options;
+    options.targets = {{"USDT", usdt}, {"ETH", eth}, {"BTC", btc}};
+    return options;
+}
+
+} // namespace
+
+TEST_CASE("Inventory and execution options come from the environment", "[inventory]") {
+    ::setenv("INVENTORY", "USDT:150,ETH:0.05,BTC:0.0015", 1);
+    ::setenv("REBALANCE_THRESHOLD", "0.1", 1);
+    ::setenv("REBALANCE_INTERVAL", "0", 1);
+    const auto options = load_inventory_options_from_env();
+    REQUIRE(options.targets.size() == 3);
+    CHECK(options.targets[1].first == "ETH");
+    CHECK(options.targets[1].second == 0.05);
+    CHECK(options.threshold == 0.1);
+    CHECK(options.interval.count() == 0);
+
+    ::setenv("EXECUTION", "concurrent", 1);
+    CHECK(load_bot_options_from_env().execution == ExecutionMode::Concurrent);
+
+    for (const char* bad : {"USDT", "USDT:", ":5", "USDT:1e", "USDT:-1", "USDT:1,"}) {
+        ::setenv("INVENTORY", bad, 1);
+        CHECK_THROWS_AS(load_inventory_options_from_env(), std::invalid_argument);
+    }
+
+    // Concurrent legs have nothing to trade from without an inventory
+    ::unsetenv("INVENTORY");
+    CHECK_THROWS_AS(load_bot_options_from_env(), std::invalid_argument);
+    ::setenv("EXECUTION", "parallel", 1);
+    CHECK_THROWS_AS(load_bot_options_from_env(), std::invalid_argument);
+
+    for (const char* name : {"EXECUTION", "REBALANCE_THRESHOLD", "REBALANCE_INTERVAL"})
+        ::unsetenv(name);
+    CHECK(load_bot_options_from_env().execution == ExecutionMode::Sequential);
+}
+
+TEST_CASE("Inventory reserves all three legs or none", "[inventory]") {
+    Books b;
+    Inventory inv(b.engine, targets(100, 0.01, 0.001));
+    const auto& t = b.usdt_eth_btc();
+
+    // USDT buys ETH, ETH sells for BTC, BTC sells for USDT
+    CHECK(inv.reserve(t, {20.0, 0.02, 0.0002}) == 1);
+    CHECK(inv.reserved(b.usdt) == 0.0);
+    CHECK(inv.reserved(b.btc) == 0.0);
+
+    CHECK(inv.reserve(t, {20.0, 0.01, 0.0002}) == 3);
+    CHECK(inv.available(b.usdt) == 80.0);
+    CHECK(inv.available(b.eth) == 0.0);
+    CHECK(inv.reserve(t, {1.0, 0.001, 0.0001}) == 1);
+
+    inv.release(b.eth, 0.01);
+    CHECK(inv.available(b.eth) == 0.01);
+
+    InventoryOptions doge;
+    doge.targets = {{"DOGE", 1.0}};
+    CHECK_THROWS_AS(Inventory(b.engine, doge), std::invalid_argument);
+}
+
+TEST_CASE("Fills move balances and drift", "[inventory]") {
+    Books b;
+    Inventory inv(b.engine, targets(100, 0.01, 0.001));
+
+    inv.apply_fill(b.ethusdt, Side::Buy, 0.005, 2000.0);
+    CHECK(inv.balance(b.eth) == Approx(0.015).margin(1e-12));
+    CHECK(inv.balance(b.usdt) == Approx(90.0).margin(1e-9));
+    CHECK(inv.drift(b.eth) == Approx(0.005).margin(1e-12));
+
+    inv.apply_fill(b.ethbtc, Side::Sell, 0.005, 0.02);
+    CHECK(inv.balance(b.eth) == Approx(0.01).margin(1e-12));
+    CHECK(inv.balance(b.btc) == Approx(0.0011).margin(1e-12));
+    CHECK(inv.home_value(b.btc, 0.0001) == Approx(10.0).epsilon(1e-9));
+    CHECK(inv.home_value(b.usdt, 3.0) == 3.0);
+}
+
+TEST_CASE("Drift beyond the threshold is traded back against home", "[inventory]") {
+    Books b;
+    InventoryOptions options = targets(100, 0.01, 0.001);
+    options.threshold = 0.25;
+    Inventory inv(b.engine, options);
+    CHECK(inv.rebalance_plan().empty());
+
+    inv.apply_fill(b.ethbtc, Side::Sell, 0.002, 0.02);     // ETH -20 %, BTC +4 %
+    CHECK(inv.rebalance_plan().empty());
+
+    inv.apply_fill(b.ethbtc, Side::Sell, 0.002, 0.02);     // ETH -40 %, BTC +8 %
+    const auto plan = inv.rebalance_plan();
+    REQUIRE(plan.size() == 1);
+    CHECK(plan[0].symbol == b.ethusdt);
+    CHECK(plan[0].side == Side::Buy);
+    CHECK(plan[0].qty == Approx(0.004).margin(1e-12));
+    CHECK(plan[0].price == 2001.0);
+
+    inv.apply_fill(b.btcusdt, Side::Buy, 0.0005, 100010.0);  // BTC +58 %
+    const auto both = inv.rebalance_plan();
+    REQUIRE(both.size() == 2);
+    const auto& sell = both[0].symbol == b.btcusdt ? both[0] : both[1];
+    CHECK(sell.side == Side::Sell);
+    CHECK(sell.qty == Approx(0.00058).margin(1e-12));
+    CHECK(sell.price == 99990.0);
+}
+
+TEST_CASE("Leg risk is what a broken cycle leaves outside home", "[inventory]") {
+    Books b;
+    Inventory inv(b.engine, targets(100, 0.01, 0.001));
+    const auto& t = b.usdt_eth_btc();
+
+    // Every leg filled: ETH and BTC come back to where they were
+    const std::array<LegOutcome, 3> whole{{{true, 20.0, 0.01}, {true, 0.01, 0.0002},
+                                           {true, 0.0002, 20.1}}};
+    const auto ok = inv.leg_risk(t, whole);
+    CHECK(ok.delta[0] == Approx(0.1).margin(1e-12));
+    CHECK(ok.delta[1] == Approx(0.0).margin(1e-15));
+    CHECK(ok.delta[2] == Approx(0.0).margin(1e-15));
+    CHECK(ok.exposure == Approx(0.0).margin(1e-9));
+
+    // The ETHBTC leg missed: 0.01 ETH too many and 0.0002 BTC too few
+    auto broken = whole;
+    broken[1] = {};
+    const auto risk = inv.leg_risk(t, broken);
+    CHECK(risk.delta[1] == Approx(0.01).margin(1e-15));
+    CHECK(risk.delta[2] == Approx(-0.0002).margin(1e-15));
+    CHECK(risk.exposure == Approx(0.01 * 2000.0 + 0.0002 * 100000.0).epsilon(1e-9));
+
+    inv.record_triangle(ok, false);
+    inv.record_triangle(risk, true);
+    std::ostringstream report;
+    inv.report(report);
+    CHECK(report.str().find("[LEG RISK] triangles 2 broken 1") != std::string::npos);
+    CHECK(report.str().find("[INVENTORY] ETH") != std::string::npos);
+}
+
+TEST_CASE("Concurrent replay fires the same triangles with all legs at once", "[inventory]") {
+    const auto journal = temp_path("inventory_replay.bin");
+    {
+        JournalWriter w(journal);
+        std::uint64_t ts = 1'700'000'000'000'000'000;
+        for (const auto& f : {depth5("ethusdt@depth5@100ms", "1999.00", "2000.00"),
+                              depth5("ethbtc@depth5@100ms",  "0.02100", "0.02110"),
+                              depth5("btcusdt@depth5@100ms", "100000.00", "100010.00"),
+                              depth5("ethbtc@depth5@100ms",  "0.02120", "0.02130")})
+            w.append(RecordKind::Frame, {}, f, ts += 1'000'000);
+    }
+
+    const Books ids;
+    auto run = [&](ExecutionMode execution, InventoryOptions inventory, double* gain = nullptr,
+                   bool pipelined = false) {
+        const auto decisions = temp_path("inventory_decisions.log");
+        BotOptions options;
+        options.replay = true;
+        options.decision_log = decisions;
+        options.execution = execution;
+        options.inventory = std::move(inventory);
+        options.pipeline.enabled = pipelined;
+        boost::asio::io_context ioc;
+        {
+            TriArbBot bot{ioc, options};
+            bot.start();
+            JournalReader r(journal);
+            REQUIRE(replay_journal(bot, ioc, r, 0.0) == 4);
+            if (gain) {
+                const auto& inv = bot.inventory();
+                *gain = 0;
+                for (AssetId a : {ids.usdt, ids.eth, ids.btc})
+                    *gain += inv.home_value(a, inv.drift(a));
+            }
+        }
+        auto lines = read_lines(decisions);
+        std::filesystem::remove(decisions);
+        return lines;
+    };
+
+    const auto sequential = run(ExecutionMode::Sequential, {});
+    double gain = 0;
+    const auto concurrent = run(ExecutionMode::Concurrent, targets(1000, 1, 0.1), &gain);
+
+    const auto fires = count_with(sequential, " FIRE ");
+    REQUIRE(fires > 0);
+    CHECK(count_with(concurrent, " FIRE ") == fires);
+    CHECK(count_with(concurrent, " ORDER ") == 3 * fires);
+    CHECK(count_with(concurrent, " FILL ") == 3 * fires);
+    CHECK(count_with(concurrent, " RISK ") == 0);
+
+    // The profit is left where step rounding leaves it, mostly outside home
+    CHECK(gain > 0.5);
+
+    // Fills come back through the pipeline in any order; the lines do not change
+    auto pipelined = run(ExecutionMode::Concurrent, targets(1000, 1, 0.1), nullptr, true);
+    auto single = concurrent;
+    std::sort(pipelined.begin(), pipelined.end());
+    std::sort(single.begin(), single.end());
+    CHECK(pipelined == single);
+
+    // Without the ETH to sell, the triangle is not sent at all
+    const auto short_eth = run(ExecutionMode::Concurrent, targets(1000, 0, 0.1));
+    CHECK(count_with(short_eth, " SKIP 1 ETHBTC inventory-short") == fires);
+    CHECK(count_with(short_eth, " ORDER ") == 0);
+
+    std::filesystem::remove(journal);
+}
@@ -0,0 +1,145 @@
+#include "journal.hpp"
+#include "replay.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace triarb;
+
+TEST_CASE("Journal records read back in order", "[journal]") {
+    const auto path = temp_path("journal_roundtrip.bin");
+    {
+        JournalWriter w(path);
+        w.append(RecordKind::Frame, {}, "first", 100);
+        w.append(RecordKind::Snapshot, "ETHBTC", R"({"lastUpdateId":7})", 200);
+        w.append(RecordKind::Frame, {}, "", 300);
+        REQUIRE(w.size() % 8 == 0);
+    }
+
+    JournalReader r(path);
+    JournalRecord rec;
+    REQUIRE(r.next(rec));
+    CHECK(rec.recvNs == 100);
+    CHECK(rec.kind == RecordKind::Frame);
+    CHECK(rec.tag.empty());
+    CHECK(rec.payload == "first");
+
+    REQUIRE(r.next(rec));
+    CHECK(rec.kind == RecordKind::Snapshot);
+    CHECK(rec.tag == "ETHBTC");
+    CHECK(rec.payload == R"({"lastUpdateId":7})");
+
+    REQUIRE(r.next(rec));
+    CHECK(rec.recvNs == 300);
+    CHECK(rec.payload.empty());
+    CHECK_FALSE(r.next(rec));
+
+    r.rewind();
+    REQUIRE(r.next(rec));
+    CHECK(rec.payload == "first");
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Journal grows past its chunk and stays readable mid-write", "[journal]") {
+    const auto path = temp_path("journal_grow.bin");
+    JournalWriter w(path, 4096);
+    const std::string payload(1000, 'x');
+    for (std::uint64_t i = 0; i < 50; ++i)
+        w.append(RecordKind::Frame, {}, payload, i);
+
+    // The writer is still alive, as after a crash: the file is chunk-sized
+    // with a zero tail, and the reader must stop at the last record.
+    REQUIRE(std::filesystem::file_size(path) > w.size());
+    JournalReader r(path);
+    JournalRecord rec;
+    std::uint64_t n = 0;
+    while (r.next(rec)) {
+        CHECK(rec.recvNs == n);
+        CHECK(rec.payload.size() == payload.size());
+        ++n;
+    }
+    CHECK(n == 50);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Journal reader rejects other files", "[journal]") {
+    const auto path = temp_path("journal_bogus.bin");
+    std::ofstream(path) << "definitely not a journal";
+    CHECK_THROWS_AS(JournalReader(path), std::runtime_error);
+    CHECK_THROWS_AS(JournalReader(temp_path("journal_missing.bin")), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Replay speed parses max, realtime and multipliers", "[journal]") {
+    CHECK(parse_replay_speed("max") == 0.0);
+    CHECK(parse_replay_speed("realtime") == 1.0);
+    CHECK(parse_replay_speed("10x") == 10.0);
+    CHECK(parse_replay_speed("0.5x") == 0.5);
+    CHECK_FALSE(parse_replay_speed("10"));
+    CHECK_FALSE(parse_replay_speed("0x"));
+    CHECK_FALSE(parse_replay_speed("fastx"));
+}
+
+TEST_CASE("Replaying a journal gives byte-identical decisions", "[journal]") {
+    const auto journal = temp_path("journal_replay.bin");
+    {
+        // ETHUSDT ask 2000, ETHBTC bid 0.021, BTCUSDT bid 100000: buying ETH
+        // with USDT and selling it round through BTC returns about 5%.
+        JournalWriter w(journal);
+        std::uint64_t ts = 1'700'000'000'000'000'000;
+        for (const auto& f : {depth5("ethusdt@depth5@100ms", "1999.00", "2000.00"),
+                              depth5("ethbtc@depth5@100ms",  "0.02100", "0.02110"),
+                              depth5("btcusdt@depth5@100ms", "100000.00", "100010.00"),
+                              depth5("ethbtc@depth5@100ms",  "0.02120", "0.02130")})
+            w.append(RecordKind::Frame, {}, f, ts += 1'000'000);
+    }
+
+    auto run = [&](const std::string& decisions) {
+        BotOptions options;
+        options.replay = true;
+        options.decision_log = decisions;
+        boost::asio::io_context ioc;
+        {
+            TriArbBot bot{ioc, options};
+            bot.start();
+            JournalReader r(journal);
+            REQUIRE(replay_journal(bot, ioc, r, 0.0) == 4);
+        }
+        return read_file(decisions);
+    };
+
+    const auto first  = run(temp_path("decisions_1.log"));
+    const auto second = run(temp_path("decisions_2.log"));
+
+    CHECK(first == second);
+    CHECK(first.find(" FIRE USDT->ETH->BTC->USDT") != std::string::npos);
+    CHECK(first.find(" ORDER 0 ETHUSDT BUY 0.0075 @ 2000.00") != std::string::npos);
+    CHECK(first.find(" FILL 2 BTCUSDT") != std::string::npos);
+
+    std::filesystem::remove(journal);
+    std::filesystem::remove(temp_path("decisions_1.log"));
+    std::filesystem::remove(temp_path("decisions_2.log"));
+}
+
+TEST_CASE("Journal append on the frame path", "[.][benchmark][journal]") {
+    const auto path  = temp_path("journal_bench.bin");
+    const auto frame = depth5("btcusdt@depth5@100ms", "104312.01000000", "104312.02000000");
+    JournalWriter w(path);
+
+    BENCHMARK("clock only") {
+        return journal_clock_ns();
+    };
+    BENCHMARK("append") {
+        w.append(RecordKind::Frame, {}, frame, 0);
+        return w.size();
+    };
+    BENCHMARK("clock + append") {
+        w.append(RecordKind::Frame, {}, frame, journal_clock_ns());
+        return w.size();
+    };
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,119 @@
+#include "latency.hpp"
+#include "metrics_server.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace triarb;
+
+TEST_CASE("Histogram buckets tile the value range in order", "[latency]") {
+    using H = LatencyHistogram;
+    for (std::size_t b = 0; b + 1 < H::kBuckets; ++b) {
+        REQUIRE(H::bucket(H::upper_bound(b)) == b);
+        REQUIRE(H::bucket(H::upper_bound(b) + 1) == b + 1);
+    }
+    // Relative bucket width stays within 1/32 above the linear range.
+    for (std::size_t b = H::kLinear; b + 1 < H::kBuckets; ++b) {
+        const double lo = static_cast<double>(H::upper_bound(b - 1) + 1);
+        const double hi = static_cast<double>(H::upper_bound(b));
+        REQUIRE((hi - lo) / lo < 1.0 / 32);
+    }
+    CHECK(H::bucket(~std::uint64_t{0}) == H::kBuckets - 1);
+}
+
+TEST_CASE("Histogram percentiles are within bucket precision", "[latency]") {
+    LatencyHistogram h;
+    CHECK(h.percentile(0.5) == 0);
+
+    for (std::uint64_t v = 1; v <= 100000; ++v) h.record(v);
+    CHECK(h.count() == 100000);
+    CHECK(h.max() == 100000);
+
+    for (double q : {0.5, 0.99, 0.999}) {
+        const double exact = q * 100000;
+        const double got = static_cast<double>(h.percentile(q));
+        CHECK(got >= exact);
+        CHECK(got <= exact * 1.032);
+    }
+    CHECK(h.percentile(1.0) == 100000);
+
+    h.reset();
+    CHECK(h.count() == 0);
+    CHECK(h.max() == 0);
+}
+
+TEST_CASE("Histogram records from many threads without losing counts", "[latency]") {
+    LatencyHistogram h;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t)
+        writers.emplace_back([&h, t] {
+            for (std::uint64_t i = 0; i < 50000; ++i) h.record(i * (t + 1));
+        });
+    for (auto& w : writers) w.join();
+
+    CHECK(h.count() == 200000);
+    CHECK(h.max() == 49999 * 4);
+}
+
+TEST_CASE("Metrics endpoint serves Prometheus text", "[latency]") {
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+
+    LatencyMetrics metrics;
+    metrics.record(Span::Parse, 1500);
+    metrics.record(Span::TickToTrade, 42000);
+
+    net::io_context ioc;
+    MetricsServer server(ioc, 0, metrics);
+    server.start();
+    std::thread io([&ioc] { ioc.run(); });
+
+    auto get = [&](const std::string& target) {
+        net::io_context client;
+        tcp::socket s(client);
+        s.connect({net::ip::make_address("127.0.0.1"), server.port()});
+        const std::string req = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        net::write(s, net::buffer(req));
+        std::string res;
+        boost::system::error_code ec;
+        net::read(s, net::dynamic_buffer(res), ec);   // until the server closes
+        return res;
+    };
+
+    const auto ok = get("/metrics");
+    CHECK(ok.rfind("HTTP/1.1 200", 0) == 0);
+    CHECK(ok.find("# TYPE triarb_latency_ns summary") != std::string::npos);
+    CHECK(ok.find("triarb_latency_ns{stage=\"parse\",quantile=\"0.5\"} 1500") != std::string::npos);
+    CHECK(ok.find("triarb_latency_ns_count{stage=\"tick_to_trade\"} 1") != std::string::npos);
+    CHECK(ok.find("triarb_latency_ns_max{stage=\"tick_to_trade\"} 42000") != std::string::npos);
+
+    CHECK(get("/other").rfind("HTTP/1.1 404", 0) == 0);
+
+    ioc.stop();
+    io.join();
+}
+
+TEST_CASE("Instrumentation overhead per stamp", "[.][benchmark][latency]") {
+    auto h = std::make_unique<LatencyHistogram>();
+    std::uint64_t v = 1234;
+
+    BENCHMARK("now_ns") {
+        return now_ns();
+    };
+    BENCHMARK("record") {
+        v = v * 6364136223846793005ull + 1442695040888963407ull;
+        h->record(v >> 44);
+        return v;
+    };
+    std::uint64_t last = now_ns();
+    BENCHMARK("now_ns + record (one stage)") {
+        const auto t = now_ns();
+        h->record(t - last);
+        last = t;
+        return t;
+    };
+}
@@ -0,0 +1,111 @@
+#include "gateway.hpp"
+#include "order_template.hpp"
+#include "allocation_counter.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <string>
+
+using namespace triarb;
+
+namespace {
+
+const SymbolScale btcusdt{{1, 2}, {1, 5}};
+const SymbolScale shibusdt{{1, 8}, {1, 0}};
+const ApiKeys keys{"vmPUZE6mv9SD5VNHk4HlWFsOr6aKE2zvsw0MuIgwCIPy6utIco14y7Ju91duEh8A",
+                   "NhqPtmdSJYdKjVHjA7PZj4Mge3R5YNiP1e3UZjInClVN65XAbvqqM6A7H5fATj0j"};
+
+std::string signed_body(std::string_view symbol, std::string_view side, Qty qty, Price price,
+                        const SymbolScale& scale, std::int64_t ts)
+{
+    auto body = order_body(symbol, side, qty, price, scale, ts);
+    return body + "&signature=" + hmac_sha256(keys.secret, body);
+}
+
+} // namespace
+
+TEST_CASE("Hex encoding goes through the table", "[order_template]") {
+    const unsigned char bytes[] = {0x00, 0x0f, 0xab, 0xff};
+    char out[8];
+    CHECK(std::string(out, hex_encode(bytes, sizeof bytes, out)) == "000fabff");
+}
+
+TEST_CASE("Cached HMAC state signs like a fresh HMAC", "[order_template]") {
+    // RFC 4231, test case 2
+    char out[HmacSha256::kHexSize];
+    HmacSha256 jefe("Jefe");
+    CHECK(std::string(out, jefe.sign_hex("what do ya want for nothing?", out)) ==
+          "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+    for (const std::string& key : {std::string(), std::string("k"), std::string(64, 'x'),
+                                  std::string(131, 'y'), keys.secret}) {
+        const HmacSha256 signer(key);
+        for (const std::string& msg : {std::string(), std::string("symbol=BTCUSDT"), std::string(300, 'm')}) {
+            CHECK(std::string(out, signer.sign_hex(msg, out)) == hmac_sha256(key, msg));
+            CHECK(std::string(out, signer.sign_hex(msg, out)) == hmac_sha256(key, msg));
+        }
+    }
+}
+
+TEST_CASE("REST order templates match order_body byte for byte", "[order_template]") {
+    const HmacSha256 signer(keys.secret);
+    OrderTemplate buy("BTCUSDT", "BUY", keys.key);
+    OrderTemplate sell("SHIBUSDT", "SELL", keys.key);
+
+    // Longer then shorter fields, so nothing of a previous order survives
+    for (const double px : {104312.01, 9.5, 1234567.89, 0.01}) {
+        for (const double q : {12.34567, 0.00001, 0.5}) {
+            const Qty qty = btcusdt.qty_floor(q);
+            const Price price = btcusdt.price_near(px);
+            CHECK(buy.rest_body(qty, price, btcusdt, 1'700'000'000'123, signer) ==
+                  signed_body("BTCUSDT", "BUY", qty, price, btcusdt, 1'700'000'000'123));
+        }
+    }
+    const Qty many = shibusdt.qty_floor(12'345'678);
+    const Price tiny = shibusdt.price_near(0.00001234);
+    CHECK(sell.rest_body(many, tiny, shibusdt, 1'700'000'000'000, signer) ==
+          signed_body("SHIBUSDT", "SELL", many, tiny, shibusdt, 1'700'000'000'000));
+}
+
+TEST_CASE("WebSocket order templates match ws_order_request byte for byte", "[order_template]") {
+    const HmacSha256 signer(keys.secret);
+    OrderTemplate sell("ETHBTC", "SELL", keys.key);
+    const SymbolScale ethbtc{{1, 5}, {1, 4}};
+
+    std::uint64_t id = 1;
+    for (const double px : {0.02131, 0.1}) {
+        for (const double q : {0.0001, 250.5}) {
+            const Qty qty = ethbtc.qty_floor(q);
+            const Price price = ethbtc.price_near(px);
+            CHECK(sell.ws_request(id, qty, price, ethbtc, 1'700'000'000'456, signer) ==
+                  ws_order_request(id, "ETHBTC", "SELL", qty, price, ethbtc, 1'700'000'000'456, keys));
+            id = id * 977 + 13;
+        }
+    }
+}
+
+TEST_CASE("Building and signing an order allocates nothing", "[order_template]") {
+    const HmacSha256 signer(keys.secret);
+    OrderTemplate buy("BTCUSDT", "BUY", keys.key);
+    const Qty qty = btcusdt.qty_floor(0.00123);
+    const Price price = btcusdt.price_near(104312.01);
+
+    std::size_t bytes = 0;
+    const auto before = thread_allocations();
+    for (std::int64_t ts = 1'700'000'000'000; ts < 1'700'000'000'100; ++ts) {
+        bytes += buy.rest_body(qty, price, btcusdt, ts, signer).size();
+        bytes += buy.ws_request(static_cast<std::uint64_t>(ts), qty, price, btcusdt, ts, signer).size();
+    }
+    const auto allocations = thread_allocations() - before;
+
+    CHECK(bytes > 0);
+    CHECK(allocations == 0);
+
+    // The counter does see the allocating path
+    const auto counted = thread_allocations();
+    CHECK(signed_body("BTCUSDT", "BUY", qty, price, btcusdt, 1).size() > 0);
+    CHECK(thread_allocations() > counted);
+}
+
+TEST_CASE("Templates refuse symbols they cannot hold", "[order_template]") {
+    CHECK_THROWS_AS(OrderTemplate(std::string(400, 'X'), "BUY", keys.key), std::length_error);
+}
@@ -1,5 +1,8 @@
 #include "orderbook.hpp"
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <atomic>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -31,10 +34,11 @@ TEST_CASE("OrderBook update sequence validation", "[orderbook]") {
     OrderBook book("BTCUSDT");
     
     // Initial update
-    book.update(2, Quote{100.0, 1.0}, Quote{101.0, 1.0});
+    REQUIRE(book.update(2, Quote{100.0, 1.0}, Quote{101.0, 1.0}));
     
-    // Try older update - should be ignored
-    book.update(1, Quote{99.0, 1.0}, Quote{102.0, 1.0});
+    // Try older update and a second copy - should be ignored
+    REQUIRE_FALSE(book.update(1, Quote{99.0, 1.0}, Quote{102.0, 1.0}));
+    REQUIRE_FALSE(book.update(2, Quote{99.0, 1.0}, Quote{102.0, 1.0}));
     
     auto bestBid = book.bestBid();
     auto bestAsk = book.bestAsk();
@@ -69,3 +73,195 @@ TEST_CASE("OrderBook thread safety", "[orderbook]") {
     REQUIRE(bestBid.px >= 100.0);
     REQUIRE(bestAsk.px >= 101.0);
 }
+
+namespace {
+
+WireLevel wire(const char* px, const char* qty)
+{
+    WireLevel w;
+    REQUIRE(parse_fixed(px, w.px));
+    REQUIRE(parse_fixed(qty, w.qty));
+    return w;
+}
+
+} // namespace
+
+TEST_CASE("OrderBook keeps levels sorted across diffs", "[orderbook]") {
+    OrderBook book("BTCUSDT");
+    const WireLevel bids[] = {wire("100.0", "1.0"), wire("99.0", "2.0"), wire("98.0", "3.0")};
+    const WireLevel asks[] = {wire("101.0", "1.0"), wire("102.0", "2.0")};
+    book.apply_snapshot(10, bids, asks);
+
+    const WireLevel diffBids[] = {wire("99.5", "4.0"), wire("98.0", "0.0"), wire("100.0", "1.5")};
+    const WireLevel diffAsks[] = {wire("100.5", "0.5"), wire("102.0", "0.00000000"), wire("103.0", "7.0")};
+    book.apply_diff(11, diffBids, diffAsks);
+
+    Quote out[4];
+    REQUIRE(book.depth(BookSide::Bid, out) == 3);
+    REQUIRE(out[0].px == 100.0); REQUIRE(out[0].qty == 1.5);
+    REQUIRE(out[1].px == 99.5);  REQUIRE(out[1].qty == 4.0);
+    REQUIRE(out[2].px == 99.0);
+
+    REQUIRE(book.depth(BookSide::Ask, out) == 3);
+    REQUIRE(out[0].px == 100.5);
+    REQUIRE(out[1].px == 101.0);
+    REQUIRE(out[2].px == 103.0);
+
+    REQUIRE(book.bestBid().px == 100.0);
+    REQUIRE(book.bestAsk().px == 100.5);
+
+    // Top-N reads stop at the requested size.
+    Quote top[1];
+    REQUIRE(book.depth(BookSide::Ask, top) == 1);
+    REQUIRE(top[0].px == 100.5);
+}
+
+TEST_CASE("OrderBook takes the top from a ticker and keeps the depth below", "[orderbook]") {
+    OrderBook book("BTCUSDT");
+    const WireLevel bids[] = {wire("100.0", "1.0"), wire("99.0", "2.0"), wire("98.0", "3.0")};
+    const WireLevel asks[] = {wire("101.0", "1.0"), wire("102.0", "2.0")};
+    book.apply_snapshot(10, bids, asks);
+
+    // Older than the snapshot: ignored
+    REQUIRE_FALSE(book.apply_top(9, wire("97.0", "1.0"), wire("97.5", "1.0")));
+    REQUIRE(book.bestBid().px == 100.0);
+
+    // Bid 100 taken, 99 now best with less size; a better ask inserted
+    REQUIRE(book.apply_top(11, wire("99.0", "0.5"), wire("100.5", "4.0")));
+    Quote out[4];
+    REQUIRE(book.depth(BookSide::Bid, out) == 2);
+    REQUIRE(out[0].px == 99.0); REQUIRE(out[0].qty == 0.5);
+    REQUIRE(out[1].px == 98.0); REQUIRE(out[1].qty == 3.0);
+    REQUIRE(book.depth(BookSide::Ask, out) == 3);
+    REQUIRE(out[0].px == 100.5); REQUIRE(out[0].qty == 4.0);
+    REQUIRE(out[1].px == 101.0);
+    REQUIRE(book.top().updateId == 11);
+
+    // A bid above every level replaces nothing below it
+    REQUIRE(book.apply_top(12, wire("100.2", "1.0"), wire("100.5", "3.0")));
+    REQUIRE(book.levels(BookSide::Bid) == 3);
+    REQUIRE(book.bestBid().px == 100.2);
+    REQUIRE(book.bestAsk().qty == 3.0);
+    REQUIRE_FALSE(book.apply_top(12, wire("1.0", "1.0"), wire("2.0", "1.0")));
+}
+
+TEST_CASE("OrderBook keys levels by tick of the symbol scale", "[orderbook]") {
+    OrderBook book("ETHBTC", SymbolScale{{1, 5}, {1, 4}});
+
+    // Differently written prices on the same tick update one level.
+    const WireLevel bids[] = {wire("0.02391000", "41.00000000")};
+    book.apply_snapshot(1, bids, {});
+    const WireLevel diff[] = {wire("0.02391", "1.5")};
+    book.apply_diff(2, diff, {});
+
+    REQUIRE(book.levels(BookSide::Bid) == 1);
+    REQUIRE(book.bestBid().px == 0.02391);
+    REQUIRE(book.bestBid().qty == 1.5);
+
+    // Doubles are rounded onto tick and step.
+    book.update(3, Quote{0.023914, 2.00004}, Quote{0.023926, 1.0});
+    REQUIRE(book.bestBid().px == 0.02391);
+    REQUIRE(book.bestBid().qty == 2.0);
+    REQUIRE(book.bestAsk().px == 0.02393);
+    REQUIRE(book.scale().tick().scale == 5);
+}
+
+TEST_CASE("OrderBook clear resets levels and update id", "[orderbook]") {
+    OrderBook book("BTCUSDT");
+    book.update(5, Quote{100.0, 1.0}, Quote{101.0, 1.0});
+    book.clear();
+    REQUIRE(book.lastUpdateId() == 0);
+    REQUIRE(book.levels(BookSide::Bid) == 0);
+    REQUIRE(book.bestAsk().px == 0.0);
+
+    book.update(1, Quote{90.0, 1.0}, Quote{91.0, 1.0});
+    REQUIRE(book.bestBid().px == 90.0);
+}
+
+TEST_CASE("OrderBook top is consistent under one writer and many readers", "[orderbook]") {
+    OrderBook book("BTCUSDT");
+    std::atomic_bool done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> backwards{0};
+
+    // Every update encodes its id in both sides, so a mixed pair is detectable.
+    std::thread writer([&] {
+        for (uint64_t id = 1; id <= 200000; ++id) {
+            const double px = static_cast<double>(id);
+            book.update(id, Quote{px, px}, Quote{px + 1.0, px});
+        }
+        done = true;
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            while (!done) {
+                const auto top = book.top();
+                if (top.updateId == 0) continue;
+                const double px = static_cast<double>(top.updateId);
+                if (top.bid.px != px || top.bid.qty != px ||
+                    top.ask.px != px + 1.0 || top.ask.qty != px)
+                    ++torn;
+                if (top.updateId < last)
+                    ++backwards;
+                last = top.updateId;
+            }
+        });
+    }
+
+    writer.join();
+    for (auto& t : readers) t.join();
+
+    REQUIRE(torn == 0);
+    REQUIRE(backwards == 0);
+    REQUIRE(book.top().updateId == 200000);
+}
+
+namespace {
+
+// The read path OrderBook had before the seqlock: one lock per accessor.
+struct MutexQuotes
+{
+    Quote bid{0.0, 0.0};
+    Quote ask{0.0, 0.0};
+    mutable std::mutex mutex;
+
+    void update(const Quote& b, const Quote& a)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bid = b;
+        ask = a;
+    }
+    Quote bestBid() const { std::lock_guard<std::mutex> lock(mutex); return bid; }
+    Quote bestAsk() const { std::lock_guard<std::mutex> lock(mutex); return ask; }
+};
+
+} // namespace
+
+TEST_CASE("OrderBook read contention: seqlock vs mutex", "[.][benchmark][orderbook]") {
+    OrderBook book("BTCUSDT");
+    MutexQuotes locked;
+    std::atomic_bool done{false};
+
+    // A writer hammering both books for the duration of the benchmarks.
+    std::thread writer([&] {
+        for (uint64_t id = 1; !done; ++id) {
+            const double px = static_cast<double>(id % 1000);
+            book.update(id, Quote{px, 1.0}, Quote{px + 1.0, 1.0});
+            locked.update(Quote{px, 1.0}, Quote{px + 1.0, 1.0});
+        }
+    });
+
+    BENCHMARK("mutex bestBid()+bestAsk() under writer") {
+        return locked.bestBid().px + locked.bestAsk().px;
+    };
+    BENCHMARK("seqlock top() under writer") {
+        const auto top = book.top();
+        return top.bid.px + top.ask.px;
+    };
+
+    done = true;
+    writer.join();
+}
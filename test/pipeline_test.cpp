@@ -0,0 +1,210 @@
+#include "async_log.hpp"
+#include "pipeline.hpp"
+#include "replay.hpp"
+#include "spsc_queue.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace triarb;
+
+/// A journal where every ETHBTC frame moves the USDT->ETH->BTC->USDT edge,
+/// so roughly one frame in three fires a triangle.
+static void write_firing_journal(const std::string& path, int frames, std::uint64_t gap_ns)
+{
+    JournalWriter w(path);
+    std::uint64_t ts = 1'700'000'000'000'000'000;
+    for (int i = 0; i < frames; ++i) {
+        const auto id = static_cast<std::uint64_t>(i + 1);
+        std::string f;
+        switch (i % 3) {
+        case 0: f = depth5("ethusdt@depth5@100ms", id, "1999.00", "2000.00"); break;
+        case 1: f = depth5("btcusdt@depth5@100ms", id, "100000.00", "100010.00"); break;
+        case 2: f = depth5("ethbtc@depth5@100ms", id, i % 2 ? "0.02100" : "0.02120",
+                           i % 2 ? "0.02110" : "0.02130"); break;
+        }
+        w.append(RecordKind::Frame, {}, f, ts += gap_ns);
+    }
+}
+
+TEST_CASE("SPSC queue is FIFO, bounded and wraps", "[pipeline]") {
+    SpscQueue<int> q(3);
+    REQUIRE(q.capacity() == 4);
+    CHECK(q.front() == nullptr);
+
+    int next = 0, expect = 0;
+    for (int round = 0; round < 5; ++round) {
+        while (int* slot = q.claim()) {
+            *slot = next++;
+            q.publish();
+        }
+        CHECK(q.pushed() - q.popped() == 4);
+        for (int k = 0; k < 3; ++k) {
+            REQUIRE(q.front());
+            CHECK(*q.front() == expect++);
+            q.pop();
+        }
+    }
+    CHECK(q.pushed() == static_cast<std::uint64_t>(next));
+    CHECK_FALSE(q.empty());
+}
+
+TEST_CASE("SPSC queue hands items between threads in order", "[pipeline]") {
+    SpscQueue<std::uint64_t> q(64);
+    constexpr std::uint64_t kItems = 200'000;
+
+    std::thread producer([&] {
+        for (std::uint64_t i = 0; i < kItems; ++i) {
+            std::uint64_t* slot;
+            while (!(slot = q.claim())) std::this_thread::yield();
+            *slot = i;
+            q.publish();
+        }
+    });
+
+    std::uint64_t expect = 0;
+    bool in_order = true;
+    while (expect < kItems) {
+        if (std::uint64_t* v = q.front()) {
+            in_order &= *v == expect++;
+            q.pop();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(in_order);
+    CHECK(q.empty());
+}
+
+TEST_CASE("Worker sleeps when idle and wake() never loses an item", "[pipeline]") {
+    SpscQueue<int> q(16);
+    std::vector<int> seen;
+    std::atomic<int> count{0};
+
+    Worker worker("triarb-test", -1);
+    worker.start([&] {
+        bool busy = false;
+        while (int* v = q.front()) {
+            seen.push_back(*v);
+            q.pop();
+            count.fetch_add(1, std::memory_order_release);
+            busy = true;
+        }
+        return busy;
+    });
+
+    // Bursts with pauses in between, so the worker goes to sleep and has to
+    // be woken many times.
+    for (int i = 0; i < 2000; ++i) {
+        int* slot;
+        while (!(slot = q.claim())) std::this_thread::yield();
+        *slot = i;
+        q.publish();
+        worker.wake();
+        if (i % 50 == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (count.load(std::memory_order_acquire) < 2000 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    worker.stop();
+
+    REQUIRE(seen.size() == 2000);
+    CHECK(std::is_sorted(seen.begin(), seen.end()));
+}
+
+TEST_CASE("Pipeline options come from the environment", "[pipeline]") {
+    ::setenv("THREADING", "pipelined", 1);
+    ::setenv("STRATEGY_CPU", "0", 1);
+    ::setenv("STRATEGY_BUSY_POLL", "1", 1);
+    const auto options = load_pipeline_options_from_env();
+    CHECK(options.enabled);
+    CHECK(options.strategy_cpu == 0);
+    CHECK(options.net_cpu == -1);
+    CHECK(options.busy_poll);
+
+    ::setenv("EGRESS_CPU", "100000", 1);
+    CHECK_THROWS(load_pipeline_options_from_env());
+
+    for (const char* name : {"THREADING", "STRATEGY_CPU", "STRATEGY_BUSY_POLL", "EGRESS_CPU"})
+        ::unsetenv(name);
+    CHECK_FALSE(load_pipeline_options_from_env().enabled);
+}
+
+TEST_CASE("An unknown THREADING mode is refused", "[pipeline]") {
+    ::setenv("THREADING", "single", 1);
+    CHECK_FALSE(load_pipeline_options_from_env().enabled);
+    for (const char* bad : {"pipelind", "Pipelined", "", "sharded "}) {
+        INFO("THREADING='" << bad << "'");
+        ::setenv("THREADING", bad, 1);
+        CHECK_THROWS_AS(load_pipeline_options_from_env(), std::invalid_argument);
+    }
+    ::unsetenv("THREADING");
+}
+
+TEST_CASE("Pipelined replay takes the same decisions as single-threaded", "[pipeline]") {
+    const auto journal = temp_path("pipeline_replay.bin");
+    write_firing_journal(journal, 60, 1'000'000);
+
+    auto run = [&](bool pipelined) {
+        const auto decisions = temp_path(pipelined ? "pipeline_on.log" : "pipeline_off.log");
+        BotOptions options;
+        options.replay = true;
+        options.decision_log = decisions;
+        options.pipeline.enabled = pipelined;
+        boost::asio::io_context ioc;
+        {
+            TriArbBot bot{ioc, options};
+            bot.start();
+            JournalReader r(journal);
+            REQUIRE(replay_journal(bot, ioc, r, 0.0) == 60);
+            if (pipelined) CHECK(bot.latency()[Span::Queue].count() == 60);
+        }
+        // Fills come back asynchronously, so lines of different triangles
+        // may interleave differently; the set of lines may not.
+        auto lines = read_lines(decisions);
+        std::sort(lines.begin(), lines.end());
+        std::filesystem::remove(decisions);
+        return lines;
+    };
+
+    const auto single    = run(false);
+    const auto pipelined = run(true);
+    CHECK(single.size() > 20);
+    CHECK(single == pipelined);
+    std::filesystem::remove(journal);
+}
+
+TEST_CASE("Tick-to-trade, single-threaded vs pipelined", "[.][benchmark][pipeline]") {
+    // Frames paced 200 us apart, so the pipeline is measured handing off
+    // frames as they come rather than working off a backlog.
+    const auto journal = temp_path("pipeline_bench.bin");
+    write_firing_journal(journal, 6000, 200'000);
+
+    for (const bool pipelined : {false, true}) {
+        BotOptions options;
+        options.replay = true;
+        options.pipeline.enabled = pipelined;
+        boost::asio::io_context ioc;
+        std::ostringstream report;
+        {
+            TriArbBot bot{ioc, options};
+            bot.start();
+            JournalReader r(journal);
+            replay_journal(bot, ioc, r, 1.0);
+            logger().flush();
+            bot.latency().report(report);
+        }
+        WARN((pipelined ? "pipelined\n" : "single-threaded\n") << report.str());
+    }
+    std::filesystem::remove(journal);
+}
@@ -0,0 +1,194 @@
+#include "config.hpp"
+#include "shard_plan.hpp"
+#include "triarb_bot.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace triarb;
+
+namespace {
+
+// The six traded symbols of test/data/exchange_info.json at prices that
+// agree with each other, then three moves: one that opens
+// USDT->BTC->ETH->USDT, one that closes it, and one that opens the BNB
+// triangles.  Every frame after the first six is applied on its own.
+struct Move {
+    const char* stream;
+    const char* bid;
+    const char* ask;
+};
+const std::vector<Move> kBooks{
+    {"btcusdt@depth5@100ms", "99990.00", "100000.00"},
+    {"ethusdt@depth5@100ms", "1999.90", "2000.00"},
+    {"bnbusdt@depth5@100ms", "599.90", "600.00"},
+    {"ethbtc@depth5@100ms", "0.01999", "0.02000"},
+    {"bnbbtc@depth5@100ms", "0.005999", "0.006000"},
+    {"bnbeth@depth5@100ms", "0.29990", "0.30000"}};
+const std::vector<Move> kMoves{
+    {"ethbtc@depth5@100ms", "0.01940", "0.01950"},
+    {"ethbtc@depth5@100ms", "0.01999", "0.02000"},
+    {"bnbusdt@depth5@100ms", "640.00", "640.10"}};
+
+// Replays the books and moves and returns the decision log.
+std::string replay_moves(std::size_t shards)
+{
+    const auto decisions = temp_path("sharding_decisions.log");
+    BotOptions options;
+    options.replay          = true;
+    options.decision_log    = decisions;
+    options.pipeline.shards = shards;
+    boost::asio::io_context ioc;
+    {
+        TriArbBot bot{ioc, options};
+        bot.start();
+        std::uint64_t ts = 1'700'000'000'000'000'000;
+        std::uint64_t id = 0;
+        auto play = [&](const Move& m) {
+            bot.replay({ts += 1'000'000, RecordKind::Frame, {},
+                        depth5(m.stream, ++id, m.bid, m.ask, "10.00000000")});
+        };
+        for (const auto& m : kBooks) play(m);
+        bot.wait_idle();
+        for (const auto& m : kMoves) {
+            play(m);
+            bot.wait_idle();
+        }
+
+        // A frame for no symbol the bot knows is dropped like a live one
+        play({"dogeusdt@depth5@100ms", "1", "2"});
+        bot.wait_idle();
+        bot.stop();
+    }
+    auto log = read_file(decisions);
+    std::filesystem::remove(decisions);
+    return log;
+}
+
+} // namespace
+
+TEST_CASE("THREADING=sharded takes SHARDS and SHARD_CPUS", "[sharding]") {
+    CHECK(load_pipeline_options_from_env().shards == 0);
+
+    ::setenv("THREADING", "sharded", 1);
+    auto options = load_pipeline_options_from_env();
+    CHECK_FALSE(options.enabled);
+    CHECK(options.shards == kDefaultShards);
+
+    ::setenv("SHARDS", "4", 1);
+    ::setenv("SHARD_CPUS", "0,0", 1);
+    options = load_pipeline_options_from_env();
+    CHECK(options.shards == 4);
+    CHECK(options.shard_cpus == std::vector<int>{0, 0});
+
+    ::setenv("SHARD_CPUS", "0,x", 1);
+    CHECK_THROWS_AS(load_pipeline_options_from_env(), std::invalid_argument);
+    ::setenv("SHARD_CPUS", "100000", 1);
+    CHECK_THROWS_AS(load_pipeline_options_from_env(), std::runtime_error);
+    ::unsetenv("SHARD_CPUS");
+    ::setenv("SHARDS", "0", 1);
+    CHECK_THROWS_AS(load_pipeline_options_from_env(), std::invalid_argument);
+    ::setenv("SHARDS", "3", 1);
+
+    // A journal is one stream of frames in arrival order
+    ::setenv("JOURNAL", temp_path("sharded.journal").c_str(), 1);
+    CHECK_THROWS_AS(load_bot_options_from_env(), std::invalid_argument);
+    ::unsetenv("JOURNAL");
+    CHECK(load_bot_options_from_env().pipeline.shards == 3);
+
+    for (const char* name : {"THREADING", "SHARDS"}) ::unsetenv(name);
+}
+
+TEST_CASE("The threads section picks the sharded mode", "[sharding]") {
+    auto config = parse_config(R"({"threads": {"threading": "sharded", "shards": 3,
+                                               "shard_cpus": [0]}})", {});
+    CHECK_FALSE(config.pipeline.enabled);
+    CHECK(config.pipeline.shards == 3);
+    CHECK(config.pipeline.shard_cpus == std::vector<int>{0});
+
+    // The count stays with the mode the environment chose
+    Config sharded;
+    sharded.pipeline.shards = 4;
+    CHECK(parse_config(R"({"threads": {"busy_poll": true}})", sharded).pipeline.shards == 4);
+    CHECK(parse_config(R"({"threads": {"shards": 6}})", sharded).pipeline.shards == 6);
+    config = parse_config(R"({"threads": {"threading": "pipelined"}})", sharded);
+    CHECK(config.pipeline.enabled);
+    CHECK(config.pipeline.shards == 0);
+    CHECK(parse_config(R"({"threads": {"threading": "sharded"}})", {}).pipeline.shards ==
+          kDefaultShards);
+
+    CHECK_THROWS_AS(parse_config(R"({"threads": {"threading": "sharded", "shards": 0}})", {}),
+                    std::invalid_argument);
+    CHECK_THROWS_AS(parse_config(R"({"threads": {"shard_cpus": [100000]}})", {}),
+                    std::runtime_error);
+}
+
+TEST_CASE("Symbols are dealt to shards by the triangles they rescan", "[sharding]") {
+    const TriangleEngine engine(load_exchange_info(data_file("exchange_info.json")), "USDT");
+    std::size_t traded = 0, total = 0, heaviest = 0;
+    for (SymbolId id = 0; id < engine.symbol_count(); ++id) {
+        const auto cost = engine.triangles_for(id).size();
+        traded  += cost > 0;
+        total   += cost;
+        heaviest = std::max(heaviest, cost);
+    }
+    REQUIRE(traded == 6);
+
+    const auto single = plan_shards(engine, 1);
+    CHECK(single.shards() == 1);
+    CHECK(single.symbols[0].size() == traded);
+    CHECK(single.shared == 0);
+
+    for (const std::size_t shards : {2, 3, 4}) {
+        INFO(shards << " shards");
+        const auto plan = plan_shards(engine, shards);
+        REQUIRE(plan.shards() == shards);
+
+        std::size_t dealt = 0;
+        for (std::size_t s = 0; s < shards; ++s) {
+            dealt += plan.symbols[s].size();
+            for (const SymbolId id : plan.symbols[s]) {
+                CHECK(plan.owner[id] == s);
+                CHECK_FALSE(engine.triangles_for(id).empty());
+            }
+        }
+        CHECK(dealt == traded);
+        CHECK(std::accumulate(plan.load.begin(), plan.load.end(), std::size_t{0}) == total);
+        const auto [low, high] = std::minmax_element(plan.load.begin(), plan.load.end());
+        CHECK(*high - *low <= heaviest);
+        CHECK(plan.shared > 0);
+
+        const auto again = plan_shards(engine, shards);
+        CHECK(again.owner == plan.owner);
+    }
+}
+
+TEST_CASE("A sharded replay decides as a single-threaded one does", "[sharding]") {
+    ::setenv("EXCHANGE_INFO", data_file("exchange_info.json").c_str(), 1);
+
+    const auto single = replay_moves(0);
+    CHECK(count(single, " FIRE ") == 2);
+    CHECK(count(single, " ORDER ") == 6);
+    for (const std::size_t shards : {1, 2, 4}) {
+        INFO(shards << " shards");
+        CHECK(replay_moves(shards) == single);
+    }
+
+    // Equal loads deal the six symbols three a shard
+    BotOptions options;
+    options.replay          = true;
+    options.pipeline.shards = 2;
+    boost::asio::io_context ioc;
+    TriArbBot bot{ioc, options};
+    REQUIRE(bot.shard_plan().shards() == 2);
+    for (std::size_t s = 0; s < 2; ++s)
+        CHECK(bot.shard_plan().symbols[s].size() == 3);
+    ::unsetenv("EXCHANGE_INFO");
+}
@@ -0,0 +1,199 @@
+#include "exchange_sim.hpp"
+#include "latency.hpp"
+#include "socket_tuning.hpp"
+#include "websocket_session.hpp"
+#include "test_support.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <linux/net_tstamp.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace triarb;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+
+int option(int fd, int level, int name)
+{
+    int value = 0;
+    socklen_t size = sizeof value;
+    REQUIRE(::getsockopt(fd, level, name, &value, &size) == 0);
+    return value;
+}
+
+// A connected loopback pair: the client side as a tcp_stream
+struct Loopback {
+    net::io_context                        ioc;
+    tcp::acceptor                          acceptor{ioc, {net::ip::address_v4::loopback(), 0}};
+    StampedStream<boost::beast::tcp_stream> client{ioc};
+    tcp::socket                            server{ioc};
+
+    Loopback()
+    {
+        client.next_layer().connect(acceptor.local_endpoint());
+        acceptor.accept(server);
+    }
+};
+
+} // namespace
+
+TEST_CASE("Socket options come from the environment", "[socket]") {
+    CHECK(load_socket_options_from_env() == SocketOptions{});
+
+    ::setenv("SOCKET_NODELAY", "0", 1);
+    ::setenv("SOCKET_BUSY_POLL", "50", 1);
+    ::setenv("SOCKET_RCVBUF", "1048576", 1);
+    ::setenv("SOCKET_QUICKACK", "true", 1);
+    ::setenv("SOCKET_TIMESTAMPS", "false", 1);
+    const auto options = load_socket_options_from_env();
+    CHECK_FALSE(options.nodelay);
+    CHECK(options.busy_poll_us == 50);
+    CHECK(options.rcvbuf == 1048576);
+    CHECK(options.sndbuf == 0);
+    CHECK(options.quickack);
+    CHECK_FALSE(options.timestamps);
+
+    ::setenv("SOCKET_SNDBUF", "64k", 1);
+    CHECK_THROWS_AS(load_socket_options_from_env(), std::invalid_argument);
+    ::setenv("SOCKET_SNDBUF", "-1", 1);
+    CHECK_THROWS_AS(load_socket_options_from_env(), std::invalid_argument);
+    ::unsetenv("SOCKET_SNDBUF");
+    ::setenv("SOCKET_QUICKACK", "yes", 1);
+    CHECK_THROWS_AS(load_socket_options_from_env(), std::invalid_argument);
+
+    for (const char* name : {"SOCKET_NODELAY", "SOCKET_BUSY_POLL", "SOCKET_RCVBUF",
+                             "SOCKET_QUICKACK", "SOCKET_TIMESTAMPS"})
+        ::unsetenv(name);
+}
+
+TEST_CASE("Tuning sets the options on a connected socket", "[socket]") {
+    Loopback link;
+    const int fd = link.client.lowest_layer().native_handle();
+
+    SocketOptions options;
+    options.rcvbuf = 64 * 1024;
+    options.sndbuf = 32 * 1024;
+    CHECK(tune_socket(fd, options) == 0);
+    CHECK(option(fd, IPPROTO_TCP, TCP_NODELAY) == 1);
+    CHECK(option(fd, SOL_SOCKET, SO_RCVBUF) >= 64 * 1024);   // the kernel doubles it
+    CHECK(option(fd, SOL_SOCKET, SO_SNDBUF) >= 32 * 1024);
+    CHECK(option(fd, SOL_SOCKET, SO_TIMESTAMPING) ==
+          (SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE));
+
+    options = {};
+    options.nodelay    = false;
+    options.timestamps = false;
+    CHECK(tune_socket(fd, options) == 0);
+    CHECK(option(fd, IPPROTO_TCP, TCP_NODELAY) == 0);
+}
+
+TEST_CASE("A stamped read carries the kernel's arrival time", "[socket]") {
+    Loopback link;
+    SocketOptions options;
+    options.quickack = true;
+    REQUIRE(tune_socket(link.client.lowest_layer().native_handle(), options) == 0);
+    link.client.stamp(true, true);
+
+    std::array<char, 64> buf{};
+    boost::beast::error_code result;
+    std::size_t got = 0;
+    bool done = false;
+    std::uint64_t read_ns = 0;
+    auto read = [&] {
+        done = false;
+        link.client.async_read_some(net::buffer(buf), [&](boost::beast::error_code ec, std::size_t n) {
+            result  = ec;
+            got     = n;
+            read_ns = now_ns();
+            done    = true;
+        });
+    };
+
+    SECTION("read waiting for the data") {
+        read();
+        link.ioc.poll();
+        CHECK_FALSE(done);
+
+        const auto sent = now_ns();
+        net::write(link.server, net::buffer(std::string("depth")));
+        REQUIRE(run_until(link.ioc, [&] { return done; }));
+        CHECK(!result);
+        CHECK(std::string(buf.data(), got) == "depth");
+        CHECK(link.client.kernel_ns() >= sent);
+        CHECK(link.client.kernel_ns() <= read_ns);
+    }
+
+    SECTION("data already waiting") {
+        const auto sent = now_ns();
+        net::write(link.server, net::buffer(std::string("ticker")));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        read();
+        CHECK_FALSE(done);                     // never completes inside the call
+        REQUIRE(run_until(link.ioc, [&] { return done; }));
+        CHECK(std::string(buf.data(), got) == "ticker");
+        CHECK(link.client.kernel_ns() >= sent);
+        CHECK(read_ns - link.client.kernel_ns() >= 5'000'000);   // it waited in the kernel
+    }
+
+    SECTION("peer closed") {
+        link.server.close();
+        read();
+        REQUIRE(run_until(link.ioc, [&] { return done; }));
+        CHECK(result == net::error::eof);
+        CHECK(link.client.kernel_ns() == 0);
+    }
+}
+
+TEST_CASE("Session frames carry the kernel arrival stamp", "[socket]") {
+    for (const bool stamps : {true, false}) {
+        INFO("timestamps " << stamps);
+        net::io_context ioc;
+        SimOptions sim_options;
+        sim_options.cert_file = data_file("standin_cert.pem");
+        sim_options.key_file  = data_file("standin_key.pem");
+        ExchangeSim sim(ioc, default_symbols(), sim_options);
+        auto& book = sim.book("BTCUSDT");
+        book.set(Side::Buy,  book.scale().price_near(99990.0),  book.scale().qty_near(1.0));
+        book.set(Side::Sell, book.scale().price_near(100000.0), book.scale().qty_near(1.0));
+
+        WebsocketOptions options;
+        options.socket.timestamps = stamps;
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> frames;
+        WebsocketSession session(ioc, "localhost", std::to_string(sim.port()),
+            "/stream?streams=btcusdt@depth5@100ms/btcusdt@bookTicker",
+            [&frames](std::string_view, std::uint64_t read_ns, std::uint64_t kernel_ns) {
+                frames.emplace_back(read_ns, kernel_ns);
+            }, options);
+        session.add_ca_file(data_file("standin_cert.pem"));
+        session.run();
+
+        // The first frames can come in with the handshake, before reads
+        // are stamped; the ones after a change are read on their own
+        REQUIRE(run_until(ioc, [&] { return frames.size() == 2; }));
+        book.set(Side::Sell, book.scale().price_near(99995.0), book.scale().qty_near(0.1));
+        sim.publish("BTCUSDT");
+        REQUIRE(run_until(ioc, [&] { return frames.size() == 4; }));
+        for (const auto& [read_ns, kernel_ns] : std::vector(frames.begin() + 2, frames.end())) {
+            if (!stamps) {
+                CHECK(kernel_ns == 0);
+                continue;
+            }
+            CHECK(kernel_ns > 0);
+            CHECK(kernel_ns <= read_ns);
+            CHECK(read_ns - kernel_ns < 1'000'000'000);
+        }
+        session.close();
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Test Support
+ * ------------
+ * Fixture helpers shared by the test files: paths into test/data and the
+ * temp directory, whole-file reads, synthetic depth5 frames and a bounded
+ * run of an io_context.
+ */
+
+/// A file under test/data.
+inline std::string data_file(std::string_view name)
+{
+    return std::string(TRIARB_TEST_DATA_DIR) + "/" + std::string(name);
+}
+
+/// A scratch file in the system temp directory, prefixed "triarb_".
+inline std::string temp_path(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() / ("triarb_" + name)).string();
+}
+
+inline std::string read_file(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+/// The non-empty lines of `path`.
+inline std::vector<std::string> read_lines(const std::string& path)
+{
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);)
+        if (!line.empty()) lines.push_back(line);
+    return lines;
+}
+
+/// Occurrences of `what` in `text`, overlapping ones included.
+inline std::size_t count(std::string_view text, std::string_view what)
+{
+    std::size_t n = 0;
+    for (auto at = text.find(what); at != std::string_view::npos; at = text.find(what, at + 1)) ++n;
+    return n;
+}
+
+/// Lines of the file at `path` that contain `what`.
+inline std::size_t count_lines(const std::string& path, std::string_view what)
+{
+    std::ifstream in(path);
+    std::size_t n = 0;
+    for (std::string line; std::getline(in, line);) n += line.find(what) != std::string::npos;
+    return n;
+}
+
+/// A combined-stream depth5 frame with one level per side, e.g.
+/// depth5("ethbtc@depth5@100ms", 7, "0.02100", "0.02110").
+inline std::string depth5(std::string_view stream, std::uint64_t id, std::string_view bid,
+                          std::string_view ask, std::string_view qty = "1.00000000")
+{
+    std::string f = R"({"stream":")";
+    f.append(stream).append(R"(","data":{"lastUpdateId":)").append(std::to_string(id));
+    f.append(R"(,"bids":[[")").append(bid).append(R"(",")").append(qty);
+    f.append(R"("]],"asks":[[")").append(ask).append(R"(",")").append(qty).append(R"("]]}})");
+    return f;
+}
+
+inline std::string depth5(std::string_view stream, std::string_view bid, std::string_view ask)
+{
+    return depth5(stream, 1, bid, ask);
+}
+
+/// Runs `ioc` one handler at a time until `done()` or `timeout`; returns
+/// done().
+template <class Pred>
+bool run_until(boost::asio::io_context& ioc, Pred done,
+               std::chrono::milliseconds timeout = std::chrono::seconds(10))
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!done() && std::chrono::steady_clock::now() < deadline)
+        ioc.run_one_for(std::chrono::milliseconds(10));
+    return done();
+}
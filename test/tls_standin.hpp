@@ -0,0 +1,149 @@
+#pragma once
+#include "test_support.hpp"
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* TLS Stand-In Server
+ * -------------------
+ * What every local stand-in for an exchange endpoint shares: a loopback
+ * acceptor on a free port, TLS with the self-signed pair in test/data, and
+ * the sessions accepted so far.  `make` builds the session for each
+ * accepted socket; the server starts it and keeps a weak reference, so
+ * for_each() and drop_all() reach the ones still open.  Session needs
+ * start() and close().
+ */
+template <class Session>
+class TlsServer
+{
+    public:
+        using Make = std::function<std::shared_ptr<Session>(boost::asio::ip::tcp::socket,
+                                                            boost::asio::ssl::context&)>;
+
+        TlsServer(boost::asio::io_context& ioc, Make make)
+            : ctx_(boost::asio::ssl::context::tlsv12_server)
+            , acceptor_(ioc, {boost::asio::ip::address_v4::loopback(), 0})
+            , make_(std::move(make))
+        {
+            ctx_.use_certificate_chain_file(data_file("standin_cert.pem"));
+            ctx_.use_private_key_file(data_file("standin_key.pem"), boost::asio::ssl::context::pem);
+            accept();
+        }
+
+        std::string port() const { return std::to_string(acceptor_.local_endpoint().port()); }
+
+        /// Connections accepted so far.
+        int connections() const { return connections_; }
+
+        /// Calls fn(session) for every session still alive.
+        template <class Fn>
+        void for_each(Fn&& fn) const
+        {
+            for (const auto& weak : sessions_)
+                if (auto s = weak.lock()) fn(*s);
+        }
+
+        /// Closes every connection from the server side.
+        void drop_all()
+        {
+            for_each([](Session& s) { s.close(); });
+        }
+
+    private:
+        void accept()
+        {
+            acceptor_.async_accept([this](boost::beast::error_code ec, boost::asio::ip::tcp::socket socket) {
+                if (ec) return;
+                ++connections_;
+                auto s = make_(std::move(socket), ctx_);
+                sessions_.push_back(s);
+                s->start();
+                accept();
+            });
+        }
+
+        boost::asio::ssl::context           ctx_;
+        boost::asio::ip::tcp::acceptor      acceptor_;
+        Make                                make_;
+        std::vector<std::weak_ptr<Session>> sessions_;
+        int                                 connections_ = 0;
+};
+
+/* WebSocket Stand-In Session
+ * --------------------------
+ * Server side of one WSS connection: TLS handshake, the HTTP upgrade
+ * request (kept in `request`), then the WebSocket accept.  write() queues
+ * a text frame; frames go out one at a time, in order.
+ *
+ * Derived (CRTP) provides on_open(), called once the WebSocket is up and
+ * usually the start of its read loop.  It may also provide on_upgrade(),
+ * called with `request` read and before the accept, to set stream
+ * options, and on_written(), called after each frame has gone out.
+ */
+template <class Derived>
+class WsStandInSession : public std::enable_shared_from_this<Derived>
+{
+    public:
+        WsStandInSession(boost::asio::ip::tcp::socket socket, boost::asio::ssl::context& ctx)
+            : stream(std::move(socket), ctx) {}
+
+        void start()
+        {
+            stream.next_layer().async_handshake(boost::asio::ssl::stream_base::server,
+                [self = this->shared_from_this()](boost::beast::error_code ec) {
+                    if (ec) return;
+                    boost::beast::http::async_read(self->stream.next_layer(), self->buffer, self->request,
+                        [self](boost::beast::error_code ec, std::size_t) {
+                            if (ec) return;
+                            self->on_upgrade();
+                            self->stream.async_accept(self->request, [self](boost::beast::error_code ec) {
+                                if (!ec) self->on_open();
+                            });
+                        });
+                });
+        }
+
+        void write(std::string text)
+        {
+            outbox_.push_back(std::move(text));
+            if (outbox_.size() > 1) return;
+            flush();
+        }
+
+        void close()
+        {
+            boost::beast::error_code ignored;
+            boost::beast::get_lowest_layer(stream).socket().close(ignored);
+        }
+
+        void on_upgrade() {}
+        void on_written() {}
+
+        boost::beast::websocket::stream<boost::beast::ssl_stream<boost::beast::tcp_stream>> stream;
+        boost::beast::flat_buffer                                                          buffer;
+        boost::beast::http::request<boost::beast::http::string_body>                       request;
+
+    private:
+        void flush()
+        {
+            stream.async_write(boost::asio::buffer(outbox_.front()),
+                [self = this->shared_from_this()](boost::beast::error_code ec, std::size_t) {
+                    if (ec) return;
+                    self->on_written();
+                    self->outbox_.pop_front();
+                    if (!self->outbox_.empty()) self->flush();
+                });
+        }
+
+        std::deque<std::string> outbox_;
+};
@@ -0,0 +1,124 @@
+#include "triangle_engine.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <algorithm>
+#include <string>
+
+using namespace triarb;
+
+TEST_CASE("exchangeInfo keeps trading symbols with their filters", "[triangle]") {
+    const auto symbols = load_exchange_info(std::string(TRIARB_TEST_DATA_DIR) + "/exchange_info.json");
+
+    REQUIRE(symbols.size() == 8);   // SOLBTC is in BREAK
+    REQUIRE(std::none_of(symbols.begin(), symbols.end(),
+        [](const SymbolInfo& s) { return s.symbol == "SOLBTC"; }));
+
+    auto ethbtc = std::find_if(symbols.begin(), symbols.end(),
+        [](const SymbolInfo& s) { return s.symbol == "ETHBTC"; });
+    REQUIRE(ethbtc != symbols.end());
+    REQUIRE(ethbtc->base == "ETH");
+    REQUIRE(ethbtc->quote == "BTC");
+    REQUIRE(ethbtc->tickSize == 0.00001);
+    REQUIRE(ethbtc->stepSize == 0.0001);
+    REQUIRE(ethbtc->minNotional == 0.0001);
+}
+
+TEST_CASE("Default universe yields both directions of one triangle", "[triangle]") {
+    TriangleEngine engine(default_symbols(), "USDT");
+    REQUIRE(engine.triangles().size() == 2);
+
+    std::vector<std::string> paths;
+    for (const auto& t : engine.triangles()) {
+        REQUIRE(engine.anchored(t));
+        paths.push_back(engine.describe(t));
+    }
+    std::sort(paths.begin(), paths.end());
+    REQUIRE(paths[0] == "USDT->BTC->ETH->USDT");
+    REQUIRE(paths[1] == "USDT->ETH->BTC->USDT");
+
+    for (SymbolId id = 0; id < engine.symbol_count(); ++id)
+        REQUIRE(engine.triangles_for(id).size() == 2);
+}
+
+TEST_CASE("Triangles are enumerated from exchangeInfo with a symbol index", "[triangle]") {
+    TriangleEngine engine(
+        load_exchange_info(std::string(TRIARB_TEST_DATA_DIR) + "/exchange_info.json"), "USDT");
+
+    // {BTC,ETH,USDT} {BTC,BNB,USDT} {ETH,BNB,USDT} {BTC,ETH,BNB}, both directions
+    REQUIRE(engine.triangles().size() == 8);
+    const auto anchored = std::count_if(engine.triangles().begin(), engine.triangles().end(),
+        [&](const Triangle& t) { return engine.anchored(t); });
+    REQUIRE(anchored == 6);
+
+    REQUIRE(engine.triangles_for(*engine.find("XRPUSDT")).empty());
+    REQUIRE(engine.triangles_for(*engine.find("SOLUSDT")).empty());
+    REQUIRE(engine.triangles_for(*engine.find("BTCUSDT")).size() == 4);
+    REQUIRE(engine.triangles_for(*engine.find("ETHBTC")).size() == 4);
+
+    // Every indexed triangle trades the symbol it is indexed under, and every
+    // cycle returns to its start asset.
+    for (SymbolId id = 0; id < engine.symbol_count(); ++id) {
+        for (auto t : engine.triangles_for(id)) {
+            const auto& legs = engine.triangles()[t].legs;
+            REQUIRE(std::any_of(legs.begin(), legs.end(),
+                [&](const TriangleLeg& l) { return l.symbol == id; }));
+        }
+    }
+    for (const auto& t : engine.triangles()) {
+        const auto path = engine.describe(t);
+        REQUIRE(path.substr(0, path.find("->")) == path.substr(path.rfind("->") + 2));
+    }
+
+    REQUIRE(engine.find_stream("bnbeth@depth5@100ms") == engine.find("BNBETH"));
+    REQUIRE_FALSE(engine.find_stream("dogeusdt@depth5@100ms"));
+}
+
+TEST_CASE("Triangle edge applies taker then maker fees", "[triangle]") {
+    FeeSchedule fees{-0.0001, 0.0004};
+    TriangleEngine engine(default_symbols(), "USDT", fees);
+
+    engine.book(*engine.find("ETHUSDT")).update(1, Quote{2494.56, 1.0}, Quote{2494.57, 1.0});
+    engine.book(*engine.find("ETHBTC")).update(1, Quote{0.02391, 1.0}, Quote{0.02392, 1.0});
+    engine.book(*engine.find("BTCUSDT")).update(1, Quote{104312.01, 1.0}, Quote{104312.02, 1.0});
+
+    for (const auto& t : engine.triangles()) {
+        const double edge = engine.edge(t);
+        if (engine.describe(t) == "USDT->ETH->BTC->USDT") {
+            const double expected = (1.0 - fees.taker) / 2494.57
+                                  * 0.02391 * (1.0 - fees.maker)
+                                  * 104312.01 * (1.0 - fees.maker) - 1.0;
+            REQUIRE(edge == Catch::Approx(expected).epsilon(1e-12));
+        } else {
+            const double expected = (1.0 - fees.taker) / 104312.02
+                                  * (1.0 - fees.maker) / 0.02392
+                                  * 2494.56 * (1.0 - fees.maker) - 1.0;
+            REQUIRE(edge == Catch::Approx(expected).epsilon(1e-12));
+        }
+    }
+
+    TriangleEngine empty(default_symbols(), "USDT");
+    REQUIRE(empty.edge(empty.triangles().front()) == -1.0);
+}
+
+TEST_CASE("Per-symbol triangle count stays flat as the universe grows", "[triangle]") {
+    // N alt coins, each listed against USDT, BTC and ETH.
+    auto universe = [](int alts) {
+        auto symbols = default_symbols();
+        for (int i = 0; i < alts; ++i) {
+            const std::string alt = "ALT" + std::to_string(i);
+            symbols.push_back({alt + "USDT", alt, "USDT", 0.0001, 0.1, 5.0});
+            symbols.push_back({alt + "BTC",  alt, "BTC",  1e-8,   0.1, 0.0001});
+            symbols.push_back({alt + "ETH",  alt, "ETH",  1e-8,   0.1, 0.001});
+        }
+        return symbols;
+    };
+
+    TriangleEngine small(universe(10), "USDT");
+    TriangleEngine large(universe(1000), "USDT");
+    REQUIRE(large.symbol_count() == 3003);
+
+    // ALT5USDT sits in {ALT5,USDT,BTC} and {ALT5,USDT,ETH}, both directions.
+    REQUIRE(small.triangles_for(*small.find("ALT5USDT")).size() == 4);
+    REQUIRE(large.triangles_for(*large.find("ALT5USDT")).size() == 4);
+    REQUIRE(large.triangles_for(*large.find("ALT5BTC")).size() == 4);
+}
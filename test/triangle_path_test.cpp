@@ -0,0 +1,104 @@
+#include "triangle_engine.hpp"
+#include "symbol_table.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <array>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+using namespace triarb;
+
+namespace {
+
+void seed_books(TriangleEngine& engine)
+{
+    engine.book(*engine.find("ETHUSDT")).update(1, Quote{2494.56, 1.0}, Quote{2494.57, 1.0});
+    engine.book(*engine.find("ETHBTC")).update(1, Quote{0.02391, 1.0}, Quote{0.02392, 1.0});
+    engine.book(*engine.find("BTCUSDT")).update(1, Quote{104312.01, 1.0}, Quote{104312.02, 1.0});
+}
+
+} // namespace
+
+TEST_CASE("SymbolTable resolves symbols and stream names by packed key", "[path]") {
+    SymbolTable table;
+    const std::vector<std::string> names{"BTCUSDT", "ETHBTC", "ETHUSDT", "1000SATSFDUSD",
+                                         "BNBETH", "ABCDEFGHIJKLMNOPQRSTUVWX"};
+    for (SymbolId id = 0; id < names.size(); ++id) table.insert(names[id], id);
+    REQUIRE(table.size() == names.size());
+
+    for (SymbolId id = 0; id < names.size(); ++id) REQUIRE(table.find(names[id]) == id);
+    REQUIRE(table.find("ethbtc") == 1u);
+    REQUIRE(table.find_stream("ethusdt@depth5@100ms") == 2u);
+    REQUIRE(table.find_stream("1000satsfdusd@depth@100ms") == 3u);
+    REQUIRE_FALSE(table.find("ETHBT"));
+    REQUIRE_FALSE(table.find("ETHBTCX"));
+    REQUIRE_FALSE(table.find(""));
+    REQUIRE_FALSE(table.find_stream("dogeusdt@depth5@100ms"));
+
+    REQUIRE_THROWS_AS(table.insert("ethbtc", 9), std::invalid_argument);
+    REQUIRE_THROWS_AS(table.insert("ABCDEFGHIJKLMNOPQRSTUVWXY", 9), std::invalid_argument);
+
+    // Many entries force the table to grow and rehash.
+    SymbolTable big;
+    for (SymbolId id = 0; id < 5000; ++id) big.insert("ALT" + std::to_string(id) + "USDT", id);
+    for (SymbolId id = 0; id < 5000; id += 97)
+        REQUIRE(big.find_stream("alt" + std::to_string(id) + "usdt@depth@100ms") == id);
+}
+
+TEST_CASE("Per-tick dispatch: string routing vs integer ids", "[.][benchmark][path]") {
+    const FeeSchedule fees;
+    TriangleEngine engine(default_symbols(), "USDT", fees);
+    seed_books(engine);
+
+    // Previous hot path: a string-keyed map from the stream prefix and a
+    // generic edge loop branching on each leg's side.
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const noexcept
+        {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+    std::unordered_map<std::string, SymbolId, StringHash, std::equal_to<>> by_name{
+        {"btcusdt", *engine.find("BTCUSDT")},
+        {"ethbtc",  *engine.find("ETHBTC")},
+        {"ethusdt", *engine.find("ETHUSDT")}};
+    auto generic_edge = [&](const Triangle& t) {
+        double rate = 1.0;
+        for (std::size_t i = 0; i < 3; ++i) {
+            const auto top = engine.book(t.legs[i].symbol).top();
+            const double keep = 1.0 - (i == 0 ? fees.taker : fees.maker);
+            if (t.legs[i].side == Side::Buy) {
+                if (top.ask.px <= 0) return -1.0;
+                rate *= keep / top.ask.px;
+            } else {
+                if (top.bid.px <= 0) return -1.0;
+                rate *= keep * top.bid.px;
+            }
+        }
+        return rate - 1.0;
+    };
+
+    // Rotate through the subscribed streams as a live feed would.
+    const std::array<std::string_view, 3> streams{
+        "ethbtc@depth5@100ms", "btcusdt@depth5@100ms", "ethusdt@depth5@100ms"};
+    std::size_t tick = 0;
+
+    BENCHMARK("before: string map + generic edge") {
+        const auto stream = streams[tick++ % streams.size()];
+        auto it = by_name.find(stream.substr(0, stream.find('@')));
+        double best = -1.0;
+        for (auto t : engine.triangles_for(it->second))
+            best = std::max(best, generic_edge(engine.triangles()[t]));
+        return best;
+    };
+
+    BENCHMARK("after: packed ids + shape kernels") {
+        const auto id = engine.find_stream(streams[tick++ % streams.size()]);
+        double best = -1.0;
+        for (auto t : engine.triangles_for(*id))
+            best = std::max(best, engine.edge(engine.triangles()[t]));
+        return best;
+    };
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "gateway.hpp"
+#include "tls_standin.hpp"
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+/* WebSocket API Stand-In
+ * ----------------------
+ * Local WSS server in place of the WebSocket API.  By default it checks
+ * each order.place signature against the secret "secret" and fills the
+ * order completely at its limit price.  `handler` can answer differently,
+ * or return nullopt to drop the connection unanswered.  With `batch` set,
+ * replies are held until that many are due and then sent newest first,
+ * as responses to concurrent orders may come back in any order.  Runs on
+ * the io_context passed in, which may be the test's or one on a thread of
+ * its own.
+ */
+class WsApiStandIn
+{
+    public:
+        using Handler = std::function<std::optional<nlohmann::json>(const nlohmann::json&)>;
+
+        explicit WsApiStandIn(boost::asio::io_context& ioc)
+            : server_(ioc, [this](boost::asio::ip::tcp::socket socket,
+                                  boost::asio::ssl::context& ctx) {
+                  return std::make_shared<Session>(*this, std::move(socket), ctx);
+              })
+        {}
+
+        std::string port() const { return server_.port(); }
+        int connections() const { return server_.connections(); }
+
+        /// Closes every connection from the server side.
+        void drop_all() { server_.drop_all(); }
+
+        static std::optional<nlohmann::json> fill_order(const nlohmann::json& req)
+        {
+            const auto& params = req.at("params");
+            std::string payload;
+            for (const auto& [key, value] : params.items()) {   // sorted by key
+                if (key == "signature") continue;
+                if (!payload.empty()) payload += '&';
+                payload += key + "=" + (value.is_string() ? value.get<std::string>() : value.dump());
+            }
+            if (req.value("method", "") != "order.place" ||
+                params.value("signature", "") != hmac_sha256("secret", payload))
+                return nlohmann::json{{"id", req["id"]}, {"status", 400},
+                                      {"error", {{"code", -1022},
+                                                 {"msg", "Signature for this request is not valid."}}}};
+
+            const auto qty   = params.at("quantity").get<std::string>();
+            const auto price = params.at("price").get<std::string>();
+            return nlohmann::json{{"id", req["id"]}, {"status", 200},
+                                  {"result", {{"symbol", params["symbol"]}, {"status", "FILLED"},
+                                              {"executedQty", qty},
+                                              {"cummulativeQuoteQty",
+                                               std::to_string(std::stod(qty) * std::stod(price))}}}};
+        }
+
+        int         requests = 0;
+        std::size_t batch    = 0;
+        Handler     handler  = fill_order;
+
+    private:
+        struct Session : WsStandInSession<Session> {
+            Session(WsApiStandIn& owner, boost::asio::ip::tcp::socket socket,
+                    boost::asio::ssl::context& ctx)
+                : WsStandInSession(std::move(socket), ctx), owner(owner) {}
+
+            void on_open() { read(); }
+            void read()
+            {
+                stream.async_read(buffer, [self = shared_from_this()](boost::beast::error_code ec,
+                                                                      std::size_t) {
+                    if (ec) return;
+                    ++self->owner.requests;
+                    const auto req =
+                        nlohmann::json::parse(boost::beast::buffers_to_string(self->buffer.data()));
+                    self->buffer.consume(self->buffer.size());
+                    auto answer = self->owner.handler(req);
+                    if (!answer) return self->close();
+                    self->held.push_front(answer->dump());
+                    if (self->held.size() >= self->owner.batch) {
+                        for (auto& r : self->held) self->write(std::move(r));
+                        self->held.clear();
+                    }
+                    self->read();
+                });
+            }
+
+            WsApiStandIn&           owner;
+            std::deque<std::string> held;
+        };
+
+        TlsServer<Session> server_;
+};